@@ -0,0 +1,51 @@
+//------------------------------
+// Boot graph
+//
+// init stages with declared dependencies, every stage runs in its own
+// short-lived task as soon as its dependencies are done; start and end
+// of each stage are recorded (esp_timer, usec since power on)
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define BOOT_STAGES_MAX 12
+#define BOOT_STAGE_STACK 6144
+
+//stage result
+#define BOOT_RESULT_PENDING 0
+#define BOOT_RESULT_OK 1
+#define BOOT_RESULT_FAILED 2
+#define BOOT_RESULT_SKIPPED 3               //a dependency failed
+
+#define BOOT_DEPENDS(Stage) (1 << (Stage))
+
+typedef bool (*BootStageFunc_t)(void);      //false = failed
+
+//stage declaration
+typedef struct
+{
+  const char *Name_pc;
+  uint16_t DependMask_u16;                  //BOOT_DEPENDS(stage index) | ...
+  BootStageFunc_t Run_pfn;
+} BootStage_t;
+
+//stage timing
+typedef struct
+{
+  uint32_t StartUs_u32;
+  uint32_t EndUs_u32;
+  uint8_t Core_u8;
+  uint8_t Result_u8;                        //BOOT_RESULT_xxx
+} BootTiming_t;
+
+void Boot_Run_v(const BootStage_t *Stage_past, uint8_t Count_u8);
+void Boot_Done_v(void);
+
+uint8_t Boot_StageCount_u8(void);
+const BootStage_t *Boot_Stage_pst(uint8_t Stage_u8);
+const BootTiming_t *Boot_Timing_pst(uint8_t Stage_u8);
+bool Boot_StageOk_b(uint8_t Stage_u8);
+
+uint32_t Boot_RunUs_u32(void);              //graph started
+uint32_t Boot_DoneUs_u32(void);             //setup finished
@@ -0,0 +1,110 @@
+//------------------------------
+// Device configuration
+//
+// persistent settings (/config.bin) and batch update via JSON:
+// streaming parser -> fixed size patch -> full validation -> atomic apply
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#include "TempSensors.h"
+#include "NtpClock.h"
+#include "Photoperiod.h"
+
+#define CONFIG_KEY_LEN_MAX 23
+#define CONFIG_VALUE_LEN_MAX 31
+
+//fields of a patch
+#define CONFIG_FIELD_TIME             (1 << 0)
+#define CONFIG_FIELD_THRESHOLD_DARK   (1 << 1)
+#define CONFIG_FIELD_THRESHOLD_BRIGHT (1 << 2)
+#define CONFIG_FIELD_LATITUDE         (1 << 3)
+#define CONFIG_FIELD_LONGITUDE        (1 << 4)
+#define CONFIG_FIELD_MANUAL_RAMP      (1 << 5)
+#define CONFIG_FIELD_SCHEDULE_MODE    (1 << 6)
+#define CONFIG_FIELD_MQTT_BROKER      (1 << 7)
+#define CONFIG_FIELD_MQTT_PORT        (1 << 8)
+#define CONFIG_FIELD_MQTT_INTERVAL    (1 << 9)
+#define CONFIG_FIELD_SENSOR_AIR       (1 << 10)
+#define CONFIG_FIELD_SENSOR_WATER     (1 << 11)
+#define CONFIG_FIELD_SENSOR_OUTDOOR   (1 << 12)
+#define CONFIG_FIELD_FLEET_ROLE       (1 << 13)
+#define CONFIG_FIELD_FLEET_STAGGER    (1 << 14)
+#define CONFIG_FIELD_NTP_SERVER_1     (1UL << 15)
+#define CONFIG_FIELD_NTP_SERVER_2     (1UL << 16)
+#define CONFIG_FIELD_NTP_SERVER_3     (1UL << 17)
+#define CONFIG_FIELD_NTP_SERVER_4     (1UL << 18)
+#define CONFIG_FIELD_PHOTOPERIOD      (1UL << 19)
+#define CONFIG_FIELD_PHOTOPERIOD_AM   (1UL << 20)
+#define CONFIG_FIELD_PHOTOPERIOD_DIM  (1UL << 21)
+#define CONFIG_FIELD_STRIP_WATTS      (1UL << 22)
+
+//persistent settings
+typedef struct
+{
+  uint8_t ThresholdDarkPercent_u8;
+  uint8_t ThresholdBrightPercent_u8;
+  float Latitude_f32;
+  float Longitude_f32;
+  uint16_t ManualRampSec_u16;       //ramp time of buttons and SW1
+  char MqttBroker_ac [CONFIG_VALUE_LEN_MAX + 1];    //host name or IP, empty = MQTT off
+  uint16_t MqttPort_u16;
+  uint16_t MqttIntervalMsec_u16;    //publishes are coalesced to this rate
+  char SensorRom_aac [TEMP_ROLE_COUNT] [TEMP_ROM_HEX_LEN + 1];    //ROM code per TEMP_ROLE_xxx, empty = none (air: first probe)
+  uint8_t FleetRole_u8;             //FLEET_ROLE_xxx
+  uint16_t FleetStaggerMsec_u16;    //follower: plans start this much after the leader
+  char NtpServer_aac [NTP_SERVER_COUNT] [NTP_SERVER_LEN_MAX + 1];   //"host[:port]", empty = unused
+  PhotoperiodSetting_t Photoperiod_st;                              //table mode: target day length
+  float StripWatts_f32;             //energy meter: power of one zone at full level, 0 = unknown
+} DeviceConfig_t;
+
+//date and time as set by the user
+typedef struct
+{
+  uint16_t Year_u16;
+  uint8_t Month_u8;
+  uint8_t Day_u8;
+  uint8_t Hour_u8;
+  uint8_t Minute_u8;
+  uint8_t Second_u8;
+} ConfigDateTime_t;
+
+//subset of settings sent in one request
+typedef struct
+{
+  uint32_t Present_u32;             //CONFIG_FIELD_xxx
+  ConfigDateTime_t DateTime_st;
+  DeviceConfig_t Config_st;         //only the fields in Present_u32 are set
+  uint8_t ScheduleMode_u8;
+} ConfigPatch_t;
+
+//streaming parser state (one per request, no heap besides the object itself)
+typedef struct
+{
+  uint8_t State_u8;
+  bool ValueIsString_b;
+  uint8_t KeyLen_u8;
+  uint8_t ValueLen_u8;
+  char Key_ac [CONFIG_KEY_LEN_MAX + 1];
+  char Value_ac [CONFIG_VALUE_LEN_MAX + 1];
+  char ErrorField_ac [CONFIG_KEY_LEN_MAX + 1];
+  const char *Error_pc;
+  ConfigPatch_t Patch_st;
+} ConfigParser_t;
+
+extern DeviceConfig_t Config_st;
+
+void Config_Init_v(void);
+void Config_Save_v(void);
+void Config_Copy_v(DeviceConfig_t *Config_pst);   //consistent copy for other tasks
+
+void Config_ParserInit_v(ConfigParser_t *Parser_pst);
+void Config_ParserFeed_v(ConfigParser_t *Parser_pst, const uint8_t *Data_pu8, size_t Len_u32);
+bool Config_ParserFinish_b(ConfigParser_t *Parser_pst);
+
+bool Config_Validate_b(ConfigParser_t *Parser_pst);
+void Config_Apply_v(const ConfigPatch_t *Patch_pst);
+
+bool Config_ParseDateTime_b(const char *Text_pc, ConfigDateTime_t *DateTime_pst);
+void Config_PrintJson_v(Print &Out, const char *DateTime_pc);
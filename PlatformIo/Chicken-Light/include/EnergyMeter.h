@@ -0,0 +1,45 @@
+//------------------------------
+// Energy meter
+//
+// LED energy and on-time, integrated on every output change of a zone
+// (today, this month, lifetime) plus on-hours per zone for maintenance;
+// counters are kept in RTC memory and written to /energy.bin and
+// /energy_b.bin in turn, rarely
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#include "LightZones.h"
+
+#define ENERGY_WATTS_MAX 200                //strip power of one zone at full level
+#define ENERGY_SAVE_SEC 21600               //flash write while the light was on (and at midnight)
+
+//counters of one period
+typedef struct
+{
+  uint32_t Key_u32;                         //day: YYYYMMDD, month: YYYYMM, lifetime: first day, 0 = none
+  uint32_t OnSec_u32;                       //any zone on
+  uint64_t MilliWh_u64;
+} EnergyPeriod_t;
+
+typedef struct
+{
+  EnergyPeriod_t Day_st;
+  EnergyPeriod_t PrevDay_st;
+  EnergyPeriod_t Month_st;
+  EnergyPeriod_t PrevMonth_st;
+  EnergyPeriod_t Lifetime_st;
+  uint32_t ZoneOnSec_au32 [ZONE_COUNT_MAX];       //since last reset (strip replaced)
+} EnergyCounters_t;
+
+void EnergyMeter_Init_v(float StripWatts_f32);    //SPIFFS must be mounted
+void EnergyMeter_SetWatts_v(float StripWatts_f32);
+
+void EnergyMeter_Output_v(uint8_t Zone_u8, uint16_t Level_u16);   //from the zone output hook
+void EnergyMeter_Tick_v(uint32_t DateKey_u32);    //periodic: new day / month, retained copy, save
+
+void EnergyMeter_ResetZones_v(uint8_t ZoneMask_u8);
+void EnergyMeter_Get_v(EnergyCounters_t *Counters_pst);          //integrated up to now
+float EnergyMeter_PowerW_f32(void);
+void EnergyMeter_PrintJson_v(Print &Out);
@@ -0,0 +1,88 @@
+//------------------------------
+// Fleet synchronization
+//
+// several boards (one per coop) on one network: a leader multicasts its
+// clock and the schedule plan of its AUTO zones, followers discipline
+// their clock to it and start the same plan at the same instant, each
+// delayed by its own stagger (inrush on a shared supply)
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#include "LightZones.h"
+
+#define FLEET_PORT 4210
+#define FLEET_GROUP_IP 239, 255, 42, 10       //administratively scoped multicast
+#define FLEET_MAGIC 0x4C43                    //"CL"
+#define FLEET_VERSION 1
+
+#define FLEET_POLL_MSEC 20
+#define FLEET_SYNC_MSEC 1000                  //leader: clock packet
+#define FLEET_PLAN_REPEAT_MSEC 5000           //leader: current plan again (late joiners, lost packets)
+#define FLEET_LEADER_TIMEOUT_MSEC 5000        //follower: back to own schedule without clock packets
+#define FLEET_OFFSET_SAMPLES 8                //clock offset: least delayed of the last samples
+#define FLEET_STEP_MSEC 1000                  //leader clock jumped (RTC set): restart estimate
+#define FLEET_RTC_TOLERANCE_SEC 2             //follower: set RTC beyond this difference
+
+//roles
+#define FLEET_ROLE_OFF 0
+#define FLEET_ROLE_LEADER 1
+#define FLEET_ROLE_FOLLOWER 2
+
+//packet types
+#define FLEET_MSG_SYNC 1
+#define FLEET_MSG_PLAN 2
+
+//packets: little endian, header 8 bytes
+typedef struct __attribute__((packed))
+{
+  uint16_t Magic_u16;                         //FLEET_MAGIC
+  uint8_t Version_u8;
+  uint8_t Type_u8;                            //FLEET_MSG_xxx
+  uint32_t Node_u32;                          //sender
+} FleetHeader_t;
+
+//clock: 20 bytes
+typedef struct __attribute__((packed))
+{
+  FleetHeader_t Header_st;
+  uint32_t Seq_u32;
+  uint32_t UnixSec_u32;                       //leader clock at sending
+  uint16_t Msec_u16;
+  uint8_t Plan_u8;                            //generation of the current plan, 0 = none
+  uint8_t Reserved_u8;
+} FleetClock_t;
+
+//plan: 16 bytes + 5 per keyframe (only Count_u8 are sent)
+typedef struct __attribute__((packed))
+{
+  FleetHeader_t Header_st;
+  uint8_t Generation_u8;                      //1...255
+  uint8_t Count_u8;
+  uint16_t StartMsec_u16;
+  uint32_t StartSec_u32;                      //leader clock at keyframe time 0
+  LightKeyframe_t Keyframe_ast [ZONE_KEYFRAMES_MAX];
+} FleetPlan_t;
+
+#define FLEET_PLAN_HEADER_LEN offsetof(FleetPlan_t, Keyframe_ast)
+
+//follower: run plan on the AUTO zones, OffsetMsec_u32 > 0 joins a plan in progress
+typedef void (*FleetPlanHook_t)(const LightKeyframe_t *Keyframe_past, uint8_t Count_u8, uint32_t OffsetMsec_u32);
+
+typedef struct
+{
+  uint32_t Node_u32;                          //unique per board (MAC)
+  uint32_t (*UnixTime_pfn)(void);             //local RTC
+  void (*SetTime_pfn)(uint32_t Unix_u32);     //follower: RTC discipline
+  FleetPlanHook_t Plan_pfn;
+} FleetHooks_t;
+
+void Fleet_Start_v(const FleetHooks_t *Hooks_pst);
+
+void Fleet_Publish_v(const LightKeyframe_t *Keyframe_past, uint8_t Count_u8);   //leader: plan started now (any task)
+bool Fleet_Following_b(void);                 //follower with a leader: own schedule is suspended
+uint8_t Fleet_RoleFromName_u8(const char *Name_pc);   //"off", "leader", "follower" or 0xFF
+const char *Fleet_RoleName_pc(uint8_t Role_u8);
+
+void Fleet_PrintJson_v(Print &Out);
@@ -0,0 +1,41 @@
+//------------------------------
+// I2C bus
+//
+// all transactions on the bus (DS3231) are serialized by one mutex with
+// priority inheritance and timed; time and temperature of the DS3231 are
+// read in one burst and cached while the seconds cannot have changed
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#include "RTClib.h"
+
+#define I2C_CLOCK_HZ 400000               //fast mode, supported by the DS3231
+#define I2C_RTC_ADDRESS 0x68
+#define I2C_RTC_CACHE_MARGIN_MSEC 50      //ESP clock vs. RTC (light sleep runs on the drifting slow clock)
+
+//transaction types (statistics)
+#define I2C_OP_RTC_READ 0                 //burst: time + temperature
+#define I2C_OP_RTC_WRITE 1                //set time
+#define I2C_OP_RTC_ALARM 2                //alarms, SQW output
+#define I2C_OP_OTHER 3                    //probe, status
+#define I2C_OP_COUNT 4
+
+typedef struct
+{
+  DateTime Time;
+  float Temperature_f32;                  //DS3231 die temperature [degC], updated every 64 s
+} RtcSnapshot_t;
+
+bool I2cBus_Init_b(uint8_t Sda_u8, uint8_t Scl_u8, uint32_t ClockHz_u32);
+
+//exclusive access for library calls (not recursive)
+void I2cBus_Lock_v(uint8_t Op_u8);
+void I2cBus_Unlock_v(void);
+
+bool I2cBus_RtcRead_b(RtcSnapshot_t *Snapshot_pst);    //false: bus error, last snapshot returned
+DateTime I2cBus_RtcNow(void);
+void I2cBus_RtcAdjust_v(const DateTime &Time);
+
+void I2cBus_PrintJson_v(Print &Out);
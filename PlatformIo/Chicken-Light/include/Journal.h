@@ -0,0 +1,84 @@
+//------------------------------
+// Event journal
+//
+// append-only log of state transitions, manual and web commands,
+// time adjustments and reboots in fixed-size records on flash
+// (decoder: tools/journal_decode.py)
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define JOURNAL_SEGMENTS 8
+#define JOURNAL_SEGMENT_RECORDS 256         //incl. header record, 4 KB per segment file
+#define JOURNAL_INDEX_STRIDE 32             //one index entry per 32 records
+#define JOURNAL_EXPORT_BATCH 16             //records read per file access during export
+
+//event types (keep in sync with tools/journal_decode.py)
+#define JOURNAL_EVENT_SEGMENT 0             //header record of a segment file, Value = segment number
+#define JOURNAL_EVENT_BOOT 1                //Arg = reset reason
+#define JOURNAL_EVENT_STATE 2               //Arg = new light control state, Value = old state
+#define JOURNAL_EVENT_SWITCH 3              //Arg = 1 on, 0 off
+#define JOURNAL_EVENT_COMMAND 4             //Arg = JOURNAL_CMD_xxx, Value = parameter
+#define JOURNAL_EVENT_TIME_SET 5            //Value = new time - old time [s] (signed)
+#define JOURNAL_EVENT_SCHEDULE 6            //Arg = level percent, Value = zone mask
+#define JOURNAL_EVENT_SUPERVISOR 7          //Arg = supervisor slot, Value = escalation level
+
+//event sources
+#define JOURNAL_SRC_SYSTEM 0
+#define JOURNAL_SRC_SWITCH 1
+#define JOURNAL_SRC_WEB 2
+#define JOURNAL_SRC_CONTROL 3               //light control task
+#define JOURNAL_SRC_NTP 4
+#define JOURNAL_SRC_MQTT 5
+#define JOURNAL_SRC_FLEET 6                 //fleet leader (plan, clock)
+
+//web / API commands
+#define JOURNAL_CMD_LIGHT_ON 1
+#define JOURNAL_CMD_LIGHT_OFF 2
+#define JOURNAL_CMD_CONTROL_ON 3
+#define JOURNAL_CMD_CONTROL_OFF 4
+#define JOURNAL_CMD_ZONE 5                  //Value = zone << 16 | level percent
+#define JOURNAL_CMD_CONFIG 6                //Value = changed CONFIG_FIELD_xxx
+#define JOURNAL_CMD_RULES 7
+#define JOURNAL_CMD_SCHEDULE_MODE 8         //Value = SCHEDULE_MODE_xxx
+#define JOURNAL_CMD_LIGHT_LEVEL 9           //Value = level percent << 24 | ramp time [s]
+
+//record: 16 bytes, little endian
+typedef struct __attribute__((packed))
+{
+  uint32_t Time_u32;                        //unix time
+  uint8_t Type_u8;                          //JOURNAL_EVENT_xxx
+  uint8_t Source_u8;                        //JOURNAL_SRC_xxx
+  uint16_t Arg_u16;
+  uint32_t Value_u32;
+  uint16_t Boot_u16;                        //boot counter
+  uint8_t Reserved_u8;
+  uint8_t Check_u8;                         //XOR of bytes 0...14 ^ 0xA5
+} JournalRecord_t;
+
+typedef uint32_t (*JournalClock_t)(void);
+typedef void (*JournalHook_t)(const JournalRecord_t *Record_pst);   //called for every record, must not block
+
+//state of one streamed export
+typedef struct
+{
+  uint32_t From_u32;
+  uint32_t To_u32;
+  uint32_t SegmentNo_au32 [JOURNAL_SEGMENTS];  //segments in order at start (0 = oldest), 0 = unused
+  uint8_t Segment_u8;                       //position in SegmentNo_au32
+  uint16_t Record_u16;                      //next record in segment
+  uint8_t Offset_u8;                        //bytes of Record_st already sent
+  bool Pending_b;
+  JournalRecord_t Record_st;
+  uint8_t BatchCount_u8;
+  uint8_t BatchPos_u8;
+  JournalRecord_t Batch_ast [JOURNAL_EXPORT_BATCH];
+} JournalExport_t;
+
+void Journal_Init_v(JournalClock_t Clock_pfn);
+void Journal_Log_v(uint8_t Type_u8, uint8_t Source_u8, uint16_t Arg_u16, uint32_t Value_u32);
+void Journal_SetHook_v(JournalHook_t Hook_pfn);
+
+void Journal_ExportInit_v(JournalExport_t *Export_pst, uint32_t From_u32, uint32_t To_u32);
+size_t Journal_ExportFill_u32(JournalExport_t *Export_pst, uint8_t *Buf_pu8, size_t MaxLen_u32);
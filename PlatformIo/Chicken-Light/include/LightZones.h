@@ -0,0 +1,107 @@
+//------------------------------
+// Light zones
+//
+// up to 8 independent LEDC channels (roost, nest boxes, run, ...),
+// one dimming engine task updates all ramping zones in one pass;
+// a zone follows either a linear ramp or a keyframe program
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define ZONE_COUNT_MAX 8
+#define ZONE_MASK_ALL 0xFF
+
+#define ZONE_LEVEL_MAX 0xFFFF         //full scale, independent of PWM resolution
+
+//schedule reference of a zone
+#define ZONE_SCHEDULE_AUTO 0          //light control task (table or rules)
+#define ZONE_SCHEDULE_MANUAL 0xFF     //web / API only
+
+#define ZONE_ENGINE_TICK_MSEC 20
+#define ZONE_OUTPUT_LOCK_MSEC 500     //LightZone_Set_v writes anyway after this (zone task stalled)
+
+//temporal dithering of the lowest LEDC codes (LightZone_SetDither_v)
+#define ZONE_DITHER_HZ 2500           //sigma-delta update rate (limited to the PWM frequency)
+#define ZONE_DITHER_CODE_MAX 256      //LEDC codes below are dithered, above steps are < 0.4 %
+
+#define ZONE_KEYFRAMES_MAX 8
+
+//easing curve of the segment ending at a keyframe
+#define ZONE_EASE_LINEAR 0
+#define ZONE_EASE_STEP 1              //keep previous level, jump at keyframe time
+#define ZONE_EASE_SMOOTH 2            //smoothstep, soft start and end
+#define ZONE_EASE_EXP_IN 3            //exponential, slow start (perceived linear when rising)
+#define ZONE_EASE_EXP_OUT 4           //mirrored, slow end (perceived linear when falling)
+#define ZONE_EASE_COUNT 5
+#define ZONE_EASE_NONE 0xFF           //unknown curve name
+
+//keyframe: 5 bytes
+typedef struct __attribute__((packed))
+{
+  uint16_t TimeSec_u16;                            //offset to program start, ascending
+  uint16_t Level_u16;                              //0...ZONE_LEVEL_MAX
+  uint8_t Ease_u8;                                 //ZONE_EASE_xxx (ignored for first keyframe)
+} LightKeyframe_t;
+
+//light program (first keyframe = start level)
+typedef struct
+{
+  uint8_t Count_u8;
+  LightKeyframe_t Keyframe_ast [ZONE_KEYFRAMES_MAX];
+} LightProgram_t;
+
+//zone table, struct of arrays: 19 bytes per zone
+typedef struct
+{
+  uint8_t Count_u8;
+  uint8_t RampingMask_u8;                          //bit n set while zone n is ramping (ramp or program)
+  uint8_t ProgramMask_u8;                          //bit n set while zone n runs a program
+
+  uint8_t Pin_au8 [ZONE_COUNT_MAX];                //GPIO
+  uint8_t Channel_au8 [ZONE_COUNT_MAX];            //LEDC channel
+  uint8_t Schedule_au8 [ZONE_COUNT_MAX];           //ZONE_SCHEDULE_xxx
+  uint16_t Level_au16 [ZONE_COUNT_MAX];            //current level 0...ZONE_LEVEL_MAX
+  uint16_t Target_au16 [ZONE_COUNT_MAX];           //level at end of ramp
+  uint16_t Start_au16 [ZONE_COUNT_MAX];            //level at start of ramp
+  uint32_t RampStartMsec_au32 [ZONE_COUNT_MAX];
+  uint32_t RampTimeMsec_au32 [ZONE_COUNT_MAX];
+  uint8_t Ease_au8 [ZONE_COUNT_MAX];               //ramp: ZONE_EASE_xxx
+  uint8_t Cursor_au8 [ZONE_COUNT_MAX];             //program: current segment (keyframe index)
+} ZoneTable_t;
+
+//called from engine / caller context whenever the output level of a zone changed
+typedef void (*LightZoneOutputHook_t)(uint8_t Zone_u8, uint16_t Level_u16);
+
+extern ZoneTable_t ZoneTable_st;
+
+void LightZone_Init_v(const uint8_t *Pin_pu8, const uint8_t *Schedule_pu8, uint8_t Count_u8,
+                      uint32_t PwmFreqHz_u32, uint8_t PwmResolutionBit_u8, LightZoneOutputHook_t Hook_pfn);
+
+void LightZone_Set_v(uint8_t ZoneMask_u8, uint16_t Level_u16);
+void LightZone_StartRamp_v(uint8_t ZoneMask_u8, uint16_t Target_u16, uint32_t RampTimeMsec_u32);
+void LightZone_StartFade_v(uint8_t ZoneMask_u8, uint16_t Target_u16, uint32_t RampTimeMsec_u32, uint8_t Ease_u8);
+void LightZone_StartProgram_v(uint8_t ZoneMask_u8, const LightKeyframe_t *Keyframe_past, uint8_t Count_u8, uint32_t OffsetMsec_u32);
+void LightZone_Stop_v(uint8_t ZoneMask_u8);
+
+void LightZone_Step_v(uint32_t Now_u32);          //one engine pass (engine task, host replay)
+
+void LightZone_SetDither_v(bool On_b);            //full 16 bit level in the bottom range
+uint8_t LightZone_DitherMask_u8(void);            //zones dithering now
+
+bool LightZone_IsRamping_b(uint8_t ZoneMask_u8);
+bool LightZone_IsMoving_b(uint8_t ZoneMask_u8);    //false in the hold of a program
+bool LightZone_AnyOn_b(void);
+
+void LightZone_Supervise_v(uint8_t Slot_u8);      //Supervisor slot for engine heartbeats
+void LightZone_Restart_v(void);
+
+uint8_t LightZone_Count_u8(void);
+uint8_t LightZone_ScheduleMask_u8(uint8_t Schedule_u8);
+uint16_t LightZone_GetLevel_u16(uint8_t Zone_u8);
+
+uint16_t LightZone_PercentToLevel_u16(uint8_t Percent_u8);
+uint8_t LightZone_LevelToPercent_u8(uint16_t Level_u16);
+
+uint8_t LightZone_EaseFromName_u8(const char *Name_pc);     //"linear", "smooth", ... or ZONE_EASE_NONE
+const char *LightZone_EaseName_pc(uint8_t Ease_u8);
@@ -0,0 +1,48 @@
+//------------------------------
+// MQTT bridge
+//
+// publishes status, single values and journal events to the broker of
+// the device configuration, coalesced to the configured rate; command
+// topics run the same command functions as the web buttons
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#include "Journal.h"
+#include "PageCache.h"
+#include "PageTemplate.h"
+
+#define MQTT_TOPIC_LEN_MAX 64
+#define MQTT_PAYLOAD_LEN_MAX 512          //client buffer: status JSON, event batch
+#define MQTT_VALUES_MAX 4
+#define MQTT_EVENT_QUEUE 16               //journal records between two publishes, oldest are dropped
+#define MQTT_EVENT_LEN_MAX 96             //one record as JSON
+#define MQTT_COMMAND_LEN_MAX 32
+#define MQTT_POLL_MSEC 100                //incoming commands
+#define MQTT_RECONNECT_MSEC 5000
+
+//<base>/<topic> = placeholder value of the web page (retained)
+typedef struct
+{
+  const char *Topic_pc;
+  uint8_t Var_u8;                         //PAGE_VAR_xxx
+} MqttValue_t;
+
+//<base>/cmd/<command> with payload, runs in the MQTT task; false = unknown command or payload
+typedef bool (*MqttCommand_t)(const char *Command_pc, const char *Payload_pc);
+
+typedef struct
+{
+  const char *Base_pc;                    //topic prefix and client id
+  PageCacheRender_t Status_pfn;           //<base>/status (retained)
+  PageVarResolver_t Value_pfn;
+  const MqttValue_t *Value_past;
+  uint8_t ValueCount_u8;
+  MqttCommand_t Command_pfn;
+} MqttBridge_t;
+
+void Mqtt_Start_v(const MqttBridge_t *Bridge_pst);
+
+void Mqtt_Event_v(const JournalRecord_t *Record_pst);   //journal hook (any task)
+bool Mqtt_Connected_b(void);
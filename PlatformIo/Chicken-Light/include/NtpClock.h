@@ -0,0 +1,57 @@
+//------------------------------
+// NTP clock
+//
+// time from up to NTP_SERVER_COUNT configured servers: several samples
+// per server and sync, clock filter per server, intersection of the
+// correctness intervals over all servers (falsetickers are outvoted),
+// health score per server with back-off and fresh DNS lookup on failure
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define NTP_SERVER_COUNT 4
+#define NTP_SERVER_LEN_MAX 31                 //"host" or "host:port"
+#define NTP_PORT 123
+#define NTP_LOCAL_PORT 1337
+
+#define NTP_POLL_MSEC 1                       //receive poll while a round is open (delay resolution)
+#define NTP_SAMPLES 4                         //requests per server and sync
+#define NTP_SAMPLE_GAP_MSEC 2000              //between rounds (public pool: no bursts)
+#define NTP_REPLY_TIMEOUT_MSEC 1000
+#define NTP_DNS_CACHE_SEC 3600                //resolved address is used this long (lwIP hides the TTL)
+#define NTP_DISTANCE_MAX_MSEC 1500            //server with a larger root distance is not a candidate
+
+//health score per server
+#define NTP_HEALTH_MAX 100
+#define NTP_HEALTH_START 50
+#define NTP_HEALTH_GOOD 20                    //+ truechimer
+#define NTP_HEALTH_TIMEOUT 25                 //- no valid reply in a sync
+#define NTP_HEALTH_FALSE 35                   //- falseticker
+#define NTP_BACKOFF_SYNCS 4                   //health 0 or kiss-o'-death: server skipped this many syncs
+
+//server states (last sync)
+#define NTP_STATE_IDLE 0
+#define NTP_STATE_UNRESOLVED 1
+#define NTP_STATE_TIMEOUT 2
+#define NTP_STATE_KISS 3                      //kiss-o'-death (rate limit, access denied)
+#define NTP_STATE_DISTANCE 4                  //root distance too large
+#define NTP_STATE_FALSETICKER 5
+#define NTP_STATE_TRUECHIMER 6
+#define NTP_STATE_BACKOFF 7
+#define NTP_STATE_DUPLICATE 8                 //same address as a server above (pool names)
+#define NTP_STATE_UNDECIDED 9                 //candidate, but no majority
+
+typedef struct
+{
+  void (*Active_pfn)(bool Active_b);                     //sync starts / ends (radio power save), may be NULL
+  void (*Result_pfn)(bool Ok_b, int64_t UnixUsec_s64);   //after every sync: UTC at the moment of the call
+} NtpHooks_t;
+
+void Ntp_Start_v(const NtpHooks_t *Hooks_pst);
+
+void Ntp_Request_v(void);                     //sync now (any task, result by hook)
+bool Ntp_Busy_b(void);                        //sync requested or running
+
+bool Ntp_ParseServer_b(const char *Text_pc, char *Host_pc, uint16_t *Port_pu16);   //"host[:port]", Host_pc >= NTP_SERVER_LEN_MAX + 1
+void Ntp_PrintJson_v(Print &Out);
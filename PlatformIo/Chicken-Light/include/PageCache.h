@@ -0,0 +1,26 @@
+//------------------------------
+// Page cache
+//
+// rendered pages (index.html, status JSON) kept in preallocated buffers,
+// valid until the state generation changes; ETag = generation,
+// unchanged refreshes are answered with 304
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+//cache entries
+#define PAGE_CACHE_INDEX 0
+#define PAGE_CACHE_STATUS 1
+#define PAGE_CACHE_ENTRIES 2
+
+//renders page into buffer, returns length (0 = does not fit)
+typedef size_t (*PageCacheRender_t)(char *Buf_pc, size_t Size_u32);
+
+bool PageCache_Init_b(uint8_t Entry_u8, size_t Size_u32, PageCacheRender_t Render_pfn);
+
+void PageCache_Bump_v(void);                  //state changed: all entries are stale
+uint32_t PageCache_Generation_u32(void);
+
+bool PageCache_Send_b(AsyncWebServerRequest *request, uint8_t Entry_u8, const char *Type_pc);
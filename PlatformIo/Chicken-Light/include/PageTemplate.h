@@ -0,0 +1,55 @@
+//------------------------------
+// Page template
+//
+// index.html is split once at boot into literal segments and placeholder
+// IDs; responses are streamed chunk by chunk from the segment table
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define PAGE_SEGMENTS_MAX 32
+#define PAGE_VALUE_LEN_MAX 31
+
+//placeholder IDs (%NAME% in index.html)
+#define PAGE_VAR_DATE_TIME 0
+#define PAGE_VAR_TEMP 1
+#define PAGE_VAR_LIGHT_DUTYCYCLE 2
+#define PAGE_VAR_STATE 3
+#define PAGE_VAR_SUNRISE 4
+#define PAGE_VAR_SUNSET 5
+#define PAGE_VAR_THRESHOLD_DARK 6
+#define PAGE_VAR_THRESHOLD_BRIGHT 7
+#define PAGE_VAR_VERSION 8
+#define PAGE_VAR_COUNT 9
+
+#define PAGE_VAR_LITERAL 0xFF
+
+//literal text (offset/length into template) or placeholder
+typedef struct
+{
+  uint16_t Offset_u16;
+  uint16_t Len_u16;
+  uint8_t Var_u8;                 //PAGE_VAR_xxx
+} PageSegment_t;
+
+//render position of one response
+typedef struct
+{
+  uint8_t Segment_u8;
+  uint16_t Offset_u16;            //within literal or value
+  uint8_t ValueLen_u8;
+  char Value_ac [PAGE_VALUE_LEN_MAX + 1];
+} PageRenderState_t;
+
+//writes value of placeholder into buffer, returns length
+typedef size_t (*PageVarResolver_t)(uint8_t Var_u8, char *Buf_pc, size_t Size_u32);
+
+bool PageTemplate_Load_b(const char *Path_pc, PageVarResolver_t Resolver_pfn);
+bool PageTemplate_Loaded_b(void);
+
+void PageTemplate_RenderInit_v(PageRenderState_t *State_pst);
+size_t PageTemplate_Fill_u32(PageRenderState_t *State_pst, uint8_t *Buf_pu8, size_t MaxLen_u32);
+
+size_t PageTemplate_Render_u32(char *Buf_pc, size_t Size_u32);
+size_t PageTemplate_RenderLenMax_u32(void);
@@ -0,0 +1,42 @@
+//------------------------------
+// Photoperiod
+//
+// supplementary light windows of one day: a target day length split into
+// a window before sunrise and one after sunset, or the dim and hold times
+// of the sunrise / sunset table (target 0)
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define PHOTOPERIOD_TABLE 0               //target: dim and hold times of the table
+#define PHOTOPERIOD_MIN_MAX 1440
+#define PHOTOPERIOD_DIM_MIN_MAX 240
+#define PHOTOPERIOD_MINUTES_PER_DAY 1440
+
+typedef struct
+{
+  uint16_t TargetMin_u16;                 //light per day incl. natural daylight, PHOTOPERIOD_TABLE = table
+  uint8_t MorningPercent_u8;              //share of the supplement before sunrise, rest after sunset
+  uint8_t DimMin_u8;                      //ramp at the dark end of each window (part of the window)
+} PhotoperiodSetting_t;
+
+//windows of one day, minutes of day
+typedef struct
+{
+  uint32_t DateKey_u32;                   //YYYYMMDD, 0 = needs computing
+  uint16_t SunriseMin_u16;
+  uint16_t SunsetMin_u16;
+  uint16_t MorningOnMin_u16;              //sunrise program: rise, hold, off at sunrise
+  uint16_t MorningDimMin_u16;
+  uint16_t MorningHoldMin_u16;
+  uint16_t EveningDimMin_u16;             //sunset program at sunset: hold, fall, off
+  uint16_t EveningHoldMin_u16;
+} PhotoperiodDay_t;
+
+void Photoperiod_Compute_v(PhotoperiodDay_t *Day_pst, uint32_t DateKey_u32, uint16_t SunriseMin_u16, uint16_t SunsetMin_u16,
+                           uint8_t TableDimMin_u8, uint8_t TableHoldMin_u8, const PhotoperiodSetting_t *Setting_pst);
+
+uint16_t Photoperiod_MorningMin_u16(const PhotoperiodDay_t *Day_pst);    //window length, 0 = no sunrise program
+uint16_t Photoperiod_EveningMin_u16(const PhotoperiodDay_t *Day_pst);
+void Photoperiod_PrintJson_v(const PhotoperiodDay_t *Day_pst, Print &Out);
@@ -0,0 +1,43 @@
+//------------------------------
+// Power save mode
+//
+// automatic light sleep + dynamic frequency scaling, Wi-Fi modem sleep,
+// DS3231 Alarm1/Alarm2 (SQW/INT pin) as wake source for the next schedule event
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+#include "RTClib.h"
+
+#define PLAN_EVENTS_MAX 16
+#define PLAN_MINUTES_PER_DAY 1440
+
+#define POWER_SAVE_HOUSEKEEPING_MIN 360   //main task wake-up (NTP update) interval in power save mode
+
+//schedule events of one day, cached in RTC slow memory
+typedef struct
+{
+  uint32_t DateKey_u32;                         //YYYYMMDD the plan belongs to, 0 = invalid
+  uint8_t EventCount_u8;
+  uint16_t EventMinute_au16 [PLAN_EVENTS_MAX];  //minutes since midnight, sorted ascending
+} DailyPlan_t;
+
+extern DailyPlan_t DailyPlan_st;
+
+extern uint16_t PowerSaveWakeupsToday_u16;
+extern uint16_t PowerSaveWakeupsYesterday_u16;
+
+void PowerSave_Init_v(uint8_t RtcIntPin_u8, uint8_t SwitchPin_u8);
+
+bool PowerSave_PlanValid_b(uint32_t DateKey_u32);
+void PowerSave_SetPlan_v(uint32_t DateKey_u32, const uint16_t *EventMinute_pu16, uint8_t Count_u8);
+
+void PowerSave_WaitForNextEvent_v(const DateTime &Now);
+void PowerSave_WaitForSwitch_v(uint32_t TimeoutMsec_u32);
+
+void PowerSave_SetPwmActive_v(bool Active_b);
+void PowerSave_SetRadioActive_v(bool Active_b);   //modem sleep off while replies are timed (NTP)
+
+//pure helpers (no hardware access)
+uint32_t PowerSave_SecondsToNextEvent_u32(const DailyPlan_t *Plan_pst, uint16_t NowMinute_u16, uint8_t NowSecond_u8);
+uint16_t PowerSave_SimulateWakeupsPerDay_u16(const DailyPlan_t *Plan_pst, uint16_t HousekeepingMin_u16);
@@ -0,0 +1,67 @@
+//------------------------------
+// Schedule preview
+//
+// light-on minutes, first on and last off of every day of a year, for
+// the table or the rule schedule, computed in one pass over the year
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+#include "ScheduleRules.h"
+#include "Photoperiod.h"
+
+#define PREVIEW_DAYS_MAX 366
+#define PREVIEW_BLOCK_DAYS 16                 //days computed together (struct of arrays on the stack)
+#define PREVIEW_YEAR_MIN 2000                 //DS3231 range
+#define PREVIEW_YEAR_MAX 2099
+#define PREVIEW_NONE 0xFFFF                   //first on / last off of a dark day
+
+//binary format: header, then OnMin, FirstOn and LastOff of all days (uint16, little endian)
+#define PREVIEW_BIN_MAGIC "CLPV"
+#define PREVIEW_BIN_VERSION 1
+
+#define PREVIEW_FORMAT_JSON 0
+#define PREVIEW_FORMAT_BIN 1
+
+typedef struct __attribute__((packed))
+{
+  char Magic_ac [4];
+  uint8_t Version_u8;
+  uint8_t Mode_u8;
+  uint16_t Year_u16;
+  uint16_t Days_u16;
+  uint16_t Reserved_u16;
+  uint32_t ComputeUsec_u32;
+} PreviewBinHeader_t;
+
+typedef struct
+{
+  uint16_t Year_u16;
+  uint16_t Days_u16;
+  uint8_t Mode_u8;                                  //SCHEDULE_MODE_xxx
+  uint16_t OnMin_au16 [PREVIEW_DAYS_MAX];           //minutes with any zone on
+  uint16_t FirstOn_au16 [PREVIEW_DAYS_MAX];         //minute of day, PREVIEW_NONE = dark
+  uint16_t LastOff_au16 [PREVIEW_DAYS_MAX];         //minute of day, 1440 = still on at midnight
+} SchedulePreview_t;
+
+//state of one streamed preview response (serialised day by day from Preview_st)
+typedef struct
+{
+  SchedulePreview_t Preview_st;
+  uint32_t ComputeUsec_u32;
+  uint8_t Format_u8;                //PREVIEW_FORMAT_xxx
+  uint8_t Phase_u8;
+  uint16_t Day_u16;                 //next day of the current array
+  uint8_t OutLen_u8;
+  uint8_t OutOffset_u8;
+  char Out_ac [72];
+} SchedulePreviewOut_t;
+
+//ZoneMask_u8: zones the schedule drives (AUTO), rules are ignored in table mode, photoperiod in rule mode
+void SchedulePreview_Compute_v(SchedulePreview_t *Preview_pst, uint16_t Year_u16, uint8_t Mode_u8,
+                               const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8, uint8_t ZoneMask_u8,
+                               const PhotoperiodSetting_t *Photoperiod_pst);
+
+//Preview_st of the output must be computed before
+void SchedulePreview_OutInit_v(SchedulePreviewOut_t *Out_pst, uint8_t Format_u8, uint32_t ComputeUsec_u32);
+size_t SchedulePreview_Fill_u32(SchedulePreviewOut_t *Out_pst, uint8_t *Buf_pu8, size_t MaxLen_u32);
@@ -0,0 +1,76 @@
+//------------------------------
+// Rule based schedule
+//
+// user rules ("on at 05:30 weekdays", "sunset+30min off", "dim to 20% from 20:00 to 21:00")
+// are compiled into a sorted, de-duplicated event timeline for the current day
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define SCHEDULE_RULES_MAX 16
+
+//schedule mode of light control task
+#define SCHEDULE_MODE_TABLE 0     //sunrise / sunset table with dim and hold times
+#define SCHEDULE_MODE_RULES 1     //user rules
+
+//rule anchor
+#define RULE_ANCHOR_TIME 0        //TimeMin_s16 = minute of day
+#define RULE_ANCHOR_SUNRISE 1     //TimeMin_s16 = offset to sunrise
+#define RULE_ANCHOR_SUNSET 2      //TimeMin_s16 = offset to sunset
+#define RULE_OFFSET_MIN_MAX 720   //sunrise / sunset offset range +-
+
+//rule flags
+#define RULE_FLAG_OVERRIDE 0x01   //while active, other rules are ignored for its zones
+
+//weekday mask (bit = RTClib dayOfTheWeek)
+#define RULE_DAYS_ALL 0x7F
+#define RULE_DAYS_WEEKDAYS 0x3E
+#define RULE_DAYS_WEEKEND 0x41
+
+//rule as stored in flash: 12 bytes
+typedef struct __attribute__((packed))
+{
+  uint8_t Anchor_u8;
+  uint8_t Flags_u8;
+  int16_t TimeMin_s16;
+  uint8_t LevelPercent_u8;        //target level
+  uint8_t RampMin_u8;             //time to reach target level
+  uint8_t WeekdayMask_u8;
+  uint8_t ZoneMask_u8;
+  uint16_t FromDate_u16;          //MMDD, 0 = whole year
+  uint16_t ToDate_u16;            //MMDD, range may wrap around new year
+} ScheduleRule_t;
+
+//compiled event
+typedef struct
+{
+  uint16_t Minute_u16;
+  uint8_t LevelPercent_u8;
+  uint8_t RampMin_u8;
+  uint8_t ZoneMask_u8;
+} TimelineEvent_t;
+
+typedef struct
+{
+  uint32_t DateKey_u32;           //YYYYMMDD, 0 = needs compiling
+  uint8_t Count_u8;
+  TimelineEvent_t Event_ast [SCHEDULE_RULES_MAX];
+} Timeline_t;
+
+extern uint8_t ScheduleMode_u8;
+extern Timeline_t Timeline_st;
+
+void Schedule_Init_v(void);
+
+bool Schedule_RuleValid_b(const ScheduleRule_t *Rule_pst);    //web API and rule file
+bool Schedule_AddRule_b(const ScheduleRule_t *Rule_pst);
+bool Schedule_DeleteRule_b(uint8_t Index_u8);
+void Schedule_ClearRules_v(void);
+uint8_t Schedule_GetRules_u8(ScheduleRule_t *Rule_past, uint8_t Max_u8);
+void Schedule_SetMode_v(uint8_t Mode_u8);
+
+bool Schedule_TimelineValid_b(uint32_t DateKey_u32);
+void Schedule_Compile_v(uint32_t DateKey_u32, uint8_t Weekday_u8, uint16_t MonthDay_u16,
+                        uint16_t SunriseMin_u16, uint16_t SunsetMin_u16);
+uint8_t Schedule_UpperBound_u8(uint16_t Minute_u16);
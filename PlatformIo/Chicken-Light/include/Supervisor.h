@@ -0,0 +1,36 @@
+//------------------------------
+// Task supervisor
+//
+// critical tasks register a slot and post heartbeats; a missed deadline
+// is counted, timestamped and escalated one level per deadline:
+// restart task -> safe light level -> hardware watchdog reset
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define SUPERVISOR_SLOTS_MAX 6
+#define SUPERVISOR_NONE 0xFF
+
+#define SUPERVISOR_PERIOD_MSEC 1000
+#define SUPERVISOR_WDT_SEC 10                   //task watchdog of the supervisor itself
+
+//escalation level (SupervisorRecover_t is called for each, the reset itself is done by the watchdog)
+#define SUPERVISOR_LEVEL_OK 0
+#define SUPERVISOR_LEVEL_RESTART 1
+#define SUPERVISOR_LEVEL_SAFE_LIGHT 2
+#define SUPERVISOR_LEVEL_RESET 3
+
+//recovery action of a slot, runs in the supervisor task
+typedef void (*SupervisorRecover_t)(uint8_t Slot_u8, uint8_t Level_u8);
+
+void Supervisor_Start_v(void);
+
+uint8_t Supervisor_Register_u8(const char *Name_pc, uint32_t DeadlineMsec_u32, SupervisorRecover_t Recover_pfn);
+
+void Supervisor_Heartbeat_v(uint8_t Slot_u8);
+void Supervisor_Expect_v(uint8_t Slot_u8, uint32_t WithinMsec_u32);   //heartbeat, next one may take longer
+void Supervisor_Pause_v(uint8_t Slot_u8);                             //blocking on purpose, next heartbeat resumes
+void Supervisor_Escalate_v(uint8_t Slot_u8, uint8_t Level_u8);        //skip levels (recovery not possible)
+
+void Supervisor_PrintJson_v(Print &Out);
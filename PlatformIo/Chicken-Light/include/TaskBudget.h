@@ -0,0 +1,61 @@
+//------------------------------
+// Task budget
+//
+// all long-lived tasks with their stack sizes in one table; stacks and
+// task control blocks are static (.bss), nothing is taken from the heap.
+// Tasks are only created at boot and restarted by the supervisor.
+// stack sizes are in bytes (ESP32 FreeRTOS)
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+//#define TASK_STACK_AUDIT    //debug: paint stacks, log high-water marks periodically
+
+//tasks (index into budget table)
+#define TASK_ID_MAIN 0
+#define TASK_ID_LIGHT_CONTROL 1
+#define TASK_ID_LIGHT_ZONE 2
+#define TASK_ID_TELEMETRY 3
+#define TASK_ID_WIFI 4
+#define TASK_ID_SUPERVISOR 5
+#define TASK_ID_MQTT 6
+#define TASK_ID_FLEET 7
+#define TASK_ID_NTP 8
+#define TASK_COUNT 9
+
+//budget: stack size (bytes) and priority
+#define TASK_STACK_MAIN 6144            //journal (SPIFFS), serial output
+#define TASK_STACK_LIGHT_CONTROL 6144   //RTC, rules, journal, power save
+#define TASK_STACK_LIGHT_ZONE 3072      //output hook: retained state, page cache
+#define TASK_STACK_TELEMETRY 4096       //sensor, SPIFFS ring file
+#define TASK_STACK_WIFI 3072
+#define TASK_STACK_SUPERVISOR 4096      //recovery actions (journal) run here
+#define TASK_STACK_MQTT 4096            //commands (journal, zones) run here
+#define TASK_STACK_FLEET 4096           //follower plans (zones, journal) run here
+#define TASK_STACK_NTP 4096             //DNS lookup, RTC set (journal) runs here
+
+#define TASK_PRIO_MAIN 1
+#define TASK_PRIO_LIGHT_CONTROL 1
+#define TASK_PRIO_LIGHT_ZONE 2
+#define TASK_PRIO_TELEMETRY 1
+#define TASK_PRIO_WIFI 1
+#define TASK_PRIO_SUPERVISOR 3          //above all supervised tasks
+#define TASK_PRIO_MQTT 1
+#define TASK_PRIO_FLEET 1
+#define TASK_PRIO_NTP 1
+
+#define TASK_STACK_MARGIN 512           //audit warns below this much free stack
+#define TASK_AUDIT_PERIOD_SEC 600
+
+TaskHandle_t Task_Start_h(uint8_t Task_u8, TaskFunction_t Func_pfn, void *Param_pv);
+TaskHandle_t Task_Restart_h(uint8_t Task_u8, TaskFunction_t Func_pfn, void *Param_pv);  //delete and create again
+
+#define TASK_LOCKS_MAX 8
+
+void Task_WatchLock_v(SemaphoreHandle_t Lock_h);   //bus/file mutex, a task holding it is not deleted
+bool Task_HoldsLock_b(uint8_t Task_u8);
+
+uint32_t Task_StackFree_u32(uint8_t Task_u8);       //lowest free stack so far (bytes)
+void Task_PrintJson_v(Print &Out);
+void Task_Audit_v(void);                            //serial report, warnings below margin
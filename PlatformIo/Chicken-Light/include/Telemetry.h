@@ -0,0 +1,74 @@
+//------------------------------
+// Telemetry
+//
+// temperature, duty cycle and ambient light history in three tiers
+// (1 min / 24 h, 15 min / 30 days, 1 h / 1 year), delta encoded blocks
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define TELEMETRY_SERIES_TEMP 0
+#define TELEMETRY_SERIES_DUTY 1
+#define TELEMETRY_SERIES_LIGHT 2
+
+#define TELEMETRY_TIER_COUNT 3
+#define TELEMETRY_BLOCK_SAMPLES 64
+#define TELEMETRY_SAMPLE_SEC 60
+
+#define TELEMETRY_TEMP_INVALID INT16_MIN  //sensor missing, last value is held
+
+//one sample as delivered by the sampler
+typedef struct
+{
+  uint32_t Time_u32;                //unix time
+  int16_t TempCenti_s16;            //0.01 °C
+  uint8_t DutyPercent_u8;
+  uint16_t Light_u16;               //12 bit ADC
+} TelemetrySample_t;
+
+//block of equidistant samples: 268 bytes
+//first sample absolute, then one packed word per sample:
+//bit 0...11 temperature delta (signed), bit 12...18 duty (absolute), bit 19...31 light delta (signed)
+typedef struct
+{
+  uint32_t Seq_u32;                 //0 = empty slot
+  uint32_t StartTime_u32;
+  uint8_t Count_u8;
+  uint8_t DutyPercent_u8;
+  int16_t TempCenti_s16;
+  uint16_t Light_u16;
+  uint16_t Reserved_u16;
+  uint32_t Delta_au32 [TELEMETRY_BLOCK_SAMPLES - 1];
+} TelemetryBlock_t;
+
+typedef void (*TelemetrySampler_t)(TelemetrySample_t *Sample_pst);
+
+//state of one streamed history request
+typedef struct
+{
+  uint8_t Series_u8;
+  uint8_t Tier_u8;
+  uint8_t Phase_u8;
+  bool First_b;
+  uint32_t From_u32;
+  uint32_t To_u32;
+  uint32_t Step_u32;
+  uint32_t NextTime_u32;            //decimation
+  uint32_t Seq_u32;                 //next block to load
+  uint32_t LastSeq_u32;             //open block at start of request
+  uint8_t Sample_u8;                //next sample in block
+  TelemetrySample_t Value_st;       //decoded sample Sample_u8 - 1
+  TelemetryBlock_t Block_st;
+  uint8_t OutLen_u8;
+  uint8_t OutOffset_u8;
+  char Out_ac [48];
+} TelemetryQuery_t;
+
+void Telemetry_Init_v(TelemetrySampler_t Sampler_pfn);
+
+uint8_t Telemetry_SeriesFromName_u8(const char *Name_pc);
+uint32_t Telemetry_LastTime_u32(void);
+
+void Telemetry_QueryInit_v(TelemetryQuery_t *Query_pst, uint8_t Series_u8, uint32_t From_u32, uint32_t To_u32, uint32_t Step_u32);
+size_t Telemetry_QueryFill_u32(TelemetryQuery_t *Query_pst, uint8_t *Buf_pu8, size_t MaxLen_u32);
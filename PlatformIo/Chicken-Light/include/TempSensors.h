@@ -0,0 +1,33 @@
+//------------------------------
+// Temperature sensors
+//
+// DS18B20 probes on one 1-Wire bus: ROM codes are enumerated once and
+// cached, one broadcast conversion for all probes, then addressed reads;
+// probes get a role (coop air, water trough, outdoors) by ROM code
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define TEMP_SENSORS_MAX 6
+#define TEMP_RESOLUTION_BIT 12          //750 ms conversion
+#define TEMP_RESCAN_SEC 600             //bus search for new probes
+#define TEMP_MISSING_RESCAN_SEC 60      //earlier while a configured probe (or any probe) is missing
+#define TEMP_ROM_HEX_LEN 16             //ROM code as text, e.g. "28FF641E0F160393"
+
+//roles (ROM codes in config, air defaults to the first probe found)
+#define TEMP_ROLE_AIR 0
+#define TEMP_ROLE_WATER 1
+#define TEMP_ROLE_OUTDOOR 2
+#define TEMP_ROLE_COUNT 3
+#define TEMP_ROLE_NONE 0xFF
+
+void TempSensor_Init_v(uint8_t Pin_u8);               //bus search (boot)
+void TempSensor_Update_v(void);                       //convert and read all probes (blocks for the conversion time)
+void TempSensor_RequestRescan_v(void);                //bus search with the next update
+
+float TempSensor_Get_f32(uint8_t Role_u8);            //last value [degC], NAN: no probe or no valid reading
+uint8_t TempSensor_Count_u8(void);                    //probes present
+
+bool TempSensor_ParseRom_b(const char *Hex_pc, uint8_t *Rom_pu8);
+void TempSensor_PrintJson_v(Print &Out);
@@ -0,0 +1,39 @@
+//------------------------------
+// Text formatting
+//
+// fixed capacity text in a caller buffer (usually on the stack), no heap,
+// no snprintf; integers with optional zero padding, date and time fields.
+// Output is always terminated, Overflow_b is set when text was cut.
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+typedef struct
+{
+  char *Buf_pc;
+  size_t Size_u32;
+  size_t Len_u32;
+  bool Overflow_b;
+} Text_t;
+
+void Text_Init_v(Text_t *Text_pst, char *Buf_pc, size_t Size_u32);
+
+void Text_Char_v(Text_t *Text_pst, char Char_c);
+void Text_Str_v(Text_t *Text_pst, const char *Str_pc);
+void Text_Uint_v(Text_t *Text_pst, uint32_t Value_u32, uint8_t Width_u8 = 0);   //Width: zero padded
+void Text_Int_v(Text_t *Text_pst, int32_t Value_s32, uint8_t Width_u8 = 0);
+void Text_Fixed_v(Text_t *Text_pst, float Value_f32, uint8_t Decimals_u8);      //rounded, NAN -> "nan"
+
+void Text_Date_v(Text_t *Text_pst, uint16_t Year_u16, uint8_t Month_u8, uint8_t Day_u8);      //YYYY-MM-DD
+void Text_Time_v(Text_t *Text_pst, uint8_t Hour_u8, uint8_t Minute_u8, int8_t Second_s8 = -1); //HH:MM[:SS]
+
+bool Text_Ok_b(const Text_t *Text_pst);
+size_t Text_Len_u32(const Text_t *Text_pst);            //0 after overflow
+
+//parse decimal number, whole text or up to End_pc (NULL: until '\0')
+bool Text_ParseUint_b(const char *Text_pc, const char *End_pc, uint32_t *Value_pu32);
+bool Text_ParseInt_b(const char *Text_pc, const char *End_pc, int32_t *Value_ps32);
+
+//value of Key_pc in a flat JSON object (strings without quotes), false: missing or too long
+bool Text_JsonValue_b(const char *Json_pc, const char *Key_pc, char *Value_pc, size_t Size_u32);
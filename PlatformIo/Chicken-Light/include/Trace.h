@@ -0,0 +1,54 @@
+//------------------------------
+// Input trace
+//
+// capture mode for field problems: all external inputs (RTC, NTP,
+// temperature, ADC, switch, commands), the resulting zone engine calls
+// and the output levels are recorded with a millisecond timestamp into a
+// RAM buffer (replay on the host: tools/trace_replay)
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define TRACE_RECORDS_MAX 2048              //32 KB, allocated with the first capture
+#define TRACE_VERSION 1
+
+//record types (keep in sync with tools/trace_replay/trace_replay.cpp)
+#define TRACE_START 0                       //Arg = zone count, schedule mode, ramping mask, Value = unix time, Aux = TRACE_VERSION
+#define TRACE_IN_RTC 1                      //Value = unix time (only when the RTC differs from the uptime clock)
+#define TRACE_IN_NTP 2                      //Arg0 = 1 ok / 0 failed, Value = unix time of the NTP server
+#define TRACE_IN_TEMP 3                     //Arg0 = TEMP_ROLE_xxx, Value = temperature [1/100 degC] (signed, INT32_MIN: invalid)
+#define TRACE_IN_ADC 4                      //Arg0 = GPIO, Value = raw value
+#define TRACE_IN_SWITCH 5                   //Arg0 = level (edges only)
+#define TRACE_IN_COMMAND 6                  //Arg0 = JOURNAL_CMD_xxx, Arg1 = JOURNAL_SRC_xxx, Arg2 = zone mask,
+                                            //Value = percent | ease << 8 (or parameter), Aux = ramp time [ms]
+#define TRACE_ZONE_SET 16                   //Arg0 = zone mask, Value = level
+#define TRACE_ZONE_FADE 17                  //Arg0 = zone mask, Arg1 = ZONE_EASE_xxx, Value = target level, Aux = ramp time [ms]
+#define TRACE_ZONE_PROGRAM 18               //Arg0 = zone mask, Arg1 = keyframe count, Aux = offset [ms]
+#define TRACE_ZONE_KEYFRAME 19              //Arg0 = index, Arg1 = ZONE_EASE_xxx, Value = level << 16 | time [s]
+#define TRACE_ZONE_STOP 20                  //Arg0 = zone mask
+#define TRACE_OUT_LEVEL 32                  //Arg0 = zone, Value = level (on every change of the percent value)
+
+//record: 16 bytes, little endian
+typedef struct __attribute__((packed))
+{
+  uint32_t Msec_u32;                        //since start of capture
+  uint8_t Type_u8;                          //TRACE_xxx
+  uint8_t Arg_au8 [3];
+  uint32_t Value_u32;
+  uint32_t Aux_u32;
+} TraceRecord_t;
+
+bool Trace_Start_b(uint32_t Unix_u32, uint8_t ScheduleMode_u8);   //false: no memory
+void Trace_Stop_v(void);
+bool Trace_Active_b(void);
+
+void Trace_Log_v(uint8_t Type_u8, uint8_t Arg0_u8, uint8_t Arg1_u8, uint8_t Arg2_u8, uint32_t Value_u32, uint32_t Aux_u32);
+void Trace_Rtc_v(uint32_t Unix_u32);                          //every RTC bus read
+void Trace_Switch_v(uint8_t Level_u8);                        //every switch poll
+void Trace_Output_v(uint8_t Zone_u8, uint16_t Level_u16);     //every output change
+
+//export of the records of the last capture, 0 = end (or capture restarted)
+uint32_t Trace_Generation_u32(void);
+size_t Trace_Read_u32(uint32_t Capture_u32, size_t Offset_u32, uint8_t *Buf_pu8, size_t MaxLen_u32);
+void Trace_PrintJson_v(Print &Out);
@@ -0,0 +1,28 @@
+//------------------------------
+// WiFi connection manager
+//
+// connects in the background, retries with exponential backoff,
+// reconnects after a drop and optionally opens an access point
+// after repeated failures
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#define WIFI_CONNECT_TIMEOUT_MSEC 15000
+#define WIFI_BACKOFF_MIN_MSEC 2000
+#define WIFI_BACKOFF_MAX_MSEC 300000
+#define WIFI_AP_FALLBACK_FAILURES 5       //failed attempts before access point is opened
+
+//connection state
+#define WIFI_STATE_CONNECTING 0
+#define WIFI_STATE_CONNECTED 1
+#define WIFI_STATE_BACKOFF 2
+
+void Wifi_Start_v(const char *Ssid_pc, const char *Password_pc, const char *ApSsid_pc, const char *ApPassword_pc);
+
+bool Wifi_Connected_b(void);
+uint8_t Wifi_State_u8(void);
+uint32_t Wifi_ConnectCount_u32(void);         //incremented on every (re)connect
+uint32_t Wifi_FirstConnectUs_u32(void);       //boot timeline: first connection [usec since power on]
+bool Wifi_ApActive_b(void);
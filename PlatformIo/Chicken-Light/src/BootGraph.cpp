@@ -0,0 +1,160 @@
+//------------------------------
+// Boot graph
+//
+// One task per stage is created up front. Each task waits on the event
+// group for the bits of its dependencies, runs the stage and sets its own
+// bit, so independent stages (e.g. SPIFFS mount and RTC) overlap and a
+// slow stage only delays the stages depending on it. A failed stage still
+// sets its bit, dependent stages are then skipped. The event group is
+// static and never deleted: a stage task may still be inside
+// xEventGroupSetBits when Boot_Run_v wakes up on the last bit.
+//------------------------------
+
+//includes
+//------------------------------
+#include "BootGraph.h"
+
+#include "esp_timer.h"
+//------------------------------
+
+//global variables
+//------------------------------
+static const BootStage_t *Stage_past = NULL;
+static uint8_t Count_u8 = 0;
+static BootTiming_t Timing_ast [BOOT_STAGES_MAX];
+
+static StaticEventGroup_t BootEventsBuffer_st;
+static EventGroupHandle_t BootEvents = NULL;
+static volatile uint16_t FailedMask_u16 = 0;
+static portMUX_TYPE BootMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t RunUs_u32 = 0;
+static uint32_t DoneUs_u32 = 0;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void BootStage_task(void * pvParameters);
+//------------------------------
+
+
+//------------------------------
+// run all stages, returns when the last stage is done
+//------------------------------
+void Boot_Run_v(const BootStage_t *BootStage_past, uint8_t BootCount_u8)
+{
+  Stage_past = BootStage_past;
+  Count_u8 = min(BootCount_u8, (uint8_t)BOOT_STAGES_MAX);
+  FailedMask_u16 = 0;
+
+  memset(Timing_ast, 0, sizeof(Timing_ast));
+
+  if(BootEvents == NULL)
+  {
+    BootEvents = xEventGroupCreateStatic(&BootEventsBuffer_st);
+  }
+
+  xEventGroupClearBits(BootEvents, (1 << BOOT_STAGES_MAX) - 1);
+  RunUs_u32 = (uint32_t)esp_timer_get_time();
+
+  for(uint8_t i = 0; i < Count_u8; i++)
+  {
+    xTaskCreate(BootStage_task, Stage_past [i].Name_pc, BOOT_STAGE_STACK, (void *)(uintptr_t)i, 2, NULL);
+  }
+
+  xEventGroupWaitBits(BootEvents, (1 << Count_u8) - 1, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+//------------------------------
+
+
+//------------------------------
+// stage task: wait for dependencies, run, signal
+//------------------------------
+static void BootStage_task(void * pvParameters)
+{
+  uint8_t Stage_u8 = (uintptr_t)pvParameters;
+  const BootStage_t *Stage_pst = &Stage_past [Stage_u8];
+  BootTiming_t *Timing_pst = &Timing_ast [Stage_u8];
+
+  if(Stage_pst->DependMask_u16 != 0)
+  {
+    xEventGroupWaitBits(BootEvents, Stage_pst->DependMask_u16, pdFALSE, pdTRUE, portMAX_DELAY);
+  }
+
+  Timing_pst->StartUs_u32 = (uint32_t)esp_timer_get_time();
+  Timing_pst->Core_u8 = xPortGetCoreID();
+
+  if(Stage_pst->DependMask_u16 & FailedMask_u16)
+  {
+    Timing_pst->Result_u8 = BOOT_RESULT_SKIPPED;
+  }
+  else
+  {
+    Timing_pst->Result_u8 = Stage_pst->Run_pfn() ? BOOT_RESULT_OK : BOOT_RESULT_FAILED;
+  }
+
+  Timing_pst->EndUs_u32 = (uint32_t)esp_timer_get_time();
+
+  Serial.printf("boot: %-8s %7u .. %7u us %s\n", Stage_pst->Name_pc, Timing_pst->StartUs_u32, Timing_pst->EndUs_u32,
+                (Timing_pst->Result_u8 == BOOT_RESULT_OK) ? "" : (Timing_pst->Result_u8 == BOOT_RESULT_FAILED) ? "FAILED" : "skipped");
+
+  //mark before signalling, dependent stages check the mask right after waking up
+  if(Timing_pst->Result_u8 != BOOT_RESULT_OK)
+  {
+    portENTER_CRITICAL(&BootMux);
+    FailedMask_u16 |= BOOT_DEPENDS(Stage_u8);
+    portEXIT_CRITICAL(&BootMux);
+  }
+
+  xEventGroupSetBits(BootEvents, BOOT_DEPENDS(Stage_u8));
+
+  vTaskDelete(NULL);
+}
+//------------------------------
+
+
+//------------------------------
+// setup finished (web server running)
+//------------------------------
+void Boot_Done_v(void)
+{
+  DoneUs_u32 = (uint32_t)esp_timer_get_time();
+
+  Serial.printf("boot: done after %u us\n", DoneUs_u32);
+}
+//------------------------------
+
+
+//------------------------------
+// results for /api/boot
+//------------------------------
+uint8_t Boot_StageCount_u8(void)
+{
+  return Count_u8;
+}
+
+const BootStage_t *Boot_Stage_pst(uint8_t Stage_u8)
+{
+  return (Stage_u8 < Count_u8) ? &Stage_past [Stage_u8] : NULL;
+}
+
+const BootTiming_t *Boot_Timing_pst(uint8_t Stage_u8)
+{
+  return (Stage_u8 < Count_u8) ? &Timing_ast [Stage_u8] : NULL;
+}
+
+bool Boot_StageOk_b(uint8_t Stage_u8)
+{
+  return (Stage_u8 < Count_u8) && (Timing_ast [Stage_u8].Result_u8 == BOOT_RESULT_OK);
+}
+
+uint32_t Boot_RunUs_u32(void)
+{
+  return RunUs_u32;
+}
+
+uint32_t Boot_DoneUs_u32(void)
+{
+  return DoneUs_u32;
+}
+//------------------------------
@@ -0,0 +1,901 @@
+//------------------------------
+// Device configuration
+//
+// The JSON parser accepts one flat object, e.g.
+//   {"time":"2022-05-15 13:14:00","threshold_dark":5,"manual_ramp_s":10,"schedule_mode":"rules"}
+//   {"mqtt_broker":"192.168.1.10","mqtt_port":1883,"mqtt_interval_ms":1000}
+//   {"sensor_water":"28FF641E0F160393","sensor_outdoor":""}
+//   {"fleet_role":"follower","fleet_stagger_ms":500}
+//   {"ntp_server_1":"192.168.1.1","ntp_server_2":"ptbtime1.ptb.de:123","ntp_server_4":""}
+//   {"photoperiod_min":840,"photoperiod_morning_pct":70,"strip_watts":14.4}
+// Chunks are fed as they arrive, every key/value pair is converted into the
+// fixed size patch right away. Nothing is applied before the whole document
+// is parsed and validated.
+//------------------------------
+
+//includes
+//------------------------------
+#include "DeviceConfig.h"
+#include "ScheduleRules.h"
+#include "FleetSync.h"
+#include "EnergyMeter.h"
+
+#include "SPIFFS.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define CONFIG_FILE "/config.bin"
+#define CONFIG_FILE_VERSION 7
+#define CONFIG_V1_SIZE offsetof(DeviceConfig_t, MqttBroker_ac)   //version 1: settings up to ManualRampSec_u16
+#define CONFIG_V2_SIZE offsetof(DeviceConfig_t, SensorRom_aac)   //version 2: up to MQTT
+#define CONFIG_V3_SIZE offsetof(DeviceConfig_t, FleetRole_u8)    //version 3: up to sensor ROM codes
+#define CONFIG_V4_SIZE offsetof(DeviceConfig_t, NtpServer_aac)   //version 4: up to fleet
+#define CONFIG_V5_SIZE offsetof(DeviceConfig_t, Photoperiod_st)  //version 5: up to NTP servers
+#define CONFIG_V6_SIZE offsetof(DeviceConfig_t, StripWatts_f32)  //version 6: up to photoperiod
+
+//parser states
+#define PARSER_START 0
+#define PARSER_KEY_OR_END 1
+#define PARSER_KEY 2
+#define PARSER_COLON 3
+#define PARSER_VALUE 4
+#define PARSER_STRING 5
+#define PARSER_LITERAL 6
+#define PARSER_COMMA_OR_END 7
+#define PARSER_DONE 8
+#define PARSER_ERROR 9
+
+//value types
+#define FIELD_TYPE_UINT 0
+#define FIELD_TYPE_FLOAT 1
+#define FIELD_TYPE_STRING 2
+
+typedef struct
+{
+  const char *Name_pc;
+  uint32_t Field_u32;
+  uint8_t Type_u8;
+} ConfigKey_t;
+
+static const ConfigKey_t ConfigKey_ast [] =
+{
+  {"time",                    CONFIG_FIELD_TIME,             FIELD_TYPE_STRING},
+  {"threshold_dark",          CONFIG_FIELD_THRESHOLD_DARK,   FIELD_TYPE_UINT},
+  {"threshold_bright",        CONFIG_FIELD_THRESHOLD_BRIGHT, FIELD_TYPE_UINT},
+  {"latitude",                CONFIG_FIELD_LATITUDE,         FIELD_TYPE_FLOAT},
+  {"longitude",               CONFIG_FIELD_LONGITUDE,        FIELD_TYPE_FLOAT},
+  {"manual_ramp_s",           CONFIG_FIELD_MANUAL_RAMP,      FIELD_TYPE_UINT},
+  {"schedule_mode",           CONFIG_FIELD_SCHEDULE_MODE,    FIELD_TYPE_STRING},
+  {"mqtt_broker",             CONFIG_FIELD_MQTT_BROKER,      FIELD_TYPE_STRING},
+  {"mqtt_port",               CONFIG_FIELD_MQTT_PORT,        FIELD_TYPE_UINT},
+  {"mqtt_interval_ms",        CONFIG_FIELD_MQTT_INTERVAL,    FIELD_TYPE_UINT},
+  {"sensor_air",              CONFIG_FIELD_SENSOR_AIR,       FIELD_TYPE_STRING},
+  {"sensor_water",            CONFIG_FIELD_SENSOR_WATER,     FIELD_TYPE_STRING},
+  {"sensor_outdoor",          CONFIG_FIELD_SENSOR_OUTDOOR,   FIELD_TYPE_STRING},
+  {"fleet_role",              CONFIG_FIELD_FLEET_ROLE,       FIELD_TYPE_STRING},
+  {"fleet_stagger_ms",        CONFIG_FIELD_FLEET_STAGGER,    FIELD_TYPE_UINT},
+  {"ntp_server_1",            CONFIG_FIELD_NTP_SERVER_1,     FIELD_TYPE_STRING},
+  {"ntp_server_2",            CONFIG_FIELD_NTP_SERVER_2,     FIELD_TYPE_STRING},
+  {"ntp_server_3",            CONFIG_FIELD_NTP_SERVER_3,     FIELD_TYPE_STRING},
+  {"ntp_server_4",            CONFIG_FIELD_NTP_SERVER_4,     FIELD_TYPE_STRING},
+  {"photoperiod_min",         CONFIG_FIELD_PHOTOPERIOD,      FIELD_TYPE_UINT},
+  {"photoperiod_morning_pct", CONFIG_FIELD_PHOTOPERIOD_AM,   FIELD_TYPE_UINT},
+  {"photoperiod_dim_min",     CONFIG_FIELD_PHOTOPERIOD_DIM,  FIELD_TYPE_UINT},
+  {"strip_watts",             CONFIG_FIELD_STRIP_WATTS,      FIELD_TYPE_FLOAT},
+};
+//------------------------------
+
+//global variables
+//------------------------------
+DeviceConfig_t Config_st =
+{
+  0,            //ThresholdDarkPercent_u8
+  100,          //ThresholdBrightPercent_u8
+  51.32646730,  //Latitude_f32 (Wolfhagen, DE)
+  9.17108270,   //Longitude_f32
+  2,            //ManualRampSec_u16
+  "",           //MqttBroker_ac
+  1883,         //MqttPort_u16
+  1000,         //MqttIntervalMsec_u16
+  {"", "", ""}, //SensorRom_aac
+  0,            //FleetRole_u8 (FLEET_ROLE_OFF)
+  0,            //FleetStaggerMsec_u16
+  {"0.pool.ntp.org", "1.pool.ntp.org", "2.pool.ntp.org", "3.pool.ntp.org"},   //NtpServer_aac
+  {PHOTOPERIOD_TABLE, 50, 30},                                                   //Photoperiod_st
+  0.0           //StripWatts_f32
+};
+
+static portMUX_TYPE ConfigMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void ParserError_v(ConfigParser_t *Parser_pst, const char *Error_pc);
+static void ParserPair_v(ConfigParser_t *Parser_pst);
+static void Merge_v(DeviceConfig_t *Config_pst, const ConfigPatch_t *Patch_pst);
+//------------------------------
+
+
+//------------------------------
+// load settings (SPIFFS must be mounted)
+//------------------------------
+void Config_Init_v(void)
+{
+  uint8_t Version_u8 = 0;
+  DeviceConfig_t Stored_st;
+
+  File file = SPIFFS.open(CONFIG_FILE, FILE_READ);
+
+  if(!file)
+  {
+    return;
+  }
+
+  //older file: settings added later keep their defaults
+  Stored_st = Config_st;
+
+  file.read(&Version_u8, 1);
+
+  size_t Size_u32 = (Version_u8 == CONFIG_FILE_VERSION) ? sizeof(Stored_st)
+                    : (Version_u8 == 6) ? CONFIG_V6_SIZE
+                    : (Version_u8 == 5) ? CONFIG_V5_SIZE
+                    : (Version_u8 == 4) ? CONFIG_V4_SIZE
+                    : (Version_u8 == 3) ? CONFIG_V3_SIZE
+                    : (Version_u8 == 2) ? CONFIG_V2_SIZE
+                    : (Version_u8 == 1) ? CONFIG_V1_SIZE : 0;
+
+  if((Size_u32 > 0) && (file.read((uint8_t *)&Stored_st, Size_u32) == Size_u32))
+  {
+    Config_st = Stored_st;
+  }
+
+  Config_st.MqttBroker_ac [CONFIG_VALUE_LEN_MAX] = '\0';
+
+  for(uint8_t i = 0; i < TEMP_ROLE_COUNT; i++)
+  {
+    Config_st.SensorRom_aac [i] [TEMP_ROM_HEX_LEN] = '\0';
+  }
+
+  for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+  {
+    Config_st.NtpServer_aac [i] [NTP_SERVER_LEN_MAX] = '\0';
+  }
+
+  file.close();
+}
+//------------------------------
+
+
+//------------------------------
+// store settings
+//------------------------------
+void Config_Save_v(void)
+{
+  uint8_t Version_u8 = CONFIG_FILE_VERSION;
+
+  File file = SPIFFS.open(CONFIG_FILE, FILE_WRITE);
+
+  if(!file)
+  {
+    Serial.print("config: couldn't write config file\n");
+    return;
+  }
+
+  file.write(&Version_u8, 1);
+  file.write((const uint8_t *)&Config_st, sizeof(Config_st));
+  file.close();
+}
+//------------------------------
+
+
+//------------------------------
+// copy of all settings (strings are not written atomically)
+//------------------------------
+void Config_Copy_v(DeviceConfig_t *Config_pst)
+{
+  portENTER_CRITICAL(&ConfigMux);
+  *Config_pst = Config_st;
+  portEXIT_CRITICAL(&ConfigMux);
+}
+//------------------------------
+
+
+//------------------------------
+// streaming JSON parser
+//------------------------------
+void Config_ParserInit_v(ConfigParser_t *Parser_pst)
+{
+  memset(Parser_pst, 0, sizeof(ConfigParser_t));
+
+  Parser_pst->State_u8 = PARSER_START;
+}
+
+static void ParserError_v(ConfigParser_t *Parser_pst, const char *Error_pc)
+{
+  if(Parser_pst->State_u8 != PARSER_ERROR)
+  {
+    Parser_pst->State_u8 = PARSER_ERROR;
+    Parser_pst->Error_pc = Error_pc;
+    strcpy(Parser_pst->ErrorField_ac, Parser_pst->Key_ac);
+  }
+}
+
+void Config_ParserFeed_v(ConfigParser_t *Parser_pst, const uint8_t *Data_pu8, size_t Len_u32)
+{
+  for(size_t i = 0; (i < Len_u32) && (Parser_pst->State_u8 != PARSER_ERROR); i++)
+  {
+    char c = Data_pu8 [i];
+    bool Space_b = (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+
+    switch(Parser_pst->State_u8)
+    {
+      case PARSER_START:
+        if(c == '{')
+        {
+          Parser_pst->State_u8 = PARSER_KEY_OR_END;
+        }
+        else if(!Space_b)
+        {
+          ParserError_v(Parser_pst, "object expected");
+        }
+        break;
+
+      case PARSER_KEY_OR_END:
+        if(c == '"')
+        {
+          Parser_pst->KeyLen_u8 = 0;
+          Parser_pst->Key_ac [0] = '\0';
+          Parser_pst->State_u8 = PARSER_KEY;
+        }
+        else if(c == '}')
+        {
+          Parser_pst->State_u8 = PARSER_DONE;
+        }
+        else if(!Space_b)
+        {
+          ParserError_v(Parser_pst, "key expected");
+        }
+        break;
+
+      case PARSER_KEY:
+        if(c == '"')
+        {
+          Parser_pst->State_u8 = PARSER_COLON;
+        }
+        else if(Parser_pst->KeyLen_u8 < CONFIG_KEY_LEN_MAX)
+        {
+          Parser_pst->Key_ac [Parser_pst->KeyLen_u8++] = c;
+          Parser_pst->Key_ac [Parser_pst->KeyLen_u8] = '\0';
+        }
+        else
+        {
+          ParserError_v(Parser_pst, "unknown key");
+        }
+        break;
+
+      case PARSER_COLON:
+        if(c == ':')
+        {
+          Parser_pst->ValueLen_u8 = 0;
+          Parser_pst->Value_ac [0] = '\0';
+          Parser_pst->State_u8 = PARSER_VALUE;
+        }
+        else if(!Space_b)
+        {
+          ParserError_v(Parser_pst, "':' expected");
+        }
+        break;
+
+      case PARSER_VALUE:
+        if(c == '"')
+        {
+          Parser_pst->ValueIsString_b = true;
+          Parser_pst->State_u8 = PARSER_STRING;
+        }
+        else if((c == '{') || (c == '['))
+        {
+          ParserError_v(Parser_pst, "nested values not supported");
+        }
+        else if(!Space_b)
+        {
+          Parser_pst->ValueIsString_b = false;
+          Parser_pst->Value_ac [0] = c;
+          Parser_pst->Value_ac [1] = '\0';
+          Parser_pst->ValueLen_u8 = 1;
+          Parser_pst->State_u8 = PARSER_LITERAL;
+        }
+        break;
+
+      case PARSER_STRING:
+        if(c == '"')
+        {
+          ParserPair_v(Parser_pst);
+
+          if(Parser_pst->State_u8 != PARSER_ERROR)
+          {
+            Parser_pst->State_u8 = PARSER_COMMA_OR_END;
+          }
+        }
+        else if((c == '\\') || ((uint8_t)c < 0x20))
+        {
+          //values are printed back into JSON as they are: no '"', '\\' or control characters
+          ParserError_v(Parser_pst, "escapes and control characters not supported");
+        }
+        else if(Parser_pst->ValueLen_u8 < CONFIG_VALUE_LEN_MAX)
+        {
+          Parser_pst->Value_ac [Parser_pst->ValueLen_u8++] = c;
+          Parser_pst->Value_ac [Parser_pst->ValueLen_u8] = '\0';
+        }
+        else
+        {
+          ParserError_v(Parser_pst, "value too long");
+        }
+        break;
+
+      case PARSER_LITERAL:
+        if((c == ',') || (c == '}') || Space_b)
+        {
+          ParserPair_v(Parser_pst);
+
+          if(Parser_pst->State_u8 == PARSER_ERROR)
+          {
+            break;
+          }
+
+          Parser_pst->State_u8 = PARSER_COMMA_OR_END;
+          i--;    //delimiter is handled in next state
+        }
+        else if(Parser_pst->ValueLen_u8 < CONFIG_VALUE_LEN_MAX)
+        {
+          Parser_pst->Value_ac [Parser_pst->ValueLen_u8++] = c;
+          Parser_pst->Value_ac [Parser_pst->ValueLen_u8] = '\0';
+        }
+        else
+        {
+          ParserError_v(Parser_pst, "value too long");
+        }
+        break;
+
+      case PARSER_COMMA_OR_END:
+        if(c == ',')
+        {
+          Parser_pst->State_u8 = PARSER_KEY_OR_END;
+        }
+        else if(c == '}')
+        {
+          Parser_pst->State_u8 = PARSER_DONE;
+        }
+        else if(!Space_b)
+        {
+          ParserError_v(Parser_pst, "',' or '}' expected");
+        }
+        break;
+
+      case PARSER_DONE:
+        if(!Space_b)
+        {
+          ParserError_v(Parser_pst, "trailing data");
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+bool Config_ParserFinish_b(ConfigParser_t *Parser_pst)
+{
+  if((Parser_pst->State_u8 != PARSER_DONE) && (Parser_pst->State_u8 != PARSER_ERROR))
+  {
+    ParserError_v(Parser_pst, "incomplete document");
+  }
+
+  return Parser_pst->State_u8 == PARSER_DONE;
+}
+//------------------------------
+
+
+//------------------------------
+// convert completed key/value pair into patch
+//------------------------------
+static void ParserPair_v(ConfigParser_t *Parser_pst)
+{
+  const ConfigKey_t *Key_pst = NULL;
+  ConfigPatch_t *Patch_pst = &Parser_pst->Patch_st;
+  const char *Value_pc = Parser_pst->Value_ac;
+  char *End_pc = NULL;
+
+  for(uint8_t i = 0; i < sizeof(ConfigKey_ast) / sizeof(ConfigKey_ast [0]); i++)
+  {
+    if(strcmp(ConfigKey_ast [i].Name_pc, Parser_pst->Key_ac) == 0)
+    {
+      Key_pst = &ConfigKey_ast [i];
+      break;
+    }
+  }
+
+  if(Key_pst == NULL)
+  {
+    ParserError_v(Parser_pst, "unknown key");
+    return;
+  }
+
+  if(Parser_pst->ValueIsString_b != (Key_pst->Type_u8 == FIELD_TYPE_STRING))
+  {
+    ParserError_v(Parser_pst, "wrong type");
+    return;
+  }
+
+  unsigned long Uint_u32 = 0;
+  float Float_f32 = 0.0F;
+
+  if(Key_pst->Type_u8 == FIELD_TYPE_UINT)
+  {
+    Uint_u32 = strtoul(Value_pc, &End_pc, 10);
+
+    if((*End_pc != '\0') || (Value_pc [0] == '-') || (Uint_u32 > 65535))
+    {
+      ParserError_v(Parser_pst, "unsigned integer expected");
+      return;
+    }
+  }
+  else if(Key_pst->Type_u8 == FIELD_TYPE_FLOAT)
+  {
+    Float_f32 = strtof(Value_pc, &End_pc);
+
+    if((*End_pc != '\0') || (End_pc == Value_pc))
+    {
+      ParserError_v(Parser_pst, "number expected");
+      return;
+    }
+  }
+
+  switch(Key_pst->Field_u32)
+  {
+    case CONFIG_FIELD_TIME:
+      if(!Config_ParseDateTime_b(Value_pc, &Patch_pst->DateTime_st))
+      {
+        ParserError_v(Parser_pst, "format YYYY-MM-DD HH:MM:SS expected");
+        return;
+      }
+      break;
+
+    case CONFIG_FIELD_THRESHOLD_DARK:
+      Patch_pst->Config_st.ThresholdDarkPercent_u8 = min(Uint_u32, 255UL);
+      break;
+
+    case CONFIG_FIELD_THRESHOLD_BRIGHT:
+      Patch_pst->Config_st.ThresholdBrightPercent_u8 = min(Uint_u32, 255UL);
+      break;
+
+    case CONFIG_FIELD_LATITUDE:
+      Patch_pst->Config_st.Latitude_f32 = Float_f32;
+      break;
+
+    case CONFIG_FIELD_LONGITUDE:
+      Patch_pst->Config_st.Longitude_f32 = Float_f32;
+      break;
+
+    case CONFIG_FIELD_MANUAL_RAMP:
+      Patch_pst->Config_st.ManualRampSec_u16 = Uint_u32;
+      break;
+
+    case CONFIG_FIELD_SCHEDULE_MODE:
+      if(strcmp(Value_pc, "table") == 0)
+      {
+        Patch_pst->ScheduleMode_u8 = SCHEDULE_MODE_TABLE;
+      }
+      else if(strcmp(Value_pc, "rules") == 0)
+      {
+        Patch_pst->ScheduleMode_u8 = SCHEDULE_MODE_RULES;
+      }
+      else
+      {
+        ParserError_v(Parser_pst, "\"table\" or \"rules\" expected");
+        return;
+      }
+      break;
+
+    case CONFIG_FIELD_MQTT_BROKER:
+      //value is limited to CONFIG_VALUE_LEN_MAX by the parser
+      strcpy(Patch_pst->Config_st.MqttBroker_ac, Value_pc);
+      break;
+
+    case CONFIG_FIELD_MQTT_PORT:
+      Patch_pst->Config_st.MqttPort_u16 = Uint_u32;
+      break;
+
+    case CONFIG_FIELD_MQTT_INTERVAL:
+      Patch_pst->Config_st.MqttIntervalMsec_u16 = Uint_u32;
+      break;
+
+    case CONFIG_FIELD_SENSOR_AIR:
+    case CONFIG_FIELD_SENSOR_WATER:
+    case CONFIG_FIELD_SENSOR_OUTDOOR:
+    {
+      uint8_t Rom_au8 [8];
+      uint8_t Role_u8 = (Key_pst->Field_u32 == CONFIG_FIELD_SENSOR_AIR) ? TEMP_ROLE_AIR
+                        : (Key_pst->Field_u32 == CONFIG_FIELD_SENSOR_WATER) ? TEMP_ROLE_WATER : TEMP_ROLE_OUTDOOR;
+
+      //empty: role not assigned
+      if((Value_pc [0] != '\0') && !TempSensor_ParseRom_b(Value_pc, Rom_au8))
+      {
+        ParserError_v(Parser_pst, "ROM code (16 hex digits) expected");
+        return;
+      }
+
+      strcpy(Patch_pst->Config_st.SensorRom_aac [Role_u8], Value_pc);
+      break;
+    }
+
+    case CONFIG_FIELD_FLEET_ROLE:
+    {
+      uint8_t Role_u8 = Fleet_RoleFromName_u8(Value_pc);
+
+      if(Role_u8 == 0xFF)
+      {
+        ParserError_v(Parser_pst, "\"off\", \"leader\" or \"follower\" expected");
+        return;
+      }
+
+      Patch_pst->Config_st.FleetRole_u8 = Role_u8;
+      break;
+    }
+
+    case CONFIG_FIELD_FLEET_STAGGER:
+      Patch_pst->Config_st.FleetStaggerMsec_u16 = Uint_u32;
+      break;
+
+    case CONFIG_FIELD_NTP_SERVER_1:
+    case CONFIG_FIELD_NTP_SERVER_2:
+    case CONFIG_FIELD_NTP_SERVER_3:
+    case CONFIG_FIELD_NTP_SERVER_4:
+    {
+      char Host_ac [NTP_SERVER_LEN_MAX + 1];
+      uint16_t Port_u16;
+      uint8_t Index_u8 = (Key_pst->Field_u32 == CONFIG_FIELD_NTP_SERVER_1) ? 0
+                         : (Key_pst->Field_u32 == CONFIG_FIELD_NTP_SERVER_2) ? 1
+                         : (Key_pst->Field_u32 == CONFIG_FIELD_NTP_SERVER_3) ? 2 : 3;
+
+      //empty: slot not used
+      if((Value_pc [0] != '\0') && !Ntp_ParseServer_b(Value_pc, Host_ac, &Port_u16))
+      {
+        ParserError_v(Parser_pst, "host name or IP address, optional :port expected");
+        return;
+      }
+
+      strcpy(Patch_pst->Config_st.NtpServer_aac [Index_u8], Value_pc);
+      break;
+    }
+
+    case CONFIG_FIELD_PHOTOPERIOD:
+      Patch_pst->Config_st.Photoperiod_st.TargetMin_u16 = Uint_u32;
+      break;
+
+    case CONFIG_FIELD_PHOTOPERIOD_AM:
+      Patch_pst->Config_st.Photoperiod_st.MorningPercent_u8 = min(Uint_u32, 255UL);
+      break;
+
+    case CONFIG_FIELD_PHOTOPERIOD_DIM:
+      Patch_pst->Config_st.Photoperiod_st.DimMin_u8 = min(Uint_u32, 255UL);
+      break;
+
+    case CONFIG_FIELD_STRIP_WATTS:
+      Patch_pst->Config_st.StripWatts_f32 = Float_f32;
+      break;
+
+    default:
+      break;
+  }
+
+  Patch_pst->Present_u32 |= Key_pst->Field_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// validate complete patch (ranges and cross-field rules)
+//------------------------------
+bool Config_Validate_b(ConfigParser_t *Parser_pst)
+{
+  DeviceConfig_t New_st;
+  const DeviceConfig_t *New_pst = &New_st;
+
+  if(Parser_pst->State_u8 != PARSER_DONE)
+  {
+    return false;
+  }
+
+  //cross-field rules are checked against the current settings
+  Config_Copy_v(&New_st);
+  Merge_v(&New_st, &Parser_pst->Patch_st);
+
+  if(New_pst->ThresholdDarkPercent_u8 > 100)
+  {
+    strcpy(Parser_pst->ErrorField_ac, "threshold_dark");
+    Parser_pst->Error_pc = "range 0...100";
+  }
+  else if(New_pst->ThresholdBrightPercent_u8 > 100)
+  {
+    strcpy(Parser_pst->ErrorField_ac, "threshold_bright");
+    Parser_pst->Error_pc = "range 0...100";
+  }
+  else if(New_pst->ThresholdDarkPercent_u8 > New_pst->ThresholdBrightPercent_u8)
+  {
+    strcpy(Parser_pst->ErrorField_ac, "threshold_dark");
+    Parser_pst->Error_pc = "must not exceed threshold_bright";
+  }
+  else if((New_pst->Latitude_f32 < -90.0F) || (New_pst->Latitude_f32 > 90.0F))
+  {
+    strcpy(Parser_pst->ErrorField_ac, "latitude");
+    Parser_pst->Error_pc = "range -90...90";
+  }
+  else if((New_pst->Longitude_f32 < -180.0F) || (New_pst->Longitude_f32 > 180.0F))
+  {
+    strcpy(Parser_pst->ErrorField_ac, "longitude");
+    Parser_pst->Error_pc = "range -180...180";
+  }
+  else if(New_pst->ManualRampSec_u16 > 3600)
+  {
+    strcpy(Parser_pst->ErrorField_ac, "manual_ramp_s");
+    Parser_pst->Error_pc = "range 0...3600";
+  }
+  else if(New_pst->MqttPort_u16 == 0)
+  {
+    strcpy(Parser_pst->ErrorField_ac, "mqtt_port");
+    Parser_pst->Error_pc = "range 1...65535";
+  }
+  else if((New_pst->MqttIntervalMsec_u16 < 100) || (New_pst->MqttIntervalMsec_u16 > 60000))
+  {
+    strcpy(Parser_pst->ErrorField_ac, "mqtt_interval_ms");
+    Parser_pst->Error_pc = "range 100...60000";
+  }
+  else if(New_pst->FleetStaggerMsec_u16 > 60000)
+  {
+    strcpy(Parser_pst->ErrorField_ac, "fleet_stagger_ms");
+    Parser_pst->Error_pc = "range 0...60000";
+  }
+  else if(New_pst->Photoperiod_st.TargetMin_u16 > PHOTOPERIOD_MIN_MAX)
+  {
+    strcpy(Parser_pst->ErrorField_ac, "photoperiod_min");
+    Parser_pst->Error_pc = "range 0...1440 (0 = table)";
+  }
+  else if(New_pst->Photoperiod_st.MorningPercent_u8 > 100)
+  {
+    strcpy(Parser_pst->ErrorField_ac, "photoperiod_morning_pct");
+    Parser_pst->Error_pc = "range 0...100";
+  }
+  else if(New_pst->Photoperiod_st.DimMin_u8 > PHOTOPERIOD_DIM_MIN_MAX)
+  {
+    strcpy(Parser_pst->ErrorField_ac, "photoperiod_dim_min");
+    Parser_pst->Error_pc = "range 0...240";
+  }
+  else if(!((New_pst->StripWatts_f32 >= 0.0F) && (New_pst->StripWatts_f32 <= ENERGY_WATTS_MAX)))   //also NaN
+  {
+    strcpy(Parser_pst->ErrorField_ac, "strip_watts");
+    Parser_pst->Error_pc = "range 0...200 (0 = unknown)";
+  }
+  else
+  {
+    return true;
+  }
+
+  Parser_pst->State_u8 = PARSER_ERROR;
+
+  return false;
+}
+//------------------------------
+
+
+//------------------------------
+// copy the fields present in the patch, others keep their value
+//------------------------------
+static void Merge_v(DeviceConfig_t *Config_pst, const ConfigPatch_t *Patch_pst)
+{
+  const DeviceConfig_t *New_pst = &Patch_pst->Config_st;
+  uint32_t Present_u32 = Patch_pst->Present_u32;
+
+  if(Present_u32 & CONFIG_FIELD_THRESHOLD_DARK)
+  {
+    Config_pst->ThresholdDarkPercent_u8 = New_pst->ThresholdDarkPercent_u8;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_THRESHOLD_BRIGHT)
+  {
+    Config_pst->ThresholdBrightPercent_u8 = New_pst->ThresholdBrightPercent_u8;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_LATITUDE)
+  {
+    Config_pst->Latitude_f32 = New_pst->Latitude_f32;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_LONGITUDE)
+  {
+    Config_pst->Longitude_f32 = New_pst->Longitude_f32;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_MANUAL_RAMP)
+  {
+    Config_pst->ManualRampSec_u16 = New_pst->ManualRampSec_u16;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_MQTT_BROKER)
+  {
+    strcpy(Config_pst->MqttBroker_ac, New_pst->MqttBroker_ac);
+  }
+
+  if(Present_u32 & CONFIG_FIELD_MQTT_PORT)
+  {
+    Config_pst->MqttPort_u16 = New_pst->MqttPort_u16;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_MQTT_INTERVAL)
+  {
+    Config_pst->MqttIntervalMsec_u16 = New_pst->MqttIntervalMsec_u16;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_SENSOR_AIR)
+  {
+    strcpy(Config_pst->SensorRom_aac [TEMP_ROLE_AIR], New_pst->SensorRom_aac [TEMP_ROLE_AIR]);
+  }
+
+  if(Present_u32 & CONFIG_FIELD_SENSOR_WATER)
+  {
+    strcpy(Config_pst->SensorRom_aac [TEMP_ROLE_WATER], New_pst->SensorRom_aac [TEMP_ROLE_WATER]);
+  }
+
+  if(Present_u32 & CONFIG_FIELD_SENSOR_OUTDOOR)
+  {
+    strcpy(Config_pst->SensorRom_aac [TEMP_ROLE_OUTDOOR], New_pst->SensorRom_aac [TEMP_ROLE_OUTDOOR]);
+  }
+
+  if(Present_u32 & CONFIG_FIELD_FLEET_ROLE)
+  {
+    Config_pst->FleetRole_u8 = New_pst->FleetRole_u8;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_FLEET_STAGGER)
+  {
+    Config_pst->FleetStaggerMsec_u16 = New_pst->FleetStaggerMsec_u16;
+  }
+
+  for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+  {
+    if(Present_u32 & (CONFIG_FIELD_NTP_SERVER_1 << i))
+    {
+      strcpy(Config_pst->NtpServer_aac [i], New_pst->NtpServer_aac [i]);
+    }
+  }
+
+  if(Present_u32 & CONFIG_FIELD_PHOTOPERIOD)
+  {
+    Config_pst->Photoperiod_st.TargetMin_u16 = New_pst->Photoperiod_st.TargetMin_u16;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_PHOTOPERIOD_AM)
+  {
+    Config_pst->Photoperiod_st.MorningPercent_u8 = New_pst->Photoperiod_st.MorningPercent_u8;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_PHOTOPERIOD_DIM)
+  {
+    Config_pst->Photoperiod_st.DimMin_u8 = New_pst->Photoperiod_st.DimMin_u8;
+  }
+
+  if(Present_u32 & CONFIG_FIELD_STRIP_WATTS)
+  {
+    Config_pst->StripWatts_f32 = New_pst->StripWatts_f32;
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// apply validated patch (date/time is set by the caller)
+//------------------------------
+void Config_Apply_v(const ConfigPatch_t *Patch_pst)
+{
+  const uint32_t ConfigFields_u32 = CONFIG_FIELD_THRESHOLD_DARK | CONFIG_FIELD_THRESHOLD_BRIGHT | CONFIG_FIELD_LATITUDE
+                                    | CONFIG_FIELD_LONGITUDE | CONFIG_FIELD_MANUAL_RAMP | CONFIG_FIELD_MQTT_BROKER
+                                    | CONFIG_FIELD_MQTT_PORT | CONFIG_FIELD_MQTT_INTERVAL | CONFIG_FIELD_SENSOR_AIR
+                                    | CONFIG_FIELD_SENSOR_WATER | CONFIG_FIELD_SENSOR_OUTDOOR | CONFIG_FIELD_FLEET_ROLE
+                                    | CONFIG_FIELD_FLEET_STAGGER | CONFIG_FIELD_NTP_SERVER_1 | CONFIG_FIELD_NTP_SERVER_2
+                                    | CONFIG_FIELD_NTP_SERVER_3 | CONFIG_FIELD_NTP_SERVER_4 | CONFIG_FIELD_PHOTOPERIOD
+                                    | CONFIG_FIELD_PHOTOPERIOD_AM | CONFIG_FIELD_PHOTOPERIOD_DIM | CONFIG_FIELD_STRIP_WATTS;
+
+  if(Patch_pst->Present_u32 & ConfigFields_u32)
+  {
+    //only the fields of the request: changes of other requests meanwhile are kept
+    portENTER_CRITICAL(&ConfigMux);
+    Merge_v(&Config_st, Patch_pst);
+    portEXIT_CRITICAL(&ConfigMux);
+
+    Config_Save_v();
+  }
+
+  if(Patch_pst->Present_u32 & CONFIG_FIELD_SCHEDULE_MODE)
+  {
+    Schedule_SetMode_v(Patch_pst->ScheduleMode_u8);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// parse "YYYY-MM-DD HH:MM:SS"
+//------------------------------
+bool Config_ParseDateTime_b(const char *Text_pc, ConfigDateTime_t *DateTime_pst)
+{
+  static const uint8_t DaysInMonth_au8 [12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  //                            Y Y Y Y - M M - D D   H H : M M : S S
+  static const char Pattern_ac [] = "dddd-dd-dd dd:dd:dd";
+  uint8_t Digit_au8 [14];
+  uint8_t n_u8 = 0;
+
+  if(strlen(Text_pc) != sizeof(Pattern_ac) - 1)
+  {
+    return false;
+  }
+
+  for(uint8_t i = 0; i < sizeof(Pattern_ac) - 1; i++)
+  {
+    if(Pattern_ac [i] == 'd')
+    {
+      if((Text_pc [i] < '0') || (Text_pc [i] > '9'))
+      {
+        return false;
+      }
+      Digit_au8 [n_u8++] = Text_pc [i] - '0';
+    }
+    else if((Text_pc [i] != Pattern_ac [i]) && !((i == 10) && (Text_pc [i] == 'T')))
+    {
+      return false;
+    }
+  }
+
+  DateTime_pst->Year_u16 = Digit_au8 [0] * 1000 + Digit_au8 [1] * 100 + Digit_au8 [2] * 10 + Digit_au8 [3];
+  DateTime_pst->Month_u8 = Digit_au8 [4] * 10 + Digit_au8 [5];
+  DateTime_pst->Day_u8 = Digit_au8 [6] * 10 + Digit_au8 [7];
+  DateTime_pst->Hour_u8 = Digit_au8 [8] * 10 + Digit_au8 [9];
+  DateTime_pst->Minute_u8 = Digit_au8 [10] * 10 + Digit_au8 [11];
+  DateTime_pst->Second_u8 = Digit_au8 [12] * 10 + Digit_au8 [13];
+
+  uint16_t Year_u16 = DateTime_pst->Year_u16;
+  bool Leap_b = (((Year_u16 % 4) == 0) && ((Year_u16 % 100) != 0)) || ((Year_u16 % 400) == 0);
+
+  return (DateTime_pst->Year_u16 >= 2000) && (DateTime_pst->Year_u16 <= 2099)
+         && (DateTime_pst->Month_u8 >= 1) && (DateTime_pst->Month_u8 <= 12)
+         && (DateTime_pst->Day_u8 >= 1) && (DateTime_pst->Day_u8 <= DaysInMonth_au8 [DateTime_pst->Month_u8 - 1] + ((DateTime_pst->Month_u8 == 2) && Leap_b))
+         && (DateTime_pst->Hour_u8 < 24) && (DateTime_pst->Minute_u8 < 60) && (DateTime_pst->Second_u8 < 60);
+}
+//------------------------------
+
+
+//------------------------------
+// print current settings as JSON
+//------------------------------
+void Config_PrintJson_v(Print &Out, const char *DateTime_pc)
+{
+  DeviceConfig_t Current_st;
+
+  Config_Copy_v(&Current_st);
+
+  Out.printf("{\"time\":\"%s\",\"threshold_dark\":%u,\"threshold_bright\":%u,\"latitude\":%.6f,\"longitude\":%.6f,"
+             "\"manual_ramp_s\":%u,\"schedule_mode\":\"%s\",\"mqtt_broker\":\"%s\",\"mqtt_port\":%u,\"mqtt_interval_ms\":%u,"
+             "\"sensor_air\":\"%s\",\"sensor_water\":\"%s\",\"sensor_outdoor\":\"%s\",\"fleet_role\":\"%s\",\"fleet_stagger_ms\":%u,"
+             "\"ntp_server_1\":\"%s\",\"ntp_server_2\":\"%s\",\"ntp_server_3\":\"%s\",\"ntp_server_4\":\"%s\","
+             "\"photoperiod_min\":%u,\"photoperiod_morning_pct\":%u,\"photoperiod_dim_min\":%u,\"strip_watts\":%.1f}",
+             DateTime_pc, Current_st.ThresholdDarkPercent_u8, Current_st.ThresholdBrightPercent_u8,
+             Current_st.Latitude_f32, Current_st.Longitude_f32, Current_st.ManualRampSec_u16,
+             (ScheduleMode_u8 == SCHEDULE_MODE_RULES) ? "rules" : "table",
+             Current_st.MqttBroker_ac, Current_st.MqttPort_u16, Current_st.MqttIntervalMsec_u16,
+             Current_st.SensorRom_aac [TEMP_ROLE_AIR], Current_st.SensorRom_aac [TEMP_ROLE_WATER],
+             Current_st.SensorRom_aac [TEMP_ROLE_OUTDOOR], Fleet_RoleName_pc(Current_st.FleetRole_u8),
+             Current_st.FleetStaggerMsec_u16, Current_st.NtpServer_aac [0], Current_st.NtpServer_aac [1],
+             Current_st.NtpServer_aac [2], Current_st.NtpServer_aac [3], Current_st.Photoperiod_st.TargetMin_u16,
+             Current_st.Photoperiod_st.MorningPercent_u8, Current_st.Photoperiod_st.DimMin_u8, Current_st.StripWatts_f32);
+}
+//------------------------------
@@ -0,0 +1,511 @@
+//------------------------------
+// Energy meter
+//
+// The zone output hook reports every level change. The interval since the
+// previous change is closed with the old levels: energy = strip power *
+// sum of levels / full scale * time, on-time for every zone that was on.
+// The level is the LEDC duty, so this is the power the strip really draws,
+// not the perceived brightness. Remainders below 1 mWh / 1 s are carried
+// over, nothing is lost between the many small steps of a ramp.
+//
+// The telemetry task calls EnergyMeter_Tick_v once a minute: it closes the
+// day and the month, keeps a copy in RTC memory (survives warm resets) and
+// writes the counter file at midnight and every 6 h while the light was on.
+//
+// The counter file is written to two slots in turn, each record with a
+// sequence number and CRC: a power cut while writing only loses the record
+// being written, the load takes the newest valid one.
+//------------------------------
+
+//includes
+//------------------------------
+#include "EnergyMeter.h"
+
+#include "SPIFFS.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define ENERGY_FILE_SLOTS 2
+#define ENERGY_FILE_VERSION 2                             //version 1: /energy.bin, counters only
+#define ENERGY_RETAIN_MAGIC 0x454E4701                    //"ENG", version 1
+#define ENERGY_UNIT_PER_MWH (10ULL * ZONE_LEVEL_MAX * 3600)  //0.1 W * level * msec per mWh
+//------------------------------
+
+//one slot of the counter file
+typedef struct
+{
+  uint8_t Version_u8;
+  uint8_t Reserved_au8 [3];
+  uint32_t Seq_u32;                                       //higher = newer
+  EnergyCounters_t Counters_st;
+  uint32_t Crc_u32;
+} EnergyRecord_t;
+
+//counters for restart after brownout / watchdog (not initialised on reset)
+typedef struct
+{
+  uint32_t Magic_u32;
+  EnergyCounters_t Counters_st;
+  uint32_t Check_u32;
+} EnergyRetained_t;
+
+//global variables
+//------------------------------
+static EnergyCounters_t Counters_st;
+
+static uint16_t Level_au16 [ZONE_COUNT_MAX];              //output level since the last change
+static uint32_t LevelSum_u32 = 0;
+static uint8_t OnMask_u8 = 0;
+static uint32_t LastMsec_u32 = 0;                         //integrated up to
+
+static uint64_t EnergyRest_u64 = 0;                       //below 1 mWh
+static uint16_t OnRestMsec_u16 = 0;                       //below 1 s
+static uint16_t ZoneRestMsec_au16 [ZONE_COUNT_MAX];
+
+static uint16_t DeciWatts_u16 = 0;                        //strip power of one zone at full level
+static bool Ready_b = false;
+static bool Dirty_b = false;                              //light was on since the last save
+static uint32_t SaveMsec_u32 = 0;
+static uint32_t SaveSeq_u32 = 0;                          //sequence number of the newest record
+
+static const char *File_apc [ENERGY_FILE_SLOTS] = {"/energy.bin", "/energy_b.bin"};
+
+RTC_NOINIT_ATTR static EnergyRetained_t Retained_st;
+static portMUX_TYPE EnergyMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void Integrate_v(uint32_t Now_u32);
+static bool NewDay_b(uint32_t DateKey_u32);
+static uint32_t RetainCheck_u32(const EnergyRetained_t *Retained_pst);
+static bool Load_b(EnergyCounters_t *Counters_pst);
+static uint32_t Crc32_u32(const uint8_t *Data_pu8, size_t Len_u32);
+static void Save_v(const EnergyCounters_t *Counters_pst);
+static void PrintPeriod_v(Print &Out, const char *Name_pc, const char *KeyName_pc, const EnergyPeriod_t *Period_pst);
+//------------------------------
+
+
+//------------------------------
+// load counters: RTC copy after warm reset, else file (SPIFFS must be mounted)
+//------------------------------
+void EnergyMeter_Init_v(float StripWatts_f32)
+{
+  EnergyCounters_t Loaded_st;
+  const char *Source_pc = "new";
+
+  memset(&Loaded_st, 0, sizeof(Loaded_st));
+
+  if((esp_reset_reason() != ESP_RST_POWERON) && (Retained_st.Magic_u32 == ENERGY_RETAIN_MAGIC) &&
+     (RetainCheck_u32(&Retained_st) == Retained_st.Check_u32))
+  {
+    Loaded_st = Retained_st.Counters_st;
+    Source_pc = "RTC memory";
+  }
+  else if(Load_b(&Loaded_st))
+  {
+    Source_pc = File_apc [SaveSeq_u32 % ENERGY_FILE_SLOTS];
+  }
+
+  //boot time before this point is not counted
+  portENTER_CRITICAL(&EnergyMux);
+  Counters_st = Loaded_st;
+  LastMsec_u32 = millis();
+  SaveMsec_u32 = LastMsec_u32;
+  Ready_b = true;
+  portEXIT_CRITICAL(&EnergyMux);
+
+  EnergyMeter_SetWatts_v(StripWatts_f32);
+
+  Serial.printf("energy: %u Wh since %u (%s)\n", (uint32_t)(Loaded_st.Lifetime_st.MilliWh_u64 / 1000),
+                Loaded_st.Lifetime_st.Key_u32, Source_pc);
+}
+//------------------------------
+
+
+//------------------------------
+// strip power of one zone at full level (0 = unknown, on-time only)
+//------------------------------
+void EnergyMeter_SetWatts_v(float StripWatts_f32)
+{
+  uint16_t New_u16 = (uint16_t)lroundf(constrain(StripWatts_f32, 0.0F, (float)ENERGY_WATTS_MAX) * 10.0F);
+
+  //time so far at the old power
+  portENTER_CRITICAL(&EnergyMux);
+  Integrate_v(millis());
+  DeciWatts_u16 = New_u16;
+  portEXIT_CRITICAL(&EnergyMux);
+}
+//------------------------------
+
+
+//------------------------------
+// output level of a zone changed
+//------------------------------
+void EnergyMeter_Output_v(uint8_t Zone_u8, uint16_t Level_u16)
+{
+  if(Zone_u8 >= ZONE_COUNT_MAX)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&EnergyMux);
+
+  Integrate_v(millis());
+
+  LevelSum_u32 = LevelSum_u32 - Level_au16 [Zone_u8] + Level_u16;
+  Level_au16 [Zone_u8] = Level_u16;
+
+  if(Level_u16 > 0)
+  {
+    OnMask_u8 |= (1 << Zone_u8);
+  }
+  else
+  {
+    OnMask_u8 &= ~(1 << Zone_u8);
+  }
+
+  portEXIT_CRITICAL(&EnergyMux);
+}
+//------------------------------
+
+
+//------------------------------
+// periodic: close day / month, update RTC copy, save now and then
+//------------------------------
+void EnergyMeter_Tick_v(uint32_t DateKey_u32)
+{
+  EnergyCounters_t Save_st;
+  bool Save_b = false;
+  uint32_t Now_u32 = millis();
+
+  if(!Ready_b)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&EnergyMux);
+
+  Integrate_v(Now_u32);
+
+  if(NewDay_b(DateKey_u32) || (Dirty_b && (Now_u32 - SaveMsec_u32 >= ENERGY_SAVE_SEC * 1000UL)))
+  {
+    Save_st = Counters_st;
+    Save_b = true;
+    Dirty_b = false;
+    SaveMsec_u32 = Now_u32;
+  }
+
+  Retained_st.Magic_u32 = ENERGY_RETAIN_MAGIC;
+  Retained_st.Counters_st = Counters_st;
+  Retained_st.Check_u32 = RetainCheck_u32(&Retained_st);
+
+  portEXIT_CRITICAL(&EnergyMux);
+
+  if(Save_b)
+  {
+    Save_v(&Save_st);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// on-hours of zones restart at 0 (strip replaced)
+//------------------------------
+void EnergyMeter_ResetZones_v(uint8_t ZoneMask_u8)
+{
+  EnergyCounters_t Save_st;
+
+  portENTER_CRITICAL(&EnergyMux);
+
+  Integrate_v(millis());
+
+  for(uint8_t i = 0; i < ZONE_COUNT_MAX; i++)
+  {
+    if(ZoneMask_u8 & (1 << i))
+    {
+      Counters_st.ZoneOnSec_au32 [i] = 0;
+      ZoneRestMsec_au16 [i] = 0;
+    }
+  }
+
+  Save_st = Counters_st;
+
+  portEXIT_CRITICAL(&EnergyMux);
+
+  if(Ready_b)
+  {
+    Save_v(&Save_st);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// counters including the running interval
+//------------------------------
+void EnergyMeter_Get_v(EnergyCounters_t *Counters_pst)
+{
+  portENTER_CRITICAL(&EnergyMux);
+  Integrate_v(millis());
+  *Counters_pst = Counters_st;
+  portEXIT_CRITICAL(&EnergyMux);
+}
+
+float EnergyMeter_PowerW_f32(void)
+{
+  uint64_t Power_u64;
+
+  portENTER_CRITICAL(&EnergyMux);
+  Power_u64 = (uint64_t)DeciWatts_u16 * LevelSum_u32;
+  portEXIT_CRITICAL(&EnergyMux);
+
+  return (float)Power_u64 / (ZONE_LEVEL_MAX * 10.0F);
+}
+//------------------------------
+
+
+//------------------------------
+// output: {"strip_watts":..,"power_w":..,"today":{..},"prev_day":{..},"month":{..},"prev_month":{..},
+//          "lifetime":{..},"zone_on_h":[..]}
+//------------------------------
+void EnergyMeter_PrintJson_v(Print &Out)
+{
+  EnergyCounters_t Copy_st;
+
+  EnergyMeter_Get_v(&Copy_st);
+
+  Out.printf("{\"strip_watts\":%.1f,\"power_w\":%.2f,", DeciWatts_u16 / 10.0F, EnergyMeter_PowerW_f32());
+  PrintPeriod_v(Out, "today", "date", &Copy_st.Day_st);
+  Out.print(",");
+  PrintPeriod_v(Out, "prev_day", "date", &Copy_st.PrevDay_st);
+  Out.print(",");
+  PrintPeriod_v(Out, "month", "month", &Copy_st.Month_st);
+  Out.print(",");
+  PrintPeriod_v(Out, "prev_month", "month", &Copy_st.PrevMonth_st);
+  Out.print(",");
+  PrintPeriod_v(Out, "lifetime", "since", &Copy_st.Lifetime_st);
+  Out.print(",\"zone_on_h\":[");
+
+  for(uint8_t i = 0; i < LightZone_Count_u8(); i++)
+  {
+    Out.printf("%s%.2f", (i == 0) ? "" : ",", Copy_st.ZoneOnSec_au32 [i] / 3600.0F);
+  }
+
+  Out.print("]}");
+}
+//------------------------------
+
+
+//------------------------------
+// close the interval since the last call with the levels of that time (EnergyMux held)
+//------------------------------
+static void Integrate_v(uint32_t Now_u32)
+{
+  uint32_t Delta_u32 = Now_u32 - LastMsec_u32;
+
+  LastMsec_u32 = Now_u32;
+
+  if((OnMask_u8 == 0) || (Delta_u32 == 0))
+  {
+    return;
+  }
+
+  //max. 200 W * 8 zones full: ~200 days until the 64 bit product overflows
+  uint64_t Energy_u64 = EnergyRest_u64 + (uint64_t)DeciWatts_u16 * LevelSum_u32 * Delta_u32;
+  uint64_t MilliWh_u64 = Energy_u64 / ENERGY_UNIT_PER_MWH;
+  uint32_t OnMsec_u32 = OnRestMsec_u16 + Delta_u32;
+
+  EnergyRest_u64 = Energy_u64 - MilliWh_u64 * ENERGY_UNIT_PER_MWH;
+  OnRestMsec_u16 = OnMsec_u32 % 1000;
+
+  Counters_st.Day_st.MilliWh_u64 += MilliWh_u64;
+  Counters_st.Month_st.MilliWh_u64 += MilliWh_u64;
+  Counters_st.Lifetime_st.MilliWh_u64 += MilliWh_u64;
+  Counters_st.Day_st.OnSec_u32 += OnMsec_u32 / 1000;
+  Counters_st.Month_st.OnSec_u32 += OnMsec_u32 / 1000;
+  Counters_st.Lifetime_st.OnSec_u32 += OnMsec_u32 / 1000;
+
+  for(uint8_t i = 0; i < ZONE_COUNT_MAX; i++)
+  {
+    if(OnMask_u8 & (1 << i))
+    {
+      uint32_t ZoneMsec_u32 = ZoneRestMsec_au16 [i] + Delta_u32;
+
+      Counters_st.ZoneOnSec_au32 [i] += ZoneMsec_u32 / 1000;
+      ZoneRestMsec_au16 [i] = ZoneMsec_u32 % 1000;
+    }
+  }
+
+  Dirty_b = true;
+}
+//------------------------------
+
+
+//------------------------------
+// start a new day (and month) on date change (EnergyMux held)
+//------------------------------
+static bool NewDay_b(uint32_t DateKey_u32)
+{
+  if(DateKey_u32 == Counters_st.Day_st.Key_u32)
+  {
+    return false;
+  }
+
+  if(Counters_st.Day_st.Key_u32 != 0)
+  {
+    Counters_st.PrevDay_st = Counters_st.Day_st;
+  }
+
+  memset(&Counters_st.Day_st, 0, sizeof(EnergyPeriod_t));
+  Counters_st.Day_st.Key_u32 = DateKey_u32;
+
+  if(DateKey_u32 / 100 != Counters_st.Month_st.Key_u32)
+  {
+    if(Counters_st.Month_st.Key_u32 != 0)
+    {
+      Counters_st.PrevMonth_st = Counters_st.Month_st;
+    }
+
+    memset(&Counters_st.Month_st, 0, sizeof(EnergyPeriod_t));
+    Counters_st.Month_st.Key_u32 = DateKey_u32 / 100;
+  }
+
+  if(Counters_st.Lifetime_st.Key_u32 == 0)
+  {
+    Counters_st.Lifetime_st.Key_u32 = DateKey_u32;
+  }
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// checksum of the RTC copy
+//------------------------------
+static uint32_t RetainCheck_u32(const EnergyRetained_t *Retained_pst)
+{
+  const uint8_t *Byte_pu8 = (const uint8_t *)Retained_pst;
+  uint32_t Check_u32 = 0xA5A5A5A5;
+
+  for(uint16_t i = 0; i < offsetof(EnergyRetained_t, Check_u32); i++)
+  {
+    Check_u32 = ((Check_u32 << 5) | (Check_u32 >> 27)) ^ Byte_pu8 [i];
+  }
+
+  return Check_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// newest valid record of both slots (version 1 file counts as oldest)
+//------------------------------
+static bool Load_b(EnergyCounters_t *Counters_pst)
+{
+  bool Found_b = false;
+
+  for(uint8_t i = 0; i < ENERGY_FILE_SLOTS; i++)
+  {
+    EnergyRecord_t Record_st;
+    File file = SPIFFS.open(File_apc [i], FILE_READ);
+
+    if(!file)
+    {
+      continue;
+    }
+
+    size_t Size_u32 = file.read((uint8_t *)&Record_st, sizeof(Record_st));
+    file.close();
+
+    if((Size_u32 == sizeof(Record_st)) && (Record_st.Version_u8 == ENERGY_FILE_VERSION)
+       && (Record_st.Crc_u32 == Crc32_u32((const uint8_t *)&Record_st, offsetof(EnergyRecord_t, Crc_u32))))
+    {
+      if(!Found_b || (Record_st.Seq_u32 > SaveSeq_u32))
+      {
+        *Counters_pst = Record_st.Counters_st;
+        SaveSeq_u32 = Record_st.Seq_u32;
+        Found_b = true;
+      }
+    }
+    else if((i == 0) && !Found_b && (Size_u32 >= 1 + sizeof(EnergyCounters_t)) && (Record_st.Version_u8 == 1))
+    {
+      //version 1: counters right after the version byte, no check
+      memcpy(Counters_pst, (const uint8_t *)&Record_st + 1, sizeof(EnergyCounters_t));
+      SaveSeq_u32 = 0;
+      Found_b = true;
+    }
+  }
+
+  return Found_b;
+}
+//------------------------------
+
+
+//------------------------------
+// CRC-32 (IEEE, reflected)
+//------------------------------
+static uint32_t Crc32_u32(const uint8_t *Data_pu8, size_t Len_u32)
+{
+  uint32_t Crc_u32 = 0xFFFFFFFF;
+
+  for(size_t i = 0; i < Len_u32; i++)
+  {
+    Crc_u32 ^= Data_pu8 [i];
+
+    for(uint8_t Bit_u8 = 0; Bit_u8 < 8; Bit_u8++)
+    {
+      Crc_u32 = (Crc_u32 >> 1) ^ ((Crc_u32 & 1) ? 0xEDB88320 : 0);
+    }
+  }
+
+  return ~Crc_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// store counters into the older slot
+//------------------------------
+static void Save_v(const EnergyCounters_t *Counters_pst)
+{
+  EnergyRecord_t Record_st;
+
+  memset(&Record_st, 0, sizeof(Record_st));
+  Record_st.Version_u8 = ENERGY_FILE_VERSION;
+  Record_st.Counters_st = *Counters_pst;
+
+  //telemetry task and web reset may save at the same time: each gets its own slot
+  portENTER_CRITICAL(&EnergyMux);
+  Record_st.Seq_u32 = ++SaveSeq_u32;
+  portEXIT_CRITICAL(&EnergyMux);
+
+  Record_st.Crc_u32 = Crc32_u32((const uint8_t *)&Record_st, offsetof(EnergyRecord_t, Crc_u32));
+
+  File file = SPIFFS.open(File_apc [Record_st.Seq_u32 % ENERGY_FILE_SLOTS], FILE_WRITE);
+
+  if(!file)
+  {
+    Serial.print("energy: couldn't write counter file\n");
+    return;
+  }
+
+  file.write((const uint8_t *)&Record_st, sizeof(Record_st));
+  file.close();
+}
+//------------------------------
+
+
+//------------------------------
+// "name":{"key":..,"wh":..,"on_h":..}
+//------------------------------
+static void PrintPeriod_v(Print &Out, const char *Name_pc, const char *KeyName_pc, const EnergyPeriod_t *Period_pst)
+{
+  Out.printf("\"%s\":{\"%s\":%u,\"wh\":%u.%03u,\"on_h\":%.2f}", Name_pc, KeyName_pc, Period_pst->Key_u32,
+             (uint32_t)(Period_pst->MilliWh_u64 / 1000), (uint32_t)(Period_pst->MilliWh_u64 % 1000),
+             Period_pst->OnSec_u32 / 3600.0F);
+}
+//------------------------------
@@ -0,0 +1,547 @@
+//------------------------------
+// Fleet synchronization
+//
+// Fleet clock: milliseconds of the leader's RTC time. The leader derives
+// it from its uptime clock, anchored to the RTC once and again only when
+// the RTC was set (NTP, web), so it never jitters by the RTC's second
+// steps. A clock packet every second carries it; a follower takes
+// leader time - own uptime as one sample of the offset and uses the
+// largest of the last FLEET_OFFSET_SAMPLES (network delay only makes
+// samples smaller). Its RTC is only set when it is more than
+// FLEET_RTC_TOLERANCE_SEC off, ramps are timed by the fleet clock.
+//
+// A plan is the keyframe program the leader's schedule started on its
+// AUTO zones (sunrise, sunset, rule event, off), stamped with the fleet
+// time of keyframe 0 and sent right away, then repeated every
+// FLEET_PLAN_REPEAT_MSEC. A follower runs a new plan on its AUTO zones
+// once the fleet clock reaches start + stagger; a packet that arrives
+// later joins the program at the elapsed offset, so delay and repeats
+// cost no accuracy. Zone masks of the leader are not sent.
+//
+// Without clock packets for FLEET_LEADER_TIMEOUT_MSEC a follower returns
+// to its own schedule.
+//------------------------------
+
+//includes
+//------------------------------
+#include "FleetSync.h"
+#include "DeviceConfig.h"
+#include "TaskBudget.h"
+#include "WifiManager.h"
+
+#include <WiFiUdp.h>
+#include "esp_timer.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define FLEET_RTC_CHECK_MSEC 10000
+
+static const char * const RoleName_apc [] = {"off", "leader", "follower"};
+//------------------------------
+
+//global variables
+//------------------------------
+static FleetHooks_t Hooks_st;
+static WiFiUDP Udp;
+static bool Joined_b = false;                 //multicast group joined on this connection
+static uint32_t JoinedConnect_u32 = 0;
+
+static volatile uint8_t Role_u8 = FLEET_ROLE_OFF;
+static uint16_t StaggerMsec_u16 = 0;
+
+//leader
+static bool Anchored_b = false;
+static int64_t LeaderBaseMsec_s64 = 0;        //fleet clock - uptime
+static uint32_t Seq_u32 = 0;
+static FleetPlan_t Plan_st;                   //current plan, generation 0 = none
+static bool PlanSend_b = false;
+static uint32_t LastClockMsec_u32 = 0;
+static uint32_t LastPlanMsec_u32 = 0;
+
+//follower
+static volatile bool Locked_b = false;
+static uint32_t LeaderNode_u32 = 0;
+static uint32_t LastHeardMsec_u32 = 0;
+static int64_t Sample_as64 [FLEET_OFFSET_SAMPLES];
+static uint8_t SampleCount_u8 = 0;
+static uint8_t SampleNext_u8 = 0;
+static int64_t OffsetMsec_s64 = 0;            //fleet clock - uptime
+static FleetPlan_t Pending_st;
+static bool PendingValid_b = false;
+static uint8_t AppliedPlan_u8 = 0;
+static uint32_t LastRtcCheckMsec_u32 = 0;
+
+//statistics
+static uint32_t Rx_u32 = 0;
+static uint32_t Tx_u32 = 0;
+static uint32_t Invalid_u32 = 0;
+static uint32_t Steps_u32 = 0;                //leader clock jumps
+static uint32_t RtcSets_u32 = 0;
+static uint32_t Conflicts_u32 = 0;            //clock packets of a second leader
+static uint32_t JoinLateMsec_u32 = 0;         //last plan: fleet time past start + stagger
+
+static portMUX_TYPE FleetMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void Fleet_task(void * pvParameters);
+static int64_t UptimeMsec_s64(void);
+static int64_t LeaderClock_s64(void);
+static void Reset_v(void);
+static void Receive_v(void);
+static void ReceiveClock_v(const FleetClock_t *Clock_pst);
+static void ReceivePlan_v(const FleetPlan_t *Plan_pst, int Len_s32);
+static void Leader_v(uint32_t Now_u32);
+static void Follower_v(uint32_t Now_u32);
+static void Send_v(const void *Packet_pv, size_t Len_u32);
+//------------------------------
+
+
+//------------------------------
+// start fleet task (idle while the role is off)
+//------------------------------
+void Fleet_Start_v(const FleetHooks_t *Hooks_pst)
+{
+  Hooks_st = *Hooks_pst;
+
+  Task_Start_h(TASK_ID_FLEET, Fleet_task, NULL);
+}
+//------------------------------
+
+
+//------------------------------
+// fleet task: role from config, multicast group, packets
+//------------------------------
+static void Fleet_task(void * pvParameters)
+{
+  DeviceConfig_t Current_st;
+
+  while(1)
+  {
+    Config_Copy_v(&Current_st);
+
+    if(Current_st.FleetRole_u8 != Role_u8)
+    {
+      Reset_v();
+      Role_u8 = Current_st.FleetRole_u8;
+    }
+
+    StaggerMsec_u16 = Current_st.FleetStaggerMsec_u16;
+
+    if((Role_u8 == FLEET_ROLE_OFF) || !Wifi_Connected_b())
+    {
+      if(Joined_b)
+      {
+        Udp.stop();
+        Joined_b = false;
+      }
+
+      vTaskDelay(pdMS_TO_TICKS(FLEET_SYNC_MSEC));
+      continue;
+    }
+
+    //(re)join after every WiFi connect
+    if(!Joined_b || (Wifi_ConnectCount_u32() != JoinedConnect_u32))
+    {
+      Udp.stop();
+      Joined_b = Udp.beginMulticast(IPAddress(FLEET_GROUP_IP), FLEET_PORT);
+      JoinedConnect_u32 = Wifi_ConnectCount_u32();
+    }
+
+    Receive_v();
+
+    if(Role_u8 == FLEET_ROLE_LEADER)
+    {
+      Leader_v(millis());
+    }
+    else
+    {
+      Follower_v(millis());
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(FLEET_POLL_MSEC));
+  }
+}
+
+static void Reset_v(void)
+{
+  portENTER_CRITICAL(&FleetMux);
+
+  Anchored_b = false;
+  Plan_st.Generation_u8 = 0;
+  PlanSend_b = false;
+
+  Locked_b = false;
+  LeaderNode_u32 = 0;
+  SampleCount_u8 = 0;
+  PendingValid_b = false;
+  AppliedPlan_u8 = 0;
+
+  portEXIT_CRITICAL(&FleetMux);
+}
+//------------------------------
+
+
+//------------------------------
+// clocks [ms]
+//------------------------------
+static int64_t UptimeMsec_s64(void)
+{
+  return esp_timer_get_time() / 1000;
+}
+
+//leader: uptime anchored to the RTC (RTC read outside the critical section)
+static int64_t LeaderClock_s64(void)
+{
+  int64_t Rtc_s64 = (int64_t)Hooks_st.UnixTime_pfn() * 1000;
+  int64_t Uptime_s64 = UptimeMsec_s64();
+
+  portENTER_CRITICAL(&FleetMux);
+
+  int64_t Clock_s64 = Uptime_s64 + LeaderBaseMsec_s64;
+
+  if(!Anchored_b || (llabs(Clock_s64 - Rtc_s64) > FLEET_RTC_TOLERANCE_SEC * 1000))
+  {
+    Steps_u32 += Anchored_b ? 1 : 0;
+    LeaderBaseMsec_s64 = Rtc_s64 - Uptime_s64;
+    Anchored_b = true;
+    Clock_s64 = Rtc_s64;
+  }
+
+  portEXIT_CRITICAL(&FleetMux);
+
+  return Clock_s64;
+}
+//------------------------------
+
+
+//------------------------------
+// leader: plan started by the schedule (any task, sent by the fleet task)
+//------------------------------
+void Fleet_Publish_v(const LightKeyframe_t *Keyframe_past, uint8_t Count_u8)
+{
+  if((Role_u8 != FLEET_ROLE_LEADER) || (Count_u8 == 0))
+  {
+    return;
+  }
+
+  int64_t Start_s64 = LeaderClock_s64();
+
+  Count_u8 = min<uint8_t>(Count_u8, ZONE_KEYFRAMES_MAX);
+
+  portENTER_CRITICAL(&FleetMux);
+
+  Plan_st.Generation_u8 = (Plan_st.Generation_u8 % 255) + 1;
+  Plan_st.Count_u8 = Count_u8;
+  Plan_st.StartSec_u32 = Start_s64 / 1000;
+  Plan_st.StartMsec_u16 = Start_s64 % 1000;
+  memcpy(Plan_st.Keyframe_ast, Keyframe_past, Count_u8 * sizeof(LightKeyframe_t));
+  PlanSend_b = true;
+
+  portEXIT_CRITICAL(&FleetMux);
+}
+
+static void Leader_v(uint32_t Now_u32)
+{
+  if((Now_u32 - LastClockMsec_u32) >= FLEET_SYNC_MSEC)
+  {
+    FleetClock_t Clock_st;
+    int64_t Clock_s64 = LeaderClock_s64();
+
+    LastClockMsec_u32 = Now_u32;
+
+    Clock_st.Header_st.Type_u8 = FLEET_MSG_SYNC;
+    Clock_st.Seq_u32 = ++Seq_u32;
+    Clock_st.UnixSec_u32 = Clock_s64 / 1000;
+    Clock_st.Msec_u16 = Clock_s64 % 1000;
+    Clock_st.Plan_u8 = Plan_st.Generation_u8;
+    Clock_st.Reserved_u8 = 0;
+
+    Send_v(&Clock_st, sizeof(Clock_st));
+  }
+
+  FleetPlan_t Copy_st;
+  bool Send_b;
+
+  portENTER_CRITICAL(&FleetMux);
+
+  Send_b = PlanSend_b || ((Plan_st.Generation_u8 != 0) && ((Now_u32 - LastPlanMsec_u32) >= FLEET_PLAN_REPEAT_MSEC));
+  PlanSend_b = false;
+  Copy_st = Plan_st;
+
+  portEXIT_CRITICAL(&FleetMux);
+
+  if(Send_b)
+  {
+    LastPlanMsec_u32 = Now_u32;
+    Copy_st.Header_st.Type_u8 = FLEET_MSG_PLAN;
+
+    Send_v(&Copy_st, FLEET_PLAN_HEADER_LEN + Copy_st.Count_u8 * sizeof(LightKeyframe_t));
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// follower: leader timeout, due plan, RTC discipline
+//------------------------------
+static void Follower_v(uint32_t Now_u32)
+{
+  FleetPlan_t Due_st;
+  bool Due_b = false;
+  uint32_t Offset_u32 = 0;
+
+  portENTER_CRITICAL(&FleetMux);
+
+  if(Locked_b && ((Now_u32 - LastHeardMsec_u32) >= FLEET_LEADER_TIMEOUT_MSEC))
+  {
+    //plan of a returning leader is joined again
+    Locked_b = false;
+    LeaderNode_u32 = 0;
+    SampleCount_u8 = 0;
+    PendingValid_b = false;
+    AppliedPlan_u8 = 0;
+  }
+
+  int64_t Fleet_s64 = UptimeMsec_s64() + OffsetMsec_s64;
+
+  if(Locked_b && PendingValid_b)
+  {
+    int64_t Start_s64 = (int64_t)Pending_st.StartSec_u32 * 1000 + Pending_st.StartMsec_u16 + StaggerMsec_u16;
+
+    if(Fleet_s64 >= Start_s64)
+    {
+      Due_st = Pending_st;
+      Due_b = true;
+      Offset_u32 = min<int64_t>(Fleet_s64 - Start_s64, UINT32_MAX);
+      JoinLateMsec_u32 = Offset_u32;
+      AppliedPlan_u8 = Pending_st.Generation_u8;
+      PendingValid_b = false;
+    }
+  }
+
+  bool Check_b = Locked_b && (SampleCount_u8 >= FLEET_OFFSET_SAMPLES / 2) && ((Now_u32 - LastRtcCheckMsec_u32) >= FLEET_RTC_CHECK_MSEC);
+
+  portEXIT_CRITICAL(&FleetMux);
+
+  if(Due_b && (Hooks_st.Plan_pfn != NULL))
+  {
+    Hooks_st.Plan_pfn(Due_st.Keyframe_ast, Due_st.Count_u8, Offset_u32);
+  }
+
+  if(Check_b)
+  {
+    uint32_t FleetSec_u32 = Fleet_s64 / 1000;
+    int32_t Diff_s32 = (int32_t)(FleetSec_u32 - Hooks_st.UnixTime_pfn());
+
+    LastRtcCheckMsec_u32 = Now_u32;
+
+    if((abs(Diff_s32) >= FLEET_RTC_TOLERANCE_SEC) && (Hooks_st.SetTime_pfn != NULL))
+    {
+      Hooks_st.SetTime_pfn(FleetSec_u32);
+      RtcSets_u32++;
+    }
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// receive all waiting packets
+//------------------------------
+static void Receive_v(void)
+{
+  FleetPlan_t Packet_st;
+  int Len_s32;
+
+  while((Len_s32 = Udp.parsePacket()) > 0)
+  {
+    Len_s32 = Udp.read((uint8_t *)&Packet_st, min<int>(Len_s32, sizeof(Packet_st)));
+
+    const FleetHeader_t *Header_pst = &Packet_st.Header_st;
+
+    if((Len_s32 < (int)sizeof(FleetHeader_t)) || (Header_pst->Magic_u16 != FLEET_MAGIC) || (Header_pst->Version_u8 != FLEET_VERSION))
+    {
+      Invalid_u32++;
+      continue;
+    }
+
+    //own packets (multicast loopback)
+    if(Header_pst->Node_u32 == Hooks_st.Node_u32)
+    {
+      continue;
+    }
+
+    Rx_u32++;
+
+    if((Header_pst->Type_u8 == FLEET_MSG_SYNC) && (Len_s32 == sizeof(FleetClock_t)))
+    {
+      ReceiveClock_v((const FleetClock_t *)&Packet_st);
+    }
+    else if((Header_pst->Type_u8 == FLEET_MSG_PLAN) && (Len_s32 >= (int)FLEET_PLAN_HEADER_LEN))
+    {
+      ReceivePlan_v(&Packet_st, Len_s32);
+    }
+    else
+    {
+      Invalid_u32++;
+    }
+  }
+}
+
+static void ReceiveClock_v(const FleetClock_t *Clock_pst)
+{
+  if(Role_u8 == FLEET_ROLE_LEADER)
+  {
+    Conflicts_u32++;
+    return;
+  }
+
+  int64_t Sample_s64 = (int64_t)Clock_pst->UnixSec_u32 * 1000 + Clock_pst->Msec_u16 - UptimeMsec_s64();
+
+  portENTER_CRITICAL(&FleetMux);
+
+  //first leader heard is kept while it is alive
+  if(Locked_b && (Clock_pst->Header_st.Node_u32 != LeaderNode_u32))
+  {
+    Conflicts_u32++;
+    portEXIT_CRITICAL(&FleetMux);
+    return;
+  }
+
+  //leader clock was set: old samples are meaningless
+  if(Locked_b && (llabs(Sample_s64 - OffsetMsec_s64) > FLEET_STEP_MSEC))
+  {
+    SampleCount_u8 = 0;
+    Steps_u32++;
+  }
+
+  if(SampleCount_u8 == 0)
+  {
+    SampleNext_u8 = 0;
+  }
+
+  Sample_as64 [SampleNext_u8] = Sample_s64;
+  SampleNext_u8 = (SampleNext_u8 + 1) % FLEET_OFFSET_SAMPLES;
+  SampleCount_u8 = min<uint8_t>(SampleCount_u8 + 1, FLEET_OFFSET_SAMPLES);
+
+  //least delayed sample
+  OffsetMsec_s64 = Sample_as64 [0];
+
+  for(uint8_t i = 1; i < SampleCount_u8; i++)
+  {
+    OffsetMsec_s64 = max<int64_t>(OffsetMsec_s64, Sample_as64 [i]);
+  }
+
+  LeaderNode_u32 = Clock_pst->Header_st.Node_u32;
+  LastHeardMsec_u32 = millis();
+  Locked_b = true;
+
+  portEXIT_CRITICAL(&FleetMux);
+}
+
+static void ReceivePlan_v(const FleetPlan_t *Plan_pst, int Len_s32)
+{
+  if((Plan_pst->Count_u8 == 0) || (Plan_pst->Count_u8 > ZONE_KEYFRAMES_MAX)
+     || (Len_s32 != (int)(FLEET_PLAN_HEADER_LEN + Plan_pst->Count_u8 * sizeof(LightKeyframe_t))))
+  {
+    Invalid_u32++;
+    return;
+  }
+
+  portENTER_CRITICAL(&FleetMux);
+
+  //new plans of the leader only, the newest replaces one not yet due
+  if((Role_u8 == FLEET_ROLE_FOLLOWER) && Locked_b && (Plan_pst->Header_st.Node_u32 == LeaderNode_u32)
+     && (Plan_pst->Generation_u8 != AppliedPlan_u8))
+  {
+    Pending_st = *Plan_pst;
+    PendingValid_b = true;
+  }
+
+  portEXIT_CRITICAL(&FleetMux);
+}
+//------------------------------
+
+
+//------------------------------
+// send packet to the group
+//------------------------------
+static void Send_v(const void *Packet_pv, size_t Len_u32)
+{
+  FleetHeader_t *Header_pst = (FleetHeader_t *)Packet_pv;
+
+  Header_pst->Magic_u16 = FLEET_MAGIC;
+  Header_pst->Version_u8 = FLEET_VERSION;
+  Header_pst->Node_u32 = Hooks_st.Node_u32;
+
+  if(!Joined_b)
+  {
+    return;
+  }
+
+  Udp.beginMulticastPacket();
+  Udp.write((const uint8_t *)Packet_pv, Len_u32);
+
+  if(Udp.endPacket())
+  {
+    Tx_u32++;
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// status
+//------------------------------
+bool Fleet_Following_b(void)
+{
+  return (Role_u8 == FLEET_ROLE_FOLLOWER) && Locked_b;
+}
+
+uint8_t Fleet_RoleFromName_u8(const char *Name_pc)
+{
+  for(uint8_t i = 0; i < sizeof(RoleName_apc) / sizeof(RoleName_apc [0]); i++)
+  {
+    if(strcmp(Name_pc, RoleName_apc [i]) == 0)
+    {
+      return i;
+    }
+  }
+
+  return 0xFF;
+}
+
+const char *Fleet_RoleName_pc(uint8_t Role_u8)
+{
+  return (Role_u8 <= FLEET_ROLE_FOLLOWER) ? RoleName_apc [Role_u8] : "";
+}
+
+void Fleet_PrintJson_v(Print &Out)
+{
+  portENTER_CRITICAL(&FleetMux);
+  uint8_t Mode_u8 = Role_u8;
+  bool Lock_b = Locked_b;
+  uint32_t Leader_u32 = (Mode_u8 == FLEET_ROLE_LEADER) ? Hooks_st.Node_u32 : LeaderNode_u32;
+  uint8_t Samples_u8 = SampleCount_u8;
+  uint8_t Plan_u8 = (Mode_u8 == FLEET_ROLE_LEADER) ? Plan_st.Generation_u8 : AppliedPlan_u8;
+  bool Pending_b = PendingValid_b;
+  int64_t Fleet_s64 = UptimeMsec_s64() + ((Mode_u8 == FLEET_ROLE_LEADER) ? LeaderBaseMsec_s64 : OffsetMsec_s64);
+  bool Valid_b = (Mode_u8 == FLEET_ROLE_LEADER) ? Anchored_b : Lock_b;
+  portEXIT_CRITICAL(&FleetMux);
+
+  //fleet clock - RTC [s]
+  int32_t RtcDiff_s32 = Valid_b ? (int32_t)((uint32_t)(Fleet_s64 / 1000) - Hooks_st.UnixTime_pfn()) : 0;
+
+  Out.printf("{\"role\":\"%s\",\"node\":%u,\"joined\":%s,\"locked\":%s,\"leader\":%u,\"samples\":%u,\"stagger_ms\":%u,",
+             Fleet_RoleName_pc(Mode_u8), Hooks_st.Node_u32, Joined_b ? "true" : "false", Lock_b ? "true" : "false",
+             Leader_u32, Samples_u8, StaggerMsec_u16);
+
+  Out.printf("\"plan\":%u,\"pending\":%s,\"join_late_ms\":%u,\"rtc_diff_s\":%d,\"rx\":%u,\"tx\":%u,\"invalid\":%u,"
+             "\"steps\":%u,\"rtc_sets\":%u,\"conflicts\":%u}",
+             Plan_u8, Pending_b ? "true" : "false", JoinLateMsec_u32, RtcDiff_s32, Rx_u32, Tx_u32, Invalid_u32,
+             Steps_u32, RtcSets_u32, Conflicts_u32);
+}
+//------------------------------
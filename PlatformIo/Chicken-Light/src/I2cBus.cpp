@@ -0,0 +1,308 @@
+//------------------------------
+// I2C bus
+//
+// Every transaction takes the bus mutex (FreeRTOS mutexes inherit the
+// priority of a waiting task, so LightControl_task is not held up behind
+// a preempted web request). Wait and hold time are recorded per
+// transaction type.
+//
+// Registers 0x00..0x12 of the DS3231 (time, alarms, control, status,
+// temperature) are read in one burst. A read that sees the time change
+// proves the tick came after the previous read, so the next tick cannot
+// come before one second after that: until then the snapshot is reused.
+//------------------------------
+
+//includes
+//------------------------------
+#include "I2cBus.h"
+#include "Trace.h"
+#include "TaskBudget.h"
+
+#include <Wire.h>
+//------------------------------
+
+//constants
+//------------------------------
+#define RTC_REG_SECONDS 0x00
+#define RTC_REG_COUNT 0x13            //seconds .. temperature LSB
+#define RTC_REG_TEMP_MSB 0x11
+#define RTC_REG_TEMP_LSB 0x12
+#define RTC_TIME_LEN 7                //seconds .. year
+
+static const char *OpName_apc [I2C_OP_COUNT] = {"rtc_read", "rtc_write", "rtc_alarm", "other"};
+//------------------------------
+
+//global variables
+//------------------------------
+extern RTC_DS3231 rtc;
+
+typedef struct
+{
+  uint32_t Count_u32;
+  uint64_t HoldUsec_u64;
+  uint32_t HoldMaxUsec_u32;
+  uint64_t WaitUsec_u64;
+  uint32_t WaitMaxUsec_u32;
+} I2cOpStats_t;
+
+static SemaphoreHandle_t I2cMutex = NULL;
+static uint32_t BusClockHz_u32 = 0;
+
+//holder of the mutex only
+static uint8_t LockOp_u8 = I2C_OP_OTHER;
+static uint32_t LockUsec_u32 = 0;
+static uint32_t LockWaitUsec_u32 = 0;
+
+//statistics and cache
+static I2cOpStats_t OpStats_ast [I2C_OP_COUNT];
+static RtcSnapshot_t Cache_st = {DateTime(), NAN};
+static bool CacheValid_b = false;
+static uint32_t CacheUntilMsec_u32 = 0;
+static uint32_t CacheHits_u32 = 0;
+static uint32_t Errors_u32 = 0;
+static portMUX_TYPE I2cMux = portMUX_INITIALIZER_UNLOCKED;
+
+//previous burst (read by the mutex holder only)
+static bool LastValid_b = false;
+static uint32_t LastReadMsec_u32 = 0;
+static uint8_t LastTime_au8 [RTC_TIME_LEN];
+//------------------------------
+
+//function prototypes
+//------------------------------
+static bool RtcBurst_b(uint8_t *Reg_pu8);
+static uint8_t Bcd2Bin_u8(uint8_t Bcd_u8);
+//------------------------------
+
+
+//------------------------------
+// start I2C master, create bus mutex
+//------------------------------
+bool I2cBus_Init_b(uint8_t Sda_u8, uint8_t Scl_u8, uint32_t ClockHz_u32)
+{
+  I2cMutex = xSemaphoreCreateMutex();
+
+  if(I2cMutex == NULL)
+  {
+    return false;
+  }
+
+  Task_WatchLock_v(I2cMutex);
+
+  BusClockHz_u32 = ClockHz_u32;
+
+  Wire.begin(Sda_u8, Scl_u8);
+  Wire.setClock(ClockHz_u32);
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// exclusive bus access
+//------------------------------
+void I2cBus_Lock_v(uint8_t Op_u8)
+{
+  uint32_t StartUsec_u32 = micros();
+
+  xSemaphoreTake(I2cMutex, portMAX_DELAY);
+
+  LockUsec_u32 = micros();
+  LockWaitUsec_u32 = LockUsec_u32 - StartUsec_u32;
+  LockOp_u8 = (Op_u8 < I2C_OP_COUNT) ? Op_u8 : I2C_OP_OTHER;
+}
+
+void I2cBus_Unlock_v(void)
+{
+  uint32_t HoldUsec_u32 = micros() - LockUsec_u32;
+  I2cOpStats_t *Stats_pst = &OpStats_ast [LockOp_u8];
+
+  portENTER_CRITICAL(&I2cMux);
+  Stats_pst->Count_u32++;
+  Stats_pst->HoldUsec_u64 += HoldUsec_u32;
+  Stats_pst->HoldMaxUsec_u32 = max<uint32_t>(Stats_pst->HoldMaxUsec_u32, HoldUsec_u32);
+  Stats_pst->WaitUsec_u64 += LockWaitUsec_u32;
+  Stats_pst->WaitMaxUsec_u32 = max<uint32_t>(Stats_pst->WaitMaxUsec_u32, LockWaitUsec_u32);
+  portEXIT_CRITICAL(&I2cMux);
+
+  xSemaphoreGive(I2cMutex);
+}
+//------------------------------
+
+
+//------------------------------
+// time and temperature of the DS3231 (any task)
+//------------------------------
+bool I2cBus_RtcRead_b(RtcSnapshot_t *Snapshot_pst)
+{
+  bool Hit_b = false;
+
+  portENTER_CRITICAL(&I2cMux);
+
+  if(CacheValid_b && ((int32_t)(millis() - CacheUntilMsec_u32) < 0))
+  {
+    *Snapshot_pst = Cache_st;
+    CacheHits_u32++;
+    Hit_b = true;
+  }
+
+  portEXIT_CRITICAL(&I2cMux);
+
+  if(Hit_b)
+  {
+    return true;
+  }
+
+  uint8_t Reg_au8 [RTC_REG_COUNT];
+
+  I2cBus_Lock_v(I2C_OP_RTC_READ);
+
+  uint32_t StartMsec_u32 = millis();
+  bool Ok_b = RtcBurst_b(Reg_au8);
+
+  if(Ok_b)
+  {
+    RtcSnapshot_t Read_st;
+
+    Read_st.Time = DateTime(2000 + Bcd2Bin_u8(Reg_au8 [6]), Bcd2Bin_u8(Reg_au8 [5] & 0x7F), Bcd2Bin_u8(Reg_au8 [4]),
+                            Bcd2Bin_u8(Reg_au8 [2] & 0x3F), Bcd2Bin_u8(Reg_au8 [1]), Bcd2Bin_u8(Reg_au8 [0] & 0x7F));
+    Read_st.Temperature_f32 = (int8_t)Reg_au8 [RTC_REG_TEMP_MSB] + (Reg_au8 [RTC_REG_TEMP_LSB] >> 6) * 0.25F;
+
+    //time changed: the tick was after the previous read
+    bool Tick_b = LastValid_b && (memcmp(LastTime_au8, Reg_au8, RTC_TIME_LEN) != 0);
+
+    portENTER_CRITICAL(&I2cMux);
+
+    Cache_st = Read_st;
+
+    if(Tick_b)
+    {
+      CacheValid_b = true;
+      CacheUntilMsec_u32 = LastReadMsec_u32 + 1000 - I2C_RTC_CACHE_MARGIN_MSEC;
+    }
+
+    portEXIT_CRITICAL(&I2cMux);
+
+    Trace_Rtc_v(Read_st.Time.unixtime());
+
+    memcpy(LastTime_au8, Reg_au8, RTC_TIME_LEN);
+    LastReadMsec_u32 = StartMsec_u32;
+    LastValid_b = true;
+  }
+
+  I2cBus_Unlock_v();
+
+  portENTER_CRITICAL(&I2cMux);
+
+  if(!Ok_b)
+  {
+    Errors_u32++;
+  }
+
+  *Snapshot_pst = Cache_st;
+
+  portEXIT_CRITICAL(&I2cMux);
+
+  return Ok_b;
+}
+
+DateTime I2cBus_RtcNow(void)
+{
+  RtcSnapshot_t Snapshot_st;
+
+  I2cBus_RtcRead_b(&Snapshot_st);
+
+  return Snapshot_st.Time;
+}
+
+void I2cBus_RtcAdjust_v(const DateTime &Time)
+{
+  I2cBus_Lock_v(I2C_OP_RTC_WRITE);
+
+  rtc.adjust(Time);
+
+  //writing the seconds restarts the countdown chain
+  portENTER_CRITICAL(&I2cMux);
+  CacheValid_b = false;
+  portEXIT_CRITICAL(&I2cMux);
+
+  LastValid_b = false;
+
+  I2cBus_Unlock_v();
+}
+
+static bool RtcBurst_b(uint8_t *Reg_pu8)
+{
+  Wire.beginTransmission(I2C_RTC_ADDRESS);
+  Wire.write(RTC_REG_SECONDS);
+
+  if(Wire.endTransmission(false) != 0)
+  {
+    return false;
+  }
+
+  if(Wire.requestFrom((uint8_t)I2C_RTC_ADDRESS, (uint8_t)RTC_REG_COUNT) != RTC_REG_COUNT)
+  {
+    return false;
+  }
+
+  for(uint8_t i = 0; i < RTC_REG_COUNT; i++)
+  {
+    Reg_pu8 [i] = Wire.read();
+  }
+
+  return true;
+}
+
+static uint8_t Bcd2Bin_u8(uint8_t Bcd_u8)
+{
+  return (Bcd_u8 >> 4) * 10 + (Bcd_u8 & 0x0F);
+}
+//------------------------------
+
+
+//------------------------------
+// statistics as JSON
+//------------------------------
+void I2cBus_PrintJson_v(Print &Out)
+{
+  I2cOpStats_t Stats_ast [I2C_OP_COUNT];
+  RtcSnapshot_t Snapshot_st;
+  uint32_t Hits_u32;
+  uint32_t ErrorCount_u32;
+
+  portENTER_CRITICAL(&I2cMux);
+  memcpy(Stats_ast, OpStats_ast, sizeof(Stats_ast));
+  Snapshot_st = Cache_st;
+  Hits_u32 = CacheHits_u32;
+  ErrorCount_u32 = Errors_u32;
+  portEXIT_CRITICAL(&I2cMux);
+
+  Out.printf("{\"clock_hz\":%u,\"rtc\":{\"temperature\":", BusClockHz_u32);
+
+  if(isnan(Snapshot_st.Temperature_f32))
+  {
+    Out.print("null");
+  }
+  else
+  {
+    Out.printf("%.2f", Snapshot_st.Temperature_f32);
+  }
+
+  Out.printf(",\"cache_hits\":%u,\"errors\":%u},\"ops\":[", Hits_u32, ErrorCount_u32);
+
+  for(uint8_t i = 0; i < I2C_OP_COUNT; i++)
+  {
+    const I2cOpStats_t *Stats_pst = &Stats_ast [i];
+    uint32_t Count_u32 = max<uint32_t>(Stats_pst->Count_u32, 1);
+
+    Out.printf("%s{\"name\":\"%s\",\"count\":%u,\"hold_avg_us\":%u,\"hold_max_us\":%u,\"wait_avg_us\":%u,\"wait_max_us\":%u}",
+               (i > 0) ? "," : "", OpName_apc [i], Stats_pst->Count_u32,
+               (uint32_t)(Stats_pst->HoldUsec_u64 / Count_u32), Stats_pst->HoldMaxUsec_u32,
+               (uint32_t)(Stats_pst->WaitUsec_u64 / Count_u32), Stats_pst->WaitMaxUsec_u32);
+  }
+
+  Out.print("]}");
+}
+//------------------------------
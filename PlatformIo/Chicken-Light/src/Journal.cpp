@@ -0,0 +1,486 @@
+//------------------------------
+// Event journal
+//
+// Records are appended to the current segment file (/jrnl<n>.bin); a full
+// segment rotates to the next of 8 files, overwriting the oldest. Record 0
+// of each file is a header with the running segment number, so the order
+// survives reboots. Every 32nd record time is kept in a RAM index: a time
+// range is found by binary search over segments and index entries, only
+// up to 32 records before the start of the range are read.
+//------------------------------
+
+//includes
+//------------------------------
+#include "Journal.h"
+#include "TaskBudget.h"
+
+#include "SPIFFS.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define JOURNAL_INDEX_ENTRIES (JOURNAL_SEGMENT_RECORDS / JOURNAL_INDEX_STRIDE)
+#define JOURNAL_EARLY_MAX 4                 //records logged before init
+#define JOURNAL_LOCK_MSEC 200               //longer: record is dropped (holder may be stalled)
+//------------------------------
+
+//global variables
+//------------------------------
+static uint32_t SegmentNo_au32 [JOURNAL_SEGMENTS];    //0 = unused
+static uint16_t Records_au16 [JOURNAL_SEGMENTS];
+static uint32_t IndexTime_au32 [JOURNAL_SEGMENTS] [JOURNAL_INDEX_ENTRIES];
+static uint8_t Current_u8 = 0;
+static uint16_t Boot_u16 = 0;
+
+static JournalRecord_t Early_ast [JOURNAL_EARLY_MAX];
+static uint8_t EarlyCount_u8 = 0;
+
+static JournalClock_t Clock_pfn = NULL;
+static JournalHook_t Hook_pfn = NULL;
+static SemaphoreHandle_t JournalMutex = NULL;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void SegmentName_v(uint8_t Slot_u8, char *Name_pc);
+static void Seal_v(JournalRecord_t *Record_pst);
+static bool Valid_b(const JournalRecord_t *Record_pst);
+static uint16_t ScanSegment_u16(uint8_t Slot_u8);
+static void OpenSegment_v(uint8_t Slot_u8, uint32_t SegmentNo_u32);
+static void Append_v(JournalRecord_t *Record_pst);
+static uint8_t SlotAt_u8(uint8_t Position_u8);
+static uint8_t SlotOf_u8(uint32_t SegmentNo_u32);
+static bool NextRecord_b(JournalExport_t *Export_pst);
+//------------------------------
+
+
+//------------------------------
+// find current segment, log reboot (SPIFFS must be mounted)
+//------------------------------
+void Journal_Init_v(JournalClock_t JournalClock_pfn)
+{
+  uint32_t MaxNo_u32 = 0;
+  uint16_t LastBoot_u16 = 0;
+
+  Clock_pfn = JournalClock_pfn;
+
+  for(uint8_t i = 0; i < JOURNAL_SEGMENTS; i++)
+  {
+    uint16_t SegmentBoot_u16 = ScanSegment_u16(i);
+
+    if(SegmentNo_au32 [i] > MaxNo_u32)
+    {
+      MaxNo_u32 = SegmentNo_au32 [i];
+      Current_u8 = i;
+      LastBoot_u16 = SegmentBoot_u16;
+    }
+  }
+
+  Boot_u16 = LastBoot_u16 + 1;
+
+  if(MaxNo_u32 == 0)
+  {
+    OpenSegment_v(0, 1);
+  }
+
+  JournalMutex = xSemaphoreCreateMutex();
+  Task_WatchLock_v(JournalMutex);
+
+  Journal_Log_v(JOURNAL_EVENT_BOOT, JOURNAL_SRC_SYSTEM, esp_reset_reason(), 0);
+
+  //records logged during setup before the file system was ready
+  for(uint8_t i = 0; i < EarlyCount_u8; i++)
+  {
+    Journal_Log_v(Early_ast [i].Type_u8, Early_ast [i].Source_u8, Early_ast [i].Arg_u16, Early_ast [i].Value_u32);
+  }
+  EarlyCount_u8 = 0;
+
+  Serial.printf("journal: segment %u, %u records, boot %u\n", SegmentNo_au32 [Current_u8], Records_au16 [Current_u8], Boot_u16);
+}
+//------------------------------
+
+
+//------------------------------
+// record helpers
+//------------------------------
+static void SegmentName_v(uint8_t Slot_u8, char *Name_pc)
+{
+  sprintf(Name_pc, "/jrnl%u.bin", Slot_u8);
+}
+
+static void Seal_v(JournalRecord_t *Record_pst)
+{
+  const uint8_t *Byte_pu8 = (const uint8_t *)Record_pst;
+  uint8_t Check_u8 = 0xA5;
+
+  for(uint8_t i = 0; i < sizeof(JournalRecord_t) - 1; i++)
+  {
+    Check_u8 ^= Byte_pu8 [i];
+  }
+
+  Record_pst->Check_u8 = Check_u8;
+}
+
+static bool Valid_b(const JournalRecord_t *Record_pst)
+{
+  JournalRecord_t Copy_st = *Record_pst;
+
+  Seal_v(&Copy_st);
+
+  return Copy_st.Check_u8 == Record_pst->Check_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// read header, record count and index of a segment file, returns boot counter of last record
+//------------------------------
+static uint16_t ScanSegment_u16(uint8_t Slot_u8)
+{
+  char Name_ac [16];
+  JournalRecord_t Record_st;
+  uint16_t LastBoot_u16 = 0;
+
+  SegmentNo_au32 [Slot_u8] = 0;
+  Records_au16 [Slot_u8] = 0;
+
+  SegmentName_v(Slot_u8, Name_ac);
+  File file = SPIFFS.open(Name_ac, FILE_READ);
+
+  if(!file)
+  {
+    return 0;
+  }
+
+  size_t Size_u32 = file.size();
+
+  if((file.read((uint8_t *)&Record_st, sizeof(Record_st)) == sizeof(Record_st)) && Valid_b(&Record_st)
+     && (Record_st.Type_u8 == JOURNAL_EVENT_SEGMENT))
+  {
+    SegmentNo_au32 [Slot_u8] = Record_st.Value_u32;
+    Records_au16 [Slot_u8] = min<size_t>(Size_u32 / sizeof(JournalRecord_t), JOURNAL_SEGMENT_RECORDS);
+
+    for(uint16_t k = 0; k * JOURNAL_INDEX_STRIDE < Records_au16 [Slot_u8]; k++)
+    {
+      file.seek(k * JOURNAL_INDEX_STRIDE * sizeof(JournalRecord_t));
+      file.read((uint8_t *)&IndexTime_au32 [Slot_u8] [k], sizeof(uint32_t));
+    }
+
+    file.seek((Records_au16 [Slot_u8] - 1) * sizeof(JournalRecord_t));
+    file.read((uint8_t *)&Record_st, sizeof(Record_st));
+    LastBoot_u16 = Record_st.Boot_u16;
+
+    //torn write at the end: never append behind it
+    if(Size_u32 % sizeof(JournalRecord_t) != 0)
+    {
+      Records_au16 [Slot_u8] = JOURNAL_SEGMENT_RECORDS;
+    }
+  }
+
+  file.close();
+
+  return LastBoot_u16;
+}
+//------------------------------
+
+
+//------------------------------
+// start segment file with header record
+//------------------------------
+static void OpenSegment_v(uint8_t Slot_u8, uint32_t SegmentNo_u32)
+{
+  char Name_ac [16];
+  JournalRecord_t Header_st;
+
+  memset(&Header_st, 0, sizeof(Header_st));
+  Header_st.Time_u32 = (Clock_pfn != NULL) ? Clock_pfn() : 0;
+  Header_st.Type_u8 = JOURNAL_EVENT_SEGMENT;
+  Header_st.Value_u32 = SegmentNo_u32;
+  Header_st.Boot_u16 = Boot_u16;
+  Seal_v(&Header_st);
+
+  Current_u8 = Slot_u8;
+  SegmentNo_au32 [Slot_u8] = SegmentNo_u32;
+  Records_au16 [Slot_u8] = 1;
+  IndexTime_au32 [Slot_u8] [0] = Header_st.Time_u32;
+
+  SegmentName_v(Slot_u8, Name_ac);
+  File file = SPIFFS.open(Name_ac, FILE_WRITE);
+
+  if(file)
+  {
+    file.write((const uint8_t *)&Header_st, sizeof(Header_st));
+    file.close();
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// forward every new record (e.g. to MQTT)
+//------------------------------
+void Journal_SetHook_v(JournalHook_t JournalHook_pfn)
+{
+  Hook_pfn = JournalHook_pfn;
+}
+//------------------------------
+
+
+//------------------------------
+// log event (any task)
+//------------------------------
+void Journal_Log_v(uint8_t Type_u8, uint8_t Source_u8, uint16_t Arg_u16, uint32_t Value_u32)
+{
+  JournalRecord_t Record_st;
+
+  memset(&Record_st, 0, sizeof(Record_st));
+  Record_st.Type_u8 = Type_u8;
+  Record_st.Source_u8 = Source_u8;
+  Record_st.Arg_u16 = Arg_u16;
+  Record_st.Value_u32 = Value_u32;
+
+  //not initialized yet: keep a few records until init
+  if(JournalMutex == NULL)
+  {
+    if(EarlyCount_u8 < JOURNAL_EARLY_MAX)
+    {
+      Early_ast [EarlyCount_u8++] = Record_st;
+    }
+    return;
+  }
+
+  //a stalled writer must not block the caller (supervisor recovery logs here)
+  if(xSemaphoreTake(JournalMutex, pdMS_TO_TICKS(JOURNAL_LOCK_MSEC)) != pdTRUE)
+  {
+    Serial.printf("journal: busy, event %u dropped\n", Type_u8);
+    return;
+  }
+
+  Append_v(&Record_st);
+  xSemaphoreGive(JournalMutex);
+
+  if(Hook_pfn != NULL)
+  {
+    Hook_pfn(&Record_st);
+  }
+}
+
+static void Append_v(JournalRecord_t *Record_pst)
+{
+  char Name_ac [16];
+
+  if(Records_au16 [Current_u8] >= JOURNAL_SEGMENT_RECORDS)
+  {
+    OpenSegment_v((Current_u8 + 1) % JOURNAL_SEGMENTS, SegmentNo_au32 [Current_u8] + 1);
+  }
+
+  Record_pst->Time_u32 = Clock_pfn();
+  Record_pst->Boot_u16 = Boot_u16;
+  Seal_v(Record_pst);
+
+  SegmentName_v(Current_u8, Name_ac);
+  File file = SPIFFS.open(Name_ac, FILE_APPEND);
+
+  if(!file)
+  {
+    Serial.print("journal: couldn't write record\n");
+    return;
+  }
+
+  file.write((const uint8_t *)Record_pst, sizeof(JournalRecord_t));
+  file.close();
+
+  if(Records_au16 [Current_u8] % JOURNAL_INDEX_STRIDE == 0)
+  {
+    IndexTime_au32 [Current_u8] [Records_au16 [Current_u8] / JOURNAL_INDEX_STRIDE] = Record_pst->Time_u32;
+  }
+  Records_au16 [Current_u8]++;
+}
+//------------------------------
+
+
+//------------------------------
+// export: binary search start position, then stream records in range
+//------------------------------
+static uint8_t SlotAt_u8(uint8_t Position_u8)
+{
+  //position 0 = oldest segment, JOURNAL_SEGMENTS - 1 = current
+  return (Current_u8 + 1 + Position_u8) % JOURNAL_SEGMENTS;
+}
+
+static uint8_t SlotOf_u8(uint32_t SegmentNo_u32)
+{
+  for(uint8_t i = 0; i < JOURNAL_SEGMENTS; i++)
+  {
+    if((SegmentNo_u32 != 0) && (SegmentNo_au32 [i] == SegmentNo_u32))
+    {
+      return i;
+    }
+  }
+
+  return JOURNAL_SEGMENTS;
+}
+
+void Journal_ExportInit_v(JournalExport_t *Export_pst, uint32_t From_u32, uint32_t To_u32)
+{
+  memset(Export_pst, 0, sizeof(JournalExport_t));
+  Export_pst->From_u32 = From_u32;
+  Export_pst->To_u32 = To_u32;
+
+  xSemaphoreTake(JournalMutex, portMAX_DELAY);
+
+  //segment order at start: a rotation during the export must not shift positions
+  for(uint8_t i = 0; i < JOURNAL_SEGMENTS; i++)
+  {
+    Export_pst->SegmentNo_au32 [i] = SegmentNo_au32 [SlotAt_u8(i)];
+  }
+
+  //unused slots only exist before the first rotation, they come first in order
+  uint8_t Low_u8 = 0;
+  while((Low_u8 < JOURNAL_SEGMENTS - 1) && (SegmentNo_au32 [SlotAt_u8(Low_u8)] == 0))
+  {
+    Low_u8++;
+  }
+
+  //last segment starting at or before From
+  uint8_t High_u8 = JOURNAL_SEGMENTS - 1;
+  uint8_t Position_u8 = Low_u8;
+
+  while(Low_u8 <= High_u8)
+  {
+    uint8_t Mid_u8 = (Low_u8 + High_u8) / 2;
+
+    if(IndexTime_au32 [SlotAt_u8(Mid_u8)] [0] <= From_u32)
+    {
+      Position_u8 = Mid_u8;
+      Low_u8 = Mid_u8 + 1;
+    }
+    else if(Mid_u8 == 0)
+    {
+      break;
+    }
+    else
+    {
+      High_u8 = Mid_u8 - 1;
+    }
+  }
+
+  //last index entry at or before From within this segment
+  uint8_t Slot_u8 = SlotAt_u8(Position_u8);
+  uint8_t Entries_u8 = (Records_au16 [Slot_u8] + JOURNAL_INDEX_STRIDE - 1) / JOURNAL_INDEX_STRIDE;
+  uint8_t Entry_u8 = 0;
+
+  Low_u8 = 1;
+  High_u8 = Entries_u8;
+
+  while(Low_u8 < High_u8)
+  {
+    uint8_t Mid_u8 = (Low_u8 + High_u8) / 2;
+
+    if(IndexTime_au32 [Slot_u8] [Mid_u8] <= From_u32)
+    {
+      Entry_u8 = Mid_u8;
+      Low_u8 = Mid_u8 + 1;
+    }
+    else
+    {
+      High_u8 = Mid_u8;
+    }
+  }
+
+  xSemaphoreGive(JournalMutex);
+
+  Export_pst->Segment_u8 = Position_u8;
+  Export_pst->Record_u16 = Entry_u8 * JOURNAL_INDEX_STRIDE;
+}
+
+static bool NextRecord_b(JournalExport_t *Export_pst)
+{
+  char Name_ac [16];
+
+  while(1)
+  {
+    //next record of current batch
+    while(Export_pst->BatchPos_u8 < Export_pst->BatchCount_u8)
+    {
+      const JournalRecord_t *Record_pst = &Export_pst->Batch_ast [Export_pst->BatchPos_u8++];
+
+      if(Valid_b(Record_pst) && (Record_pst->Time_u32 >= Export_pst->From_u32) && (Record_pst->Time_u32 <= Export_pst->To_u32))
+      {
+        Export_pst->Record_st = *Record_pst;
+        return true;
+      }
+    }
+
+    if(Export_pst->Segment_u8 >= JOURNAL_SEGMENTS)
+    {
+      return false;
+    }
+
+    //read next batch (segment overwritten since the start: skipped)
+    xSemaphoreTake(JournalMutex, portMAX_DELAY);
+
+    uint8_t Slot_u8 = SlotOf_u8(Export_pst->SegmentNo_au32 [Export_pst->Segment_u8]);
+
+    if((Slot_u8 >= JOURNAL_SEGMENTS) || (Export_pst->Record_u16 >= Records_au16 [Slot_u8]))
+    {
+      xSemaphoreGive(JournalMutex);
+
+      Export_pst->Segment_u8++;
+      Export_pst->Record_u16 = 0;
+      continue;
+    }
+
+    uint16_t Count_u16 = min<uint16_t>(JOURNAL_EXPORT_BATCH, Records_au16 [Slot_u8] - Export_pst->Record_u16);
+
+    SegmentName_v(Slot_u8, Name_ac);
+    File file = SPIFFS.open(Name_ac, FILE_READ);
+
+    Export_pst->BatchCount_u8 = 0;
+    Export_pst->BatchPos_u8 = 0;
+
+    if(file)
+    {
+      file.seek(Export_pst->Record_u16 * sizeof(JournalRecord_t));
+      Export_pst->BatchCount_u8 = file.read((uint8_t *)Export_pst->Batch_ast, Count_u16 * sizeof(JournalRecord_t)) / sizeof(JournalRecord_t);
+      file.close();
+    }
+
+    xSemaphoreGive(JournalMutex);
+
+    Export_pst->Record_u16 += Count_u16;
+  }
+}
+
+size_t Journal_ExportFill_u32(JournalExport_t *Export_pst, uint8_t *Buf_pu8, size_t MaxLen_u32)
+{
+  size_t Len_u32 = 0;
+
+  while(Len_u32 < MaxLen_u32)
+  {
+    if(!Export_pst->Pending_b)
+    {
+      if(!NextRecord_b(Export_pst))
+      {
+        break;
+      }
+
+      Export_pst->Pending_b = true;
+      Export_pst->Offset_u8 = 0;
+    }
+
+    size_t Copy_u32 = min(sizeof(JournalRecord_t) - Export_pst->Offset_u8, MaxLen_u32 - Len_u32);
+
+    memcpy(&Buf_pu8 [Len_u32], (const uint8_t *)&Export_pst->Record_st + Export_pst->Offset_u8, Copy_u32);
+    Len_u32 += Copy_u32;
+    Export_pst->Offset_u8 += Copy_u32;
+
+    if(Export_pst->Offset_u8 >= sizeof(JournalRecord_t))
+    {
+      Export_pst->Pending_b = false;
+    }
+  }
+
+  return Len_u32;
+}
+//------------------------------
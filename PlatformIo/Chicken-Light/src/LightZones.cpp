@@ -0,0 +1,734 @@
+//------------------------------
+// Light zones
+//
+// Ramps are stored as start level, target, start time, duration and
+// easing curve, so
+// every tick computes the level directly from the elapsed time (no error
+// accumulation, immune to tick jitter). Only zones with their bit set in
+// RampingMask_u8 are touched; idle zones cost nothing. Without a running
+// ramp the engine task blocks until the next ramp is started.
+//
+// Programs are evaluated the same way from the elapsed time. A cursor per
+// zone points to the current segment and only moves forward, so a tick
+// costs one comparison plus one interpolation regardless of the number
+// of keyframes.
+//
+// Dithering: a level between two LEDC codes is the lower code plus a
+// fraction of PwmShift_u8 bits. A first order sigma-delta modulator in
+// an esp_timer callback adds the fraction to an accumulator every period
+// and outputs the next code on overflow, so the average over 2^PwmShift_u8
+// periods is the exact 16 bit level. The timer only runs while a zone
+// with a fraction is below ZONE_DITHER_CODE_MAX; LEDC is only written
+// when the code changes. Worst case (fraction 1/8 or 7/8 at 13 bit) the
+// output repeats every 8 periods: 2500 Hz / 8 = 312 Hz, far above the
+// flicker fusion of chickens (tools/dither_model.py).
+//------------------------------
+
+//includes
+//------------------------------
+#include "LightZones.h"
+#include "TaskBudget.h"
+#include "Supervisor.h"
+#include "Trace.h"
+
+#include "esp_timer.h"
+//------------------------------
+
+//global variables
+//------------------------------
+ZoneTable_t ZoneTable_st;
+
+static uint8_t PwmShift_u8 = 3;     //ZONE_LEVEL_MAX (16 bit) -> LEDC resolution
+static uint32_t ChannelFreqHz_u32 = 5000;
+
+static LightZoneOutputHook_t OutputHook_pfn = NULL;
+
+static TaskHandle_t LightZone_taskHandle = NULL;
+static uint8_t SupervisorSlot_u8 = SUPERVISOR_NONE;
+
+static portMUX_TYPE ZoneMux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t OutputMutex = NULL;        //level computed and written as one step (LEDC, hook)
+
+static LightProgram_t Program_ast [ZONE_COUNT_MAX];
+
+//dithering (DitherMux, timer callback runs in the esp_timer task)
+static esp_timer_handle_t Dither_h = NULL;
+static bool DitherOn_b = false;
+static bool DitherRunning_b = false;
+static uint8_t DitherMask_u8 = 0;                     //zones modulated by the timer
+static uint16_t DitherLevel_au16 [ZONE_COUNT_MAX];
+static uint16_t DitherAcc_au16 [ZONE_COUNT_MAX];      //fraction accumulator
+static uint16_t DitherCode_au16 [ZONE_COUNT_MAX];     //code written last
+static portMUX_TYPE DitherMux = portMUX_INITIALIZER_UNLOCKED;
+
+//2^(6x) - 1 normalised, 17 points (x = 0, 1/16, ... 1)
+static const uint16_t EaseExp_au16 [17] = {0, 309, 709, 1229, 1902, 2775, 3908, 5377, 7282, 9752,
+                                           12955, 17110, 22498, 29485, 38546, 50296, 65535};
+
+//order of ZONE_EASE_xxx
+static const char * const EaseName_apc [ZONE_EASE_COUNT] = {"linear", "step", "smooth", "exp_in", "exp_out"};
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void LightZone_task(void * pvParameters);
+static void WriteOutput_v(uint8_t Zone_u8, uint16_t Level_u16);
+static void WritePwm_v(uint8_t Zone_u8, uint16_t Level_u16);
+static void DitherTimer_v(void *Arg_pv);
+static uint16_t ProgramLevel_u16(uint8_t Zone_u8, uint32_t Elapsed_u32);
+static uint32_t Ease_u32(uint8_t Ease_u8, uint32_t Fraction_u32);
+//------------------------------
+
+
+//------------------------------
+// init zones, LEDC channels and engine task
+//------------------------------
+void LightZone_Init_v(const uint8_t *Pin_pu8, const uint8_t *Schedule_pu8, uint8_t Count_u8,
+                      uint32_t PwmFreqHz_u32, uint8_t PwmResolutionBit_u8, LightZoneOutputHook_t Hook_pfn)
+{
+  if(Count_u8 > ZONE_COUNT_MAX)
+  {
+    Count_u8 = ZONE_COUNT_MAX;
+  }
+
+  memset(&ZoneTable_st, 0, sizeof(ZoneTable_st));
+
+  ZoneTable_st.Count_u8 = Count_u8;
+  PwmShift_u8 = 16 - PwmResolutionBit_u8;
+  ChannelFreqHz_u32 = PwmFreqHz_u32;
+  OutputHook_pfn = Hook_pfn;
+  OutputMutex = xSemaphoreCreateMutex();
+  Task_WatchLock_v(OutputMutex);
+
+  for(uint8_t i = 0; i < Count_u8; i++)
+  {
+    ZoneTable_st.Pin_au8 [i] = Pin_pu8 [i];
+    ZoneTable_st.Channel_au8 [i] = i;
+    ZoneTable_st.Schedule_au8 [i] = Schedule_pu8 [i];
+
+    ledcSetup(i, PwmFreqHz_u32, PwmResolutionBit_u8);   //configure PWM
+    ledcAttachPin(Pin_pu8 [i], i);                      //attach GPIO pin
+    WriteOutput_v(i, 0);
+  }
+
+  LightZone_taskHandle = Task_Start_h(TASK_ID_LIGHT_ZONE, LightZone_task, NULL);
+}
+//------------------------------
+
+
+//------------------------------
+// dimming engine: one pass over all ramping zones per tick
+//------------------------------
+static void LightZone_task(void * pvParameters)
+{
+  TickType_t LastWake = xTaskGetTickCount();
+
+  while(1)
+  {
+    if(ZoneTable_st.RampingMask_u8 == 0)
+    {
+      Supervisor_Pause_v(SupervisorSlot_u8);
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      LastWake = xTaskGetTickCount();
+    }
+
+    Supervisor_Heartbeat_v(SupervisorSlot_u8);
+
+    LightZone_Step_v(millis());
+
+    vTaskDelayUntil(&LastWake, pdMS_TO_TICKS(ZONE_ENGINE_TICK_MSEC));
+  }
+}
+
+void LightZone_Step_v(uint32_t Now_u32)
+{
+  uint16_t NewLevel_au16 [ZONE_COUNT_MAX];
+  uint8_t Changed_u8 = 0;
+
+  //a LightZone_Set_v of another task can't slip in between compute and write
+  xSemaphoreTake(OutputMutex, portMAX_DELAY);
+  portENTER_CRITICAL(&ZoneMux);
+
+  uint8_t Mask_u8 = ZoneTable_st.RampingMask_u8;
+
+  while(Mask_u8)
+  {
+    uint8_t i = __builtin_ctz(Mask_u8);
+    Mask_u8 &= Mask_u8 - 1;
+
+    uint32_t Elapsed_u32 = Now_u32 - ZoneTable_st.RampStartMsec_au32 [i];
+    uint16_t Level_u16;
+
+    if(Elapsed_u32 >= ZoneTable_st.RampTimeMsec_au32 [i])
+    {
+      Level_u16 = ZoneTable_st.Target_au16 [i];
+      ZoneTable_st.RampingMask_u8 &= ~(1 << i);
+      ZoneTable_st.ProgramMask_u8 &= ~(1 << i);
+    }
+    else if(ZoneTable_st.ProgramMask_u8 & (1 << i))
+    {
+      Level_u16 = ProgramLevel_u16(i, Elapsed_u32);
+    }
+    else if(ZoneTable_st.Ease_au8 [i] == ZONE_EASE_LINEAR)
+    {
+      int32_t Delta_s32 = (int32_t)ZoneTable_st.Target_au16 [i] - ZoneTable_st.Start_au16 [i];
+      Level_u16 = ZoneTable_st.Start_au16 [i] + (int32_t)((int64_t)Delta_s32 * Elapsed_u32 / ZoneTable_st.RampTimeMsec_au32 [i]);
+    }
+    else
+    {
+      uint32_t Fraction_u32 = (uint64_t)Elapsed_u32 * 65536 / ZoneTable_st.RampTimeMsec_au32 [i];
+      int32_t Delta_s32 = (int32_t)ZoneTable_st.Target_au16 [i] - ZoneTable_st.Start_au16 [i];
+      Level_u16 = ZoneTable_st.Start_au16 [i] + (int32_t)((int64_t)Delta_s32 * Ease_u32(ZoneTable_st.Ease_au8 [i], Fraction_u32) / 65536);
+    }
+
+    if(Level_u16 != ZoneTable_st.Level_au16 [i])
+    {
+      ZoneTable_st.Level_au16 [i] = Level_u16;
+      NewLevel_au16 [i] = Level_u16;
+      Changed_u8 |= (1 << i);
+    }
+  }
+
+  portEXIT_CRITICAL(&ZoneMux);
+
+  while(Changed_u8)
+  {
+    uint8_t i = __builtin_ctz(Changed_u8);
+    Changed_u8 &= Changed_u8 - 1;
+
+    WriteOutput_v(i, NewLevel_au16 [i]);
+  }
+
+  xSemaphoreGive(OutputMutex);
+}
+//------------------------------
+
+
+//------------------------------
+// supervision: heartbeat slot, restart of a stalled engine task
+//------------------------------
+void LightZone_Supervise_v(uint8_t Slot_u8)
+{
+  SupervisorSlot_u8 = Slot_u8;
+}
+
+void LightZone_Restart_v(void)
+{
+  LightZone_taskHandle = Task_Restart_h(TASK_ID_LIGHT_ZONE, LightZone_task, NULL);
+}
+//------------------------------
+
+
+//------------------------------
+// program level at elapsed time (called in critical section)
+//------------------------------
+static uint16_t ProgramLevel_u16(uint8_t Zone_u8, uint32_t Elapsed_u32)
+{
+  const LightProgram_t *Program_pst = &Program_ast [Zone_u8];
+  uint8_t Cursor_u8 = ZoneTable_st.Cursor_au8 [Zone_u8];
+
+  //advance to the segment containing the elapsed time (also skips zero length segments)
+  while((Cursor_u8 + 2 < Program_pst->Count_u8) && (Elapsed_u32 >= (uint32_t)Program_pst->Keyframe_ast [Cursor_u8 + 1].TimeSec_u16 * 1000))
+  {
+    Cursor_u8++;
+  }
+
+  ZoneTable_st.Cursor_au8 [Zone_u8] = Cursor_u8;
+
+  const LightKeyframe_t *From_pst = &Program_pst->Keyframe_ast [Cursor_u8];
+  const LightKeyframe_t *To_pst = &Program_pst->Keyframe_ast [Cursor_u8 + 1];
+
+  uint32_t StartMsec_u32 = (uint32_t)From_pst->TimeSec_u16 * 1000;
+  uint32_t SpanMsec_u32 = (uint32_t)(To_pst->TimeSec_u16 - From_pst->TimeSec_u16) * 1000;
+
+  if((SpanMsec_u32 == 0) || (Elapsed_u32 >= StartMsec_u32 + SpanMsec_u32))
+  {
+    return To_pst->Level_u16;
+  }
+
+  //fraction of segment 0...65536
+  uint32_t Fraction_u32 = (uint64_t)(Elapsed_u32 - StartMsec_u32) * 65536 / SpanMsec_u32;
+  int32_t Delta_s32 = (int32_t)To_pst->Level_u16 - From_pst->Level_u16;
+
+  return From_pst->Level_u16 + (int32_t)((int64_t)Delta_s32 * Ease_u32(To_pst->Ease_u8, Fraction_u32) / 65536);
+}
+//------------------------------
+
+
+//------------------------------
+// easing curve, fraction and result 0...65536
+//------------------------------
+static uint32_t Ease_u32(uint8_t Ease_u8, uint32_t Fraction_u32)
+{
+  switch(Ease_u8)
+  {
+    case ZONE_EASE_STEP:
+      return 0;
+
+    case ZONE_EASE_SMOOTH:
+    {
+      //3f^2 - 2f^3
+      uint64_t Square_u64 = (uint64_t)Fraction_u32 * Fraction_u32 >> 16;
+      return (Square_u64 * (3 * 65536 - 2 * Fraction_u32)) >> 16;
+    }
+
+    case ZONE_EASE_EXP_IN:
+    case ZONE_EASE_EXP_OUT:
+    {
+      uint32_t X_u32 = (Ease_u8 == ZONE_EASE_EXP_IN) ? Fraction_u32 : 65536 - Fraction_u32;
+      uint8_t Index_u8 = min<uint32_t>(X_u32 >> 12, 15);
+      uint32_t Rest_u32 = X_u32 - ((uint32_t)Index_u8 << 12);
+      uint32_t Y_u32 = EaseExp_au16 [Index_u8] + (((EaseExp_au16 [Index_u8 + 1] - EaseExp_au16 [Index_u8]) * Rest_u32) >> 12);
+
+      //table ends at 65535
+      Y_u32 = (Y_u32 >= 65535) ? 65536 : Y_u32;
+
+      return (Ease_u8 == ZONE_EASE_EXP_IN) ? Y_u32 : 65536 - Y_u32;
+    }
+
+    default:
+      return Fraction_u32;
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// write level to LEDC channel
+//------------------------------
+static void WriteOutput_v(uint8_t Zone_u8, uint16_t Level_u16)
+{
+  WritePwm_v(Zone_u8, Level_u16);
+
+  if(OutputHook_pfn != NULL)
+  {
+    OutputHook_pfn(Zone_u8, Level_u16);
+  }
+}
+
+static void WritePwm_v(uint8_t Zone_u8, uint16_t Level_u16)
+{
+  //PWM dutycycle (range: 0...2^resolution - 1)
+  uint16_t Code_u16 = Level_u16 >> PwmShift_u8;
+  uint16_t Fraction_u16 = Level_u16 & ((1 << PwmShift_u8) - 1);
+
+  portENTER_CRITICAL(&DitherMux);
+
+  DitherLevel_au16 [Zone_u8] = Level_u16;
+  DitherCode_au16 [Zone_u8] = Code_u16;
+
+  if(DitherOn_b && (Code_u16 < ZONE_DITHER_CODE_MAX) && (Fraction_u16 != 0))
+  {
+    DitherMask_u8 |= (1 << Zone_u8);
+  }
+  else
+  {
+    DitherMask_u8 &= ~(1 << Zone_u8);
+  }
+
+  //esp_timer start / stop do not block
+  if((DitherMask_u8 != 0) && !DitherRunning_b)
+  {
+    DitherRunning_b = (esp_timer_start_periodic(Dither_h, 1000000 / min<uint32_t>(ZONE_DITHER_HZ, ChannelFreqHz_u32)) == ESP_OK);
+  }
+  else if((DitherMask_u8 == 0) && DitherRunning_b)
+  {
+    esp_timer_stop(Dither_h);
+    DitherRunning_b = false;
+  }
+
+  //written under DitherMux: a timer write of the old level can't land after this one
+  ledcWrite(ZoneTable_st.Channel_au8 [Zone_u8], Code_u16);
+
+  portEXIT_CRITICAL(&DitherMux);
+}
+//------------------------------
+
+
+//------------------------------
+// sigma-delta modulator (esp_timer task)
+//------------------------------
+static void DitherTimer_v(void *Arg_pv)
+{
+  uint16_t FractionMask_u16 = (1 << PwmShift_u8) - 1;
+
+  portENTER_CRITICAL(&DitherMux);
+
+  uint8_t Mask_u8 = DitherMask_u8;
+
+  while(Mask_u8)
+  {
+    uint8_t i = __builtin_ctz(Mask_u8);
+    Mask_u8 &= Mask_u8 - 1;
+
+    DitherAcc_au16 [i] += DitherLevel_au16 [i] & FractionMask_u16;
+
+    uint16_t Code_u16 = (DitherLevel_au16 [i] >> PwmShift_u8) + (DitherAcc_au16 [i] >> PwmShift_u8);
+    DitherAcc_au16 [i] &= FractionMask_u16;
+
+    //written under DitherMux, WritePwm_v can't change the zone in between
+    if(Code_u16 != DitherCode_au16 [i])
+    {
+      DitherCode_au16 [i] = Code_u16;
+      ledcWrite(ZoneTable_st.Channel_au8 [i], Code_u16);
+    }
+  }
+
+  portEXIT_CRITICAL(&DitherMux);
+}
+//------------------------------
+
+
+//------------------------------
+// dithering on / off (applied to the current levels)
+//------------------------------
+void LightZone_SetDither_v(bool On_b)
+{
+  if(On_b && (Dither_h == NULL))
+  {
+    esp_timer_create_args_t Args_st = {};
+
+    Args_st.callback = DitherTimer_v;
+    Args_st.dispatch_method = ESP_TIMER_TASK;
+    Args_st.name = "dither";
+
+    if(esp_timer_create(&Args_st, &Dither_h) != ESP_OK)
+    {
+      Dither_h = NULL;
+    }
+  }
+
+  DitherOn_b = On_b && (Dither_h != NULL) && (PwmShift_u8 > 0);
+
+  xSemaphoreTake(OutputMutex, portMAX_DELAY);
+
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    WritePwm_v(i, ZoneTable_st.Level_au16 [i]);
+  }
+
+  xSemaphoreGive(OutputMutex);
+}
+
+uint8_t LightZone_DitherMask_u8(void)
+{
+  return DitherMask_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// set level immediately (stops running ramps)
+//------------------------------
+void LightZone_Set_v(uint8_t ZoneMask_u8, uint16_t Level_u16)
+{
+  uint8_t Changed_u8 = 0;
+
+  ZoneMask_u8 &= (1 << ZoneTable_st.Count_u8) - 1;
+
+  Trace_Log_v(TRACE_ZONE_SET, ZoneMask_u8, 0, 0, Level_u16, 0);
+
+  //the supervisor sets the safe light level here, the stalled zone task may hold the mutex
+  bool Locked_b = (xSemaphoreTake(OutputMutex, pdMS_TO_TICKS(ZONE_OUTPUT_LOCK_MSEC)) == pdTRUE);
+
+  portENTER_CRITICAL(&ZoneMux);
+
+  ZoneTable_st.RampingMask_u8 &= ~ZoneMask_u8;
+  ZoneTable_st.ProgramMask_u8 &= ~ZoneMask_u8;
+
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    if(ZoneMask_u8 & (1 << i))
+    {
+      ZoneTable_st.Target_au16 [i] = Level_u16;
+
+      if(ZoneTable_st.Level_au16 [i] != Level_u16)
+      {
+        ZoneTable_st.Level_au16 [i] = Level_u16;
+        Changed_u8 |= (1 << i);
+      }
+    }
+  }
+
+  portEXIT_CRITICAL(&ZoneMux);
+
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    if(Changed_u8 & (1 << i))
+    {
+      WriteOutput_v(i, Level_u16);
+    }
+  }
+
+  if(Locked_b)
+  {
+    xSemaphoreGive(OutputMutex);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// ramp from current level to target (interrupts running ramps and programs)
+//------------------------------
+void LightZone_StartRamp_v(uint8_t ZoneMask_u8, uint16_t Target_u16, uint32_t RampTimeMsec_u32)
+{
+  LightZone_StartFade_v(ZoneMask_u8, Target_u16, RampTimeMsec_u32, ZONE_EASE_LINEAR);
+}
+
+void LightZone_StartFade_v(uint8_t ZoneMask_u8, uint16_t Target_u16, uint32_t RampTimeMsec_u32, uint8_t Ease_u8)
+{
+  if(RampTimeMsec_u32 == 0)
+  {
+    LightZone_Set_v(ZoneMask_u8, Target_u16);
+    return;
+  }
+
+  ZoneMask_u8 &= (1 << ZoneTable_st.Count_u8) - 1;
+
+  Trace_Log_v(TRACE_ZONE_FADE, ZoneMask_u8, Ease_u8, 0, Target_u16, RampTimeMsec_u32);
+
+  uint32_t Now_u32 = millis();
+
+  portENTER_CRITICAL(&ZoneMux);
+
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    if(ZoneMask_u8 & (1 << i))
+    {
+      ZoneTable_st.Start_au16 [i] = ZoneTable_st.Level_au16 [i];
+      ZoneTable_st.Target_au16 [i] = Target_u16;
+      ZoneTable_st.RampStartMsec_au32 [i] = Now_u32;
+      ZoneTable_st.RampTimeMsec_au32 [i] = RampTimeMsec_u32;
+      ZoneTable_st.Ease_au8 [i] = (Ease_u8 < ZONE_EASE_COUNT) ? Ease_u8 : ZONE_EASE_LINEAR;
+    }
+  }
+
+  ZoneTable_st.RampingMask_u8 |= ZoneMask_u8;
+  ZoneTable_st.ProgramMask_u8 &= ~ZoneMask_u8;
+
+  portEXIT_CRITICAL(&ZoneMux);
+
+  if(LightZone_taskHandle != NULL)
+  {
+    xTaskNotifyGive(LightZone_taskHandle);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// run keyframe program (copied), OffsetMsec_u32 > 0: join a program already in progress
+//------------------------------
+void LightZone_StartProgram_v(uint8_t ZoneMask_u8, const LightKeyframe_t *Keyframe_past, uint8_t Count_u8, uint32_t OffsetMsec_u32)
+{
+  if(Count_u8 == 0)
+  {
+    return;
+  }
+
+  if(Count_u8 > ZONE_KEYFRAMES_MAX)
+  {
+    Count_u8 = ZONE_KEYFRAMES_MAX;
+  }
+
+  //single keyframe: just a level
+  if(Count_u8 == 1)
+  {
+    LightZone_Set_v(ZoneMask_u8, Keyframe_past [0].Level_u16);
+    return;
+  }
+
+  ZoneMask_u8 &= (1 << ZoneTable_st.Count_u8) - 1;
+
+  //keyframes follow the program record
+  Trace_Log_v(TRACE_ZONE_PROGRAM, ZoneMask_u8, Count_u8, 0, 0, OffsetMsec_u32);
+
+  for(uint8_t k = 0; k < Count_u8; k++)
+  {
+    Trace_Log_v(TRACE_ZONE_KEYFRAME, k, Keyframe_past [k].Ease_u8, 0,
+                ((uint32_t)Keyframe_past [k].Level_u16 << 16) | Keyframe_past [k].TimeSec_u16, 0);
+  }
+
+  uint32_t Now_u32 = millis();
+
+  portENTER_CRITICAL(&ZoneMux);
+
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    if(ZoneMask_u8 & (1 << i))
+    {
+      Program_ast [i].Count_u8 = Count_u8;
+      memcpy(Program_ast [i].Keyframe_ast, Keyframe_past, Count_u8 * sizeof(LightKeyframe_t));
+
+      ZoneTable_st.Cursor_au8 [i] = 0;
+      ZoneTable_st.Start_au16 [i] = Keyframe_past [0].Level_u16;
+      ZoneTable_st.Target_au16 [i] = Keyframe_past [Count_u8 - 1].Level_u16;
+      ZoneTable_st.RampStartMsec_au32 [i] = Now_u32 - OffsetMsec_u32;
+      ZoneTable_st.RampTimeMsec_au32 [i] = (uint32_t)Keyframe_past [Count_u8 - 1].TimeSec_u16 * 1000;
+    }
+  }
+
+  ZoneTable_st.RampingMask_u8 |= ZoneMask_u8;
+  ZoneTable_st.ProgramMask_u8 |= ZoneMask_u8;
+
+  portEXIT_CRITICAL(&ZoneMux);
+
+  if(LightZone_taskHandle != NULL)
+  {
+    xTaskNotifyGive(LightZone_taskHandle);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// stop ramps, keep current level
+//------------------------------
+void LightZone_Stop_v(uint8_t ZoneMask_u8)
+{
+  Trace_Log_v(TRACE_ZONE_STOP, ZoneMask_u8, 0, 0, 0, 0);
+
+  portENTER_CRITICAL(&ZoneMux);
+
+  ZoneTable_st.RampingMask_u8 &= ~ZoneMask_u8;
+  ZoneTable_st.ProgramMask_u8 &= ~ZoneMask_u8;
+
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    if(ZoneMask_u8 & (1 << i))
+    {
+      ZoneTable_st.Target_au16 [i] = ZoneTable_st.Level_au16 [i];
+    }
+  }
+
+  portEXIT_CRITICAL(&ZoneMux);
+}
+//------------------------------
+
+
+//------------------------------
+// zone status
+//------------------------------
+bool LightZone_IsRamping_b(uint8_t ZoneMask_u8)
+{
+  return (ZoneTable_st.RampingMask_u8 & ZoneMask_u8) != 0;
+}
+
+//level changes now: ramp, or program segment between different levels (not a hold)
+bool LightZone_IsMoving_b(uint8_t ZoneMask_u8)
+{
+  bool Moving_b = false;
+
+  portENTER_CRITICAL(&ZoneMux);
+
+  uint8_t Mask_u8 = ZoneTable_st.RampingMask_u8 & ZoneMask_u8;
+
+  while(Mask_u8 && !Moving_b)
+  {
+    uint8_t i = __builtin_ctz(Mask_u8);
+    Mask_u8 &= Mask_u8 - 1;
+
+    if(ZoneTable_st.ProgramMask_u8 & (1 << i))
+    {
+      const LightKeyframe_t *From_pst = &Program_ast [i].Keyframe_ast [ZoneTable_st.Cursor_au8 [i]];
+
+      Moving_b = From_pst [0].Level_u16 != From_pst [1].Level_u16;
+    }
+    else
+    {
+      Moving_b = ZoneTable_st.Start_au16 [i] != ZoneTable_st.Target_au16 [i];
+    }
+  }
+
+  portEXIT_CRITICAL(&ZoneMux);
+
+  return Moving_b;
+}
+
+bool LightZone_AnyOn_b(void)
+{
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    if(ZoneTable_st.Level_au16 [i] > 0)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+uint8_t LightZone_Count_u8(void)
+{
+  return ZoneTable_st.Count_u8;
+}
+
+uint8_t LightZone_ScheduleMask_u8(uint8_t Schedule_u8)
+{
+  uint8_t Mask_u8 = 0;
+
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    if(ZoneTable_st.Schedule_au8 [i] == Schedule_u8)
+    {
+      Mask_u8 |= (1 << i);
+    }
+  }
+
+  return Mask_u8;
+}
+
+uint16_t LightZone_GetLevel_u16(uint8_t Zone_u8)
+{
+  if(Zone_u8 >= ZoneTable_st.Count_u8)
+  {
+    return 0;
+  }
+
+  return ZoneTable_st.Level_au16 [Zone_u8];
+}
+//------------------------------
+
+
+//------------------------------
+// conversion percent <-> level
+//------------------------------
+uint16_t LightZone_PercentToLevel_u16(uint8_t Percent_u8)
+{
+  if(Percent_u8 >= 100)
+  {
+    return ZONE_LEVEL_MAX;
+  }
+
+  return (uint32_t)Percent_u8 * ZONE_LEVEL_MAX / 100;
+}
+
+uint8_t LightZone_LevelToPercent_u8(uint16_t Level_u16)
+{
+  return ((uint32_t)Level_u16 * 100 + ZONE_LEVEL_MAX / 2) / ZONE_LEVEL_MAX;
+}
+//------------------------------
+
+
+//------------------------------
+// easing curve names (web API)
+//------------------------------
+uint8_t LightZone_EaseFromName_u8(const char *Name_pc)
+{
+  for(uint8_t i = 0; i < ZONE_EASE_COUNT; i++)
+  {
+    if(strcmp(Name_pc, EaseName_apc [i]) == 0)
+    {
+      return i;
+    }
+  }
+
+  return ZONE_EASE_NONE;
+}
+
+const char *LightZone_EaseName_pc(uint8_t Ease_u8)
+{
+  return (Ease_u8 < ZONE_EASE_COUNT) ? EaseName_apc [Ease_u8] : "";
+}
+//------------------------------
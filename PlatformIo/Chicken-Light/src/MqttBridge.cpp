@@ -0,0 +1,395 @@
+//------------------------------
+// MQTT bridge
+//
+// Topics below <base> (host name):
+//   online           "online" / "offline" (last will), retained
+//   status           status JSON of /api/status, retained
+//   <value>          single page values (state, dutycycle, ...), retained
+//   event            JSON array of the journal records since the last batch
+//   cmd/<command>    subscribed, see MqttCommand_t
+//
+// The task polls the connection every 100 ms for commands, but publishes
+// at most once per configured interval: status only when the page cache
+// generation moved, values only when their text changed, events as one
+// batch. After every (re)connect all retained topics are sent again.
+// Journal records arrive from any task and wait in a small ring; when the
+// broker is away the oldest are dropped.
+//------------------------------
+
+//includes
+//------------------------------
+#include "MqttBridge.h"
+#include "DeviceConfig.h"
+#include "TaskBudget.h"
+#include "TextFormat.h"
+
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <PubSubClient.h>
+//------------------------------
+
+//global variables
+//------------------------------
+static MqttBridge_t Bridge_st;
+static bool Running_b = false;
+
+static WiFiClient NetClient;
+static PubSubClient MqttClient(NetClient);
+
+static char Broker_ac [CONFIG_VALUE_LEN_MAX + 1];     //setServer() keeps the pointer
+static uint16_t Port_u16 = 0;
+
+static char Payload_ac [MQTT_PAYLOAD_LEN_MAX];
+static char Value_aac [MQTT_VALUES_MAX] [PAGE_VALUE_LEN_MAX + 1];   //last published
+
+static JournalRecord_t Event_ast [MQTT_EVENT_QUEUE];
+static uint8_t EventFirst_u8 = 0;
+static uint8_t EventCount_u8 = 0;
+static uint32_t EventDropped_u32 = 0;
+static portMUX_TYPE MqttMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void Mqtt_task(void * pvParameters);
+static bool Topic_b(char *Topic_pc, const char *Suffix_pc);
+static bool Connect_b(void);
+static void Received_v(char *Topic_pc, uint8_t *Payload_pu8, unsigned int Len_u32);
+static void PublishState_v(bool All_b);
+static void PublishEvents_v(void);
+//------------------------------
+
+
+//------------------------------
+// start bridge task (MQTT stays idle while no broker is configured)
+//------------------------------
+void Mqtt_Start_v(const MqttBridge_t *Bridge_pst)
+{
+  Bridge_st = *Bridge_pst;
+  Bridge_st.ValueCount_u8 = min<uint8_t>(Bridge_st.ValueCount_u8, MQTT_VALUES_MAX);
+
+  MqttClient.setBufferSize(MQTT_PAYLOAD_LEN_MAX);
+  MqttClient.setCallback(Received_v);
+
+  Running_b = true;
+  Task_Start_h(TASK_ID_MQTT, Mqtt_task, NULL);
+}
+
+bool Mqtt_Connected_b(void)
+{
+  return Running_b && MqttClient.connected();
+}
+//------------------------------
+
+
+//------------------------------
+// journal hook: queue record for the next batch
+//------------------------------
+void Mqtt_Event_v(const JournalRecord_t *Record_pst)
+{
+  if(!Running_b || (Broker_ac [0] == '\0'))
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&MqttMux);
+
+  if(EventCount_u8 == MQTT_EVENT_QUEUE)
+  {
+    EventFirst_u8 = (EventFirst_u8 + 1) % MQTT_EVENT_QUEUE;
+    EventCount_u8--;
+    EventDropped_u32++;
+  }
+
+  Event_ast [(EventFirst_u8 + EventCount_u8) % MQTT_EVENT_QUEUE] = *Record_pst;
+  EventCount_u8++;
+
+  portEXIT_CRITICAL(&MqttMux);
+}
+//------------------------------
+
+
+//------------------------------
+// bridge task: connection, coalesced publishes, commands
+//------------------------------
+static void Mqtt_task(void * pvParameters)
+{
+  DeviceConfig_t Current_st;
+  uint32_t LastConnectMsec_u32 = 0;
+  uint32_t LastPublishMsec_u32 = 0;
+  uint32_t Generation_u32 = 0;
+  bool Fresh_b = false;         //connected, nothing published yet
+
+  while(1)
+  {
+    uint32_t Now_u32 = millis();
+
+    Config_Copy_v(&Current_st);
+
+    //broker changed: reconnect with new settings
+    if((strcmp(Current_st.MqttBroker_ac, Broker_ac) != 0) || (Current_st.MqttPort_u16 != Port_u16))
+    {
+      if(MqttClient.connected())
+      {
+        MqttClient.disconnect();
+      }
+
+      strcpy(Broker_ac, Current_st.MqttBroker_ac);
+      Port_u16 = Current_st.MqttPort_u16;
+      MqttClient.setServer(Broker_ac, Port_u16);
+      LastConnectMsec_u32 = 0;
+    }
+
+    if((Broker_ac [0] == '\0') || (WiFi.status() != WL_CONNECTED))
+    {
+      if(MqttClient.connected())
+      {
+        MqttClient.disconnect();
+      }
+
+      vTaskDelay(pdMS_TO_TICKS(MQTT_RECONNECT_MSEC));
+      continue;
+    }
+
+    if(!MqttClient.connected())
+    {
+      if((LastConnectMsec_u32 == 0) || ((Now_u32 - LastConnectMsec_u32) >= MQTT_RECONNECT_MSEC))
+      {
+        LastConnectMsec_u32 = Now_u32;
+        Fresh_b = Connect_b();
+      }
+    }
+    else
+    {
+      //commands are handled in Received_v
+      MqttClient.loop();
+
+      if(Fresh_b || ((Now_u32 - LastPublishMsec_u32) >= Current_st.MqttIntervalMsec_u16))
+      {
+        if(Fresh_b || (PageCache_Generation_u32() != Generation_u32))
+        {
+          Generation_u32 = PageCache_Generation_u32();
+          PublishState_v(Fresh_b);
+        }
+
+        PublishEvents_v();
+
+        Fresh_b = false;
+        LastPublishMsec_u32 = Now_u32;
+      }
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(MQTT_POLL_MSEC));
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// "<base>/<suffix>"
+//------------------------------
+static bool Topic_b(char *Topic_pc, const char *Suffix_pc)
+{
+  Text_t Text_st;
+
+  Text_Init_v(&Text_st, Topic_pc, MQTT_TOPIC_LEN_MAX);
+  Text_Str_v(&Text_st, Bridge_st.Base_pc);
+  Text_Char_v(&Text_st, '/');
+  Text_Str_v(&Text_st, Suffix_pc);
+
+  return Text_Ok_b(&Text_st);
+}
+//------------------------------
+
+
+//------------------------------
+// connect with last will, subscribe to commands
+//------------------------------
+static bool Connect_b(void)
+{
+  char Online_ac [MQTT_TOPIC_LEN_MAX];
+  char Command_ac [MQTT_TOPIC_LEN_MAX];
+
+  if(!Topic_b(Online_ac, "online") || !Topic_b(Command_ac, "cmd/#"))
+  {
+    return false;
+  }
+
+  if(!MqttClient.connect(Bridge_st.Base_pc, Online_ac, 1, true, "offline"))
+  {
+    Serial.printf("MQTT: connect to %s:%u failed (%d)\n", Broker_ac, Port_u16, MqttClient.state());
+    return false;
+  }
+
+  MqttClient.publish(Online_ac, "online", true);
+  MqttClient.subscribe(Command_ac);
+
+  Serial.printf("MQTT: connected to %s:%u\n", Broker_ac, Port_u16);
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// command topic (runs in MqttClient.loop())
+//------------------------------
+static void Received_v(char *Topic_pc, uint8_t *Payload_pu8, unsigned int Len_u32)
+{
+  char Prefix_ac [MQTT_TOPIC_LEN_MAX];
+  char Value_ac [MQTT_COMMAND_LEN_MAX + 1];
+
+  if((Bridge_st.Command_pfn == NULL) || !Topic_b(Prefix_ac, "cmd/"))
+  {
+    return;
+  }
+
+  size_t PrefixLen_u32 = strlen(Prefix_ac);
+
+  if(strncmp(Topic_pc, Prefix_ac, PrefixLen_u32) != 0)
+  {
+    return;
+  }
+
+  //payload is not terminated
+  Len_u32 = min<unsigned int>(Len_u32, MQTT_COMMAND_LEN_MAX);
+  memcpy(Value_ac, Payload_pu8, Len_u32);
+  Value_ac [Len_u32] = '\0';
+
+  if(!Bridge_st.Command_pfn(Topic_pc + PrefixLen_u32, Value_ac))
+  {
+    Serial.printf("MQTT: rejected %s = %s\n", Topic_pc, Value_ac);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// status JSON and changed values (All_b: after connect)
+//------------------------------
+static void PublishState_v(bool All_b)
+{
+  char Topic_ac [MQTT_TOPIC_LEN_MAX];
+
+  if((Bridge_st.Status_pfn != NULL) && Topic_b(Topic_ac, "status"))
+  {
+    size_t Len_u32 = Bridge_st.Status_pfn(Payload_ac, sizeof(Payload_ac));
+
+    if(Len_u32 > 0)
+    {
+      MqttClient.publish(Topic_ac, (const uint8_t *)Payload_ac, Len_u32, true);
+    }
+  }
+
+  for(uint8_t i = 0; i < Bridge_st.ValueCount_u8; i++)
+  {
+    char Value_ac [PAGE_VALUE_LEN_MAX + 1];
+
+    Bridge_st.Value_pfn(Bridge_st.Value_past [i].Var_u8, Value_ac, sizeof(Value_ac));
+
+    if(!All_b && (strcmp(Value_ac, Value_aac [i]) == 0))
+    {
+      continue;
+    }
+
+    if(Topic_b(Topic_ac, Bridge_st.Value_past [i].Topic_pc) && MqttClient.publish(Topic_ac, Value_ac, true))
+    {
+      strcpy(Value_aac [i], Value_ac);
+    }
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// queued journal records as one JSON array
+// (numeric type/source: JOURNAL_EVENT_xxx, JOURNAL_SRC_xxx)
+//------------------------------
+static void PublishEvents_v(void)
+{
+  JournalRecord_t Record_ast [MQTT_EVENT_QUEUE];
+  uint8_t Count_u8 = 0;
+  uint32_t Dropped_u32 = 0;
+  char Topic_ac [MQTT_TOPIC_LEN_MAX];
+  Text_t Text_st;
+
+  portENTER_CRITICAL(&MqttMux);
+
+  while(Count_u8 < EventCount_u8)
+  {
+    Record_ast [Count_u8] = Event_ast [(EventFirst_u8 + Count_u8) % MQTT_EVENT_QUEUE];
+    Count_u8++;
+  }
+
+  Dropped_u32 = EventDropped_u32;
+  portEXIT_CRITICAL(&MqttMux);
+
+  if((Count_u8 == 0) || !Topic_b(Topic_ac, "event"))
+  {
+    return;
+  }
+
+  Text_Init_v(&Text_st, Payload_ac, sizeof(Payload_ac));
+  Text_Char_v(&Text_st, '[');
+
+  uint8_t Sent_u8 = 0;
+
+  for(; Sent_u8 < Count_u8; Sent_u8++)
+  {
+    const JournalRecord_t *Record_pst = &Record_ast [Sent_u8];
+    char Item_ac [MQTT_EVENT_LEN_MAX];
+    Text_t Item_st;
+
+    Text_Init_v(&Item_st, Item_ac, sizeof(Item_ac));
+    Text_Str_v(&Item_st, (Sent_u8 > 0) ? ",{\"time\":" : "{\"time\":");
+    Text_Uint_v(&Item_st, Record_pst->Time_u32);
+    Text_Str_v(&Item_st, ",\"type\":");
+    Text_Uint_v(&Item_st, Record_pst->Type_u8);
+    Text_Str_v(&Item_st, ",\"source\":");
+    Text_Uint_v(&Item_st, Record_pst->Source_u8);
+    Text_Str_v(&Item_st, ",\"arg\":");
+    Text_Uint_v(&Item_st, Record_pst->Arg_u16);
+    Text_Str_v(&Item_st, ",\"value\":");
+    Text_Uint_v(&Item_st, Record_pst->Value_u32);
+    Text_Char_v(&Item_st, '}');
+
+    //keep room for the closing bracket, the rest goes with the next batch
+    if(Text_Len_u32(&Text_st) + Text_Len_u32(&Item_st) + 2 > sizeof(Payload_ac))
+    {
+      break;
+    }
+
+    Text_Str_v(&Text_st, Item_ac);
+  }
+
+  Text_Char_v(&Text_st, ']');
+
+  if((Sent_u8 == 0) || !MqttClient.publish(Topic_ac, (const uint8_t *)Payload_ac, Text_Len_u32(&Text_st), false))
+  {
+    return;
+  }
+
+  //remove sent records; records dropped meanwhile by Mqtt_Event_v were the oldest (sent) ones
+  portENTER_CRITICAL(&MqttMux);
+
+  uint32_t Gone_u32 = EventDropped_u32 - Dropped_u32;
+
+  if(Gone_u32 < Sent_u8)
+  {
+    EventFirst_u8 = (EventFirst_u8 + Sent_u8 - Gone_u32) % MQTT_EVENT_QUEUE;
+    EventCount_u8 -= Sent_u8 - Gone_u32;
+    EventDropped_u32 = 0;
+  }
+  else
+  {
+    EventDropped_u32 = Gone_u32 - Sent_u8;
+  }
+
+  portEXIT_CRITICAL(&MqttMux);
+
+  if(Dropped_u32 > 0)
+  {
+    Serial.printf("MQTT: %u events dropped\n", Dropped_u32);
+  }
+}
+//------------------------------
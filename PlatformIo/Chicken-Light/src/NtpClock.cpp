@@ -0,0 +1,801 @@
+//------------------------------
+// NTP clock
+//
+// A sync sends NTP_SAMPLES rounds of requests, one request per server and
+// round, NTP_SAMPLE_GAP_MSEC apart. Every reply gives offset (UTC -
+// uptime) and round trip delay; the reply must echo the transmit
+// timestamp of our request, so late or foreign packets are ignored.
+//
+// Clock filter: per server the sample with the least delay is used, the
+// spread of the other samples is its jitter. Offset +- root distance
+// (half delay, the server's own root delay and dispersion, jitter) is an
+// interval that contains the true time if the server is right.
+// Intersection (Marzullo): the range covered by the most intervals wins
+// if more than half of the candidates agree on it; servers outside are
+// falsetickers. The result is the mean offset of the truechimers,
+// weighted by 1 / root distance. Without a majority the sync fails and
+// the RTC is kept.
+//
+// Health: truechimers gain, timeouts and falsetickers lose points. At 0
+// (or after a kiss-o'-death) a server is skipped for NTP_BACKOFF_SYNCS
+// syncs and its name is looked up again, a pool name then usually points
+// to another host. Addresses are cached NTP_DNS_CACHE_SEC; a failed
+// lookup keeps the old address.
+//------------------------------
+
+//includes
+//------------------------------
+#include "NtpClock.h"
+#include "DeviceConfig.h"
+#include "TaskBudget.h"
+#include "WifiManager.h"
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "esp_timer.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define NTP_PACKET_LEN 48
+#define NTP_UNIX_OFFSET_SEC 2208988800LL      //1900-01-01 to 1970-01-01
+#define NTP_PRECISION_USEC 1000               //receive poll, added to every root distance
+#define NTP_IDLE_MSEC 100
+
+static const char * const StateName_apc [] =
+{
+  "idle", "unresolved", "timeout", "kiss", "distance", "falseticker", "truechimer", "backoff", "duplicate", "undecided"
+};
+//------------------------------
+
+//global variables
+//------------------------------
+typedef struct
+{
+  char Host_ac [NTP_SERVER_LEN_MAX + 1];      //empty = unused
+  uint16_t Port_u16;
+  IPAddress Ip;
+  bool Resolved_b;
+  uint32_t ResolvedMsec_u32;
+  uint8_t Health_u8;
+  uint8_t Backoff_u8;                         //syncs left to skip
+  uint8_t State_u8;                           //NTP_STATE_xxx of the last sync
+  uint8_t Stratum_u8;
+  uint8_t Samples_u8;                         //valid samples of the last sync
+
+  //open request
+  bool Waiting_b;
+  int64_t SentUsec_s64;
+  uint8_t Cookie_au8 [8];                     //our transmit timestamp, echoed as origin
+
+  int64_t Offset_as64 [NTP_SAMPLES];          //UTC - uptime [us]
+  int64_t Delay_as64 [NTP_SAMPLES];
+  uint32_t RootUsec_u32;                      //root delay / 2 + root dispersion of the server
+
+  //clock filter
+  int64_t OffsetUsec_s64;
+  int64_t DelayUsec_s64;
+  int64_t JitterUsec_s64;
+  int64_t DistanceUsec_s64;
+
+  //statistics
+  uint32_t Replies_u32;
+  uint32_t Timeouts_u32;
+  uint32_t Invalid_u32;
+  uint32_t Kisses_u32;
+  uint32_t Falsetickers_u32;
+  uint32_t Lookups_u32;
+} NtpServer_t;
+
+typedef struct
+{
+  int64_t Value_s64;
+  int8_t Type_s8;                             //+1 lower end, -1 upper end
+} NtpEdge_t;
+
+static NtpHooks_t Hooks_st;
+static WiFiUDP Udp;
+static NtpServer_t Server_ast [NTP_SERVER_COUNT];      //NTP task only
+
+static volatile bool Requested_b = false;
+static volatile bool Running_b = false;
+
+//status (copied under mux for the web server)
+static NtpServer_t Shown_ast [NTP_SERVER_COUNT];
+static int64_t SystemOffsetUsec_s64 = 0;      //UTC - uptime of the last good sync
+static uint8_t Candidates_u8 = 0;
+static uint8_t Truechimers_u8 = 0;
+static uint32_t Syncs_u32 = 0;
+static uint32_t Fails_u32 = 0;
+static uint32_t LastOkMsec_u32 = 0;
+static bool EverOk_b = false;
+
+static portMUX_TYPE NtpMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void Ntp_task(void * pvParameters);
+static bool Sync_b(int64_t *OffsetUsec_ps64);
+static void Prepare_v(const DeviceConfig_t *Config_pst);
+static bool Resolve_b(NtpServer_t *Server_pst);
+static void Send_v(NtpServer_t *Server_pst);
+static void Receive_v(void);
+static void Filter_v(NtpServer_t *Server_pst);
+static uint8_t Select_u8(int64_t *OffsetUsec_ps64);
+static void Score_v(void);
+static int64_t NtpToUnixUsec_s64(const uint8_t *Ts_pu8);
+static uint32_t Read32_u32(const uint8_t *Data_pu8);
+//------------------------------
+
+
+//------------------------------
+// start NTP task (syncs on request only)
+//------------------------------
+void Ntp_Start_v(const NtpHooks_t *Hooks_pst)
+{
+  Hooks_st = *Hooks_pst;
+
+  Task_Start_h(TASK_ID_NTP, Ntp_task, NULL);
+}
+
+void Ntp_Request_v(void)
+{
+  Requested_b = true;
+}
+
+bool Ntp_Busy_b(void)
+{
+  return Requested_b || Running_b;
+}
+//------------------------------
+
+
+//------------------------------
+// NTP task: one sync per request, result to the hook
+//------------------------------
+static void Ntp_task(void * pvParameters)
+{
+  while(1)
+  {
+    if(!Requested_b)
+    {
+      vTaskDelay(pdMS_TO_TICKS(NTP_IDLE_MSEC));
+      continue;
+    }
+
+    Running_b = true;
+    Requested_b = false;
+
+    if(Hooks_st.Active_pfn != NULL)
+    {
+      Hooks_st.Active_pfn(true);
+    }
+
+    int64_t OffsetUsec_s64 = 0;
+    bool Ok_b = Wifi_Connected_b() && Sync_b(&OffsetUsec_s64);
+
+    if(Hooks_st.Active_pfn != NULL)
+    {
+      Hooks_st.Active_pfn(false);
+    }
+
+    portENTER_CRITICAL(&NtpMux);
+
+    for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+    {
+      Shown_ast [i] = Server_ast [i];
+    }
+
+    Syncs_u32++;
+    Fails_u32 += Ok_b ? 0 : 1;
+
+    if(Ok_b)
+    {
+      SystemOffsetUsec_s64 = OffsetUsec_s64;
+      LastOkMsec_u32 = millis();
+      EverOk_b = true;
+    }
+
+    portEXIT_CRITICAL(&NtpMux);
+
+    Hooks_st.Result_pfn(Ok_b, Ok_b ? esp_timer_get_time() + OffsetUsec_s64 : 0);
+
+    Running_b = false;
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// one sync: all rounds, filter, selection, health
+//------------------------------
+static bool Sync_b(int64_t *OffsetUsec_ps64)
+{
+  DeviceConfig_t Current_st;
+  uint8_t Active_u8 = 0;
+
+  Config_Copy_v(&Current_st);
+  Prepare_v(&Current_st);
+
+  for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+  {
+    Active_u8 += (Server_ast [i].State_u8 == NTP_STATE_IDLE) && (Server_ast [i].Host_ac [0] != '\0') ? 1 : 0;
+  }
+
+  if((Active_u8 == 0) || !Udp.begin(NTP_LOCAL_PORT))
+  {
+    Score_v();
+    return false;
+  }
+
+  for(uint8_t Round_u8 = 0; Round_u8 < NTP_SAMPLES; Round_u8++)
+  {
+    if(Round_u8 > 0)
+    {
+      vTaskDelay(pdMS_TO_TICKS(NTP_SAMPLE_GAP_MSEC));
+    }
+
+    //late replies of the last round
+    while(Udp.parsePacket() > 0)
+    {
+    }
+
+    for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+    {
+      if((Server_ast [i].State_u8 == NTP_STATE_IDLE) && (Server_ast [i].Host_ac [0] != '\0'))
+      {
+        Send_v(&Server_ast [i]);
+      }
+    }
+
+    uint32_t StartMsec_u32 = millis();
+    bool Waiting_b = true;
+
+    while(Waiting_b && (millis() - StartMsec_u32 < NTP_REPLY_TIMEOUT_MSEC))
+    {
+      vTaskDelay(pdMS_TO_TICKS(NTP_POLL_MSEC));
+      Receive_v();
+
+      Waiting_b = false;
+
+      for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+      {
+        Waiting_b = Waiting_b || Server_ast [i].Waiting_b;
+      }
+    }
+
+    for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+    {
+      Server_ast [i].Waiting_b = false;
+    }
+  }
+
+  Udp.stop();
+
+  for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+  {
+    Filter_v(&Server_ast [i]);
+  }
+
+  bool Ok_b = (Select_u8(OffsetUsec_ps64) > 0);
+
+  Score_v();
+
+  return Ok_b;
+}
+//------------------------------
+
+
+//------------------------------
+// servers of this sync: config, back-off, DNS cache
+//------------------------------
+static void Prepare_v(const DeviceConfig_t *Config_pst)
+{
+  for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+  {
+    NtpServer_t *Server_pst = &Server_ast [i];
+    char Host_ac [NTP_SERVER_LEN_MAX + 1] = "";
+    uint16_t Port_u16 = NTP_PORT;
+
+    //validated when configured: empty or wrong = unused
+    if(!Ntp_ParseServer_b(Config_pst->NtpServer_aac [i], Host_ac, &Port_u16))
+    {
+      Host_ac [0] = '\0';
+    }
+
+    //other server: cache and score start over
+    if((strcmp(Host_ac, Server_pst->Host_ac) != 0) || (Port_u16 != Server_pst->Port_u16))
+    {
+      *Server_pst = NtpServer_t();
+      strcpy(Server_pst->Host_ac, Host_ac);
+      Server_pst->Port_u16 = Port_u16;
+      Server_pst->Health_u8 = NTP_HEALTH_START;
+    }
+
+    Server_pst->State_u8 = NTP_STATE_IDLE;
+    Server_pst->Samples_u8 = 0;
+    Server_pst->Waiting_b = false;
+
+    if(Server_pst->Host_ac [0] == '\0')
+    {
+      continue;
+    }
+
+    if(Server_pst->Backoff_u8 > 0)
+    {
+      Server_pst->State_u8 = NTP_STATE_BACKOFF;
+
+      if(--Server_pst->Backoff_u8 == 0)
+      {
+        Server_pst->Health_u8 = NTP_HEALTH_START / 2;
+      }
+      continue;
+    }
+
+    if(!Resolve_b(Server_pst))
+    {
+      Server_pst->State_u8 = NTP_STATE_UNRESOLVED;
+      continue;
+    }
+
+    //two pool names on one host would vote twice
+    for(uint8_t k = 0; k < i; k++)
+    {
+      if((Server_ast [k].State_u8 == NTP_STATE_IDLE) && (Server_ast [k].Host_ac [0] != '\0')
+         && (Server_ast [k].Ip == Server_pst->Ip) && (Server_ast [k].Port_u16 == Server_pst->Port_u16))
+      {
+        Server_pst->State_u8 = NTP_STATE_DUPLICATE;
+        Server_pst->Resolved_b = false;
+        break;
+      }
+    }
+  }
+}
+
+static bool Resolve_b(NtpServer_t *Server_pst)
+{
+  IPAddress Ip;
+
+  if(Server_pst->Resolved_b && (millis() - Server_pst->ResolvedMsec_u32 < NTP_DNS_CACHE_SEC * 1000UL))
+  {
+    return true;
+  }
+
+  Server_pst->Lookups_u32++;
+
+  if(Ip.fromString(Server_pst->Host_ac) || ((WiFi.hostByName(Server_pst->Host_ac, Ip) == 1) && ((uint32_t)Ip != 0)))
+  {
+    Server_pst->Ip = Ip;
+    Server_pst->Resolved_b = true;
+    Server_pst->ResolvedMsec_u32 = millis();
+  }
+
+  //lookup failed: an expired address is better than none
+  return Server_pst->Resolved_b;
+}
+//------------------------------
+
+
+//------------------------------
+// request and replies
+//------------------------------
+static void Send_v(NtpServer_t *Server_pst)
+{
+  uint8_t Packet_au8 [NTP_PACKET_LEN];
+  int64_t Now_s64 = esp_timer_get_time();
+  uint32_t Sec_u32 = Now_s64 / 1000000;
+  uint32_t Frac_u32 = ((uint64_t)(Now_s64 % 1000000) << 32) / 1000000;
+
+  memset(Packet_au8, 0, sizeof(Packet_au8));
+  Packet_au8 [0] = 0x23;                      //LI 0, version 4, mode 3 (client)
+
+  //transmit timestamp: uptime, only compared with the echoed origin
+  for(uint8_t i = 0; i < 4; i++)
+  {
+    Packet_au8 [40 + i] = Sec_u32 >> (24 - 8 * i);
+    Packet_au8 [44 + i] = Frac_u32 >> (24 - 8 * i);
+  }
+
+  memcpy(Server_pst->Cookie_au8, &Packet_au8 [40], 8);
+
+  Udp.beginPacket(Server_pst->Ip, Server_pst->Port_u16);
+  Udp.write(Packet_au8, sizeof(Packet_au8));
+
+  Server_pst->SentUsec_s64 = esp_timer_get_time();
+  Server_pst->Waiting_b = (Udp.endPacket() == 1);
+}
+
+static void Receive_v(void)
+{
+  uint8_t Packet_au8 [NTP_PACKET_LEN];
+
+  while(Udp.parsePacket() > 0)
+  {
+    int64_t Arrival_s64 = esp_timer_get_time();
+    int Len_s32 = Udp.read(Packet_au8, sizeof(Packet_au8));
+    NtpServer_t *Server_pst = NULL;
+
+    for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+    {
+      if(Server_ast [i].Waiting_b && (Server_ast [i].Ip == Udp.remoteIP()) && (Server_ast [i].Port_u16 == Udp.remotePort()))
+      {
+        Server_pst = &Server_ast [i];
+        break;
+      }
+    }
+
+    if(Server_pst == NULL)
+    {
+      continue;
+    }
+
+    uint8_t Leap_u8 = Packet_au8 [0] >> 6;
+    uint8_t Version_u8 = (Packet_au8 [0] >> 3) & 0x07;
+    uint8_t Stratum_u8 = Packet_au8 [1];
+
+    //answer to our open request (origin = our transmit timestamp)
+    if((Len_s32 != NTP_PACKET_LEN) || ((Packet_au8 [0] & 0x07) != 4) || (Version_u8 < 3)
+       || (memcmp(&Packet_au8 [24], Server_pst->Cookie_au8, 8) != 0))
+    {
+      Server_pst->Invalid_u32++;
+      continue;
+    }
+
+    Server_pst->Waiting_b = false;
+
+    if(Stratum_u8 == 0)
+    {
+      Server_pst->Kisses_u32++;
+      Server_pst->State_u8 = NTP_STATE_KISS;
+      continue;
+    }
+
+    if((Leap_u8 == 3) || (Stratum_u8 > 15) || (Read32_u32(&Packet_au8 [40]) == 0))
+    {
+      Server_pst->Invalid_u32++;
+      continue;
+    }
+
+    //T1 sent, T2 server receive, T3 server transmit, T4 arrival
+    int64_t T2_s64 = NtpToUnixUsec_s64(&Packet_au8 [32]);
+    int64_t T3_s64 = NtpToUnixUsec_s64(&Packet_au8 [40]);
+    int64_t Delay_s64 = (Arrival_s64 - Server_pst->SentUsec_s64) - (T3_s64 - T2_s64);
+    uint8_t n_u8 = Server_pst->Samples_u8;
+
+    if(n_u8 < NTP_SAMPLES)
+    {
+      Server_pst->Offset_as64 [n_u8] = ((T2_s64 - Server_pst->SentUsec_s64) + (T3_s64 - Arrival_s64)) / 2;
+      Server_pst->Delay_as64 [n_u8] = max<int64_t>(Delay_s64, 0);
+      Server_pst->Samples_u8++;
+    }
+
+    //root delay and dispersion: 16.16 seconds
+    Server_pst->RootUsec_u32 = (((uint64_t)Read32_u32(&Packet_au8 [4]) * 1000000) >> 17)
+                               + (((uint64_t)Read32_u32(&Packet_au8 [8]) * 1000000) >> 16);
+    Server_pst->Stratum_u8 = Stratum_u8;
+    Server_pst->Replies_u32++;
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// clock filter: least delayed sample, jitter, root distance
+//------------------------------
+static void Filter_v(NtpServer_t *Server_pst)
+{
+  if(Server_pst->State_u8 != NTP_STATE_IDLE)
+  {
+    return;
+  }
+
+  if(Server_pst->Samples_u8 == 0)
+  {
+    Server_pst->Timeouts_u32 += (Server_pst->Host_ac [0] != '\0') ? 1 : 0;
+    Server_pst->State_u8 = (Server_pst->Host_ac [0] != '\0') ? NTP_STATE_TIMEOUT : NTP_STATE_IDLE;
+    return;
+  }
+
+  uint8_t Best_u8 = 0;
+
+  for(uint8_t i = 1; i < Server_pst->Samples_u8; i++)
+  {
+    if(Server_pst->Delay_as64 [i] < Server_pst->Delay_as64 [Best_u8])
+    {
+      Best_u8 = i;
+    }
+  }
+
+  int64_t Sum_s64 = 0;
+
+  for(uint8_t i = 0; i < Server_pst->Samples_u8; i++)
+  {
+    int64_t Diff_s64 = min<int64_t>(llabs(Server_pst->Offset_as64 [i] - Server_pst->Offset_as64 [Best_u8]), 1000000);
+    Sum_s64 += Diff_s64 * Diff_s64;
+  }
+
+  Server_pst->OffsetUsec_s64 = Server_pst->Offset_as64 [Best_u8];
+  Server_pst->DelayUsec_s64 = Server_pst->Delay_as64 [Best_u8];
+  Server_pst->JitterUsec_s64 = (Server_pst->Samples_u8 > 1) ? (int64_t)sqrt((double)Sum_s64 / (Server_pst->Samples_u8 - 1)) : 0;
+  Server_pst->DistanceUsec_s64 = Server_pst->DelayUsec_s64 / 2 + Server_pst->RootUsec_u32 + Server_pst->JitterUsec_s64
+                                 + NTP_PRECISION_USEC;
+
+  if(Server_pst->DistanceUsec_s64 > NTP_DISTANCE_MAX_MSEC * 1000LL)
+  {
+    Server_pst->State_u8 = NTP_STATE_DISTANCE;
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// intersection of the correctness intervals, combined offset
+// returns the number of truechimers (0: no majority)
+//------------------------------
+static uint8_t Select_u8(int64_t *OffsetUsec_ps64)
+{
+  NtpEdge_t Edge_ast [2 * NTP_SERVER_COUNT];
+  uint8_t Edges_u8 = 0;
+  uint8_t n_u8 = 0;
+
+  for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+  {
+    const NtpServer_t *Server_pst = &Server_ast [i];
+
+    if((Server_pst->State_u8 == NTP_STATE_IDLE) && (Server_pst->Samples_u8 > 0))
+    {
+      Edge_ast [Edges_u8++] = {Server_pst->OffsetUsec_s64 - Server_pst->DistanceUsec_s64, 1};
+      Edge_ast [Edges_u8++] = {Server_pst->OffsetUsec_s64 + Server_pst->DistanceUsec_s64, -1};
+      n_u8++;
+    }
+  }
+
+  Candidates_u8 = n_u8;
+  Truechimers_u8 = 0;
+
+  if(n_u8 == 0)
+  {
+    return 0;
+  }
+
+  //by value, lower end first: touching intervals overlap
+  for(uint8_t i = 1; i < Edges_u8; i++)
+  {
+    NtpEdge_t Edge_st = Edge_ast [i];
+    uint8_t k = i;
+
+    while((k > 0) && ((Edge_ast [k - 1].Value_s64 > Edge_st.Value_s64)
+                      || ((Edge_ast [k - 1].Value_s64 == Edge_st.Value_s64) && (Edge_ast [k - 1].Type_s8 < Edge_st.Type_s8))))
+    {
+      Edge_ast [k] = Edge_ast [k - 1];
+      k--;
+    }
+
+    Edge_ast [k] = Edge_st;
+  }
+
+  int8_t Count_s8 = 0;
+  int8_t Best_s8 = 0;
+  int64_t Low_s64 = 0;
+  int64_t High_s64 = 0;
+
+  for(uint8_t i = 0; i + 1 < Edges_u8; i++)
+  {
+    Count_s8 += Edge_ast [i].Type_s8;
+
+    if(Count_s8 > Best_s8)
+    {
+      Best_s8 = Count_s8;
+      Low_s64 = Edge_ast [i].Value_s64;
+      High_s64 = Edge_ast [i + 1].Value_s64;
+    }
+  }
+
+  //majority of the candidates
+  if(2 * Best_s8 <= n_u8)
+  {
+    for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+    {
+      if((Server_ast [i].State_u8 == NTP_STATE_IDLE) && (Server_ast [i].Samples_u8 > 0))
+      {
+        Server_ast [i].State_u8 = NTP_STATE_UNDECIDED;
+      }
+    }
+
+    return 0;
+  }
+
+  //weighted mean relative to the intersection (no precision lost in double)
+  double Sum_f64 = 0.0;
+  double Weight_f64 = 0.0;
+
+  for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+  {
+    NtpServer_t *Server_pst = &Server_ast [i];
+
+    if((Server_pst->State_u8 != NTP_STATE_IDLE) || (Server_pst->Samples_u8 == 0))
+    {
+      continue;
+    }
+
+    if((Server_pst->OffsetUsec_s64 - Server_pst->DistanceUsec_s64 <= High_s64)
+       && (Server_pst->OffsetUsec_s64 + Server_pst->DistanceUsec_s64 >= Low_s64))
+    {
+      Server_pst->State_u8 = NTP_STATE_TRUECHIMER;
+      Sum_f64 += (double)(Server_pst->OffsetUsec_s64 - Low_s64) / Server_pst->DistanceUsec_s64;
+      Weight_f64 += 1.0 / Server_pst->DistanceUsec_s64;
+      Truechimers_u8++;
+    }
+    else
+    {
+      Server_pst->State_u8 = NTP_STATE_FALSETICKER;
+      Server_pst->Falsetickers_u32++;
+    }
+  }
+
+  *OffsetUsec_ps64 = Low_s64 + (int64_t)(Sum_f64 / Weight_f64);
+
+  return Truechimers_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// health scores from the states of the selection, back-off (failover to the other servers)
+//------------------------------
+static void Score_v(void)
+{
+  for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+  {
+    NtpServer_t *Server_pst = &Server_ast [i];
+    int16_t Health_s16 = Server_pst->Health_u8;
+
+    switch(Server_pst->State_u8)
+    {
+      case NTP_STATE_TRUECHIMER:
+        Health_s16 += NTP_HEALTH_GOOD;
+        break;
+
+      case NTP_STATE_FALSETICKER:
+        Health_s16 -= NTP_HEALTH_FALSE;
+        break;
+
+      case NTP_STATE_UNRESOLVED:
+      case NTP_STATE_TIMEOUT:
+      case NTP_STATE_DISTANCE:
+        Health_s16 -= NTP_HEALTH_TIMEOUT;
+        break;
+
+      case NTP_STATE_KISS:
+        Health_s16 = 0;
+        break;
+
+      default:
+        //no majority: nobody can be blamed
+        break;
+    }
+
+    Server_pst->Health_u8 = constrain(Health_s16, 0, NTP_HEALTH_MAX);
+
+    if((Server_pst->Health_u8 == 0) && (Server_pst->State_u8 != NTP_STATE_BACKOFF) && (Server_pst->Host_ac [0] != '\0'))
+    {
+      Server_pst->Backoff_u8 = NTP_BACKOFF_SYNCS;
+      Server_pst->Resolved_b = false;
+    }
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// NTP timestamp (big endian 32.32 since 1900) to unix time [us]
+//------------------------------
+static int64_t NtpToUnixUsec_s64(const uint8_t *Ts_pu8)
+{
+  uint32_t Sec_u32 = Read32_u32(Ts_pu8);
+  uint32_t Frac_u32 = Read32_u32(Ts_pu8 + 4);
+
+  //era 1 starts 2036-02-07: small second counts are after the wrap
+  int64_t Unix_s64 = (int64_t)Sec_u32 + ((Sec_u32 < 0x80000000UL) ? 0x100000000LL : 0) - NTP_UNIX_OFFSET_SEC;
+
+  return Unix_s64 * 1000000 + (int64_t)(((uint64_t)Frac_u32 * 1000000) >> 32);
+}
+
+static uint32_t Read32_u32(const uint8_t *Data_pu8)
+{
+  return ((uint32_t)Data_pu8 [0] << 24) | ((uint32_t)Data_pu8 [1] << 16) | ((uint32_t)Data_pu8 [2] << 8) | Data_pu8 [3];
+}
+//------------------------------
+
+
+//------------------------------
+// "host" or "host:port" (host name or IPv4 address)
+//------------------------------
+bool Ntp_ParseServer_b(const char *Text_pc, char *Host_pc, uint16_t *Port_pu16)
+{
+  const char *Colon_pc = strchr(Text_pc, ':');
+  size_t Len_u32 = (Colon_pc != NULL) ? (size_t)(Colon_pc - Text_pc) : strlen(Text_pc);
+
+  if((Len_u32 == 0) || (Len_u32 > NTP_SERVER_LEN_MAX))
+  {
+    return false;
+  }
+
+  for(size_t i = 0; i < Len_u32; i++)
+  {
+    if(!isalnum((unsigned char)Text_pc [i]) && (Text_pc [i] != '.') && (Text_pc [i] != '-'))
+    {
+      return false;
+    }
+  }
+
+  *Port_pu16 = NTP_PORT;
+
+  if(Colon_pc != NULL)
+  {
+    char *End_pc = NULL;
+    unsigned long Port_u32 = strtoul(Colon_pc + 1, &End_pc, 10);
+
+    if((Colon_pc [1] == '\0') || (*End_pc != '\0') || (Port_u32 == 0) || (Port_u32 > 65535))
+    {
+      return false;
+    }
+
+    *Port_pu16 = Port_u32;
+  }
+
+  memcpy(Host_pc, Text_pc, Len_u32);
+  Host_pc [Len_u32] = '\0';
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// status: last sync per server, offsets relative to the selected time
+//------------------------------
+void Ntp_PrintJson_v(Print &Out)
+{
+  NtpServer_t Server_st;
+
+  portENTER_CRITICAL(&NtpMux);
+  int64_t System_s64 = SystemOffsetUsec_s64;
+  uint32_t Total_u32 = Syncs_u32;
+  uint32_t Failed_u32 = Fails_u32;
+  int32_t AgeSec_s32 = EverOk_b ? (int32_t)((millis() - LastOkMsec_u32) / 1000) : -1;
+  uint8_t Found_u8 = Candidates_u8;
+  uint8_t Agree_u8 = Truechimers_u8;
+  portEXIT_CRITICAL(&NtpMux);
+
+  Out.printf("{\"busy\":%s,\"syncs\":%u,\"fails\":%u,\"last_ok_s\":%d,\"candidates\":%u,\"truechimers\":%u,\"servers\":[",
+             Ntp_Busy_b() ? "true" : "false", Total_u32, Failed_u32, AgeSec_s32, Found_u8, Agree_u8);
+
+  for(uint8_t i = 0; i < NTP_SERVER_COUNT; i++)
+  {
+    portENTER_CRITICAL(&NtpMux);
+    Server_st = Shown_ast [i];
+    portEXIT_CRITICAL(&NtpMux);
+
+    bool Sampled_b = (Server_st.Samples_u8 > 0);
+
+    Out.printf("%s{\"host\":\"%s\",\"port\":%u,\"ip\":\"%u.%u.%u.%u\",\"dns_age_s\":%d,\"health\":%u,\"state\":\"%s\","
+               "\"stratum\":%u,\"samples\":%u,",
+               (i > 0) ? "," : "", Server_st.Host_ac, Server_st.Port_u16,
+               Server_st.Ip [0], Server_st.Ip [1], Server_st.Ip [2], Server_st.Ip [3],
+               Server_st.Resolved_b ? (int32_t)((millis() - Server_st.ResolvedMsec_u32) / 1000) : -1,
+               Server_st.Health_u8, StateName_apc [Server_st.State_u8], Server_st.Stratum_u8, Server_st.Samples_u8);
+
+    Out.printf("\"offset_ms\":%.3f,\"delay_ms\":%.3f,\"jitter_ms\":%.3f,\"distance_ms\":%.3f,"
+               "\"replies\":%u,\"timeouts\":%u,\"invalid\":%u,\"kisses\":%u,\"falsetickers\":%u,\"lookups\":%u}",
+               Sampled_b ? (Server_st.OffsetUsec_s64 - System_s64) / 1000.0 : 0.0,
+               Sampled_b ? Server_st.DelayUsec_s64 / 1000.0 : 0.0, Sampled_b ? Server_st.JitterUsec_s64 / 1000.0 : 0.0,
+               Sampled_b ? Server_st.DistanceUsec_s64 / 1000.0 : 0.0,
+               Server_st.Replies_u32, Server_st.Timeouts_u32, Server_st.Invalid_u32, Server_st.Kisses_u32,
+               Server_st.Falsetickers_u32, Server_st.Lookups_u32);
+  }
+
+  Out.printf("]}");
+}
+//------------------------------
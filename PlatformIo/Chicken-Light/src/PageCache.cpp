@@ -0,0 +1,203 @@
+//------------------------------
+// Page cache
+//
+// The controller bumps one generation counter on every change that is
+// visible on a page. A request compares If-None-Match with the current
+// generation (304, nothing rendered), otherwise the buffer is rendered
+// again only if its generation is old. Each entry has two buffers: a
+// response streams from its buffer until the connection is closed, so a
+// new render goes into the other one. Both buffers busy or page too large:
+// the caller falls back to rendering directly.
+//
+// Buffers are only touched from the async_tcp task (request handlers and
+// disconnect callbacks), only the generation counter is shared.
+//------------------------------
+
+//includes
+//------------------------------
+#include "PageCache.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define PAGE_CACHE_BUFFERS 2
+#define PAGE_CACHE_ETAG_LEN 12                  //"\"" + 10 digits + "\""
+//------------------------------
+
+//global variables
+//------------------------------
+typedef struct
+{
+  PageCacheRender_t Render_pfn;
+  size_t Size_u32;
+  char *Buf_apc [PAGE_CACHE_BUFFERS];
+  size_t Len_au32 [PAGE_CACHE_BUFFERS];
+  uint32_t Generation_au32 [PAGE_CACHE_BUFFERS];
+  uint8_t Readers_au8 [PAGE_CACHE_BUFFERS];     //responses streaming from buffer
+  bool Valid_ab [PAGE_CACHE_BUFFERS];
+  uint8_t Current_u8;                           //buffer with the newest render
+} PageCacheEntry_t;
+
+static PageCacheEntry_t Entry_ast [PAGE_CACHE_ENTRIES];
+
+static volatile uint32_t StateGeneration_u32 = 0;
+static bool GenerationSeeded_b = false;
+static portMUX_TYPE GenerationMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static int8_t Render_s8(PageCacheEntry_t *Entry_pst, uint32_t Generation_u32);
+//------------------------------
+
+
+//------------------------------
+// allocate buffers of one entry
+//------------------------------
+bool PageCache_Init_b(uint8_t Entry_u8, size_t Size_u32, PageCacheRender_t Render_pfn)
+{
+  if(Entry_u8 >= PAGE_CACHE_ENTRIES)
+  {
+    return false;
+  }
+
+  //random start, an ETag of the last boot must not match
+  portENTER_CRITICAL(&GenerationMux);
+  if(!GenerationSeeded_b)
+  {
+    StateGeneration_u32 += esp_random();
+    GenerationSeeded_b = true;
+  }
+  portEXIT_CRITICAL(&GenerationMux);
+
+  PageCacheEntry_t *Entry_pst = &Entry_ast [Entry_u8];
+
+  memset(Entry_pst, 0, sizeof(PageCacheEntry_t));
+
+  for(uint8_t i = 0; i < PAGE_CACHE_BUFFERS; i++)
+  {
+    Entry_pst->Buf_apc [i] = (char *)malloc(Size_u32);
+
+    if(Entry_pst->Buf_apc [i] == NULL)
+    {
+      Serial.printf("page cache: no memory for entry %u\n", Entry_u8);
+      return false;
+    }
+  }
+
+  Entry_pst->Size_u32 = Size_u32;
+  Entry_pst->Render_pfn = Render_pfn;
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// state generation
+//------------------------------
+void PageCache_Bump_v(void)
+{
+  portENTER_CRITICAL(&GenerationMux);
+  StateGeneration_u32++;
+  portEXIT_CRITICAL(&GenerationMux);
+}
+
+uint32_t PageCache_Generation_u32(void)
+{
+  return StateGeneration_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// answer request from cache (false: not possible, caller renders directly)
+//------------------------------
+bool PageCache_Send_b(AsyncWebServerRequest *request, uint8_t Entry_u8, const char *Type_pc)
+{
+  if((Entry_u8 >= PAGE_CACHE_ENTRIES) || (Entry_ast [Entry_u8].Render_pfn == NULL))
+  {
+    return false;
+  }
+
+  PageCacheEntry_t *Entry_pst = &Entry_ast [Entry_u8];
+  uint32_t Generation_u32 = PageCache_Generation_u32();
+  char ETag_ac [PAGE_CACHE_ETAG_LEN + 1];
+
+  snprintf(ETag_ac, sizeof(ETag_ac), "\"%u\"", Generation_u32);
+
+  //browser copy still valid
+  if(request->hasHeader("If-None-Match") && (request->getHeader("If-None-Match")->value() == ETag_ac))
+  {
+    AsyncWebServerResponse *response = request->beginResponse(304);
+    response->addHeader("ETag", ETag_ac);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+    return true;
+  }
+
+  int8_t Buffer_s8 = Entry_pst->Current_u8;
+
+  if(!Entry_pst->Valid_ab [Buffer_s8] || (Entry_pst->Generation_au32 [Buffer_s8] != Generation_u32))
+  {
+    Buffer_s8 = Render_s8(Entry_pst, Generation_u32);
+
+    if(Buffer_s8 < 0)
+    {
+      return false;
+    }
+  }
+
+  //buffer stays reserved until the connection is gone
+  Entry_pst->Readers_au8 [Buffer_s8]++;
+  request->onDisconnect([Entry_pst, Buffer_s8]()
+                          {
+                            Entry_pst->Readers_au8 [Buffer_s8]--;
+                          }
+                        );
+
+  AsyncWebServerResponse *response = request->beginResponse_P(200, Type_pc, (const uint8_t *)Entry_pst->Buf_apc [Buffer_s8], Entry_pst->Len_au32 [Buffer_s8]);
+  response->addHeader("ETag", ETag_ac);
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// render into a free buffer, returns buffer or -1
+//------------------------------
+static int8_t Render_s8(PageCacheEntry_t *Entry_pst, uint32_t Generation_u32)
+{
+  for(uint8_t i = 0; i < PAGE_CACHE_BUFFERS; i++)
+  {
+    //prefer the buffer not holding the newest render
+    uint8_t Buffer_u8 = (Entry_pst->Current_u8 + 1 + i) % PAGE_CACHE_BUFFERS;
+
+    if(Entry_pst->Readers_au8 [Buffer_u8] > 0)
+    {
+      continue;
+    }
+
+    Entry_pst->Valid_ab [Buffer_u8] = false;
+
+    size_t Len_u32 = Entry_pst->Render_pfn(Entry_pst->Buf_apc [Buffer_u8], Entry_pst->Size_u32);
+
+    if(Len_u32 == 0)
+    {
+      return -1;
+    }
+
+    Entry_pst->Len_au32 [Buffer_u8] = Len_u32;
+    Entry_pst->Generation_au32 [Buffer_u8] = Generation_u32;
+    Entry_pst->Valid_ab [Buffer_u8] = true;
+    Entry_pst->Current_u8 = Buffer_u8;
+
+    return Buffer_u8;
+  }
+
+  return -1;
+}
+//------------------------------
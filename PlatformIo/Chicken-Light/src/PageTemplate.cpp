@@ -0,0 +1,287 @@
+//------------------------------
+// Page template
+//
+// The template is read and scanned for %NAME% markers once. A response
+// then only copies literal bytes out of the segment table and asks the
+// resolver for each placeholder value (switch on ID, small buffer),
+// no String objects and no re-scan per request.
+//------------------------------
+
+//includes
+//------------------------------
+#include "PageTemplate.h"
+
+#include "SPIFFS.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define PAGE_VAR_NAME_LEN_MAX 32
+
+//names in order of PAGE_VAR_xxx
+static const char *PageVarName_apc [PAGE_VAR_COUNT] =
+{
+  "DATE_TIME",
+  "TEMP",
+  "LIGHT_DUTYCYCLE",
+  "STATE",
+  "SUNRISE",
+  "SUNSET",
+  "THRESHOLD_DARK",
+  "THRESHOLD_BRIGHT",
+  "VERSION"
+};
+//------------------------------
+
+//global variables
+//------------------------------
+static char *Template_pc = NULL;
+static PageSegment_t Segment_ast [PAGE_SEGMENTS_MAX];
+static uint8_t SegmentCount_u8 = 0;
+
+static PageVarResolver_t Resolver_pfn = NULL;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static bool AddSegment_b(uint16_t Offset_u16, uint16_t Len_u16, uint8_t Var_u8);
+static uint8_t LookupVar_u8(const char *Name_pc, uint8_t Len_u8);
+static void EnterSegment_v(PageRenderState_t *State_pst, uint8_t Segment_u8);
+//------------------------------
+
+
+//------------------------------
+// read template and split it into segments (SPIFFS must be mounted)
+//------------------------------
+bool PageTemplate_Load_b(const char *Path_pc, PageVarResolver_t VarResolver_pfn)
+{
+  Resolver_pfn = VarResolver_pfn;
+  SegmentCount_u8 = 0;
+
+  File file = SPIFFS.open(Path_pc, FILE_READ);
+
+  if(!file)
+  {
+    Serial.printf("template: %s not found\n", Path_pc);
+    return false;
+  }
+
+  size_t Size_u32 = file.size();
+
+  free(Template_pc);
+  Template_pc = (char *)malloc(Size_u32 + 1);
+
+  if((Template_pc == NULL) || (Size_u32 > 0xFFFF) || (file.read((uint8_t *)Template_pc, Size_u32) != Size_u32))
+  {
+    Serial.printf("template: couldn't read %s\n", Path_pc);
+    file.close();
+    free(Template_pc);
+    Template_pc = NULL;
+    return false;
+  }
+
+  file.close();
+  Template_pc [Size_u32] = '\0';
+
+  //scan: "%NAME%" -> placeholder, "%%" -> '%', anything else stays literal
+  uint16_t Literal_u16 = 0;
+  uint16_t i = 0;
+
+  while(i < Size_u32)
+  {
+    if(Template_pc [i] != '%')
+    {
+      i++;
+      continue;
+    }
+
+    uint16_t End_u16 = i + 1;
+    while((End_u16 < Size_u32) && (End_u16 - i <= PAGE_VAR_NAME_LEN_MAX)
+          && (isupper(Template_pc [End_u16]) || isdigit(Template_pc [End_u16]) || (Template_pc [End_u16] == '_')))
+    {
+      End_u16++;
+    }
+
+    if((End_u16 >= Size_u32) || (Template_pc [End_u16] != '%'))
+    {
+      i++;
+      continue;
+    }
+
+    uint8_t Var_u8 = LookupVar_u8(&Template_pc [i + 1], End_u16 - i - 1);
+
+    if(End_u16 == i + 1)
+    {
+      //"%%": keep first '%' in literal, drop second
+      if(!AddSegment_b(Literal_u16, i + 1 - Literal_u16, PAGE_VAR_LITERAL))
+      {
+        return false;
+      }
+    }
+    else if(Var_u8 != PAGE_VAR_LITERAL)
+    {
+      if(!AddSegment_b(Literal_u16, i - Literal_u16, PAGE_VAR_LITERAL) || !AddSegment_b(0, 0, Var_u8))
+      {
+        return false;
+      }
+    }
+    else
+    {
+      //unknown name: literal, closing '%' may open the next marker
+      i++;
+      continue;
+    }
+
+    i = End_u16 + 1;
+    Literal_u16 = i;
+  }
+
+  if(!AddSegment_b(Literal_u16, Size_u32 - Literal_u16, PAGE_VAR_LITERAL))
+  {
+    return false;
+  }
+
+  Serial.printf("template: %s, %u bytes, %u segments\n", Path_pc, Size_u32, SegmentCount_u8);
+
+  return true;
+}
+
+bool PageTemplate_Loaded_b(void)
+{
+  return (Template_pc != NULL) && (SegmentCount_u8 > 0);
+}
+//------------------------------
+
+
+//------------------------------
+// segment table helpers
+//------------------------------
+static bool AddSegment_b(uint16_t Offset_u16, uint16_t Len_u16, uint8_t Var_u8)
+{
+  //empty literals are skipped
+  if((Var_u8 == PAGE_VAR_LITERAL) && (Len_u16 == 0))
+  {
+    return true;
+  }
+
+  if(SegmentCount_u8 >= PAGE_SEGMENTS_MAX)
+  {
+    Serial.print("template: too many segments\n");
+    SegmentCount_u8 = 0;
+    return false;
+  }
+
+  Segment_ast [SegmentCount_u8].Offset_u16 = Offset_u16;
+  Segment_ast [SegmentCount_u8].Len_u16 = Len_u16;
+  Segment_ast [SegmentCount_u8].Var_u8 = Var_u8;
+  SegmentCount_u8++;
+
+  return true;
+}
+
+static uint8_t LookupVar_u8(const char *Name_pc, uint8_t Len_u8)
+{
+  for(uint8_t i = 0; i < PAGE_VAR_COUNT; i++)
+  {
+    if((strlen(PageVarName_apc [i]) == Len_u8) && (strncmp(PageVarName_apc [i], Name_pc, Len_u8) == 0))
+    {
+      return i;
+    }
+  }
+
+  return PAGE_VAR_LITERAL;
+}
+//------------------------------
+
+
+//------------------------------
+// render: start of page / next segment (placeholders resolved on entry)
+//------------------------------
+void PageTemplate_RenderInit_v(PageRenderState_t *State_pst)
+{
+  EnterSegment_v(State_pst, 0);
+}
+
+static void EnterSegment_v(PageRenderState_t *State_pst, uint8_t Segment_u8)
+{
+  State_pst->Segment_u8 = Segment_u8;
+  State_pst->Offset_u16 = 0;
+  State_pst->ValueLen_u8 = 0;
+
+  if((Segment_u8 < SegmentCount_u8) && (Segment_ast [Segment_u8].Var_u8 != PAGE_VAR_LITERAL) && (Resolver_pfn != NULL))
+  {
+    size_t Len_u32 = Resolver_pfn(Segment_ast [Segment_u8].Var_u8, State_pst->Value_ac, sizeof(State_pst->Value_ac));
+    State_pst->ValueLen_u8 = min(Len_u32, sizeof(State_pst->Value_ac) - 1);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// fill next chunk, returns 0 at end of page
+//------------------------------
+size_t PageTemplate_Fill_u32(PageRenderState_t *State_pst, uint8_t *Buf_pu8, size_t MaxLen_u32)
+{
+  size_t Len_u32 = 0;
+
+  while((Len_u32 < MaxLen_u32) && (State_pst->Segment_u8 < SegmentCount_u8))
+  {
+    const PageSegment_t *Segment_pst = &Segment_ast [State_pst->Segment_u8];
+    const char *Src_pc;
+    uint16_t Total_u16;
+
+    if(Segment_pst->Var_u8 == PAGE_VAR_LITERAL)
+    {
+      Src_pc = &Template_pc [Segment_pst->Offset_u16];
+      Total_u16 = Segment_pst->Len_u16;
+    }
+    else
+    {
+      Src_pc = State_pst->Value_ac;
+      Total_u16 = State_pst->ValueLen_u8;
+    }
+
+    size_t Copy_u32 = min((size_t)(Total_u16 - State_pst->Offset_u16), MaxLen_u32 - Len_u32);
+
+    memcpy(&Buf_pu8 [Len_u32], &Src_pc [State_pst->Offset_u16], Copy_u32);
+    Len_u32 += Copy_u32;
+    State_pst->Offset_u16 += Copy_u32;
+
+    if(State_pst->Offset_u16 >= Total_u16)
+    {
+      EnterSegment_v(State_pst, State_pst->Segment_u8 + 1);
+    }
+  }
+
+  return Len_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// render whole page into buffer, returns length (0: does not fit)
+//------------------------------
+size_t PageTemplate_Render_u32(char *Buf_pc, size_t Size_u32)
+{
+  PageRenderState_t State_st;
+
+  PageTemplate_RenderInit_v(&State_st);
+
+  size_t Len_u32 = PageTemplate_Fill_u32(&State_st, (uint8_t *)Buf_pc, Size_u32);
+
+  return (State_st.Segment_u8 >= SegmentCount_u8) ? Len_u32 : 0;
+}
+
+//upper bound of the rendered size (all values at maximum length)
+size_t PageTemplate_RenderLenMax_u32(void)
+{
+  size_t Len_u32 = 0;
+
+  for(uint8_t i = 0; i < SegmentCount_u8; i++)
+  {
+    Len_u32 += (Segment_ast [i].Var_u8 == PAGE_VAR_LITERAL) ? Segment_ast [i].Len_u16 : PAGE_VALUE_LEN_MAX;
+  }
+
+  return Len_u32;
+}
+//------------------------------
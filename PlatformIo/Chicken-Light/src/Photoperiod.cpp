@@ -0,0 +1,87 @@
+//------------------------------
+// Photoperiod
+//
+// Computed once per day from the sunrise and sunset of the table. With a
+// target day length, the missing light (target - natural day) is split
+// by MorningPercent_u8 into a window ending at sunrise and one starting at
+// sunset; a day that is long enough gets no windows. Without a target,
+// both windows are dim + hold of the table (the hand-tuned columns).
+//
+// Each window begins or ends with the dim ramp on its dark side, the
+// rest is hold at full level. Windows never cross midnight.
+//------------------------------
+
+//includes
+//------------------------------
+#include "Photoperiod.h"
+//------------------------------
+
+
+//------------------------------
+// windows of one day
+//------------------------------
+void Photoperiod_Compute_v(PhotoperiodDay_t *Day_pst, uint32_t DateKey_u32, uint16_t SunriseMin_u16, uint16_t SunsetMin_u16,
+                           uint8_t TableDimMin_u8, uint8_t TableHoldMin_u8, const PhotoperiodSetting_t *Setting_pst)
+{
+  uint16_t Morning_u16 = TableDimMin_u8 + TableHoldMin_u8;
+  uint16_t Evening_u16 = TableDimMin_u8 + TableHoldMin_u8;
+  uint16_t Dim_u16 = TableDimMin_u8;
+
+  if(Setting_pst->TargetMin_u16 != PHOTOPERIOD_TABLE)
+  {
+    uint16_t Natural_u16 = (SunsetMin_u16 > SunriseMin_u16) ? SunsetMin_u16 - SunriseMin_u16 : 0;
+    uint16_t Supplement_u16 = (Setting_pst->TargetMin_u16 > Natural_u16) ? Setting_pst->TargetMin_u16 - Natural_u16 : 0;
+
+    Morning_u16 = ((uint32_t)Supplement_u16 * min<uint8_t>(Setting_pst->MorningPercent_u8, 100) + 50) / 100;
+    Evening_u16 = Supplement_u16 - Morning_u16;
+    Dim_u16 = Setting_pst->DimMin_u8;
+  }
+
+  Morning_u16 = min(Morning_u16, SunriseMin_u16);
+  Evening_u16 = min<uint16_t>(Evening_u16, PHOTOPERIOD_MINUTES_PER_DAY - SunsetMin_u16);
+
+  Day_pst->SunriseMin_u16 = SunriseMin_u16;
+  Day_pst->SunsetMin_u16 = SunsetMin_u16;
+  Day_pst->MorningOnMin_u16 = SunriseMin_u16 - Morning_u16;
+  Day_pst->MorningDimMin_u16 = min(Dim_u16, Morning_u16);
+  Day_pst->MorningHoldMin_u16 = Morning_u16 - Day_pst->MorningDimMin_u16;
+  Day_pst->EveningDimMin_u16 = min(Dim_u16, Evening_u16);
+  Day_pst->EveningHoldMin_u16 = Evening_u16 - Day_pst->EveningDimMin_u16;
+  Day_pst->DateKey_u32 = DateKey_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// window lengths
+//------------------------------
+uint16_t Photoperiod_MorningMin_u16(const PhotoperiodDay_t *Day_pst)
+{
+  return Day_pst->MorningDimMin_u16 + Day_pst->MorningHoldMin_u16;
+}
+
+uint16_t Photoperiod_EveningMin_u16(const PhotoperiodDay_t *Day_pst)
+{
+  return Day_pst->EveningDimMin_u16 + Day_pst->EveningHoldMin_u16;
+}
+//------------------------------
+
+
+//------------------------------
+// output: {"date":..,"sunrise":"HH:MM","sunset":"HH:MM","light_min":..,"morning":{..},"evening":{..}}
+//------------------------------
+void Photoperiod_PrintJson_v(const PhotoperiodDay_t *Day_pst, Print &Out)
+{
+  uint16_t Morning_u16 = Photoperiod_MorningMin_u16(Day_pst);
+  uint16_t Evening_u16 = Photoperiod_EveningMin_u16(Day_pst);
+  uint16_t Natural_u16 = (Day_pst->SunsetMin_u16 > Day_pst->SunriseMin_u16) ? Day_pst->SunsetMin_u16 - Day_pst->SunriseMin_u16 : 0;
+
+  Out.printf("{\"date\":%u,\"sunrise\":\"%02u:%02u\",\"sunset\":\"%02u:%02u\",\"light_min\":%u,"
+             "\"morning\":{\"on\":\"%02u:%02u\",\"dim_min\":%u,\"hold_min\":%u},"
+             "\"evening\":{\"on\":\"%02u:%02u\",\"hold_min\":%u,\"dim_min\":%u}}",
+             Day_pst->DateKey_u32, Day_pst->SunriseMin_u16 / 60, Day_pst->SunriseMin_u16 % 60,
+             Day_pst->SunsetMin_u16 / 60, Day_pst->SunsetMin_u16 % 60, Natural_u16 + Morning_u16 + Evening_u16,
+             Day_pst->MorningOnMin_u16 / 60, Day_pst->MorningOnMin_u16 % 60, Day_pst->MorningDimMin_u16, Day_pst->MorningHoldMin_u16,
+             Day_pst->SunsetMin_u16 / 60, Day_pst->SunsetMin_u16 % 60, Day_pst->EveningHoldMin_u16, Day_pst->EveningDimMin_u16);
+}
+//------------------------------
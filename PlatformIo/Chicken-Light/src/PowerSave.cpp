@@ -0,0 +1,402 @@
+//------------------------------
+// Power save mode
+//
+// Light sleep is entered automatically by the idle task (esp_pm) whenever
+// no task is runnable. The LEDC peripheral runs from the APB clock, so
+// light sleep and frequency scaling are blocked by PM locks while the
+// light is on. The DS3231 INT/SQW output (open drain, active low) wakes
+// the chip exactly at the next schedule event, independent of the drift
+// of the internal RTC slow clock.
+//
+// esp_pm needs CONFIG_PM_ENABLE and FreeRTOS tickless idle, which the
+// prebuilt Arduino SDK lacks: the nodemcu-32s-powersave environment
+// (platformio.ini) builds Arduino as an ESP-IDF component with
+// sdkconfig.defaults and sets USE_POWER_SAVE.
+//
+// GPIO wake-up from light sleep needs a level interrupt type on the pin,
+// which is also the type the pin ISR fires on. The ISRs therefore switch
+// their pin interrupt off on the first call; the waiting task re-arms the
+// level for the next wait and restores the edge type after waking up.
+//------------------------------
+
+//includes
+//------------------------------
+#include "PowerSave.h"
+#include "I2cBus.h"
+
+#include <WiFi.h>
+
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_wifi.h"
+#include "driver/gpio.h"
+#include "soc/gpio_struct.h"
+//------------------------------
+
+//constants
+//------------------------------
+const uint16_t PowerSaveMaxCpuFreqMhz_u16 = 160;
+const uint16_t PowerSaveMinCpuFreqMhz_u16 = 40;   //XTAL frequency
+
+const uint32_t PowerSaveAlarmMarginSec_u32 = 5;    //fallback timeout if the RTC alarm is not wired
+//------------------------------
+
+//global variables
+//------------------------------
+extern RTC_DS3231 rtc;
+
+RTC_DATA_ATTR DailyPlan_t DailyPlan_st;   //survives light sleep, deep sleep and software resets
+
+uint16_t PowerSaveWakeupsToday_u16 = 0;
+uint16_t PowerSaveWakeupsYesterday_u16 = 0;
+
+static uint8_t RtcIntPin_u8 = 0;
+static uint8_t SwitchPin_u8 = 0;
+
+static TaskHandle_t AlarmWaiter_taskHandle = NULL;
+static TaskHandle_t SwitchWaiter_taskHandle = NULL;
+static volatile bool AlarmSeen_b = false;   //alarm interrupt works, timeout is only a watchdog
+
+static esp_pm_lock_handle_t NoSleepLock_h = NULL;
+static esp_pm_lock_handle_t ApbMaxLock_h = NULL;
+static bool PwmLockHeld_b = false;
+//------------------------------
+
+
+//------------------------------
+// ISR: DS3231 alarm fired
+//------------------------------
+static void IRAM_ATTR RtcAlarmIsr_v(void)
+{
+  BaseType_t Woken = pdFALSE;
+
+  //INT stays low until the alarm is cleared by the task
+  GPIO.pin [RtcIntPin_u8].int_type = GPIO_INTR_DISABLE;
+  AlarmSeen_b = true;
+
+  if(AlarmWaiter_taskHandle != NULL)
+  {
+    vTaskNotifyGiveFromISR(AlarmWaiter_taskHandle, &Woken);
+  }
+
+  if(Woken == pdTRUE)
+  {
+    portYIELD_FROM_ISR();
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// ISR: switch SW1 changed
+//------------------------------
+static void IRAM_ATTR SwitchIsr_v(void)
+{
+  BaseType_t Woken = pdFALSE;
+
+  //armed for a level while waiting, which would fire until the switch moves back
+  GPIO.pin [SwitchPin_u8].int_type = GPIO_INTR_DISABLE;
+
+  if(SwitchWaiter_taskHandle != NULL)
+  {
+    vTaskNotifyGiveFromISR(SwitchWaiter_taskHandle, &Woken);
+  }
+
+  if(Woken == pdTRUE)
+  {
+    portYIELD_FROM_ISR();
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// init power management, Wi-Fi modem sleep and wake sources
+//------------------------------
+void PowerSave_Init_v(uint8_t RtcIntPin, uint8_t SwitchPin)
+{
+  RtcIntPin_u8 = RtcIntPin;
+  SwitchPin_u8 = SwitchPin;
+
+  //dynamic frequency scaling + automatic light sleep
+  esp_pm_config_esp32_t PmConfig_st;
+  PmConfig_st.max_freq_mhz = PowerSaveMaxCpuFreqMhz_u16;
+  PmConfig_st.min_freq_mhz = PowerSaveMinCpuFreqMhz_u16;
+  PmConfig_st.light_sleep_enable = true;
+
+  esp_err_t Err = esp_pm_configure(&PmConfig_st);
+  if(Err != ESP_OK)
+  {
+    Serial.printf("power save: esp_pm_configure failed (%d), running without light sleep (sdkconfig?)\n", Err);
+  }
+
+  esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "pwm", &NoSleepLock_h);
+  esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "pwm", &ApbMaxLock_h);
+
+  //Wi-Fi stays associated, radio sleeps between DTIM beacons
+  WiFi.setSleep(true);
+  esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+
+  //DS3231 INT/SQW: alarms only, no square wave
+  pinMode(RtcIntPin_u8, INPUT_PULLUP);
+  I2cBus_Lock_v(I2C_OP_RTC_ALARM);
+  rtc.writeSqwPinMode(DS3231_OFF);
+  rtc.clearAlarm(1);
+  rtc.clearAlarm(2);
+  I2cBus_Unlock_v();
+  //wake-up level is armed only while waiting (PowerSave_WaitForNextEvent_v)
+  attachInterrupt(digitalPinToInterrupt(RtcIntPin_u8), RtcAlarmIsr_v, FALLING);
+
+  //SW1 edges wake the main task
+  attachInterrupt(digitalPinToInterrupt(SwitchPin_u8), SwitchIsr_v, CHANGE);
+
+  esp_sleep_enable_gpio_wakeup();
+
+  Serial.print("power save mode enabled\n");
+}
+//------------------------------
+
+
+//------------------------------
+// check if cached plan belongs to given date
+//------------------------------
+bool PowerSave_PlanValid_b(uint32_t DateKey_u32)
+{
+  return (DateKey_u32 != 0) && (DailyPlan_st.DateKey_u32 == DateKey_u32);
+}
+//------------------------------
+
+
+//------------------------------
+// store plan of the day (sorted, at most PLAN_EVENTS_MAX events)
+//------------------------------
+void PowerSave_SetPlan_v(uint32_t DateKey_u32, const uint16_t *EventMinute_pu16, uint8_t Count_u8)
+{
+  uint8_t n_u8 = 0;
+
+  //new day: keep the wake-up count of the last one as regression value
+  if((DailyPlan_st.DateKey_u32 != 0) && (DailyPlan_st.DateKey_u32 != DateKey_u32))
+  {
+    Serial.printf("power save: %u wake-ups yesterday (simulated: %u)\n",
+                  PowerSaveWakeupsToday_u16,
+                  PowerSave_SimulateWakeupsPerDay_u16(&DailyPlan_st, POWER_SAVE_HOUSEKEEPING_MIN));
+
+    PowerSaveWakeupsYesterday_u16 = PowerSaveWakeupsToday_u16;
+    PowerSaveWakeupsToday_u16 = 0;
+  }
+
+  for(uint8_t i = 0; (i < Count_u8) && (n_u8 < PLAN_EVENTS_MAX); i++)
+  {
+    uint16_t Minute_u16 = EventMinute_pu16 [i];
+
+    if(Minute_u16 >= PLAN_MINUTES_PER_DAY)
+    {
+      continue;
+    }
+
+    //insertion sort, drop duplicates
+    uint8_t Pos_u8 = n_u8;
+    while((Pos_u8 > 0) && (DailyPlan_st.EventMinute_au16 [Pos_u8 - 1] > Minute_u16))
+    {
+      Pos_u8--;
+    }
+
+    if((Pos_u8 > 0) && (DailyPlan_st.EventMinute_au16 [Pos_u8 - 1] == Minute_u16))
+    {
+      continue;
+    }
+
+    for(uint8_t k = n_u8; k > Pos_u8; k--)
+    {
+      DailyPlan_st.EventMinute_au16 [k] = DailyPlan_st.EventMinute_au16 [k - 1];
+    }
+
+    DailyPlan_st.EventMinute_au16 [Pos_u8] = Minute_u16;
+    n_u8++;
+  }
+
+  DailyPlan_st.EventCount_u8 = n_u8;
+  DailyPlan_st.DateKey_u32 = DateKey_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// seconds from now until next event (midnight counts as event for re-planning)
+//------------------------------
+uint32_t PowerSave_SecondsToNextEvent_u32(const DailyPlan_t *Plan_pst, uint16_t NowMinute_u16, uint8_t NowSecond_u8)
+{
+  uint16_t Next_u16 = PLAN_MINUTES_PER_DAY;
+
+  for(uint8_t i = 0; i < Plan_pst->EventCount_u8; i++)
+  {
+    if(Plan_pst->EventMinute_au16 [i] > NowMinute_u16)
+    {
+      Next_u16 = Plan_pst->EventMinute_au16 [i];
+      break;
+    }
+  }
+
+  return (uint32_t)(Next_u16 - NowMinute_u16) * 60 - NowSecond_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// number of wake-ups a day with this plan would cause
+// (one per event, one at midnight, one per housekeeping interval)
+//------------------------------
+uint16_t PowerSave_SimulateWakeupsPerDay_u16(const DailyPlan_t *Plan_pst, uint16_t HousekeepingMin_u16)
+{
+  uint16_t Wakeups_u16 = 0;
+  uint8_t NextEvent_u8 = 0;
+
+  for(uint16_t Minute_u16 = 0; Minute_u16 < PLAN_MINUTES_PER_DAY; Minute_u16++)
+  {
+    bool Wake_b = (Minute_u16 == 0);
+
+    while((NextEvent_u8 < Plan_pst->EventCount_u8) && (Plan_pst->EventMinute_au16 [NextEvent_u8] <= Minute_u16))
+    {
+      Wake_b = Wake_b || (Plan_pst->EventMinute_au16 [NextEvent_u8] == Minute_u16);
+      NextEvent_u8++;
+    }
+
+    if((HousekeepingMin_u16 > 0) && ((Minute_u16 % HousekeepingMin_u16) == 0))
+    {
+      Wake_b = true;
+    }
+
+    if(Wake_b)
+    {
+      Wakeups_u16++;
+    }
+  }
+
+  return Wakeups_u16;
+}
+//------------------------------
+
+
+//------------------------------
+// program DS3231 alarms for the next two events and block until the first one
+//------------------------------
+void PowerSave_WaitForNextEvent_v(const DateTime &Now)
+{
+  uint16_t NowMinute_u16 = Now.hour() * 60 + Now.minute();
+  uint32_t WaitSec_u32 = PowerSave_SecondsToNextEvent_u32(&DailyPlan_st, NowMinute_u16, Now.second());
+
+  //Alarm1: next event (match h:m:s), Alarm2: the one after (match h:m)
+  DateTime Alarm1 = Now + TimeSpan(WaitSec_u32);
+  uint16_t Alarm1Minute_u16 = Alarm1.hour() * 60 + Alarm1.minute();
+  DateTime Alarm2 = Alarm1 + TimeSpan(PowerSave_SecondsToNextEvent_u32(&DailyPlan_st, Alarm1Minute_u16, 0));
+
+  I2cBus_Lock_v(I2C_OP_RTC_ALARM);
+  rtc.clearAlarm(1);
+  rtc.clearAlarm(2);
+  rtc.setAlarm1(Alarm1, DS3231_A1_Hour);
+  rtc.setAlarm2(Alarm2, DS3231_A2_Hour);
+  I2cBus_Unlock_v();
+
+  AlarmWaiter_taskHandle = xTaskGetCurrentTaskHandle();
+
+  //INT is high again (alarms cleared): arm level for ISR and light sleep wake-up
+  gpio_wakeup_enable((gpio_num_t)RtcIntPin_u8, GPIO_INTR_LOW_LEVEL);
+
+  //without alarm interrupt the internal slow clock is the only reference: it
+  //drifts by a few percent, so the fallback timeout wakes early and the
+  //remainder is slept again; once the alarm works, the timeout stays behind it
+  uint32_t TimeoutSec_u32 = WaitSec_u32;
+  if(AlarmSeen_b)
+  {
+    TimeoutSec_u32 += TimeoutSec_u32 / 16 + PowerSaveAlarmMarginSec_u32;
+  }
+  else if(TimeoutSec_u32 > 120)
+  {
+    TimeoutSec_u32 -= TimeoutSec_u32 / 16;
+  }
+  else
+  {
+    TimeoutSec_u32 += PowerSaveAlarmMarginSec_u32;
+  }
+
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TimeoutSec_u32 * 1000));
+
+  AlarmWaiter_taskHandle = NULL;
+
+  //disarm the level before INT is released, then back to the edge of attachInterrupt()
+  gpio_wakeup_disable((gpio_num_t)RtcIntPin_u8);
+
+  I2cBus_Lock_v(I2C_OP_RTC_ALARM);
+  rtc.clearAlarm(1);
+  rtc.clearAlarm(2);
+  I2cBus_Unlock_v();
+
+  gpio_set_intr_type((gpio_num_t)RtcIntPin_u8, GPIO_INTR_NEGEDGE);
+
+  PowerSaveWakeupsToday_u16++;
+}
+//------------------------------
+
+
+//------------------------------
+// block main task until SW1 changes or timeout expires
+//------------------------------
+void PowerSave_WaitForSwitch_v(uint32_t TimeoutMsec_u32)
+{
+  SwitchWaiter_taskHandle = xTaskGetCurrentTaskHandle();
+
+  //light sleep GPIO wake-up is level triggered -> arm for the opposite level
+  gpio_wakeup_enable((gpio_num_t)SwitchPin_u8, digitalRead(SwitchPin_u8) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TimeoutMsec_u32));
+
+  SwitchWaiter_taskHandle = NULL;
+
+  //gpio_wakeup_disable() leaves the pin without interrupt type: back to CHANGE of attachInterrupt()
+  gpio_wakeup_disable((gpio_num_t)SwitchPin_u8);
+  gpio_set_intr_type((gpio_num_t)SwitchPin_u8, GPIO_INTR_ANYEDGE);
+
+  PowerSaveWakeupsToday_u16++;
+}
+//------------------------------
+
+
+//------------------------------
+// keep APB clock and chip awake while PWM output is active
+//------------------------------
+void PowerSave_SetPwmActive_v(bool Active_b)
+{
+  if((NoSleepLock_h == NULL) || (ApbMaxLock_h == NULL) || (Active_b == PwmLockHeld_b))
+  {
+    return;
+  }
+
+  if(Active_b)
+  {
+    esp_pm_lock_acquire(NoSleepLock_h);
+    esp_pm_lock_acquire(ApbMaxLock_h);
+  }
+  else
+  {
+    esp_pm_lock_release(ApbMaxLock_h);
+    esp_pm_lock_release(NoSleepLock_h);
+  }
+
+  PwmLockHeld_b = Active_b;
+}
+//------------------------------
+
+
+//------------------------------
+// radio awake: replies are not held back until the next DTIM beacon
+//------------------------------
+void PowerSave_SetRadioActive_v(bool Active_b)
+{
+  if(NoSleepLock_h == NULL)
+  {
+    return;
+  }
+
+  esp_wifi_set_ps(Active_b ? WIFI_PS_NONE : WIFI_PS_MAX_MODEM);
+}
+//------------------------------
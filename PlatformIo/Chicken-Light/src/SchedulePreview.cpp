@@ -0,0 +1,501 @@
+//------------------------------
+// Schedule preview
+//
+// The year is computed in blocks of PREVIEW_BLOCK_DAYS days. For a block
+// the calendar (weekday, MMDD, calendar week), the table values and the
+// event minute and zones of every rule are filled into arrays over the
+// days (struct of arrays) with branch-free arithmetic, selects instead
+// of ifs, so the compiler can unroll and vectorize the day loops. Only
+// the sweep over the sorted events of one day (rule mode) is scalar.
+//
+// Table mode models the sunrise and sunset programs with the windows of
+// the photoperiod (same arithmetic as Photoperiod_Compute_v, as selects
+// over the block): a window ending at sunrise, one starting at sunset.
+// Rule mode follows the timeline compiler (override rules,
+// later rule wins within a minute). A zone counts as on while its target
+// level is > 0 and while it ramps down to 0. Ramps are cut at midnight,
+// the on/off state of the zones is carried into the next day (the year
+// starts with Dec 31 of the year before as slot 0).
+//------------------------------
+
+//includes
+//------------------------------
+#include "SchedulePreview.h"
+#include "SunriseSunset.h"
+#include "LightZones.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define MINUTES_PER_DAY 1440
+#define TABLE_WEEKS 52
+
+#define PREVIEW_PHASE_HEADER 0
+#define PREVIEW_PHASE_ON_MIN 1
+#define PREVIEW_PHASE_FIRST_ON 2
+#define PREVIEW_PHASE_LAST_OFF 3
+#define PREVIEW_PHASE_FOOTER 4
+#define PREVIEW_PHASE_DONE 5
+
+//days before the 1st of each month (no leap year)
+static const uint16_t MonthStart_au16 [12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+//------------------------------
+
+//global variables
+//------------------------------
+typedef struct
+{
+  uint16_t Days_u16;
+  uint8_t Jan1Weekday_u8;                         //RTClib dayOfTheWeek
+  int16_t WeekAdj_s16;                            //calendar week = (adjust + day of year) / 7
+  uint8_t WeeksBefore_u8;                         //calendar week of the days before week 1 (52 / 53)
+  uint8_t WeekAfter_u8;                           //calendar week of the days after week 52 (53 / 1)
+  uint16_t MonthStart_au16 [12];                  //leap day included
+} PreviewYear_t;
+
+//one block of days, index = slot - first slot of the block
+typedef struct
+{
+  uint8_t Weekday_au8 [PREVIEW_BLOCK_DAYS];
+  uint16_t MonthDay_au16 [PREVIEW_BLOCK_DAYS];    //MMDD
+  int16_t Sunrise_as16 [PREVIEW_BLOCK_DAYS];      //minute of day
+  int16_t Sunset_as16 [PREVIEW_BLOCK_DAYS];
+  int16_t Length_as16 [PREVIEW_BLOCK_DAYS];       //table: dim + hold of the week
+  uint16_t OnMin_au16 [PREVIEW_BLOCK_DAYS];
+  uint16_t FirstOn_au16 [PREVIEW_BLOCK_DAYS];
+  uint16_t LastOff_au16 [PREVIEW_BLOCK_DAYS];
+} PreviewBlock_t;
+
+//rule events of one block
+typedef struct
+{
+  int16_t Minute_aas16 [SCHEDULE_RULES_MAX] [PREVIEW_BLOCK_DAYS];
+  uint8_t Zones_aau8 [SCHEDULE_RULES_MAX] [PREVIEW_BLOCK_DAYS];    //0 = rule not active that day
+  uint8_t Override_au8 [PREVIEW_BLOCK_DAYS];                        //zones claimed by override rules
+} PreviewEvents_t;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void InitYear_v(PreviewYear_t *Year_pst, uint16_t Year_u16);
+static void FillCalendar_v(PreviewBlock_t *Block_pst, const PreviewYear_t *Year_pst, uint16_t First_u16, uint8_t Count_u8);
+static void TableBlock_v(PreviewBlock_t *Block_pst, uint8_t Count_u8, uint8_t ZoneMask_u8, const PhotoperiodSetting_t *Photoperiod_pst);
+static void FillEvents_v(PreviewEvents_t *Events_pst, const PreviewBlock_t *Block_pst, uint8_t Count_u8,
+                         const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8, uint8_t ZoneMask_u8);
+static void RuleDay_v(PreviewBlock_t *Block_pst, const PreviewEvents_t *Events_pst, uint8_t Day_u8,
+                      const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8, uint8_t *Lit_pu8);
+static void OutHeader_v(SchedulePreviewOut_t *Out_pst);
+static void OutDay_v(SchedulePreviewOut_t *Out_pst);
+//------------------------------
+
+
+//------------------------------
+// compute preview of one year
+//------------------------------
+void SchedulePreview_Compute_v(SchedulePreview_t *Preview_pst, uint16_t Year_u16, uint8_t Mode_u8,
+                               const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8, uint8_t ZoneMask_u8,
+                               const PhotoperiodSetting_t *Photoperiod_pst)
+{
+  PreviewYear_t Year_st;
+  PreviewBlock_t Block_st;
+  PreviewEvents_t Events_st;
+  uint8_t Lit_u8 = 0;           //zones on at midnight
+
+  Year_u16 = constrain(Year_u16, PREVIEW_YEAR_MIN, PREVIEW_YEAR_MAX);
+  RuleCount_u8 = min<uint8_t>(RuleCount_u8, SCHEDULE_RULES_MAX);
+
+  InitYear_v(&Year_st, Year_u16);
+
+  Preview_pst->Year_u16 = Year_u16;
+  Preview_pst->Days_u16 = Year_st.Days_u16;
+  Preview_pst->Mode_u8 = Mode_u8;
+
+  //slot 0 = Dec 31 of the year before, slot n = day n of the year
+  for(uint16_t First_u16 = 0; First_u16 <= Year_st.Days_u16; First_u16 += PREVIEW_BLOCK_DAYS)
+  {
+    uint8_t Count_u8 = min<uint16_t>(PREVIEW_BLOCK_DAYS, Year_st.Days_u16 + 1 - First_u16);
+
+    FillCalendar_v(&Block_st, &Year_st, First_u16, Count_u8);
+
+    if(Mode_u8 == SCHEDULE_MODE_RULES)
+    {
+      FillEvents_v(&Events_st, &Block_st, Count_u8, Rule_past, RuleCount_u8, ZoneMask_u8);
+
+      for(uint8_t i = 0; i < Count_u8; i++)
+      {
+        RuleDay_v(&Block_st, &Events_st, i, Rule_past, RuleCount_u8, &Lit_u8);
+      }
+    }
+    else
+    {
+      TableBlock_v(&Block_st, Count_u8, ZoneMask_u8, Photoperiod_pst);
+    }
+
+    //slot 0 only carries the state into Jan 1
+    uint8_t Skip_u8 = (First_u16 == 0) ? 1 : 0;
+    uint16_t Day_u16 = First_u16 + Skip_u8 - 1;
+
+    memcpy(&Preview_pst->OnMin_au16 [Day_u16], &Block_st.OnMin_au16 [Skip_u8], (Count_u8 - Skip_u8) * sizeof(uint16_t));
+    memcpy(&Preview_pst->FirstOn_au16 [Day_u16], &Block_st.FirstOn_au16 [Skip_u8], (Count_u8 - Skip_u8) * sizeof(uint16_t));
+    memcpy(&Preview_pst->LastOff_au16 [Day_u16], &Block_st.LastOff_au16 [Skip_u8], (Count_u8 - Skip_u8) * sizeof(uint16_t));
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// year constants (same calendar week as CalcCalendarWeek_u8)
+//------------------------------
+static void InitYear_v(PreviewYear_t *Year_pst, uint16_t Year_u16)
+{
+  uint8_t Leap_u8 = ((Year_u16 % 4) == 0) ? 1 : 0;          //2000...2099
+  uint32_t Since2000_u32 = 365UL * (Year_u16 - 2000) + (Year_u16 - 2000 + 3) / 4;
+  int16_t Adj_s16 = (((Year_u16 - 1901) + ((Year_u16 - 1901) / 4) + 4) % 7) + 3;
+  int16_t PrevAdj_s16 = (((Year_u16 - 1902) + ((Year_u16 - 1902) / 4) + 4) % 7) + 3;
+
+  Year_pst->Days_u16 = 365 + Leap_u8;
+  Year_pst->Jan1Weekday_u8 = (6 + Since2000_u32) % 7;          //01.01.2000 was a Saturday
+  Year_pst->WeekAdj_s16 = Adj_s16;
+  Year_pst->WeeksBefore_u8 = ((PrevAdj_s16 == 9) || ((PrevAdj_s16 == 8) && ((Year_u16 % 4) == 1))) ? 53 : 52;
+  Year_pst->WeekAfter_u8 = ((Adj_s16 == 9) || ((Adj_s16 == 8) && Leap_u8)) ? 53 : 1;
+
+  for(uint8_t m = 0; m < 12; m++)
+  {
+    Year_pst->MonthStart_au16 [m] = MonthStart_au16 [m] + ((m >= 2) ? Leap_u8 : 0);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// calendar and table values of a block (slot = day of year)
+//------------------------------
+static void FillCalendar_v(PreviewBlock_t *Block_pst, const PreviewYear_t *Year_pst, uint16_t First_u16, uint8_t Count_u8)
+{
+  for(uint8_t i = 0; i < Count_u8; i++)
+  {
+    int16_t Slot_s16 = First_u16 + i;
+
+    //month = number of month starts before the day
+    uint8_t Month_u8 = 0;
+    for(uint8_t m = 1; m < 12; m++)
+    {
+      Month_u8 += (Slot_s16 > Year_pst->MonthStart_au16 [m]);
+    }
+
+    uint16_t MonthDay_u16 = (Month_u8 + 1) * 100 + Slot_s16 - Year_pst->MonthStart_au16 [Month_u8];
+    Block_pst->MonthDay_au16 [i] = (Slot_s16 == 0) ? 1231 : MonthDay_u16;
+    Block_pst->Weekday_au8 [i] = (Year_pst->Jan1Weekday_u8 + 6 + Slot_s16) % 7;
+
+    //calendar week, week 53 uses the last table row
+    int16_t Count_s16 = (Year_pst->WeekAdj_s16 + Slot_s16) / 7;
+    int16_t Week_s16 = (Count_s16 > TABLE_WEEKS) ? Year_pst->WeekAfter_u8 : Count_s16;
+    Week_s16 = (Count_s16 < 1) ? Year_pst->WeeksBefore_u8 : Week_s16;
+
+    const uint8_t *Row_pu8 = SunriseSunset_au8 [min<int16_t>(Week_s16, TABLE_WEEKS) - 1];
+
+    Block_pst->Sunrise_as16 [i] = Row_pu8 [0] * 60 + Row_pu8 [1];
+    Block_pst->Sunset_as16 [i] = Row_pu8 [2] * 60 + Row_pu8 [3];
+    Block_pst->Length_as16 [i] = Row_pu8 [4] + Row_pu8 [5];
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// table mode: morning window ends at sunrise, evening window starts at sunset
+//------------------------------
+static void TableBlock_v(PreviewBlock_t *Block_pst, uint8_t Count_u8, uint8_t ZoneMask_u8, const PhotoperiodSetting_t *Photoperiod_pst)
+{
+  int16_t Enabled_s16 = (ZoneMask_u8 != 0) ? 1 : 0;
+  bool Target_b = (Photoperiod_pst->TargetMin_u16 != PHOTOPERIOD_TABLE);
+  int32_t Target_s32 = Photoperiod_pst->TargetMin_u16;
+  int32_t Percent_s32 = min<uint8_t>(Photoperiod_pst->MorningPercent_u8, 100);
+
+  for(uint8_t i = 0; i < Count_u8; i++)
+  {
+    int16_t Sunrise_s16 = Block_pst->Sunrise_as16 [i];
+    int16_t Sunset_s16 = Block_pst->Sunset_as16 [i];
+
+    //target: missing light split into morning and evening, else dim + hold of the table
+    int32_t Supplement_s32 = max<int32_t>(Target_s32 - max<int32_t>(Sunset_s16 - Sunrise_s16, 0), 0);
+    int32_t Share_s32 = (Supplement_s32 * Percent_s32 + 50) / 100;
+    int16_t Morning_s16 = Target_b ? Share_s32 : Block_pst->Length_as16 [i];
+    int16_t Evening_s16 = Target_b ? Supplement_s32 - Share_s32 : Block_pst->Length_as16 [i];
+
+    Morning_s16 = min<int16_t>(Morning_s16 * Enabled_s16, Sunrise_s16);
+    Evening_s16 = min<int16_t>(Evening_s16 * Enabled_s16, MINUTES_PER_DAY - Sunset_s16);
+
+    Block_pst->OnMin_au16 [i] = Morning_s16 + Evening_s16;
+    Block_pst->FirstOn_au16 [i] = (Morning_s16 > 0) ? Sunrise_s16 - Morning_s16 : (Evening_s16 > 0) ? Sunset_s16 : PREVIEW_NONE;
+    Block_pst->LastOff_au16 [i] = (Evening_s16 > 0) ? Sunset_s16 + Evening_s16 : (Morning_s16 > 0) ? Sunrise_s16 : PREVIEW_NONE;
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// rule mode: event minute and zones of every rule and day
+//------------------------------
+static inline uint8_t RuleActive_u8(const ScheduleRule_t *Rule_pst, uint8_t Weekday_u8, uint16_t MonthDay_u16)
+{
+  uint8_t Day_u8 = (Rule_pst->WeekdayMask_u8 >> Weekday_u8) & 1;
+  uint8_t All_u8 = (Rule_pst->FromDate_u16 == 0) | (Rule_pst->ToDate_u16 == 0);
+  uint8_t Ordered_u8 = (Rule_pst->FromDate_u16 <= Rule_pst->ToDate_u16);
+  uint8_t After_u8 = (MonthDay_u16 >= Rule_pst->FromDate_u16);
+  uint8_t Before_u8 = (MonthDay_u16 <= Rule_pst->ToDate_u16);
+
+  //range may wrap around new year
+  uint8_t Range_u8 = (Ordered_u8 & After_u8 & Before_u8) | ((Ordered_u8 ^ 1) & (After_u8 | Before_u8));
+
+  return Day_u8 & (All_u8 | Range_u8);
+}
+
+static void FillEvents_v(PreviewEvents_t *Events_pst, const PreviewBlock_t *Block_pst, uint8_t Count_u8,
+                         const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8, uint8_t ZoneMask_u8)
+{
+  memset(Events_pst->Override_au8, 0, sizeof(Events_pst->Override_au8));
+
+  for(uint8_t r = 0; r < RuleCount_u8; r++)
+  {
+    const ScheduleRule_t *Rule_pst = &Rule_past [r];
+    uint8_t Claim_u8 = (Rule_pst->Flags_u8 & RULE_FLAG_OVERRIDE) ? Rule_pst->ZoneMask_u8 : 0;
+
+    for(uint8_t i = 0; i < Count_u8; i++)
+    {
+      uint8_t Active_u8 = RuleActive_u8(Rule_pst, Block_pst->Weekday_au8 [i], Block_pst->MonthDay_au16 [i]);
+      Events_pst->Override_au8 [i] |= (uint8_t)(-Active_u8) & Claim_u8;
+    }
+  }
+
+  for(uint8_t r = 0; r < RuleCount_u8; r++)
+  {
+    const ScheduleRule_t *Rule_pst = &Rule_past [r];
+    int16_t Sunrise_s16 = (Rule_pst->Anchor_u8 == RULE_ANCHOR_SUNRISE) ? 1 : 0;
+    int16_t Sunset_s16 = (Rule_pst->Anchor_u8 == RULE_ANCHOR_SUNSET) ? 1 : 0;
+    uint8_t Keep_u8 = (Rule_pst->Flags_u8 & RULE_FLAG_OVERRIDE) ? 0xFF : 0x00;
+    uint8_t Zones_u8 = Rule_pst->ZoneMask_u8 & ZoneMask_u8;
+
+    for(uint8_t i = 0; i < Count_u8; i++)
+    {
+      uint8_t Active_u8 = RuleActive_u8(Rule_pst, Block_pst->Weekday_au8 [i], Block_pst->MonthDay_au16 [i]);
+      int16_t Minute_s16 = Rule_pst->TimeMin_s16 + Sunrise_s16 * Block_pst->Sunrise_as16 [i] + Sunset_s16 * Block_pst->Sunset_as16 [i];
+
+      Events_pst->Minute_aas16 [r] [i] = constrain(Minute_s16, 0, MINUTES_PER_DAY - 1);
+      Events_pst->Zones_aau8 [r] [i] = (uint8_t)(-Active_u8) & Zones_u8 & (Keep_u8 | (uint8_t)~Events_pst->Override_au8 [i]);
+    }
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// rule mode: sweep over the sorted events of one day
+//------------------------------
+static inline void AddOn_v(PreviewBlock_t *Block_pst, uint8_t Day_u8, uint16_t From_u16, uint16_t To_u16)
+{
+  if(To_u16 > From_u16)
+  {
+    Block_pst->OnMin_au16 [Day_u8] += To_u16 - From_u16;
+    Block_pst->FirstOn_au16 [Day_u8] = min(Block_pst->FirstOn_au16 [Day_u8], From_u16);
+    Block_pst->LastOff_au16 [Day_u8] = To_u16;
+  }
+}
+
+static void RuleDay_v(PreviewBlock_t *Block_pst, const PreviewEvents_t *Events_pst, uint8_t Day_u8,
+                      const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8, uint8_t *Lit_pu8)
+{
+  uint16_t Key_au16 [SCHEDULE_RULES_MAX];         //minute * SCHEDULE_RULES_MAX + rule: later rule last within a minute
+  uint16_t Tail_au16 [ZONE_COUNT_MAX] = {0};      //end of ramp down to 0
+  uint8_t Count_u8 = 0;
+  uint8_t Lit_u8 = *Lit_pu8;
+  uint16_t From_u16 = 0;
+
+  Block_pst->OnMin_au16 [Day_u8] = 0;
+  Block_pst->FirstOn_au16 [Day_u8] = PREVIEW_NONE;
+  Block_pst->LastOff_au16 [Day_u8] = PREVIEW_NONE;
+
+  for(uint8_t r = 0; r < RuleCount_u8; r++)
+  {
+    if(Events_pst->Zones_aau8 [r] [Day_u8] == 0)
+    {
+      continue;
+    }
+
+    uint16_t Key_u16 = Events_pst->Minute_aas16 [r] [Day_u8] * SCHEDULE_RULES_MAX + r;
+    uint8_t Pos_u8 = Count_u8++;
+
+    while((Pos_u8 > 0) && (Key_au16 [Pos_u8 - 1] > Key_u16))
+    {
+      Key_au16 [Pos_u8] = Key_au16 [Pos_u8 - 1];
+      Pos_u8--;
+    }
+
+    Key_au16 [Pos_u8] = Key_u16;
+  }
+
+  for(uint8_t k = 0; k <= Count_u8; k++)
+  {
+    uint16_t To_u16 = (k < Count_u8) ? Key_au16 [k] / SCHEDULE_RULES_MAX : MINUTES_PER_DAY;
+
+    //segment up to the event: any zone on, else the longest ramp down
+    if(Lit_u8 != 0)
+    {
+      AddOn_v(Block_pst, Day_u8, From_u16, To_u16);
+    }
+    else
+    {
+      uint16_t Tail_u16 = 0;
+      for(uint8_t z = 0; z < ZONE_COUNT_MAX; z++)
+      {
+        Tail_u16 = max(Tail_u16, Tail_au16 [z]);
+      }
+
+      AddOn_v(Block_pst, Day_u8, From_u16, min(Tail_u16, To_u16));
+    }
+
+    if(k == Count_u8)
+    {
+      break;
+    }
+
+    const ScheduleRule_t *Rule_pst = &Rule_past [Key_au16 [k] % SCHEDULE_RULES_MAX];
+    uint8_t Zones_u8 = Events_pst->Zones_aau8 [Key_au16 [k] % SCHEDULE_RULES_MAX] [Day_u8];
+
+    for(uint8_t z = 0; z < ZONE_COUNT_MAX; z++)
+    {
+      if(Zones_u8 & (1 << z))
+      {
+        bool On_b = (Lit_u8 & (1 << z)) || (Tail_au16 [z] > To_u16);
+        Tail_au16 [z] = ((Rule_pst->LevelPercent_u8 == 0) && On_b) ? To_u16 + Rule_pst->RampMin_u8 : 0;
+      }
+    }
+
+    Lit_u8 = (Rule_pst->LevelPercent_u8 > 0) ? (Lit_u8 | Zones_u8) : (Lit_u8 & ~Zones_u8);
+    From_u16 = To_u16;
+  }
+
+  *Lit_pu8 = Lit_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// output, streamed chunk by chunk:
+//   json  {"year":..,"mode":"..","days":..,"compute_us":..,"on_min":[..],"first_on":[..],"last_off":[..]}, -1 = dark
+//   bin   PreviewBinHeader_t, then on_min, first_on and last_off of all days
+//------------------------------
+void SchedulePreview_OutInit_v(SchedulePreviewOut_t *Out_pst, uint8_t Format_u8, uint32_t ComputeUsec_u32)
+{
+  Out_pst->ComputeUsec_u32 = ComputeUsec_u32;
+  Out_pst->Format_u8 = Format_u8;
+  Out_pst->Phase_u8 = PREVIEW_PHASE_HEADER;
+  Out_pst->Day_u16 = 0;
+  Out_pst->OutLen_u8 = 0;
+  Out_pst->OutOffset_u8 = 0;
+}
+
+size_t SchedulePreview_Fill_u32(SchedulePreviewOut_t *Out_pst, uint8_t *Buf_pu8, size_t MaxLen_u32)
+{
+  size_t Len_u32 = 0;
+
+  while(Len_u32 < MaxLen_u32)
+  {
+    //pending output first
+    if(Out_pst->OutOffset_u8 < Out_pst->OutLen_u8)
+    {
+      size_t Copy_u32 = min((size_t)(Out_pst->OutLen_u8 - Out_pst->OutOffset_u8), MaxLen_u32 - Len_u32);
+
+      memcpy(&Buf_pu8 [Len_u32], &Out_pst->Out_ac [Out_pst->OutOffset_u8], Copy_u32);
+      Len_u32 += Copy_u32;
+      Out_pst->OutOffset_u8 += Copy_u32;
+      continue;
+    }
+
+    Out_pst->OutOffset_u8 = 0;
+    Out_pst->OutLen_u8 = 0;
+
+    if(Out_pst->Phase_u8 == PREVIEW_PHASE_HEADER)
+    {
+      OutHeader_v(Out_pst);
+      Out_pst->Phase_u8 = PREVIEW_PHASE_ON_MIN;
+    }
+    else if(Out_pst->Phase_u8 <= PREVIEW_PHASE_LAST_OFF)
+    {
+      OutDay_v(Out_pst);
+    }
+    else if(Out_pst->Phase_u8 == PREVIEW_PHASE_FOOTER)
+    {
+      Out_pst->OutLen_u8 = (Out_pst->Format_u8 == PREVIEW_FORMAT_JSON) ? snprintf(Out_pst->Out_ac, sizeof(Out_pst->Out_ac), "}") : 0;
+      Out_pst->Phase_u8 = PREVIEW_PHASE_DONE;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  return Len_u32;
+}
+
+static void OutHeader_v(SchedulePreviewOut_t *Out_pst)
+{
+  const SchedulePreview_t *Preview_pst = &Out_pst->Preview_st;
+
+  if(Out_pst->Format_u8 == PREVIEW_FORMAT_JSON)
+  {
+    Out_pst->OutLen_u8 = snprintf(Out_pst->Out_ac, sizeof(Out_pst->Out_ac), "{\"year\":%u,\"mode\":\"%s\",\"days\":%u,\"compute_us\":%u",
+                                  Preview_pst->Year_u16, (Preview_pst->Mode_u8 == SCHEDULE_MODE_RULES) ? "rules" : "table",
+                                  Preview_pst->Days_u16, Out_pst->ComputeUsec_u32);
+    return;
+  }
+
+  PreviewBinHeader_t Header_st;
+
+  memcpy(Header_st.Magic_ac, PREVIEW_BIN_MAGIC, sizeof(Header_st.Magic_ac));
+  Header_st.Version_u8 = PREVIEW_BIN_VERSION;
+  Header_st.Mode_u8 = Preview_pst->Mode_u8;
+  Header_st.Year_u16 = Preview_pst->Year_u16;
+  Header_st.Days_u16 = Preview_pst->Days_u16;
+  Header_st.Reserved_u16 = 0;
+  Header_st.ComputeUsec_u32 = Out_pst->ComputeUsec_u32;
+
+  memcpy(Out_pst->Out_ac, &Header_st, sizeof(Header_st));
+  Out_pst->OutLen_u8 = sizeof(Header_st);
+}
+
+//next value of the current array, closes the array after the last day
+static void OutDay_v(SchedulePreviewOut_t *Out_pst)
+{
+  static const char *ArrayName_apc [3] = {"on_min", "first_on", "last_off"};
+  const SchedulePreview_t *Preview_pst = &Out_pst->Preview_st;
+  uint8_t Array_u8 = Out_pst->Phase_u8 - PREVIEW_PHASE_ON_MIN;
+  const uint16_t *Value_pu16 = (Array_u8 == 0) ? Preview_pst->OnMin_au16 : (Array_u8 == 1) ? Preview_pst->FirstOn_au16 : Preview_pst->LastOff_au16;
+  uint16_t Day_u16 = Out_pst->Day_u16;
+  bool Json_b = (Out_pst->Format_u8 == PREVIEW_FORMAT_JSON);
+
+  if(Day_u16 >= Preview_pst->Days_u16)
+  {
+    Out_pst->OutLen_u8 = Json_b ? snprintf(Out_pst->Out_ac, sizeof(Out_pst->Out_ac), (Day_u16 == 0) ? ",\"%s\":[]" : "]", ArrayName_apc [Array_u8]) : 0;
+    Out_pst->Phase_u8++;
+    Out_pst->Day_u16 = 0;
+    return;
+  }
+
+  if(Json_b)
+  {
+    int Value_s32 = (Value_pu16 [Day_u16] == PREVIEW_NONE) ? -1 : Value_pu16 [Day_u16];
+
+    Out_pst->OutLen_u8 = (Day_u16 == 0) ? snprintf(Out_pst->Out_ac, sizeof(Out_pst->Out_ac), ",\"%s\":[%d", ArrayName_apc [Array_u8], Value_s32)
+                                        : snprintf(Out_pst->Out_ac, sizeof(Out_pst->Out_ac), ",%d", Value_s32);
+  }
+  else
+  {
+    //ESP32 is little endian, values go out as they are
+    memcpy(Out_pst->Out_ac, &Value_pu16 [Day_u16], sizeof(uint16_t));
+    Out_pst->OutLen_u8 = sizeof(uint16_t);
+  }
+
+  Out_pst->Day_u16++;
+}
+//------------------------------
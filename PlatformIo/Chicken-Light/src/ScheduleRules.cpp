@@ -0,0 +1,396 @@
+//------------------------------
+// Rule based schedule
+//
+// Rules are evaluated once per day (or after a change) into Timeline_st.
+// The light control task only does a binary search on the timeline to
+// find the events that became due.
+//------------------------------
+
+//includes
+//------------------------------
+#include "ScheduleRules.h"
+#include "TaskBudget.h"
+
+#include "SPIFFS.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define SCHEDULE_FILE "/rules.bin"
+#define SCHEDULE_FILE_VERSION 1
+
+#define MINUTES_PER_DAY 1440
+//------------------------------
+
+//global variables
+//------------------------------
+uint8_t ScheduleMode_u8 = SCHEDULE_MODE_TABLE;
+Timeline_t Timeline_st;
+
+static ScheduleRule_t Rule_ast [SCHEDULE_RULES_MAX];
+static uint8_t RuleCount_u8 = 0;
+
+static SemaphoreHandle_t ScheduleMutex = NULL;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void LoadRules_v(void);
+static void SaveRules_v(void);
+static bool RuleActive_b(const ScheduleRule_t *Rule_pst, uint8_t Weekday_u8, uint16_t MonthDay_u16);
+//------------------------------
+
+
+//------------------------------
+// init (SPIFFS must be mounted)
+//------------------------------
+void Schedule_Init_v(void)
+{
+  ScheduleMutex = xSemaphoreCreateMutex();
+  Task_WatchLock_v(ScheduleMutex);
+
+  Timeline_st.DateKey_u32 = 0;
+  Timeline_st.Count_u8 = 0;
+
+  LoadRules_v();
+
+  Serial.printf("schedule: %u rules loaded, mode %u\n", RuleCount_u8, ScheduleMode_u8);
+}
+//------------------------------
+
+
+//------------------------------
+// rule file: version, mode, count, rules
+//------------------------------
+static void LoadRules_v(void)
+{
+  uint8_t Header_au8 [3] = {0};
+
+  File file = SPIFFS.open(SCHEDULE_FILE, FILE_READ);
+
+  if(!file)
+  {
+    return;
+  }
+
+  if((file.read(Header_au8, sizeof(Header_au8)) == sizeof(Header_au8)) && (Header_au8 [0] == SCHEDULE_FILE_VERSION))
+  {
+    uint8_t Count_u8 = min<uint8_t>(Header_au8 [2], SCHEDULE_RULES_MAX);
+
+    //unknown mode: table mode (default) stays
+    if((Header_au8 [1] == SCHEDULE_MODE_TABLE) || (Header_au8 [1] == SCHEDULE_MODE_RULES))
+    {
+      ScheduleMode_u8 = Header_au8 [1];
+    }
+
+    //invalid records are dropped, the others keep their order
+    for(uint8_t i = 0; i < Count_u8; i++)
+    {
+      if(file.read((uint8_t *)&Rule_ast [RuleCount_u8], sizeof(ScheduleRule_t)) != sizeof(ScheduleRule_t))
+      {
+        break;
+      }
+
+      if(Schedule_RuleValid_b(&Rule_ast [RuleCount_u8]))
+      {
+        RuleCount_u8++;
+      }
+    }
+
+    if(RuleCount_u8 < Count_u8)
+    {
+      Serial.printf("schedule: %u invalid rules dropped\n", Count_u8 - RuleCount_u8);
+    }
+  }
+
+  file.close();
+}
+
+static void SaveRules_v(void)
+{
+  uint8_t Header_au8 [3] = {SCHEDULE_FILE_VERSION, ScheduleMode_u8, RuleCount_u8};
+
+  File file = SPIFFS.open(SCHEDULE_FILE, FILE_WRITE);
+
+  if(!file)
+  {
+    Serial.print("schedule: couldn't write rule file\n");
+    return;
+  }
+
+  file.write(Header_au8, sizeof(Header_au8));
+  file.write((const uint8_t *)Rule_ast, RuleCount_u8 * sizeof(ScheduleRule_t));
+  file.close();
+}
+//------------------------------
+
+
+//------------------------------
+// rule management (any change invalidates the timeline)
+//------------------------------
+bool Schedule_RuleValid_b(const ScheduleRule_t *Rule_pst)
+{
+  bool Time_b = (Rule_pst->Anchor_u8 == RULE_ANCHOR_TIME)
+                && (Rule_pst->TimeMin_s16 >= 0) && (Rule_pst->TimeMin_s16 < MINUTES_PER_DAY);
+  bool Sun_b = ((Rule_pst->Anchor_u8 == RULE_ANCHOR_SUNRISE) || (Rule_pst->Anchor_u8 == RULE_ANCHOR_SUNSET))
+               && (abs(Rule_pst->TimeMin_s16) <= RULE_OFFSET_MIN_MAX);
+  bool Dates_b = ((Rule_pst->FromDate_u16 == 0) && (Rule_pst->ToDate_u16 == 0))
+                 || ((Rule_pst->FromDate_u16 >= 101) && (Rule_pst->FromDate_u16 <= 1231)
+                     && (Rule_pst->ToDate_u16 >= 101) && (Rule_pst->ToDate_u16 <= 1231));
+
+  return (Time_b || Sun_b) && Dates_b && (Rule_pst->LevelPercent_u8 <= 100)
+         && ((Rule_pst->Flags_u8 & ~RULE_FLAG_OVERRIDE) == 0)
+         && (Rule_pst->WeekdayMask_u8 != 0) && ((Rule_pst->WeekdayMask_u8 & ~RULE_DAYS_ALL) == 0)
+         && (Rule_pst->ZoneMask_u8 != 0);
+}
+
+bool Schedule_AddRule_b(const ScheduleRule_t *Rule_pst)
+{
+  bool Ok_b = false;
+
+  xSemaphoreTake(ScheduleMutex, portMAX_DELAY);
+
+  if(RuleCount_u8 < SCHEDULE_RULES_MAX)
+  {
+    Rule_ast [RuleCount_u8++] = *Rule_pst;
+    Timeline_st.DateKey_u32 = 0;
+    SaveRules_v();
+    Ok_b = true;
+  }
+
+  xSemaphoreGive(ScheduleMutex);
+
+  return Ok_b;
+}
+
+bool Schedule_DeleteRule_b(uint8_t Index_u8)
+{
+  bool Ok_b = false;
+
+  xSemaphoreTake(ScheduleMutex, portMAX_DELAY);
+
+  if(Index_u8 < RuleCount_u8)
+  {
+    memmove(&Rule_ast [Index_u8], &Rule_ast [Index_u8 + 1], (RuleCount_u8 - Index_u8 - 1) * sizeof(ScheduleRule_t));
+    RuleCount_u8--;
+    Timeline_st.DateKey_u32 = 0;
+    SaveRules_v();
+    Ok_b = true;
+  }
+
+  xSemaphoreGive(ScheduleMutex);
+
+  return Ok_b;
+}
+
+void Schedule_ClearRules_v(void)
+{
+  xSemaphoreTake(ScheduleMutex, portMAX_DELAY);
+
+  RuleCount_u8 = 0;
+  Timeline_st.DateKey_u32 = 0;
+  SaveRules_v();
+
+  xSemaphoreGive(ScheduleMutex);
+}
+
+uint8_t Schedule_GetRules_u8(ScheduleRule_t *Rule_past, uint8_t Max_u8)
+{
+  xSemaphoreTake(ScheduleMutex, portMAX_DELAY);
+
+  uint8_t Count_u8 = min(RuleCount_u8, Max_u8);
+  memcpy(Rule_past, Rule_ast, Count_u8 * sizeof(ScheduleRule_t));
+
+  xSemaphoreGive(ScheduleMutex);
+
+  return Count_u8;
+}
+
+void Schedule_SetMode_v(uint8_t Mode_u8)
+{
+  xSemaphoreTake(ScheduleMutex, portMAX_DELAY);
+
+  if(Mode_u8 != ScheduleMode_u8)
+  {
+    ScheduleMode_u8 = Mode_u8;
+    Timeline_st.DateKey_u32 = 0;
+    SaveRules_v();
+  }
+
+  xSemaphoreGive(ScheduleMutex);
+}
+//------------------------------
+
+
+//------------------------------
+// rule applies to this day?
+//------------------------------
+static bool RuleActive_b(const ScheduleRule_t *Rule_pst, uint8_t Weekday_u8, uint16_t MonthDay_u16)
+{
+  if((Rule_pst->WeekdayMask_u8 & (1 << Weekday_u8)) == 0)
+  {
+    return false;
+  }
+
+  if((Rule_pst->FromDate_u16 == 0) || (Rule_pst->ToDate_u16 == 0))
+  {
+    return true;
+  }
+
+  if(Rule_pst->FromDate_u16 <= Rule_pst->ToDate_u16)
+  {
+    return (MonthDay_u16 >= Rule_pst->FromDate_u16) && (MonthDay_u16 <= Rule_pst->ToDate_u16);
+  }
+
+  //range wraps around new year (e.g. 1101...0228)
+  return (MonthDay_u16 >= Rule_pst->FromDate_u16) || (MonthDay_u16 <= Rule_pst->ToDate_u16);
+}
+//------------------------------
+
+
+//------------------------------
+// timeline compiled for this date and current rules?
+//------------------------------
+bool Schedule_TimelineValid_b(uint32_t DateKey_u32)
+{
+  return (DateKey_u32 != 0) && (Timeline_st.DateKey_u32 == DateKey_u32);
+}
+//------------------------------
+
+
+//------------------------------
+// compile rules into sorted, de-duplicated timeline of the day
+//------------------------------
+void Schedule_Compile_v(uint32_t DateKey_u32, uint8_t Weekday_u8, uint16_t MonthDay_u16,
+                        uint16_t SunriseMin_u16, uint16_t SunsetMin_u16)
+{
+  uint8_t OverrideZones_u8 = 0;
+  uint8_t Count_u8 = 0;
+
+  xSemaphoreTake(ScheduleMutex, portMAX_DELAY);
+
+  //zones claimed by override rules today
+  for(uint8_t i = 0; i < RuleCount_u8; i++)
+  {
+    if((Rule_ast [i].Flags_u8 & RULE_FLAG_OVERRIDE) && RuleActive_b(&Rule_ast [i], Weekday_u8, MonthDay_u16))
+    {
+      OverrideZones_u8 |= Rule_ast [i].ZoneMask_u8;
+    }
+  }
+
+  for(uint8_t i = 0; i < RuleCount_u8; i++)
+  {
+    const ScheduleRule_t *Rule_pst = &Rule_ast [i];
+
+    if(!RuleActive_b(Rule_pst, Weekday_u8, MonthDay_u16))
+    {
+      continue;
+    }
+
+    uint8_t Zones_u8 = Rule_pst->ZoneMask_u8;
+    if((Rule_pst->Flags_u8 & RULE_FLAG_OVERRIDE) == 0)
+    {
+      Zones_u8 &= ~OverrideZones_u8;
+    }
+
+    if(Zones_u8 == 0)
+    {
+      continue;
+    }
+
+    int16_t Minute_s16 = Rule_pst->TimeMin_s16;
+    if(Rule_pst->Anchor_u8 == RULE_ANCHOR_SUNRISE)
+    {
+      Minute_s16 += SunriseMin_u16;
+    }
+    else if(Rule_pst->Anchor_u8 == RULE_ANCHOR_SUNSET)
+    {
+      Minute_s16 += SunsetMin_u16;
+    }
+    Minute_s16 = constrain(Minute_s16, 0, MINUTES_PER_DAY - 1);
+
+    //insertion sort by minute, stable -> later rules come last within the same minute
+    uint8_t Pos_u8 = Count_u8;
+    while((Pos_u8 > 0) && (Timeline_st.Event_ast [Pos_u8 - 1].Minute_u16 > Minute_s16))
+    {
+      Timeline_st.Event_ast [Pos_u8] = Timeline_st.Event_ast [Pos_u8 - 1];
+      Pos_u8--;
+    }
+
+    Timeline_st.Event_ast [Pos_u8].Minute_u16 = Minute_s16;
+    Timeline_st.Event_ast [Pos_u8].LevelPercent_u8 = Rule_pst->LevelPercent_u8;
+    Timeline_st.Event_ast [Pos_u8].RampMin_u8 = Rule_pst->RampMin_u8;
+    Timeline_st.Event_ast [Pos_u8].ZoneMask_u8 = Zones_u8;
+    Count_u8++;
+  }
+
+  xSemaphoreGive(ScheduleMutex);
+
+  //de-duplicate: within one minute the later rule wins per zone, identical actions are merged
+  uint8_t Out_u8 = 0;
+  for(uint8_t i = 0; i < Count_u8; i++)
+  {
+    TimelineEvent_t Event_st = Timeline_st.Event_ast [i];
+
+    for(uint8_t k = i + 1; (k < Count_u8) && (Timeline_st.Event_ast [k].Minute_u16 == Event_st.Minute_u16); k++)
+    {
+      const TimelineEvent_t *Later_pst = &Timeline_st.Event_ast [k];
+
+      if((Later_pst->LevelPercent_u8 == Event_st.LevelPercent_u8) && (Later_pst->RampMin_u8 == Event_st.RampMin_u8))
+      {
+        continue;
+      }
+
+      Event_st.ZoneMask_u8 &= ~Later_pst->ZoneMask_u8;
+    }
+
+    if(Event_st.ZoneMask_u8 == 0)
+    {
+      continue;
+    }
+
+    if((Out_u8 > 0)
+       && (Timeline_st.Event_ast [Out_u8 - 1].Minute_u16 == Event_st.Minute_u16)
+       && (Timeline_st.Event_ast [Out_u8 - 1].LevelPercent_u8 == Event_st.LevelPercent_u8)
+       && (Timeline_st.Event_ast [Out_u8 - 1].RampMin_u8 == Event_st.RampMin_u8))
+    {
+      Timeline_st.Event_ast [Out_u8 - 1].ZoneMask_u8 |= Event_st.ZoneMask_u8;
+      continue;
+    }
+
+    Timeline_st.Event_ast [Out_u8++] = Event_st;
+  }
+
+  Timeline_st.Count_u8 = Out_u8;
+  Timeline_st.DateKey_u32 = DateKey_u32;
+
+  Serial.printf("schedule: timeline for %u compiled, %u events\n", DateKey_u32, Out_u8);
+}
+//------------------------------
+
+
+//------------------------------
+// binary search: index of first event after given minute
+//------------------------------
+uint8_t Schedule_UpperBound_u8(uint16_t Minute_u16)
+{
+  uint8_t Low_u8 = 0;
+  uint8_t High_u8 = Timeline_st.Count_u8;
+
+  while(Low_u8 < High_u8)
+  {
+    uint8_t Mid_u8 = (Low_u8 + High_u8) / 2;
+
+    if(Timeline_st.Event_ast [Mid_u8].Minute_u16 <= Minute_u16)
+    {
+      Low_u8 = Mid_u8 + 1;
+    }
+    else
+    {
+      High_u8 = Mid_u8;
+    }
+  }
+
+  return Low_u8;
+}
+//------------------------------
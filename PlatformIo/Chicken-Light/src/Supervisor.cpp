@@ -0,0 +1,234 @@
+//------------------------------
+// Task supervisor
+//
+// The supervisor task checks all slots once per second. A slot without
+// heartbeat for longer than its window escalates one level and gets a new
+// window, so each further level needs another full deadline without any
+// heartbeat. A heartbeat ends the escalation.
+//
+// The supervisor itself is the only task subscribed to the task watchdog:
+// it stops feeding it on the last level (or when it hangs itself), the
+// watchdog then resets the chip. Light levels survive this reset in RTC
+// memory (see RetainState_v).
+//------------------------------
+
+//includes
+//------------------------------
+#include "Supervisor.h"
+#include "TaskBudget.h"
+
+#include "esp_task_wdt.h"
+//------------------------------
+
+//global variables
+//------------------------------
+typedef struct
+{
+  const char *Name_pc;
+  uint32_t DeadlineMsec_u32;
+  SupervisorRecover_t Recover_pfn;
+  uint32_t BeatMsec_u32;              //last heartbeat or escalation
+  uint32_t WindowMsec_u32;            //next heartbeat expected within
+  uint32_t Misses_u32;
+  uint32_t LastMissMsec_u32;          //uptime of last miss, 0 = never
+  uint8_t Level_u8;                   //SUPERVISOR_LEVEL_xxx
+  bool Paused_b;
+} SupervisorSlot_t;
+
+static SupervisorSlot_t Slot_ast [SUPERVISOR_SLOTS_MAX];
+static uint8_t SlotCount_u8 = 0;
+static portMUX_TYPE SupervisorMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void Supervisor_task(void * pvParameters);
+//------------------------------
+
+
+//------------------------------
+// start supervisor task and task watchdog
+//------------------------------
+void Supervisor_Start_v(void)
+{
+  Task_Start_h(TASK_ID_SUPERVISOR, Supervisor_task, NULL);
+}
+//------------------------------
+
+
+//------------------------------
+// register a task (returns slot or SUPERVISOR_NONE)
+//------------------------------
+uint8_t Supervisor_Register_u8(const char *Name_pc, uint32_t DeadlineMsec_u32, SupervisorRecover_t Recover_pfn)
+{
+  uint8_t Slot_u8 = SUPERVISOR_NONE;
+
+  portENTER_CRITICAL(&SupervisorMux);
+
+  if(SlotCount_u8 < SUPERVISOR_SLOTS_MAX)
+  {
+    Slot_u8 = SlotCount_u8++;
+
+    SupervisorSlot_t *Slot_pst = &Slot_ast [Slot_u8];
+
+    memset(Slot_pst, 0, sizeof(SupervisorSlot_t));
+    Slot_pst->Name_pc = Name_pc;
+    Slot_pst->DeadlineMsec_u32 = DeadlineMsec_u32;
+    Slot_pst->Recover_pfn = Recover_pfn;
+    Slot_pst->BeatMsec_u32 = millis();
+    Slot_pst->WindowMsec_u32 = DeadlineMsec_u32;
+  }
+
+  portEXIT_CRITICAL(&SupervisorMux);
+
+  return Slot_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// heartbeats
+//------------------------------
+void Supervisor_Expect_v(uint8_t Slot_u8, uint32_t WithinMsec_u32)
+{
+  if(Slot_u8 >= SlotCount_u8)
+  {
+    return;
+  }
+
+  SupervisorSlot_t *Slot_pst = &Slot_ast [Slot_u8];
+
+  portENTER_CRITICAL(&SupervisorMux);
+  Slot_pst->BeatMsec_u32 = millis();
+  Slot_pst->WindowMsec_u32 = WithinMsec_u32;
+  Slot_pst->Level_u8 = SUPERVISOR_LEVEL_OK;
+  Slot_pst->Paused_b = false;
+  portEXIT_CRITICAL(&SupervisorMux);
+}
+
+void Supervisor_Heartbeat_v(uint8_t Slot_u8)
+{
+  if(Slot_u8 < SlotCount_u8)
+  {
+    Supervisor_Expect_v(Slot_u8, Slot_ast [Slot_u8].DeadlineMsec_u32);
+  }
+}
+
+void Supervisor_Pause_v(uint8_t Slot_u8)
+{
+  if(Slot_u8 >= SlotCount_u8)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&SupervisorMux);
+  Slot_ast [Slot_u8].Paused_b = true;
+  Slot_ast [Slot_u8].Level_u8 = SUPERVISOR_LEVEL_OK;
+  portEXIT_CRITICAL(&SupervisorMux);
+}
+
+void Supervisor_Escalate_v(uint8_t Slot_u8, uint8_t Level_u8)
+{
+  if((Slot_u8 >= SlotCount_u8) || (Level_u8 >= SUPERVISOR_LEVEL_RESET))
+  {
+    return;
+  }
+
+  //next missed deadline continues from this level
+  portENTER_CRITICAL(&SupervisorMux);
+  Slot_ast [Slot_u8].Level_u8 = max(Slot_ast [Slot_u8].Level_u8, Level_u8);
+  portEXIT_CRITICAL(&SupervisorMux);
+}
+//------------------------------
+
+
+//------------------------------
+// supervisor task: deadlines, escalation, watchdog
+//------------------------------
+static void Supervisor_task(void * pvParameters)
+{
+  bool Reset_b = false;
+
+  esp_task_wdt_init(SUPERVISOR_WDT_SEC, true);    //panic -> reset
+  esp_task_wdt_add(NULL);
+
+  while(1)
+  {
+    uint32_t Now_u32 = millis();
+
+    for(uint8_t i = 0; i < SlotCount_u8; i++)
+    {
+      SupervisorSlot_t *Slot_pst = &Slot_ast [i];
+      uint8_t Level_u8 = SUPERVISOR_LEVEL_OK;
+
+      portENTER_CRITICAL(&SupervisorMux);
+
+      if(!Slot_pst->Paused_b && (Slot_pst->Level_u8 < SUPERVISOR_LEVEL_RESET)
+         && ((Now_u32 - Slot_pst->BeatMsec_u32) > Slot_pst->WindowMsec_u32))
+      {
+        Level_u8 = ++Slot_pst->Level_u8;
+        Slot_pst->Misses_u32++;
+        Slot_pst->LastMissMsec_u32 = Now_u32;
+        Slot_pst->BeatMsec_u32 = Now_u32;
+        Slot_pst->WindowMsec_u32 = Slot_pst->DeadlineMsec_u32;
+      }
+
+      portEXIT_CRITICAL(&SupervisorMux);
+
+      if(Level_u8 == SUPERVISOR_LEVEL_OK)
+      {
+        continue;
+      }
+
+      Serial.printf("supervisor: %s missed deadline (%u total), level %u\n", Slot_pst->Name_pc, Slot_pst->Misses_u32, Level_u8);
+
+      if(Level_u8 == SUPERVISOR_LEVEL_RESET)
+      {
+        Serial.print("supervisor: no recovery, waiting for watchdog reset\n");
+        Reset_b = true;
+      }
+
+      if(Slot_pst->Recover_pfn != NULL)
+      {
+        Slot_pst->Recover_pfn(i, Level_u8);
+      }
+    }
+
+    if(!Reset_b)
+    {
+      esp_task_wdt_reset();
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(SUPERVISOR_PERIOD_MSEC));
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// status as JSON
+//------------------------------
+void Supervisor_PrintJson_v(Print &Out)
+{
+  uint32_t Now_u32 = millis();
+
+  Out.printf("{\"uptime_ms\":%u,\"wdt_s\":%u,\"slots\":[", Now_u32, SUPERVISOR_WDT_SEC);
+
+  for(uint8_t i = 0; i < SlotCount_u8; i++)
+  {
+    SupervisorSlot_t Slot_st;
+
+    portENTER_CRITICAL(&SupervisorMux);
+    Slot_st = Slot_ast [i];
+    portEXIT_CRITICAL(&SupervisorMux);
+
+    Out.printf("%s{\"name\":\"%s\",\"deadline_ms\":%u,\"window_ms\":%u,\"since_beat_ms\":%u,\"paused\":%s,"
+               "\"level\":%u,\"misses\":%u,\"last_miss_ms\":%u}",
+               (i > 0) ? "," : "", Slot_st.Name_pc, Slot_st.DeadlineMsec_u32, Slot_st.WindowMsec_u32,
+               Now_u32 - Slot_st.BeatMsec_u32, Slot_st.Paused_b ? "true" : "false", Slot_st.Level_u8,
+               Slot_st.Misses_u32, Slot_st.LastMissMsec_u32);
+  }
+
+  Out.print("]}");
+}
+//------------------------------
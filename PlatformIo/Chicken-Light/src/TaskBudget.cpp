@@ -0,0 +1,235 @@
+//------------------------------
+// Task budget
+//
+// Stacks live in .bss, so their size shows up in the static RAM report
+// (tools/ram_report.py) instead of being taken from the heap at runtime.
+// Short-lived boot stage tasks (BootGraph) are not part of the budget,
+// their stacks are returned before the web server starts.
+//
+// The ESP32 stack grows down: the untouched fill bytes at the low end of
+// the buffer are the stack that was never used.
+//------------------------------
+
+//includes
+//------------------------------
+#include "TaskBudget.h"
+
+#include "esp_heap_caps.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define TASK_STACK_PAINT 0xA5       //same fill byte FreeRTOS uses
+#define TASK_RESTART_DELAY_MSEC 20
+//------------------------------
+
+//global variables
+//------------------------------
+typedef struct
+{
+  const char *Name_pc;
+  StackType_t *Stack_pu8;
+  uint32_t StackBytes_u32;
+  UBaseType_t Priority_u32;
+} TaskBudget_t;
+
+static StackType_t MainStack_au8 [TASK_STACK_MAIN];
+static StackType_t LightControlStack_au8 [TASK_STACK_LIGHT_CONTROL];
+static StackType_t LightZoneStack_au8 [TASK_STACK_LIGHT_ZONE];
+static StackType_t TelemetryStack_au8 [TASK_STACK_TELEMETRY];
+static StackType_t WifiStack_au8 [TASK_STACK_WIFI];
+static StackType_t SupervisorStack_au8 [TASK_STACK_SUPERVISOR];
+static StackType_t MqttStack_au8 [TASK_STACK_MQTT];
+static StackType_t FleetStack_au8 [TASK_STACK_FLEET];
+static StackType_t NtpStack_au8 [TASK_STACK_NTP];
+
+//order of TASK_ID_xxx
+static const TaskBudget_t Budget_ast [TASK_COUNT] =
+{
+  //name                    stack                   size                              priority
+  {"Main task",             MainStack_au8,          sizeof(MainStack_au8),            TASK_PRIO_MAIN},
+  {"Light Control Task",    LightControlStack_au8,  sizeof(LightControlStack_au8),    TASK_PRIO_LIGHT_CONTROL},
+  {"LightZone task",        LightZoneStack_au8,     sizeof(LightZoneStack_au8),       TASK_PRIO_LIGHT_ZONE},
+  {"Telemetry task",        TelemetryStack_au8,     sizeof(TelemetryStack_au8),       TASK_PRIO_TELEMETRY},
+  {"WiFi task",             WifiStack_au8,          sizeof(WifiStack_au8),            TASK_PRIO_WIFI},
+  {"Supervisor task",       SupervisorStack_au8,    sizeof(SupervisorStack_au8),      TASK_PRIO_SUPERVISOR},
+  {"MQTT task",             MqttStack_au8,          sizeof(MqttStack_au8),            TASK_PRIO_MQTT},
+  {"Fleet task",            FleetStack_au8,         sizeof(FleetStack_au8),           TASK_PRIO_FLEET},
+  {"NTP task",              NtpStack_au8,           sizeof(NtpStack_au8),             TASK_PRIO_NTP},
+};
+
+static StaticTask_t Tcb_ast [TASK_COUNT];
+static TaskHandle_t Handle_ah [TASK_COUNT];
+
+static SemaphoreHandle_t Lock_ah [TASK_LOCKS_MAX];
+static uint8_t LockCount_u8 = 0;
+static portMUX_TYPE LockMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+
+//------------------------------
+// create task of the budget table (once, later calls return the handle)
+//------------------------------
+TaskHandle_t Task_Start_h(uint8_t Task_u8, TaskFunction_t Func_pfn, void *Param_pv)
+{
+  if(Task_u8 >= TASK_COUNT)
+  {
+    return NULL;
+  }
+
+  if(Handle_ah [Task_u8] != NULL)
+  {
+    return Handle_ah [Task_u8];
+  }
+
+  const TaskBudget_t *Budget_pst = &Budget_ast [Task_u8];
+
+  #ifdef TASK_STACK_AUDIT
+    //independent of the FreeRTOS config: whole buffer is painted
+    memset(Budget_pst->Stack_pu8, TASK_STACK_PAINT, Budget_pst->StackBytes_u32);
+  #endif
+
+  Handle_ah [Task_u8] = xTaskCreateStatic(Func_pfn, Budget_pst->Name_pc, Budget_pst->StackBytes_u32, Param_pv,
+                                          Budget_pst->Priority_u32, Budget_pst->Stack_pu8, &Tcb_ast [Task_u8]);
+
+  return Handle_ah [Task_u8];
+}
+//------------------------------
+
+
+//------------------------------
+// restart a stalled task (supervisor)
+//------------------------------
+TaskHandle_t Task_Restart_h(uint8_t Task_u8, TaskFunction_t Func_pfn, void *Param_pv)
+{
+  if(Task_u8 >= TASK_COUNT)
+  {
+    return NULL;
+  }
+
+  //a deleted task never gives its mutexes back, keep it (caller escalates)
+  if(Task_HoldsLock_b(Task_u8))
+  {
+    return Handle_ah [Task_u8];
+  }
+
+  if(Handle_ah [Task_u8] != NULL)
+  {
+    vTaskDelete(Handle_ah [Task_u8]);
+    Handle_ah [Task_u8] = NULL;
+
+    //a task running on the other core is released by the idle task, wait before reusing its TCB
+    vTaskDelay(pdMS_TO_TICKS(TASK_RESTART_DELAY_MSEC));
+  }
+
+  return Task_Start_h(Task_u8, Func_pfn, Param_pv);
+}
+//------------------------------
+
+
+//------------------------------
+// mutexes a restart must not break (registered by the module init)
+//------------------------------
+void Task_WatchLock_v(SemaphoreHandle_t Lock_h)
+{
+  portENTER_CRITICAL(&LockMux);
+
+  if((Lock_h != NULL) && (LockCount_u8 < TASK_LOCKS_MAX))
+  {
+    Lock_ah [LockCount_u8++] = Lock_h;
+  }
+
+  portEXIT_CRITICAL(&LockMux);
+}
+
+bool Task_HoldsLock_b(uint8_t Task_u8)
+{
+  if((Task_u8 >= TASK_COUNT) || (Handle_ah [Task_u8] == NULL))
+  {
+    return false;
+  }
+
+  //entries are only added, a lock registered meanwhile is checked next time
+  for(uint8_t i = 0; i < LockCount_u8; i++)
+  {
+    if(xSemaphoreGetMutexHolder(Lock_ah [i]) == Handle_ah [Task_u8])
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+//------------------------------
+
+
+//------------------------------
+// high-water mark
+//------------------------------
+uint32_t Task_StackFree_u32(uint8_t Task_u8)
+{
+  if((Task_u8 >= TASK_COUNT) || (Handle_ah [Task_u8] == NULL))
+  {
+    return 0;
+  }
+
+  #ifdef TASK_STACK_AUDIT
+    const TaskBudget_t *Budget_pst = &Budget_ast [Task_u8];
+    uint32_t Free_u32 = 0;
+
+    while((Free_u32 < Budget_pst->StackBytes_u32) && (Budget_pst->Stack_pu8 [Free_u32] == TASK_STACK_PAINT))
+    {
+      Free_u32++;
+    }
+
+    return Free_u32;
+  #else
+    return uxTaskGetStackHighWaterMark(Handle_ah [Task_u8]);
+  #endif
+}
+//------------------------------
+
+
+//------------------------------
+// print budget, high-water marks and heap as JSON
+//------------------------------
+void Task_PrintJson_v(Print &Out)
+{
+  Out.print("{\"tasks\":[");
+
+  for(uint8_t i = 0; i < TASK_COUNT; i++)
+  {
+    Out.printf("%s{\"name\":\"%s\",\"running\":%s,\"stack\":%u,\"free_min\":%u,\"priority\":%u}", (i > 0) ? "," : "",
+               Budget_ast [i].Name_pc, (Handle_ah [i] != NULL) ? "true" : "false", Budget_ast [i].StackBytes_u32,
+               Task_StackFree_u32(i), Budget_ast [i].Priority_u32);
+  }
+
+  Out.printf("],\"heap_free\":%u,\"heap_min\":%u,\"heap_largest\":%u}",
+             heap_caps_get_free_size(MALLOC_CAP_8BIT), heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+             heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
+//------------------------------
+
+
+//------------------------------
+// serial report (TASK_STACK_AUDIT: called periodically by main task)
+//------------------------------
+void Task_Audit_v(void)
+{
+  for(uint8_t i = 0; i < TASK_COUNT; i++)
+  {
+    if(Handle_ah [i] == NULL)
+    {
+      continue;
+    }
+
+    uint32_t Free_u32 = Task_StackFree_u32(i);
+
+    Serial.printf("stack: %-20s %5u of %5u bytes used%s\n", Budget_ast [i].Name_pc, Budget_ast [i].StackBytes_u32 - Free_u32,
+                  Budget_ast [i].StackBytes_u32, (Free_u32 < TASK_STACK_MARGIN) ? "  LOW" : "");
+  }
+
+  Serial.printf("heap: %u free, %u min, %u largest block\n", heap_caps_get_free_size(MALLOC_CAP_8BIT),
+                heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
+//------------------------------
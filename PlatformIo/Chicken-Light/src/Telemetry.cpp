@@ -0,0 +1,575 @@
+//------------------------------
+// Telemetry
+//
+// Each tier fills one open block in RAM. Full blocks (or blocks ended by
+// a time gap) are written once into a fixed slot ring file, slot = block
+// sequence number modulo slot count. A tier 0 slot is written every
+// 64 min, tier 1 every 16 h, tier 2 every 2.7 days; SPIFFS spreads the
+// rewrites of the same slot. The open block of tier 1 and 2 is also
+// written into its slot every hour, a reset loses at most one hour of
+// them (after the reset it stays as a short closed block). Coarser tiers are fed with the average of
+// the minute samples per time window. History requests are streamed block by
+// block, nothing is collected in memory.
+//------------------------------
+
+//includes
+//------------------------------
+#include "Telemetry.h"
+#include "TaskBudget.h"
+
+#include "SPIFFS.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define TELEMETRY_PHASE_HEADER 0
+#define TELEMETRY_PHASE_POINTS 1
+#define TELEMETRY_PHASE_FOOTER 2
+#define TELEMETRY_PHASE_DONE 3
+
+typedef struct
+{
+  const char *File_pc;
+  uint32_t StepSec_u32;
+  uint16_t Slots_u16;               //retention = slots * 64 samples
+  uint8_t FlushSamples_u8;          //write open block every n samples, 0 = only when closed
+} TelemetryTier_t;
+
+static const TelemetryTier_t Tier_ast [TELEMETRY_TIER_COUNT] =
+{
+  {"/tlm0.bin", 60, 24, 0},         //25.6 h
+  {"/tlm1.bin", 900, 48, 4},        //32 days
+  {"/tlm2.bin", 3600, 138, 1}       //368 days
+};
+
+static const char *SeriesName_apc [] = {"temp", "duty", "light"};
+//------------------------------
+
+//global variables
+//------------------------------
+typedef struct
+{
+  TelemetryBlock_t Block_st;        //open block
+  uint32_t NextSeq_u32;
+  int16_t PrevTemp_s16;             //reconstructed values of last sample
+  uint16_t PrevLight_u16;
+
+  //average of minute samples in current window of this tier
+  uint32_t Window_u32;
+  int32_t TempSum_s32;
+  uint32_t LightSum_u32;
+  uint16_t DutySum_u16;
+  uint8_t SumCount_u8;
+} TelemetryTierState_t;
+
+static TelemetryTierState_t TierState_ast [TELEMETRY_TIER_COUNT];
+
+static TelemetrySampler_t Sampler_pfn = NULL;
+static int16_t LastValidTemp_s16 = 0;
+static uint32_t LastTime_u32 = 0;
+
+static SemaphoreHandle_t TelemetryMutex = NULL;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void Telemetry_task(void * pvParameters);
+static void InitTier_v(uint8_t Tier_u8);
+static void AddSample_v(uint8_t Tier_u8, const TelemetrySample_t *Sample_pst);
+static void CloseBlock_v(uint8_t Tier_u8);
+static void WriteBlock_v(uint8_t Tier_u8);
+static bool LoadBlock_b(uint8_t Tier_u8, uint32_t Seq_u32, TelemetryBlock_t *Block_pst);
+static bool NextPoint_b(TelemetryQuery_t *Query_pst);
+//------------------------------
+
+
+//------------------------------
+// init tiers and sampling task (SPIFFS must be mounted)
+//------------------------------
+void Telemetry_Init_v(TelemetrySampler_t TelemetrySampler_pfn)
+{
+  Sampler_pfn = TelemetrySampler_pfn;
+  TelemetryMutex = xSemaphoreCreateMutex();
+  Task_WatchLock_v(TelemetryMutex);
+
+  for(uint8_t i = 0; i < TELEMETRY_TIER_COUNT; i++)
+  {
+    InitTier_v(i);
+  }
+
+  Task_Start_h(TASK_ID_TELEMETRY, Telemetry_task, NULL);
+}
+//------------------------------
+
+
+//------------------------------
+// create slot file or find next sequence number in it
+//------------------------------
+static void InitTier_v(uint8_t Tier_u8)
+{
+  const TelemetryTier_t *Tier_pst = &Tier_ast [Tier_u8];
+  TelemetryTierState_t *State_pst = &TierState_ast [Tier_u8];
+  size_t FileSize_u32 = Tier_pst->Slots_u16 * sizeof(TelemetryBlock_t);
+  uint32_t MaxSeq_u32 = 0;
+
+  memset(State_pst, 0, sizeof(TelemetryTierState_t));
+
+  File file = SPIFFS.open(Tier_pst->File_pc, FILE_READ);
+
+  if(file && (file.size() == FileSize_u32))
+  {
+    for(uint16_t i = 0; i < Tier_pst->Slots_u16; i++)
+    {
+      uint32_t Seq_u32 = 0;
+
+      file.seek(i * sizeof(TelemetryBlock_t));
+      file.read((uint8_t *)&Seq_u32, sizeof(Seq_u32));
+      MaxSeq_u32 = max(MaxSeq_u32, Seq_u32);
+    }
+
+    file.close();
+  }
+  else
+  {
+    //new or foreign file: empty slots written once, later only rewritten in place
+    if(file)
+    {
+      file.close();
+    }
+
+    file = SPIFFS.open(Tier_pst->File_pc, FILE_WRITE);
+
+    TelemetryBlock_t Empty_st;
+    memset(&Empty_st, 0, sizeof(Empty_st));
+
+    for(uint16_t i = 0; file && (i < Tier_pst->Slots_u16); i++)
+    {
+      file.write((const uint8_t *)&Empty_st, sizeof(Empty_st));
+    }
+
+    if(file)
+    {
+      file.close();
+    }
+  }
+
+  State_pst->NextSeq_u32 = MaxSeq_u32 + 1;
+
+  Serial.printf("telemetry: tier %u, next block %u\n", Tier_u8, State_pst->NextSeq_u32);
+}
+//------------------------------
+
+
+//------------------------------
+// sampling task
+//------------------------------
+static void Telemetry_task(void * pvParameters)
+{
+  TickType_t LastWake = xTaskGetTickCount();
+
+  while(1)
+  {
+    vTaskDelayUntil(&LastWake, pdMS_TO_TICKS(TELEMETRY_SAMPLE_SEC * 1000UL));
+
+    TelemetrySample_t Sample_st;
+    Sampler_pfn(&Sample_st);
+
+    //hold last value while sensor is missing
+    if(Sample_st.TempCenti_s16 == TELEMETRY_TEMP_INVALID)
+    {
+      Sample_st.TempCenti_s16 = LastValidTemp_s16;
+    }
+    LastValidTemp_s16 = Sample_st.TempCenti_s16;
+
+    xSemaphoreTake(TelemetryMutex, portMAX_DELAY);
+
+    LastTime_u32 = Sample_st.Time_u32;
+    AddSample_v(0, &Sample_st);
+
+    //feed averages of a finished window into the next tier
+    for(uint8_t i = 1; i < TELEMETRY_TIER_COUNT; i++)
+    {
+      TelemetryTierState_t *State_pst = &TierState_ast [i];
+      uint32_t Window_u32 = Sample_st.Time_u32 / Tier_ast [i].StepSec_u32;
+
+      if((State_pst->SumCount_u8 > 0) && (Window_u32 != State_pst->Window_u32))
+      {
+        TelemetrySample_t Average_st;
+
+        Average_st.Time_u32 = State_pst->Window_u32 * Tier_ast [i].StepSec_u32;
+        Average_st.TempCenti_s16 = State_pst->TempSum_s32 / State_pst->SumCount_u8;
+        Average_st.DutyPercent_u8 = State_pst->DutySum_u16 / State_pst->SumCount_u8;
+        Average_st.Light_u16 = State_pst->LightSum_u32 / State_pst->SumCount_u8;
+
+        State_pst->SumCount_u8 = 0;
+        State_pst->TempSum_s32 = 0;
+        State_pst->DutySum_u16 = 0;
+        State_pst->LightSum_u32 = 0;
+
+        AddSample_v(i, &Average_st);
+      }
+
+      //every tier averages the raw minute samples of its window
+      State_pst->Window_u32 = Window_u32;
+      State_pst->TempSum_s32 += Sample_st.TempCenti_s16;
+      State_pst->DutySum_u16 += Sample_st.DutyPercent_u8;
+      State_pst->LightSum_u32 += Sample_st.Light_u16;
+      State_pst->SumCount_u8++;
+    }
+
+    xSemaphoreGive(TelemetryMutex);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// append sample to open block of tier (mutex taken)
+//------------------------------
+static void AddSample_v(uint8_t Tier_u8, const TelemetrySample_t *Sample_pst)
+{
+  TelemetryTierState_t *State_pst = &TierState_ast [Tier_u8];
+  TelemetryBlock_t *Block_pst = &State_pst->Block_st;
+  uint32_t Step_u32 = Tier_ast [Tier_u8].StepSec_u32;
+
+  //samples of a block are equidistant, a gap or time jump starts a new block
+  if(Block_pst->Count_u8 > 0)
+  {
+    uint32_t Expected_u32 = Block_pst->StartTime_u32 + Block_pst->Count_u8 * Step_u32;
+
+    if((Sample_pst->Time_u32 + Step_u32 / 2 < Expected_u32) || (Sample_pst->Time_u32 > Expected_u32 + Step_u32 / 2))
+    {
+      CloseBlock_v(Tier_u8);
+    }
+  }
+
+  if(Block_pst->Count_u8 == 0)
+  {
+    memset(Block_pst, 0, sizeof(TelemetryBlock_t));
+
+    Block_pst->Seq_u32 = State_pst->NextSeq_u32;
+    Block_pst->StartTime_u32 = Sample_pst->Time_u32;
+    Block_pst->TempCenti_s16 = Sample_pst->TempCenti_s16;
+    Block_pst->DutyPercent_u8 = Sample_pst->DutyPercent_u8;
+    Block_pst->Light_u16 = Sample_pst->Light_u16;
+
+    State_pst->PrevTemp_s16 = Sample_pst->TempCenti_s16;
+    State_pst->PrevLight_u16 = Sample_pst->Light_u16;
+  }
+  else
+  {
+    //clamped deltas: error is carried into the next sample
+    int32_t Temp_s32 = constrain((int32_t)Sample_pst->TempCenti_s16 - State_pst->PrevTemp_s16, -2048, 2047);
+    int32_t Light_s32 = constrain((int32_t)Sample_pst->Light_u16 - State_pst->PrevLight_u16, -4096, 4095);
+
+    State_pst->PrevTemp_s16 += Temp_s32;
+    State_pst->PrevLight_u16 += Light_s32;
+
+    Block_pst->Delta_au32 [Block_pst->Count_u8 - 1] = ((uint32_t)Temp_s32 & 0xFFF)
+                                                    | ((uint32_t)(min<uint8_t>(Sample_pst->DutyPercent_u8, 100)) << 12)
+                                                    | ((uint32_t)Light_s32 << 19);
+  }
+
+  Block_pst->Count_u8++;
+
+  if(Block_pst->Count_u8 >= TELEMETRY_BLOCK_SAMPLES)
+  {
+    CloseBlock_v(Tier_u8);
+  }
+  else if((Tier_ast [Tier_u8].FlushSamples_u8 > 0) && ((Block_pst->Count_u8 % Tier_ast [Tier_u8].FlushSamples_u8) == 0))
+  {
+    //open block in place, survives a reset
+    WriteBlock_v(Tier_u8);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// write open block into its slot and start the next one (mutex taken)
+//------------------------------
+static void CloseBlock_v(uint8_t Tier_u8)
+{
+  TelemetryTierState_t *State_pst = &TierState_ast [Tier_u8];
+
+  if(State_pst->Block_st.Count_u8 == 0)
+  {
+    return;
+  }
+
+  WriteBlock_v(Tier_u8);
+
+  State_pst->NextSeq_u32++;
+  State_pst->Block_st.Count_u8 = 0;
+}
+//------------------------------
+
+
+//------------------------------
+// write open block into its slot (mutex taken)
+//------------------------------
+static void WriteBlock_v(uint8_t Tier_u8)
+{
+  const TelemetryTier_t *Tier_pst = &Tier_ast [Tier_u8];
+  TelemetryTierState_t *State_pst = &TierState_ast [Tier_u8];
+
+  File file = SPIFFS.open(Tier_pst->File_pc, "r+");
+
+  if(file)
+  {
+    file.seek((State_pst->Block_st.Seq_u32 % Tier_pst->Slots_u16) * sizeof(TelemetryBlock_t));
+    file.write((const uint8_t *)&State_pst->Block_st, sizeof(TelemetryBlock_t));
+    file.close();
+  }
+  else
+  {
+    Serial.printf("telemetry: couldn't write %s\n", Tier_pst->File_pc);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// get block by sequence number: open block from RAM, others from slot
+//------------------------------
+static bool LoadBlock_b(uint8_t Tier_u8, uint32_t Seq_u32, TelemetryBlock_t *Block_pst)
+{
+  const TelemetryTier_t *Tier_pst = &Tier_ast [Tier_u8];
+  TelemetryTierState_t *State_pst = &TierState_ast [Tier_u8];
+  bool Ok_b = false;
+
+  xSemaphoreTake(TelemetryMutex, portMAX_DELAY);
+
+  if((State_pst->Block_st.Count_u8 > 0) && (State_pst->Block_st.Seq_u32 == Seq_u32))
+  {
+    *Block_pst = State_pst->Block_st;
+    Ok_b = true;
+  }
+  else
+  {
+    File file = SPIFFS.open(Tier_pst->File_pc, FILE_READ);
+
+    if(file)
+    {
+      file.seek((Seq_u32 % Tier_pst->Slots_u16) * sizeof(TelemetryBlock_t));
+      Ok_b = (file.read((uint8_t *)Block_pst, sizeof(TelemetryBlock_t)) == sizeof(TelemetryBlock_t));
+      file.close();
+    }
+
+    //slot empty or already overwritten by a newer block
+    Ok_b = Ok_b && (Block_pst->Seq_u32 == Seq_u32) && (Block_pst->Count_u8 > 0);
+  }
+
+  xSemaphoreGive(TelemetryMutex);
+
+  return Ok_b;
+}
+//------------------------------
+
+
+//------------------------------
+// helpers for web interface
+//------------------------------
+uint8_t Telemetry_SeriesFromName_u8(const char *Name_pc)
+{
+  for(uint8_t i = 0; i < sizeof(SeriesName_apc) / sizeof(SeriesName_apc [0]); i++)
+  {
+    if(strcmp(Name_pc, SeriesName_apc [i]) == 0)
+    {
+      return i;
+    }
+  }
+
+  return 0xFF;
+}
+
+uint32_t Telemetry_LastTime_u32(void)
+{
+  return LastTime_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// history request: pick finest tier that has the range and step
+//------------------------------
+void Telemetry_QueryInit_v(TelemetryQuery_t *Query_pst, uint8_t Series_u8, uint32_t From_u32, uint32_t To_u32, uint32_t Step_u32)
+{
+  uint8_t Tier_u8 = 0;
+
+  while(Tier_u8 < TELEMETRY_TIER_COUNT - 1)
+  {
+    uint32_t Retention_u32 = Tier_ast [Tier_u8].Slots_u16 * TELEMETRY_BLOCK_SAMPLES * Tier_ast [Tier_u8].StepSec_u32;
+
+    if((Step_u32 < Tier_ast [Tier_u8 + 1].StepSec_u32) && (From_u32 + Retention_u32 >= LastTime_u32))
+    {
+      break;
+    }
+
+    Tier_u8++;
+  }
+
+  memset(Query_pst, 0, sizeof(TelemetryQuery_t));
+
+  Query_pst->Series_u8 = Series_u8;
+  Query_pst->Tier_u8 = Tier_u8;
+  Query_pst->Phase_u8 = TELEMETRY_PHASE_HEADER;
+  Query_pst->First_b = true;
+  Query_pst->From_u32 = From_u32;
+  Query_pst->To_u32 = To_u32;
+  Query_pst->Step_u32 = max(Step_u32, Tier_ast [Tier_u8].StepSec_u32);
+  Query_pst->NextTime_u32 = From_u32;
+
+  xSemaphoreTake(TelemetryMutex, portMAX_DELAY);
+  Query_pst->LastSeq_u32 = TierState_ast [Tier_u8].NextSeq_u32;
+  xSemaphoreGive(TelemetryMutex);
+
+  //oldest block still in the ring
+  Query_pst->Seq_u32 = (Query_pst->LastSeq_u32 > Tier_ast [Tier_u8].Slots_u16) ? Query_pst->LastSeq_u32 - Tier_ast [Tier_u8].Slots_u16 + 1 : 1;
+}
+//------------------------------
+
+
+//------------------------------
+// decode next point in range into output buffer, false at end of data
+//------------------------------
+static bool NextPoint_b(TelemetryQuery_t *Query_pst)
+{
+  TelemetryBlock_t *Block_pst = &Query_pst->Block_st;
+  TelemetrySample_t *Value_pst = &Query_pst->Value_st;
+
+  while(1)
+  {
+    //next block
+    if(Query_pst->Sample_u8 >= Block_pst->Count_u8)
+    {
+      Query_pst->Sample_u8 = 0;
+      Block_pst->Count_u8 = 0;
+
+      if(Query_pst->Seq_u32 > Query_pst->LastSeq_u32)
+      {
+        return false;
+      }
+
+      if(!LoadBlock_b(Query_pst->Tier_u8, Query_pst->Seq_u32++, Block_pst))
+      {
+        continue;
+      }
+
+      //skip whole block if it ends before range
+      if(Block_pst->StartTime_u32 + Block_pst->Count_u8 * Tier_ast [Query_pst->Tier_u8].StepSec_u32 < Query_pst->From_u32)
+      {
+        Block_pst->Count_u8 = 0;
+        continue;
+      }
+    }
+
+    //decode sample
+    if(Query_pst->Sample_u8 == 0)
+    {
+      Value_pst->Time_u32 = Block_pst->StartTime_u32;
+      Value_pst->TempCenti_s16 = Block_pst->TempCenti_s16;
+      Value_pst->DutyPercent_u8 = Block_pst->DutyPercent_u8;
+      Value_pst->Light_u16 = Block_pst->Light_u16;
+    }
+    else
+    {
+      uint32_t Delta_u32 = Block_pst->Delta_au32 [Query_pst->Sample_u8 - 1];
+
+      Value_pst->Time_u32 += Tier_ast [Query_pst->Tier_u8].StepSec_u32;
+      Value_pst->TempCenti_s16 += ((int32_t)(Delta_u32 << 20)) >> 20;
+      Value_pst->DutyPercent_u8 = (Delta_u32 >> 12) & 0x7F;
+      Value_pst->Light_u16 += ((int32_t)Delta_u32) >> 19;
+    }
+    Query_pst->Sample_u8++;
+
+    if(Value_pst->Time_u32 > Query_pst->To_u32)
+    {
+      return false;
+    }
+
+    if((Value_pst->Time_u32 < Query_pst->From_u32) || (Value_pst->Time_u32 < Query_pst->NextTime_u32))
+    {
+      continue;
+    }
+
+    Query_pst->NextTime_u32 = Value_pst->Time_u32 + Query_pst->Step_u32;
+
+    const char *Separator_pc = Query_pst->First_b ? "" : ",";
+    Query_pst->First_b = false;
+
+    switch(Query_pst->Series_u8)
+    {
+      case TELEMETRY_SERIES_TEMP:
+        Query_pst->OutLen_u8 = snprintf(Query_pst->Out_ac, sizeof(Query_pst->Out_ac), "%s[%u,%.2f]", Separator_pc,
+                                        Value_pst->Time_u32, Value_pst->TempCenti_s16 / 100.0F);
+        break;
+
+      case TELEMETRY_SERIES_DUTY:
+        Query_pst->OutLen_u8 = snprintf(Query_pst->Out_ac, sizeof(Query_pst->Out_ac), "%s[%u,%u]", Separator_pc,
+                                        Value_pst->Time_u32, Value_pst->DutyPercent_u8);
+        break;
+
+      default:
+        Query_pst->OutLen_u8 = snprintf(Query_pst->Out_ac, sizeof(Query_pst->Out_ac), "%s[%u,%u]", Separator_pc,
+                                        Value_pst->Time_u32, Value_pst->Light_u16);
+        break;
+    }
+
+    return true;
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// fill next chunk of JSON response, returns 0 at end
+//------------------------------
+size_t Telemetry_QueryFill_u32(TelemetryQuery_t *Query_pst, uint8_t *Buf_pu8, size_t MaxLen_u32)
+{
+  size_t Len_u32 = 0;
+
+  while(Len_u32 < MaxLen_u32)
+  {
+    //pending output first
+    if(Query_pst->OutOffset_u8 < Query_pst->OutLen_u8)
+    {
+      size_t Copy_u32 = min((size_t)(Query_pst->OutLen_u8 - Query_pst->OutOffset_u8), MaxLen_u32 - Len_u32);
+
+      memcpy(&Buf_pu8 [Len_u32], &Query_pst->Out_ac [Query_pst->OutOffset_u8], Copy_u32);
+      Len_u32 += Copy_u32;
+      Query_pst->OutOffset_u8 += Copy_u32;
+      continue;
+    }
+
+    Query_pst->OutOffset_u8 = 0;
+    Query_pst->OutLen_u8 = 0;
+
+    switch(Query_pst->Phase_u8)
+    {
+      case TELEMETRY_PHASE_HEADER:
+        Query_pst->OutLen_u8 = snprintf(Query_pst->Out_ac, sizeof(Query_pst->Out_ac), "{\"series\":\"%s\",\"step\":%u,\"points\":[",
+                                        SeriesName_apc [Query_pst->Series_u8], Query_pst->Step_u32);
+        Query_pst->Phase_u8 = TELEMETRY_PHASE_POINTS;
+        break;
+
+      case TELEMETRY_PHASE_POINTS:
+        if(!NextPoint_b(Query_pst))
+        {
+          Query_pst->Phase_u8 = TELEMETRY_PHASE_FOOTER;
+        }
+        break;
+
+      case TELEMETRY_PHASE_FOOTER:
+        Query_pst->OutLen_u8 = snprintf(Query_pst->Out_ac, sizeof(Query_pst->Out_ac), "]}");
+        Query_pst->Phase_u8 = TELEMETRY_PHASE_DONE;
+        break;
+
+      default:
+        return Len_u32;
+    }
+  }
+
+  return Len_u32;
+}
+//------------------------------
@@ -0,0 +1,496 @@
+//------------------------------
+// Temperature sensors
+//
+// getTempCByIndex() searched the whole bus for every reading and only saw
+// the first probe. Here the bus is searched at boot and then only every
+// 10 min (every minute while a probe is missing), the ROM codes stay in
+// the table. An update starts the conversion of all probes with
+// one skip-ROM command, waits once and reads every probe by its address,
+// so more probes do not add conversion time.
+//
+// A scratchpad with a bad CRC counts as CRC error, no presence pulse as
+// missed reading; both keep the last value out of the result. A removed
+// probe keeps its entry (not present) with its counters only while its
+// ROM code is configured for a role, other entries are freed by the next
+// bus search.
+//------------------------------
+
+//includes
+//------------------------------
+#include "TempSensors.h"
+#include "DeviceConfig.h"
+
+#include <OneWire.h>
+#include <DallasTemperature.h>
+//------------------------------
+
+//constants
+//------------------------------
+#define TEMP_RESET_RAW 0x0550           //85 degC power-on value: conversion did not run
+
+//result of one read
+#define TEMP_READ_OK 0
+#define TEMP_READ_MISSED 1              //no presence pulse
+#define TEMP_READ_CRC 2
+#define TEMP_READ_INVALID 3             //no conversion result
+//------------------------------
+
+//global variables
+//------------------------------
+typedef struct
+{
+  uint8_t Rom_au8 [8];
+  uint8_t Role_u8;                      //TEMP_ROLE_xxx
+  bool Present_b;                       //found by last bus search
+  bool Valid_b;                         //last reading ok
+  int16_t TempCenti_s16;
+  uint32_t Reads_u32;
+  uint32_t CrcErrors_u32;
+  uint32_t Missed_u32;
+} TempSensor_t;
+
+static OneWire *Wire_pst = NULL;
+static DallasTemperature *Bus_pst = NULL;
+
+static TempSensor_t Sensor_ast [TEMP_SENSORS_MAX];
+static uint8_t SensorCount_u8 = 0;
+static uint32_t LastScanMsec_u32 = 0;
+static volatile bool Rescan_b = false;
+static portMUX_TYPE SensorMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void Scan_v(void);
+static void AssignRoles_v(void);
+static bool Configured_b(const DeviceConfig_t *Config_pst, const uint8_t *Rom_pu8);
+static uint8_t ReadSensor_u8(const uint8_t *Rom_pu8, int16_t *TempCenti_ps16);
+static void RomHex_v(const uint8_t *Rom_pu8, char *Hex_pc);
+//------------------------------
+
+
+//------------------------------
+// init bus, search probes (boot)
+//------------------------------
+void TempSensor_Init_v(uint8_t Pin_u8)
+{
+  static OneWire OneWire_st(Pin_u8);
+  static DallasTemperature Dallas_st(&OneWire_st);
+
+  Wire_pst = &OneWire_st;
+  Bus_pst = &Dallas_st;
+
+  Bus_pst->begin();
+  Bus_pst->setWaitForConversion(false);   //waiting is done with vTaskDelay
+
+  Scan_v();
+
+  Serial.printf("DS18B20: %u sensor(s) found\n", SensorCount_u8);
+}
+//------------------------------
+
+
+//------------------------------
+// bus search, known probes keep their counters
+//------------------------------
+static void Scan_v(void)
+{
+  uint8_t Rom_au8 [8];
+  bool Found_ab [TEMP_SENSORS_MAX] = {false};
+  bool Keep_ab [TEMP_SENSORS_MAX];
+  DeviceConfig_t Current_st;
+  uint8_t Count_u8 = 0;
+
+  Config_Copy_v(&Current_st);
+
+  //slots of absent probes without role are freed before the search
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    Keep_ab [i] = Sensor_ast [i].Present_b || Configured_b(&Current_st, Sensor_ast [i].Rom_au8);
+  }
+
+  portENTER_CRITICAL(&SensorMux);
+
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    if(Keep_ab [i])
+    {
+      Sensor_ast [Count_u8++] = Sensor_ast [i];
+    }
+  }
+
+  SensorCount_u8 = Count_u8;
+
+  portEXIT_CRITICAL(&SensorMux);
+
+  Wire_pst->reset_search();
+
+  while(Wire_pst->search(Rom_au8))
+  {
+    if(OneWire::crc8(Rom_au8, 7) != Rom_au8 [7])
+    {
+      continue;
+    }
+
+    uint8_t i = 0;
+
+    while((i < SensorCount_u8) && (memcmp(Sensor_ast [i].Rom_au8, Rom_au8, 8) != 0))
+    {
+      i++;
+    }
+
+    if(i == SensorCount_u8)
+    {
+      if(SensorCount_u8 == TEMP_SENSORS_MAX)
+      {
+        continue;
+      }
+
+      portENTER_CRITICAL(&SensorMux);
+      memset(&Sensor_ast [i], 0, sizeof(TempSensor_t));
+      memcpy(Sensor_ast [i].Rom_au8, Rom_au8, 8);
+      Sensor_ast [i].Role_u8 = TEMP_ROLE_NONE;
+      SensorCount_u8++;
+      portEXIT_CRITICAL(&SensorMux);
+
+      Bus_pst->setResolution(Rom_au8, TEMP_RESOLUTION_BIT);
+    }
+
+    Found_ab [i] = true;
+  }
+
+  portENTER_CRITICAL(&SensorMux);
+
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    Sensor_ast [i].Present_b = Found_ab [i];
+    Sensor_ast [i].Valid_b = Sensor_ast [i].Valid_b && Found_ab [i];
+  }
+
+  portEXIT_CRITICAL(&SensorMux);
+
+  LastScanMsec_u32 = millis();
+  Rescan_b = false;
+}
+//------------------------------
+
+
+//------------------------------
+// ROM code assigned to a role in config?
+//------------------------------
+static bool Configured_b(const DeviceConfig_t *Config_pst, const uint8_t *Rom_pu8)
+{
+  char Hex_ac [TEMP_ROM_HEX_LEN + 1];
+
+  RomHex_v(Rom_pu8, Hex_ac);
+
+  for(uint8_t r = 0; r < TEMP_ROLE_COUNT; r++)
+  {
+    if(strcasecmp(Config_pst->SensorRom_aac [r], Hex_ac) == 0)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+//------------------------------
+
+
+//------------------------------
+// roles by ROM code in config, air: first probe if not configured
+//------------------------------
+static void AssignRoles_v(void)
+{
+  DeviceConfig_t Current_st;
+  uint8_t Role_au8 [TEMP_SENSORS_MAX];
+  bool Configured_ab [TEMP_ROLE_COUNT] = {false};
+
+  Config_Copy_v(&Current_st);
+
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    char Hex_ac [TEMP_ROM_HEX_LEN + 1];
+
+    RomHex_v(Sensor_ast [i].Rom_au8, Hex_ac);
+    Role_au8 [i] = TEMP_ROLE_NONE;
+
+    for(uint8_t r = 0; r < TEMP_ROLE_COUNT; r++)
+    {
+      if(strcasecmp(Current_st.SensorRom_aac [r], Hex_ac) == 0)
+      {
+        Role_au8 [i] = r;
+      }
+
+      Configured_ab [r] = Configured_ab [r] || (Current_st.SensorRom_aac [r] [0] != '\0');
+    }
+  }
+
+  if(!Configured_ab [TEMP_ROLE_AIR])
+  {
+    for(uint8_t i = 0; i < SensorCount_u8; i++)
+    {
+      if(Sensor_ast [i].Present_b && (Role_au8 [i] == TEMP_ROLE_NONE))
+      {
+        Role_au8 [i] = TEMP_ROLE_AIR;
+        break;
+      }
+    }
+  }
+
+  portENTER_CRITICAL(&SensorMux);
+
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    Sensor_ast [i].Role_u8 = Role_au8 [i];
+  }
+
+  portEXIT_CRITICAL(&SensorMux);
+}
+//------------------------------
+
+
+//------------------------------
+// convert all, read one by one (telemetry task)
+//------------------------------
+void TempSensor_Update_v(void)
+{
+  if(Bus_pst == NULL)
+  {
+    return;
+  }
+
+  bool Missing_b = false;
+
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    Missing_b = Missing_b || !Sensor_ast [i].Present_b;
+  }
+
+  uint32_t SinceScanMsec_u32 = millis() - LastScanMsec_u32;
+
+  //hot-plug: new probes periodically, a missing one more often (not on every update)
+  if(Rescan_b || (SinceScanMsec_u32 >= TEMP_RESCAN_SEC * 1000UL)
+     || ((Missing_b || (SensorCount_u8 == 0)) && (SinceScanMsec_u32 >= TEMP_MISSING_RESCAN_SEC * 1000UL)))
+  {
+    Scan_v();
+  }
+
+  AssignRoles_v();
+
+  if(SensorCount_u8 == 0)
+  {
+    return;
+  }
+
+  //skip ROM: all probes convert at the same time
+  Bus_pst->requestTemperatures();
+  vTaskDelay(pdMS_TO_TICKS(Bus_pst->millisToWaitForConversion(TEMP_RESOLUTION_BIT)));
+
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    TempSensor_t *Sensor_pst = &Sensor_ast [i];
+    int16_t TempCenti_s16 = 0;
+
+    if(!Sensor_pst->Present_b)
+    {
+      continue;
+    }
+
+    uint8_t Result_u8 = ReadSensor_u8(Sensor_pst->Rom_au8, &TempCenti_s16);
+
+    portENTER_CRITICAL(&SensorMux);
+
+    Sensor_pst->Reads_u32++;
+    Sensor_pst->Valid_b = (Result_u8 == TEMP_READ_OK);
+
+    switch(Result_u8)
+    {
+      case TEMP_READ_OK:
+        Sensor_pst->TempCenti_s16 = TempCenti_s16;
+        break;
+
+      case TEMP_READ_MISSED:
+        //search again with the next update
+        Sensor_pst->Missed_u32++;
+        Sensor_pst->Present_b = false;
+        break;
+
+      case TEMP_READ_CRC:
+        Sensor_pst->CrcErrors_u32++;
+        break;
+
+      default:
+        break;
+    }
+
+    portEXIT_CRITICAL(&SensorMux);
+  }
+}
+
+static uint8_t ReadSensor_u8(const uint8_t *Rom_pu8, int16_t *TempCenti_ps16)
+{
+  uint8_t Scratch_au8 [9];
+
+  if(!Bus_pst->readScratchPad(Rom_pu8, Scratch_au8))
+  {
+    return TEMP_READ_MISSED;
+  }
+
+  bool Empty_b = true;
+
+  for(uint8_t i = 0; i < sizeof(Scratch_au8); i++)
+  {
+    Empty_b = Empty_b && ((Scratch_au8 [i] == 0x00) || (Scratch_au8 [i] == 0xFF));
+  }
+
+  if(Empty_b || (OneWire::crc8(Scratch_au8, 8) != Scratch_au8 [8]))
+  {
+    return TEMP_READ_CRC;
+  }
+
+  int16_t Raw_s16 = (int16_t)((Scratch_au8 [1] << 8) | Scratch_au8 [0]);
+
+  if(Raw_s16 == TEMP_RESET_RAW)
+  {
+    return TEMP_READ_INVALID;
+  }
+
+  //DS18B20: 1/16 degC
+  *TempCenti_ps16 = (int16_t)(((int32_t)Raw_s16 * 100) / 16);
+
+  return TEMP_READ_OK;
+}
+//------------------------------
+
+
+//------------------------------
+// values
+//------------------------------
+void TempSensor_RequestRescan_v(void)
+{
+  Rescan_b = true;
+}
+
+float TempSensor_Get_f32(uint8_t Role_u8)
+{
+  float Temp_f32 = NAN;
+
+  portENTER_CRITICAL(&SensorMux);
+
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    if((Sensor_ast [i].Role_u8 == Role_u8) && Sensor_ast [i].Present_b && Sensor_ast [i].Valid_b)
+    {
+      Temp_f32 = Sensor_ast [i].TempCenti_s16 / 100.0F;
+      break;
+    }
+  }
+
+  portEXIT_CRITICAL(&SensorMux);
+
+  return Temp_f32;
+}
+
+uint8_t TempSensor_Count_u8(void)
+{
+  uint8_t Count_u8 = 0;
+
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    Count_u8 += Sensor_ast [i].Present_b ? 1 : 0;
+  }
+
+  return Count_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// ROM code <-> 16 hex digits (family code first)
+//------------------------------
+static void RomHex_v(const uint8_t *Rom_pu8, char *Hex_pc)
+{
+  static const char Digit_ac [] = "0123456789ABCDEF";
+
+  for(uint8_t i = 0; i < 8; i++)
+  {
+    *Hex_pc++ = Digit_ac [Rom_pu8 [i] >> 4];
+    *Hex_pc++ = Digit_ac [Rom_pu8 [i] & 0x0F];
+  }
+
+  *Hex_pc = '\0';
+}
+
+bool TempSensor_ParseRom_b(const char *Hex_pc, uint8_t *Rom_pu8)
+{
+  if(strlen(Hex_pc) != TEMP_ROM_HEX_LEN)
+  {
+    return false;
+  }
+
+  for(uint8_t i = 0; i < TEMP_ROM_HEX_LEN; i++)
+  {
+    char Char_c = toupper(Hex_pc [i]);
+    uint8_t Nibble_u8;
+
+    if((Char_c >= '0') && (Char_c <= '9'))
+    {
+      Nibble_u8 = Char_c - '0';
+    }
+    else if((Char_c >= 'A') && (Char_c <= 'F'))
+    {
+      Nibble_u8 = Char_c - 'A' + 10;
+    }
+    else
+    {
+      return false;
+    }
+
+    Rom_pu8 [i / 2] = (i & 1) ? (Rom_pu8 [i / 2] | Nibble_u8) : (Nibble_u8 << 4);
+  }
+
+  return OneWire::crc8(Rom_pu8, 7) == Rom_pu8 [7];
+}
+//------------------------------
+
+
+//------------------------------
+// probes as JSON
+//------------------------------
+void TempSensor_PrintJson_v(Print &Out)
+{
+  static const char * const RoleName_apc [TEMP_ROLE_COUNT] = {"air", "water", "outdoor"};
+
+  Out.print("{\"sensors\":[");
+
+  for(uint8_t i = 0; i < SensorCount_u8; i++)
+  {
+    TempSensor_t Sensor_st;
+    char Hex_ac [TEMP_ROM_HEX_LEN + 1];
+
+    portENTER_CRITICAL(&SensorMux);
+    Sensor_st = Sensor_ast [i];
+    portEXIT_CRITICAL(&SensorMux);
+
+    RomHex_v(Sensor_st.Rom_au8, Hex_ac);
+
+    Out.printf("%s{\"rom\":\"%s\",\"role\":\"%s\",\"present\":%s,", (i > 0) ? "," : "", Hex_ac,
+               (Sensor_st.Role_u8 < TEMP_ROLE_COUNT) ? RoleName_apc [Sensor_st.Role_u8] : "",
+               Sensor_st.Present_b ? "true" : "false");
+
+    if(Sensor_st.Present_b && Sensor_st.Valid_b)
+    {
+      Out.printf("\"temperature\":%.2f,", Sensor_st.TempCenti_s16 / 100.0F);
+    }
+    else
+    {
+      Out.print("\"temperature\":null,");
+    }
+
+    Out.printf("\"reads\":%u,\"crc_errors\":%u,\"missed\":%u}", Sensor_st.Reads_u32, Sensor_st.CrcErrors_u32, Sensor_st.Missed_u32);
+  }
+
+  Out.printf("],\"rescan_s\":%u}", TEMP_RESCAN_SEC);
+}
+//------------------------------
@@ -0,0 +1,296 @@
+//------------------------------
+// Text formatting
+//
+// Replaces String concatenation in paths that run all day (page values,
+// NTP sync, web handlers): every String + may allocate and over months
+// the small blocks fragment the heap. Text_t only writes into the buffer
+// it was given.
+//------------------------------
+
+//includes
+//------------------------------
+#include "TextFormat.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define TEXT_DIGITS_MAX 10                  //uint32_t
+//------------------------------
+
+
+//------------------------------
+// start text in buffer
+//------------------------------
+void Text_Init_v(Text_t *Text_pst, char *Buf_pc, size_t Size_u32)
+{
+  Text_pst->Buf_pc = Buf_pc;
+  Text_pst->Size_u32 = Size_u32;
+  Text_pst->Len_u32 = 0;
+  Text_pst->Overflow_b = (Size_u32 == 0);
+
+  if(Size_u32 > 0)
+  {
+    Buf_pc [0] = '\0';
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// append
+//------------------------------
+void Text_Char_v(Text_t *Text_pst, char Char_c)
+{
+  if(Text_pst->Len_u32 + 1 >= Text_pst->Size_u32)
+  {
+    Text_pst->Overflow_b = true;
+    return;
+  }
+
+  Text_pst->Buf_pc [Text_pst->Len_u32++] = Char_c;
+  Text_pst->Buf_pc [Text_pst->Len_u32] = '\0';
+}
+
+void Text_Str_v(Text_t *Text_pst, const char *Str_pc)
+{
+  while(*Str_pc != '\0')
+  {
+    Text_Char_v(Text_pst, *Str_pc++);
+  }
+}
+
+void Text_Uint_v(Text_t *Text_pst, uint32_t Value_u32, uint8_t Width_u8)
+{
+  char Digit_ac [TEXT_DIGITS_MAX];
+  uint8_t n_u8 = 0;
+
+  //digits in reverse order
+  do
+  {
+    Digit_ac [n_u8++] = '0' + (Value_u32 % 10);
+    Value_u32 /= 10;
+  } while(Value_u32 != 0);
+
+  for(uint8_t i = n_u8; i < Width_u8; i++)
+  {
+    Text_Char_v(Text_pst, '0');
+  }
+
+  while(n_u8 > 0)
+  {
+    Text_Char_v(Text_pst, Digit_ac [--n_u8]);
+  }
+}
+
+void Text_Int_v(Text_t *Text_pst, int32_t Value_s32, uint8_t Width_u8)
+{
+  if(Value_s32 < 0)
+  {
+    Text_Char_v(Text_pst, '-');
+    Text_Uint_v(Text_pst, -(int64_t)Value_s32, Width_u8);
+  }
+  else
+  {
+    Text_Uint_v(Text_pst, Value_s32, Width_u8);
+  }
+}
+
+void Text_Fixed_v(Text_t *Text_pst, float Value_f32, uint8_t Decimals_u8)
+{
+  uint32_t Scale_u32 = 1;
+
+  if(isnan(Value_f32))
+  {
+    Text_Str_v(Text_pst, "nan");
+    return;
+  }
+
+  for(uint8_t i = 0; i < Decimals_u8; i++)
+  {
+    Scale_u32 *= 10;
+  }
+
+  if(Value_f32 < 0)
+  {
+    Value_f32 = -Value_f32;
+
+    //no "-0.0"
+    if((uint32_t)(Value_f32 * Scale_u32 + 0.5f) != 0)
+    {
+      Text_Char_v(Text_pst, '-');
+    }
+  }
+
+  uint32_t Scaled_u32 = (uint32_t)(Value_f32 * Scale_u32 + 0.5f);
+
+  Text_Uint_v(Text_pst, Scaled_u32 / Scale_u32);
+
+  if(Decimals_u8 > 0)
+  {
+    Text_Char_v(Text_pst, '.');
+    Text_Uint_v(Text_pst, Scaled_u32 % Scale_u32, Decimals_u8);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// date and time fields
+//------------------------------
+void Text_Date_v(Text_t *Text_pst, uint16_t Year_u16, uint8_t Month_u8, uint8_t Day_u8)
+{
+  Text_Uint_v(Text_pst, Year_u16, 4);
+  Text_Char_v(Text_pst, '-');
+  Text_Uint_v(Text_pst, Month_u8, 2);
+  Text_Char_v(Text_pst, '-');
+  Text_Uint_v(Text_pst, Day_u8, 2);
+}
+
+void Text_Time_v(Text_t *Text_pst, uint8_t Hour_u8, uint8_t Minute_u8, int8_t Second_s8)
+{
+  Text_Uint_v(Text_pst, Hour_u8, 2);
+  Text_Char_v(Text_pst, ':');
+  Text_Uint_v(Text_pst, Minute_u8, 2);
+
+  if(Second_s8 >= 0)
+  {
+    Text_Char_v(Text_pst, ':');
+    Text_Uint_v(Text_pst, Second_s8, 2);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// result
+//------------------------------
+bool Text_Ok_b(const Text_t *Text_pst)
+{
+  return !Text_pst->Overflow_b;
+}
+
+size_t Text_Len_u32(const Text_t *Text_pst)
+{
+  return Text_pst->Overflow_b ? 0 : Text_pst->Len_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// parse decimal number (digits only, no blanks)
+//------------------------------
+bool Text_ParseUint_b(const char *Text_pc, const char *End_pc, uint32_t *Value_pu32)
+{
+  uint32_t Value_u32 = 0;
+  uint8_t n_u8 = 0;
+
+  while((Text_pc != End_pc) && (*Text_pc != '\0'))
+  {
+    if((*Text_pc < '0') || (*Text_pc > '9') || (n_u8 >= TEXT_DIGITS_MAX - 1))
+    {
+      return false;
+    }
+
+    Value_u32 = Value_u32 * 10 + (*Text_pc++ - '0');
+    n_u8++;
+  }
+
+  if(n_u8 == 0)
+  {
+    return false;
+  }
+
+  *Value_pu32 = Value_u32;
+  return true;
+}
+
+bool Text_ParseInt_b(const char *Text_pc, const char *End_pc, int32_t *Value_ps32)
+{
+  bool Negative_b = (*Text_pc == '-');
+  uint32_t Value_u32 = 0;
+
+  if(Negative_b || (*Text_pc == '+'))
+  {
+    Text_pc++;
+  }
+
+  if(!Text_ParseUint_b(Text_pc, End_pc, &Value_u32))
+  {
+    return false;
+  }
+
+  *Value_ps32 = Negative_b ? -(int32_t)Value_u32 : (int32_t)Value_u32;
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// value of a key in a small flat JSON object, e.g. {"level":30,"curve":"smooth"}
+// (strings without quotes, no escapes, no nesting)
+//------------------------------
+bool Text_JsonValue_b(const char *Json_pc, const char *Key_pc, char *Value_pc, size_t Size_u32)
+{
+  size_t KeyLen_u32 = strlen(Key_pc);
+  const char *Pos_pc = Json_pc;
+
+  while((Pos_pc = strchr(Pos_pc, '"')) != NULL)
+  {
+    Pos_pc++;
+
+    bool Match_b = (strncmp(Pos_pc, Key_pc, KeyLen_u32) == 0) && (Pos_pc [KeyLen_u32] == '"');
+
+    //skip key or string value
+    Pos_pc = strchr(Pos_pc, '"');
+
+    if(Pos_pc == NULL)
+    {
+      return false;
+    }
+    Pos_pc++;
+
+    while(*Pos_pc == ' ')
+    {
+      Pos_pc++;
+    }
+
+    //a string value followed by ':' cannot occur, so this is a key
+    if(*Pos_pc != ':')
+    {
+      continue;
+    }
+
+    Pos_pc++;
+
+    while(*Pos_pc == ' ')
+    {
+      Pos_pc++;
+    }
+
+    bool Quoted_b = (*Pos_pc == '"');
+    const char *End_pc = Quoted_b ? strchr(++Pos_pc, '"') : Pos_pc + strcspn(Pos_pc, ",} \r\n");
+
+    if(End_pc == NULL)
+    {
+      return false;
+    }
+
+    if(!Match_b)
+    {
+      Pos_pc = Quoted_b ? End_pc + 1 : End_pc;
+      continue;
+    }
+
+    if((size_t)(End_pc - Pos_pc) >= Size_u32)
+    {
+      return false;
+    }
+
+    memcpy(Value_pc, Pos_pc, End_pc - Pos_pc);
+    Value_pc [End_pc - Pos_pc] = '\0';
+    return true;
+  }
+
+  return false;
+}
+//------------------------------
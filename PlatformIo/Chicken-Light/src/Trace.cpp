@@ -0,0 +1,250 @@
+//------------------------------
+// Input trace
+//
+// Records are appended to one buffer until the capture is stopped or the
+// buffer is full; the start of a capture must be kept for a replay, so
+// there is no ring. The start record and one output record per zone
+// describe the initial state. The RTC is only recorded when it does not
+// follow the uptime clock (time set, drift), the switch only on edges
+// and outputs only when their percent value changes, so a one hour ramp
+// costs about 100 records per zone.
+//
+// The buffer is allocated with the first capture and kept, so an export
+// can never read freed memory; a new capture increments the generation,
+// which ends running exports.
+//------------------------------
+
+//includes
+//------------------------------
+#include "Trace.h"
+#include "LightZones.h"
+//------------------------------
+
+//global variables
+//------------------------------
+static TraceRecord_t *Record_past = NULL;
+static uint16_t Count_u16 = 0;
+static volatile bool Active_b = false;
+static bool Full_b = false;
+static uint32_t Generation_u32 = 0;
+static uint32_t StartMsec_u32 = 0;
+static uint32_t StopMsec_u32 = 0;
+
+static uint32_t AnchorUnix_u32 = 0;         //RTC time at AnchorMsec_u32
+static uint32_t AnchorMsec_u32 = 0;
+static uint8_t SwitchLevel_u8 = 0xFF;       //last recorded, 0xFF = none yet
+static uint8_t OutPercent_au8 [ZONE_COUNT_MAX];
+
+static portMUX_TYPE TraceMux = portMUX_INITIALIZER_UNLOCKED;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void Append_v(uint8_t Type_u8, uint8_t Arg0_u8, uint8_t Arg1_u8, uint8_t Arg2_u8, uint32_t Value_u32, uint32_t Aux_u32);
+//------------------------------
+
+
+//------------------------------
+// start / stop capture
+//------------------------------
+bool Trace_Start_b(uint32_t Unix_u32, uint8_t ScheduleMode_u8)
+{
+  if(Record_past == NULL)
+  {
+    Record_past = (TraceRecord_t *)malloc(TRACE_RECORDS_MAX * sizeof(TraceRecord_t));
+
+    if(Record_past == NULL)
+    {
+      return false;
+    }
+  }
+
+  portENTER_CRITICAL(&TraceMux);
+
+  Generation_u32++;
+  Count_u16 = 0;
+  Full_b = false;
+  StartMsec_u32 = millis();
+  AnchorUnix_u32 = Unix_u32;
+  AnchorMsec_u32 = StartMsec_u32;
+  SwitchLevel_u8 = 0xFF;
+
+  //initial state: zones ramping now cannot be replayed until their next engine call
+  Append_v(TRACE_START, ZoneTable_st.Count_u8, ScheduleMode_u8, ZoneTable_st.RampingMask_u8, Unix_u32, TRACE_VERSION);
+
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    OutPercent_au8 [i] = LightZone_LevelToPercent_u8(ZoneTable_st.Level_au16 [i]);
+    Append_v(TRACE_OUT_LEVEL, i, 0, 0, ZoneTable_st.Level_au16 [i], 0);
+  }
+
+  Active_b = true;
+
+  portEXIT_CRITICAL(&TraceMux);
+
+  return true;
+}
+
+void Trace_Stop_v(void)
+{
+  portENTER_CRITICAL(&TraceMux);
+
+  if(Active_b)
+  {
+    Active_b = false;
+    StopMsec_u32 = millis();
+  }
+
+  portEXIT_CRITICAL(&TraceMux);
+}
+
+bool Trace_Active_b(void)
+{
+  return Active_b;
+}
+//------------------------------
+
+
+//------------------------------
+// record (any task)
+//------------------------------
+void Trace_Log_v(uint8_t Type_u8, uint8_t Arg0_u8, uint8_t Arg1_u8, uint8_t Arg2_u8, uint32_t Value_u32, uint32_t Aux_u32)
+{
+  if(!Active_b)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&TraceMux);
+  Append_v(Type_u8, Arg0_u8, Arg1_u8, Arg2_u8, Value_u32, Aux_u32);
+  portEXIT_CRITICAL(&TraceMux);
+}
+
+void Trace_Rtc_v(uint32_t Unix_u32)
+{
+  if(!Active_b)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&TraceMux);
+
+  //the anchor was read somewhere within its second: one second more is still on time
+  uint32_t Now_u32 = millis();
+  int32_t Expected_s32 = (Now_u32 - AnchorMsec_u32) / 1000;
+  int32_t Diff_s32 = (int32_t)(Unix_u32 - AnchorUnix_u32);
+
+  if((Diff_s32 != Expected_s32) && (Diff_s32 != Expected_s32 + 1))
+  {
+    Append_v(TRACE_IN_RTC, 0, 0, 0, Unix_u32, 0);
+    AnchorUnix_u32 = Unix_u32;
+    AnchorMsec_u32 = Now_u32;
+  }
+
+  portEXIT_CRITICAL(&TraceMux);
+}
+
+void Trace_Switch_v(uint8_t Level_u8)
+{
+  if(!Active_b)
+  {
+    return;
+  }
+
+  portENTER_CRITICAL(&TraceMux);
+
+  if(Level_u8 != SwitchLevel_u8)
+  {
+    Append_v(TRACE_IN_SWITCH, Level_u8, 0, 0, 0, 0);
+    SwitchLevel_u8 = Level_u8;
+  }
+
+  portEXIT_CRITICAL(&TraceMux);
+}
+
+void Trace_Output_v(uint8_t Zone_u8, uint16_t Level_u16)
+{
+  if(!Active_b || (Zone_u8 >= ZONE_COUNT_MAX))
+  {
+    return;
+  }
+
+  uint8_t Percent_u8 = LightZone_LevelToPercent_u8(Level_u16);
+
+  portENTER_CRITICAL(&TraceMux);
+
+  if(Percent_u8 != OutPercent_au8 [Zone_u8])
+  {
+    Append_v(TRACE_OUT_LEVEL, Zone_u8, 0, 0, Level_u16, 0);
+    OutPercent_au8 [Zone_u8] = Percent_u8;
+  }
+
+  portEXIT_CRITICAL(&TraceMux);
+}
+
+//called in critical section
+static void Append_v(uint8_t Type_u8, uint8_t Arg0_u8, uint8_t Arg1_u8, uint8_t Arg2_u8, uint32_t Value_u32, uint32_t Aux_u32)
+{
+  if(Count_u16 >= TRACE_RECORDS_MAX)
+  {
+    Active_b = false;
+    Full_b = true;
+    StopMsec_u32 = millis();
+    return;
+  }
+
+  TraceRecord_t *Record_pst = &Record_past [Count_u16++];
+
+  Record_pst->Msec_u32 = millis() - StartMsec_u32;
+  Record_pst->Type_u8 = Type_u8;
+  Record_pst->Arg_au8 [0] = Arg0_u8;
+  Record_pst->Arg_au8 [1] = Arg1_u8;
+  Record_pst->Arg_au8 [2] = Arg2_u8;
+  Record_pst->Value_u32 = Value_u32;
+  Record_pst->Aux_u32 = Aux_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// export
+//------------------------------
+uint32_t Trace_Generation_u32(void)
+{
+  return Generation_u32;
+}
+
+size_t Trace_Read_u32(uint32_t Capture_u32, size_t Offset_u32, uint8_t *Buf_pu8, size_t MaxLen_u32)
+{
+  size_t Len_u32 = 0;
+
+  portENTER_CRITICAL(&TraceMux);
+
+  size_t Size_u32 = (size_t)Count_u16 * sizeof(TraceRecord_t);
+
+  if((Capture_u32 == Generation_u32) && (Record_past != NULL) && (Offset_u32 < Size_u32))
+  {
+    Len_u32 = min(Size_u32 - Offset_u32, MaxLen_u32);
+    memcpy(Buf_pu8, (const uint8_t *)Record_past + Offset_u32, Len_u32);
+  }
+
+  portEXIT_CRITICAL(&TraceMux);
+
+  return Len_u32;
+}
+
+void Trace_PrintJson_v(Print &Out)
+{
+  portENTER_CRITICAL(&TraceMux);
+  bool Running_b = Active_b;
+  uint16_t Records_u16 = Count_u16;
+  bool Overflow_b = Full_b;
+  uint32_t Capture_u32 = Generation_u32;
+  uint32_t DurationMsec_u32 = (Active_b ? millis() : StopMsec_u32) - StartMsec_u32;
+  portEXIT_CRITICAL(&TraceMux);
+
+  Out.printf("{\"active\":%s,\"generation\":%u,\"records\":%u,\"records_max\":%u,\"full\":%s,\"duration_ms\":%u}",
+             Running_b ? "true" : "false", Capture_u32, Records_u16, TRACE_RECORDS_MAX,
+             Overflow_b ? "true" : "false", (Capture_u32 > 0) ? DurationMsec_u32 : 0);
+}
+//------------------------------
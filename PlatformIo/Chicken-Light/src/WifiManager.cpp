@@ -0,0 +1,238 @@
+//------------------------------
+// WiFi connection manager
+//
+// WiFi events only notify the manager task, all decisions are taken
+// there: CONNECTING -> CONNECTED on IP, -> BACKOFF on failure or
+// timeout; BACKOFF -> CONNECTING after the backoff time, which doubles
+// per failure (plus jitter) up to 5 min. A drop of a working connection
+// retries after the minimum backoff. Nothing here blocks setup().
+// Notify bits merge: GOT_IP and DISCONNECTED in one wait are settled with
+// WiFi.isConnected(), and a connected link is polled every
+// WIFI_LINK_CHECK_MSEC in case a disconnect got lost that way.
+//------------------------------
+
+//includes
+//------------------------------
+#include "WifiManager.h"
+#include "TaskBudget.h"
+
+#include <WiFi.h>
+
+#include "esp_timer.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define WIFI_NOTIFY_GOT_IP 0x01
+#define WIFI_NOTIFY_DISCONNECTED 0x02
+#define WIFI_LINK_CHECK_MSEC 10000
+//------------------------------
+
+//global variables
+//------------------------------
+static const char *Ssid_pc = NULL;
+static const char *Password_pc = NULL;
+static const char *ApSsid_pc = NULL;        //NULL = no access point fallback
+static const char *ApPassword_pc = NULL;
+
+static volatile uint8_t State_u8 = WIFI_STATE_CONNECTING;
+static volatile uint32_t ConnectCount_u32 = 0;
+static uint32_t FirstConnectUs_u32 = 0;   //usec since power on, 0 = never connected
+static bool ApActive_b = false;
+
+static TaskHandle_t Wifi_taskHandle = NULL;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static void Wifi_task(void * pvParameters);
+static void WifiEvent_v(WiFiEvent_t Event);
+//------------------------------
+
+
+//------------------------------
+// start manager (WiFi mode, hostname and static IP are configured by caller)
+//------------------------------
+void Wifi_Start_v(const char *WifiSsid_pc, const char *WifiPassword_pc, const char *WifiApSsid_pc, const char *WifiApPassword_pc)
+{
+  Ssid_pc = WifiSsid_pc;
+  Password_pc = WifiPassword_pc;
+  ApSsid_pc = WifiApSsid_pc;
+  ApPassword_pc = WifiApPassword_pc;
+
+  WiFi.setAutoReconnect(false);   //retries are timed by the manager
+  WiFi.onEvent(WifiEvent_v, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  WiFi.onEvent(WifiEvent_v, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+
+  Wifi_taskHandle = Task_Start_h(TASK_ID_WIFI, Wifi_task, NULL);
+}
+//------------------------------
+
+
+//------------------------------
+// WiFi event (runs in event task, just notify)
+//------------------------------
+static void WifiEvent_v(WiFiEvent_t Event)
+{
+  if(Wifi_taskHandle == NULL)
+  {
+    return;
+  }
+
+  xTaskNotify(Wifi_taskHandle, (Event == ARDUINO_EVENT_WIFI_STA_GOT_IP) ? WIFI_NOTIFY_GOT_IP : WIFI_NOTIFY_DISCONNECTED, eSetBits);
+}
+//------------------------------
+
+
+//------------------------------
+// manager task
+//------------------------------
+static void Wifi_task(void * pvParameters)
+{
+  uint32_t BackoffMsec_u32 = WIFI_BACKOFF_MIN_MSEC;
+  TickType_t Deadline = 0;          //end of connect timeout / backoff
+  uint8_t Failures_u8 = 0;
+
+  Serial.printf("WiFi: connecting to %s\n", Ssid_pc);
+  WiFi.begin(Ssid_pc, Password_pc);
+  State_u8 = WIFI_STATE_CONNECTING;
+  Deadline = xTaskGetTickCount() + pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MSEC);
+
+  while(1)
+  {
+    uint32_t Notify_u32 = 0;
+    TickType_t Wait = pdMS_TO_TICKS(WIFI_LINK_CHECK_MSEC);
+
+    if(State_u8 != WIFI_STATE_CONNECTED)
+    {
+      TickType_t Now = xTaskGetTickCount();
+      Wait = ((int32_t)(Deadline - Now) > 0) ? (Deadline - Now) : 0;
+    }
+
+    xTaskNotifyWait(0, UINT32_MAX, &Notify_u32, Wait);
+
+    bool Expired_b = (State_u8 != WIFI_STATE_CONNECTED) && ((int32_t)(Deadline - xTaskGetTickCount()) <= 0);
+    bool GotIp_b = (Notify_u32 & WIFI_NOTIFY_GOT_IP) != 0;
+    bool Lost_b = (Notify_u32 & WIFI_NOTIFY_DISCONNECTED) != 0;
+
+    //both events in one wait: order unknown, the driver has the current state
+    if(GotIp_b && Lost_b)
+    {
+      GotIp_b = WiFi.isConnected();
+      Lost_b = !GotIp_b;
+    }
+
+    if(GotIp_b)
+    {
+      State_u8 = WIFI_STATE_CONNECTED;
+      ConnectCount_u32++;
+
+      if(FirstConnectUs_u32 == 0)
+      {
+        FirstConnectUs_u32 = (uint32_t)esp_timer_get_time();
+      }
+      Failures_u8 = 0;
+      BackoffMsec_u32 = WIFI_BACKOFF_MIN_MSEC;
+
+      Serial.print("WiFi: connected, IP Address: ");
+      Serial.println(WiFi.localIP());
+
+      if(ApActive_b)
+      {
+        WiFi.softAPdisconnect(false);
+        WiFi.mode(WIFI_STA);
+        ApActive_b = false;
+        Serial.print("WiFi: fallback access point closed\n");
+      }
+      continue;
+    }
+
+    switch(State_u8)
+    {
+      case WIFI_STATE_CONNECTED:
+        //connection dropped (event or link check): retry soon
+        if(Lost_b || !WiFi.isConnected())
+        {
+          Serial.print("WiFi: connection lost\n");
+          State_u8 = WIFI_STATE_BACKOFF;
+          Deadline = xTaskGetTickCount() + pdMS_TO_TICKS(WIFI_BACKOFF_MIN_MSEC);
+        }
+        break;
+
+      case WIFI_STATE_CONNECTING:
+        //attempt failed or timed out
+        if(Expired_b || Lost_b)
+        {
+          uint32_t WaitMsec_u32 = BackoffMsec_u32 + (esp_random() % 1000);
+
+          Failures_u8 = min(Failures_u8 + 1, 255);
+          BackoffMsec_u32 = min<uint32_t>(BackoffMsec_u32 * 2, WIFI_BACKOFF_MAX_MSEC);
+
+          WiFi.disconnect();
+
+          State_u8 = WIFI_STATE_BACKOFF;
+          Deadline = xTaskGetTickCount() + pdMS_TO_TICKS(WaitMsec_u32);
+
+          Serial.printf("WiFi: connection failed (%u), retry in %u s\n", Failures_u8, WaitMsec_u32 / 1000);
+
+          //local access for setup / control while the router is unreachable
+          if((ApSsid_pc != NULL) && !ApActive_b && (Failures_u8 >= WIFI_AP_FALLBACK_FAILURES))
+          {
+            WiFi.mode(WIFI_AP_STA);
+            WiFi.softAP(ApSsid_pc, ApPassword_pc);
+            ApActive_b = true;
+
+            Serial.print("WiFi: fallback access point ");
+            Serial.print(ApSsid_pc);
+            Serial.print(" at ");
+            Serial.println(WiFi.softAPIP());
+          }
+        }
+        break;
+
+      case WIFI_STATE_BACKOFF:
+        //backoff time over (disconnect events of the failed attempt are ignored)
+        if(Expired_b)
+        {
+          WiFi.begin(Ssid_pc, Password_pc);
+          State_u8 = WIFI_STATE_CONNECTING;
+          Deadline = xTaskGetTickCount() + pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MSEC);
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// state for other tasks
+//------------------------------
+bool Wifi_Connected_b(void)
+{
+  return State_u8 == WIFI_STATE_CONNECTED;
+}
+
+uint8_t Wifi_State_u8(void)
+{
+  return State_u8;
+}
+
+uint32_t Wifi_ConnectCount_u32(void)
+{
+  return ConnectCount_u32;
+}
+
+uint32_t Wifi_FirstConnectUs_u32(void)
+{
+  return FirstConnectUs_u32;
+}
+
+bool Wifi_ApActive_b(void)
+{
+  return ApActive_b;
+}
+//------------------------------
@@ -28,6 +28,7 @@
 //  * DS18B20 temperature sensor
 //      init                                  OK
 //      read temperature                      OK
+//      several probes by ROM code            OK
 //  * dim up / down using tasks               OK
 //  * light control task with state machine   OK
 //------------------------------
@@ -57,14 +58,38 @@
 #define USE_NTP   //use NTP client for time keeping
 
 #ifdef USE_NTP
-  #include <NTPClient.h>
-  #include <WiFiUdp.h>
+  #include "NtpClock.h"
 #endif
 
-#include <OneWire.h>
-#include <DallasTemperature.h>
-
 #include "SunriseSunset.h"
+#include "LightZones.h"
+#include "ScheduleRules.h"
+#include "DeviceConfig.h"
+#include "PageTemplate.h"
+#include "PageCache.h"
+#include "Telemetry.h"
+#include "Journal.h"
+#include "WifiManager.h"
+#include "BootGraph.h"
+#include "TextFormat.h"
+#include "TaskBudget.h"
+#include "Supervisor.h"
+#include "MqttBridge.h"
+#include "TempSensors.h"
+#include "I2cBus.h"
+#include "Trace.h"
+#include "FleetSync.h"
+#include "SchedulePreview.h"
+#include "Photoperiod.h"
+#include "EnergyMeter.h"
+
+#define USE_PWM_DITHER    //sigma-delta dithering of the lowest PWM codes (smooth dawn / dusk)
+
+//#define USE_POWER_SAVE    //light sleep between schedule events (battery / solar powered coops), env nodemcu-32s-powersave
+
+#ifdef USE_POWER_SAVE
+  #include "PowerSave.h"
+#endif
 //------------------------------
 
 //constants
@@ -85,9 +110,14 @@ const uint8_t VER_MINOR_U8 = 1;
 //PWM
 #define PWM_OUT 16
 const uint16_t PwmFreqHz_u16 = 5000;
-const uint8_t PwmChannel_u8 = 0;
 const uint8_t PwmResolutionBit_u8 = 13;
 
+//light zones (max. 8, LEDC channel = zone id)
+const uint8_t LightZonePin_au8 [] =      {PWM_OUT};                  //zone 0: roost
+const uint8_t LightZoneSchedule_au8 [] = {ZONE_SCHEDULE_AUTO};
+//const uint8_t LightZonePin_au8 [] =      {PWM_OUT, 17, 18};        //roost, nest boxes, run
+//const uint8_t LightZoneSchedule_au8 [] = {ZONE_SCHEDULE_AUTO, ZONE_SCHEDULE_AUTO, ZONE_SCHEDULE_MANUAL};
+
 //switch light on
 #define SWITCH1 27
 
@@ -105,6 +135,9 @@ const uint8_t PwmResolutionBit_u8 = 13;
 #define I2C_SCL     23
 #define I2C_SDA     22
 
+//DS3231 INT/SQW (open drain, alarm output -> wake source in power save mode)
+#define RTC_INT     25
+
 //RTC-EEPROM
 #define DS3231_EEPROM_ADDRESS 0x57
 
@@ -119,6 +152,27 @@ String hostname = "chickenlight";
 const char* PARAM_INPUT_1 = "InputDateTime";
 const char* PARAM_INPUT_2 = "InputThresholdDark";
 const char* PARAM_INPUT_3 = "InputThresholdBright";
+const char* PARAM_ZONE_ID = "id";
+const char* PARAM_ZONE_LEVEL = "level";
+const char* PARAM_ZONE_RAMP = "ramp";
+const char* PARAM_RULE_ANCHOR = "anchor";
+const char* PARAM_RULE_TIME = "time";
+const char* PARAM_RULE_OFFSET = "offset";
+const char* PARAM_RULE_DAYS = "days";
+const char* PARAM_RULE_ZONES = "zones";
+const char* PARAM_RULE_FROM = "from";
+const char* PARAM_RULE_TO = "to";
+const char* PARAM_RULE_OVERRIDE = "override";
+const char* PARAM_RULE_INDEX = "index";
+const char* PARAM_SCHEDULE_MODE = "mode";
+const char* PARAM_PREVIEW_YEAR = "year";
+const char* PARAM_PREVIEW_FORMAT = "format";
+const char* PARAM_HISTORY_SERIES = "series";
+const char* PARAM_HISTORY_FROM = "from";
+const char* PARAM_HISTORY_TO = "to";
+const char* PARAM_HISTORY_STEP = "step";
+const char* PARAM_JOURNAL_FROM = "from";
+const char* PARAM_JOURNAL_TO = "to";
 
 //light control states
 #define STATE_IDLE 0
@@ -128,6 +182,42 @@ const char* PARAM_INPUT_3 = "InputThresholdBright";
 #define STATE_DIM_DOWN 4
 #define STATE_STOP 5
 
+//init stages (index = bit in dependency mask, order of BootStage_ast)
+#define BOOT_STAGE_PWM 0
+#define BOOT_STAGE_RTC 1
+#define BOOT_STAGE_WIFI 2
+#define BOOT_STAGE_SPIFFS 3
+#define BOOT_STAGE_SENSOR 4
+#define BOOT_STAGE_POWER 5
+#define BOOT_STAGE_JOURNAL 6
+#define BOOT_STAGE_CONFIG 7
+#define BOOT_STAGE_CONTROL 8
+#define BOOT_STAGE_PAGE 9
+#define BOOT_STAGE_TELEMETRY 10
+#define BOOT_STAGE_ENERGY 11
+
+//status JSON (/api/status)
+#define STATUS_JSON_LEN_MAX 384
+
+//light level request (PUT /api/light)
+#define LIGHT_REQUEST_LEN_MAX 128
+#define LIGHT_RAMP_MSEC_MAX 86400000UL    //24 h
+
+//supervisor deadlines (heartbeat at least every ...)
+#define SUPERVISOR_DEADLINE_MAIN_MSEC 30000       //NTP update may block for a few seconds
+#define SUPERVISOR_DEADLINE_CONTROL_MSEC 30000
+#define SUPERVISOR_DEADLINE_ZONES_MSEC 5000
+
+//supervisor fallback when a task does not recover: light off
+//(a dark coop at the wrong time is safer than light all night)
+#define SAFE_LIGHT_PERCENT 0
+
+//hold time loops end by the uptime clock at the latest (RTC stuck or garbage)
+#define HOLD_TIMEOUT_MARGIN_SEC 300
+
+//light state kept in RTC memory over warm resets
+#define RETAIN_MAGIC 0x4C494748
+
 
 
 
@@ -148,7 +238,7 @@ const char* PARAM_INPUT_3 = "InputThresholdBright";
 AsyncWebServer server(80);
 
 //WiFi
-bool WifiConnected_b = false;
+bool WifiConnected_b = false;                //access point mode: set in setup, client mode: see WifiManager
 #ifdef STATIC_IP
   IPAddress local_IP(192, 168, 178, 199);   //static IP
   IPAddress gateway(192, 168, 178, 1);      // gateway IP
@@ -160,14 +250,8 @@ bool WifiConnected_b = false;
 RTC_DS3231 rtc;     //examples: https://wolles-elektronikkiste.de/ds3231-echtzeituhr
 
 //NTP
-#ifdef USE_NTP
-  WiFiUDP ntpUDP;
-  NTPClient timeClient(ntpUDP);
-#endif
-
-//DS18B20 temperature sensor
-OneWire oneWire(DS18B20_DATA);
-DallasTemperature DS18B20(&oneWire);
+#define NTP_SYNC_INTERVAL_MIN 15        //multi-sample sync, the DS3231 drifts < 0.2 s per day
+#define NTP_UTC_OFFSET_SEC 3600         //RTC runs on CET
 
 
 tm DateTime_st;
@@ -175,57 +259,164 @@ tm Sunrise_st;
 tm Sunset_st;
 
 
-uint16_t UpdateNtpCounter_u16 = 0;
-String NtpFormattedDate;
+uint32_t LastNtpUpdateMsec_u32 = 0;
+#ifdef TASK_STACK_AUDIT
+  uint32_t LastTaskAuditMsec_u32 = 0;
+#endif
+uint32_t NtpConnectCount_u32 = 0;            //WiFi connect count of last NTP sync
 
 uint8_t CalendarWeekNumber_u8 = 0;
 
 uint8_t DutyCyclePercent_u8 = 0;
 
-uint8_t ThresholdDarkPercent_u8 = 0;
-uint8_t ThresholdBrightPercent_u8 = 100;
 
-uint8_t StartDutyCyclePercent_u8 = 0;
-uint8_t StopDutyCycle_u8 = 0;
 uint16_t RampUpTimeSec_u16 = 0;
-uint16_t RampDownTimeSec_u16 = 0;
 
 bool LightOn_b = false;
 
-bool DimTaskRunning_b = false;
-
 bool LightControlRunning_b = false;
 uint8_t LightControlState_u8 = STATE_IDLE;
 
 uint8_t DimTimeMinFromTable_u8 = 0;
 uint8_t HoldTimeMinFromTable_u8 = 0;
 
-TaskHandle_t LightControl_taskHandle;
-TaskHandle_t DimUp_taskHandle;
-TaskHandle_t DimDown_taskHandle;
+PhotoperiodDay_t Photoperiod_st;    //table mode: light windows of today
+
+uint8_t NextTimelineEvent_u8 = 0;   //rule mode: first timeline event not executed yet
+
+float PageTemperature_f32 = NAN;    //last sensor value shown on the pages (updated by telemetry)
+uint32_t PageMinute_u32 = 0;        //minute shown on the pages
+
+TaskHandle_t LightControl_taskHandle = NULL;
+
+uint8_t SupervisorMain_u8 = SUPERVISOR_NONE;       //supervisor slots
+uint8_t SupervisorControl_u8 = SUPERVISOR_NONE;
+uint8_t SupervisorZones_u8 = SUPERVISOR_NONE;
+
+//MQTT: single values below <hostname>/ (status JSON is published as a whole)
+const MqttValue_t MqttValue_ast [] =
+{
+  {"state",       PAGE_VAR_STATE},
+  {"dutycycle",   PAGE_VAR_LIGHT_DUTYCYCLE},
+  {"temperature", PAGE_VAR_TEMP},
+};
+
+//light state for restart after brownout / watchdog (not initialised on reset)
+typedef struct
+{
+  uint32_t Magic_u32;
+  uint16_t Level_au16 [ZONE_COUNT_MAX];
+  bool LightOn_b;
+  bool LightControlRunning_b;
+  uint8_t Check_u8;                 //XOR of all bytes before ^ 0xA5
+} RetainedState_t;
+
+RTC_NOINIT_ATTR RetainedState_t Retained_st;
+portMUX_TYPE RetainMux = portMUX_INITIALIZER_UNLOCKED;
 //------------------------------
 
 //function prototypes
 //------------------------------
 void main_task(void * pvParameters);
-void DimUp_task(void * pvParameters);
-void DimDown_task(void * pvParameters);
 void LightControl_task(void * pvParameters) ;
 
-String processor(const String& var);
+size_t PageVar_u32(uint8_t Var_u8, char *Buf_pc, size_t Size_u32);
+void SendIndexPage_v(AsyncWebServerRequest *request);
+void SendStatusJson_v(AsyncWebServerRequest *request);
+size_t RenderStatusJson_u32(char *Buf_pc, size_t Size_u32);
+void UpdatePageClock_v(void);
 
 DateTime GetDateTime_v(void);
-void SetDateTime_v(String DateTimeString);
+bool SetDateTime_v(const char *DateTime_pc, uint8_t Source_u8);
+void AdjustRtc_v(const DateTime &NewTime, uint8_t Source_u8);
+uint32_t GetUnixTime_u32(void);
 void GetSunriseTime_v(void);
 void GetSunsetTime_v(void);
+bool UpdatePhotoperiod_b(void);
 
-float GetTemperature_f32(void);
+void ReadTelemetrySample_v(TelemetrySample_t *Sample_pst);
 
 uint8_t CalcCalendarWeek_u8(uint16_t YYYY_u16, uint16_t MM_u16, uint16_t DD_u16);
 
+uint32_t GetDateKey_u32(void);
+void RunRuleSchedule_v(void);
+bool ParseRule_b(AsyncWebServerRequest *request, ScheduleRule_t *Rule_pst);
+void SendRulesJson_v(AsyncWebServerRequest *request);
+void SendTimelineJson_v(AsyncWebServerRequest *request);
+void SendSchedulePreview_v(AsyncWebServerRequest *request);
+void SendConfigJson_v(AsyncWebServerRequest *request, int Code_s32);
+
+#ifdef USE_POWER_SAVE
+  void UpdateDailyPlan_v(bool Force_b);
+#endif
+
 void SetPwmDutycycle(void);
-void DimUp_v(void);
-void DimDown_v(void);
+void DimLight_v(uint8_t ZoneMask_u8, uint8_t StartPercent_u8, uint8_t StopPercent_u8, uint16_t RampTimeSec_u16);
+void StartSunriseProgram_v(uint8_t ZoneMask_u8, uint16_t DimSec_u16, uint32_t HoldSec_u32);
+void StartSunsetProgram_v(uint8_t ZoneMask_u8, uint32_t HoldSec_u32, uint16_t DimSec_u16);
+void LightOutputChanged_v(uint8_t Zone_u8, uint16_t Level_u16);
+void FleetPlan_v(const LightKeyframe_t *Keyframe_past, uint8_t Count_u8, uint32_t OffsetMsec_u32);
+void FleetSetTime_v(uint32_t Unix_u32);
+void NtpResult_v(bool Ok_b, int64_t UnixUsec_s64);
+
+void SendZoneJson_v(AsyncWebServerRequest *request, int8_t Zone_s8);
+void SendBootJson_v(AsyncWebServerRequest *request);
+
+void SupervisorRecover_v(uint8_t Slot_u8, uint8_t Level_u8);
+
+void CommandLightOn_v(uint8_t Source_u8);
+void CommandLightOff_v(uint8_t Source_u8);
+void CommandControlOn_v(uint8_t Source_u8);
+void CommandControlOff_v(uint8_t Source_u8);
+void CommandZone_v(uint8_t Zone_u8, uint8_t Percent_u8, uint16_t RampSec_u16, uint8_t Source_u8);
+void CommandLightLevel_v(uint8_t ZoneMask_u8, uint8_t Percent_u8, uint32_t RampMsec_u32, uint8_t Ease_u8, uint8_t Source_u8);
+void SendLightLevel_v(AsyncWebServerRequest *request);
+bool CommandScheduleMode_b(const char *Mode_pc, uint8_t Source_u8);
+bool MqttCommand_b(const char *Command_pc, const char *Payload_pc);
+
+void RetainState_v(void);
+bool RestoreRetainedState_b(void);
+uint8_t RetainCheck_u8(const RetainedState_t *State_pst);
+
+bool BootPwm_b(void);
+bool BootRtc_b(void);
+bool BootWifi_b(void);
+bool BootSpiffs_b(void);
+bool BootSensor_b(void);
+bool BootPowerSave_b(void);
+bool BootJournal_b(void);
+bool BootConfig_b(void);
+bool BootControl_b(void);
+bool BootPage_b(void);
+bool BootTelemetry_b(void);
+bool BootEnergy_b(void);
+//------------------------------
+
+//init graph: light output first, network and flash in parallel
+//------------------------------
+const BootStage_t BootStage_ast [] =
+{
+  {"pwm",       0,                                BootPwm_b},
+  {"rtc",       0,                                BootRtc_b},
+  {"wifi",      0,                                BootWifi_b},
+  {"spiffs",    0,                                BootSpiffs_b},
+  {"sensor",    0,                                BootSensor_b},
+  {"power",     BOOT_DEPENDS(BOOT_STAGE_PWM) |
+                BOOT_DEPENDS(BOOT_STAGE_RTC) |
+                BOOT_DEPENDS(BOOT_STAGE_WIFI),    BootPowerSave_b},
+  {"journal",   BOOT_DEPENDS(BOOT_STAGE_SPIFFS) |
+                BOOT_DEPENDS(BOOT_STAGE_RTC),     BootJournal_b},
+  {"config",    BOOT_DEPENDS(BOOT_STAGE_SPIFFS),  BootConfig_b},
+  {"control",   BOOT_DEPENDS(BOOT_STAGE_PWM) |
+                BOOT_DEPENDS(BOOT_STAGE_RTC) |
+                BOOT_DEPENDS(BOOT_STAGE_CONFIG),  BootControl_b},
+  {"page",      BOOT_DEPENDS(BOOT_STAGE_SPIFFS),  BootPage_b},
+  {"telemetry", BOOT_DEPENDS(BOOT_STAGE_SPIFFS) |
+                BOOT_DEPENDS(BOOT_STAGE_RTC) |
+                BOOT_DEPENDS(BOOT_STAGE_SENSOR),  BootTelemetry_b},
+  {"energy",    BOOT_DEPENDS(BOOT_STAGE_SPIFFS) |
+                BOOT_DEPENDS(BOOT_STAGE_CONFIG),  BootEnergy_b},
+};
 //------------------------------
 
 
@@ -251,126 +442,56 @@ void setup()
   pinMode(SWITCH1, INPUT_PULLUP);
   //------------------------------
 
-  //PWM
-  //------------------------------
-  ledcSetup(PwmChannel_u8, PwmFreqHz_u16, PwmResolutionBit_u8);   //configure PWM
-  ledcAttachPin(PWM_OUT, PwmChannel_u8);  //attach GPIO pin
-  DutyCyclePercent_u8 = 0;
-  SetPwmDutycycle();
-  //------------------------------
-
-
   Serial.println("---- Starting ESP32 Chicken House Light Control... ----");
 
-
-  //create main task
-  xTaskCreate(main_task, "Main task", 4096*4, NULL, 1, NULL);
-
   //TESTS GO HERE
   /*
 
   */
 
-  //wifi
+  //init stages (run in parallel as far as the dependencies allow)
   //---
-  #ifdef USE_ACCESS_POINT
-    //start in access point mode
-    WiFi.softAPConfig(local_IP, gateway, subnet);
-    WiFi.softAP(ssid,password);
-    Serial.printf("Settiung up WiFi Access Point ");
-    Serial.printf(ssid);
-    Serial.printf("\n");
-    WifiConnected_b = true;
-  #else
-    //start as client
-    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
-    WiFi.setHostname(hostname.c_str());
-
-    WiFi.mode(WIFI_STA);
-
-    #ifdef STATIC_IP
-      WiFi.config(local_IP, gateway, subnet, primaryDNS);
-    #endif
-
-    
-  
-    WiFi.begin(ssid, password);
-    if (WiFi.waitForConnectResult() != WL_CONNECTED) 
-    {
-      Serial.printf("WiFi Connection Failed!\n");
-      return;
-    }
-    else
-    {
-      WifiConnected_b = true;
-    }
-  #endif
-
-  Serial.print("IP Address: ");
-  Serial.println(WiFi.localIP());
-  Serial.print("\n");
+  Boot_Run_v(BootStage_ast, sizeof(BootStage_ast) / sizeof(BootStage_ast [0]));
   //---
 
-  //I2C
-  //------------------------------
-  Wire.begin(I2C_SDA, I2C_SCL);   //I2C bus master
-  Wire.setClock(100000);           //clock freq 100kHz
-  //------------------------------
-
-
-  //temperature sensor dummy read
-  //------------------------------
-  //float dummy_f32 = GetTemperature_f32();
-  //------------------------------
+  //create main task
+  SupervisorMain_u8 = Supervisor_Register_u8("main", SUPERVISOR_DEADLINE_MAIN_MSEC, SupervisorRecover_v);
+  Task_Start_h(TASK_ID_MAIN, main_task, NULL);
 
+  //heartbeats of main, light control and zone engine
+  Supervisor_Start_v();
 
-  //RTC
-  //---
-  if (!rtc.begin()) 
-  {
-    Serial.println("couldn't find RTC!\n");
-  }
-  
-  if (rtc.lostPower()) 
+  //MQTT bridge (idle until a broker is configured)
+  MqttBridge_t MqttBridge_st =
   {
-    Serial.println("RTC lost power, using default time");
+    hostname.c_str(), RenderStatusJson_u32, PageVar_u32,
+    MqttValue_ast, sizeof(MqttValue_ast) / sizeof(MqttValue_ast [0]), MqttCommand_b
+  };
 
-    rtc.adjust(DateTime(2022, 1, 1, 0, 0, 0));  //set RTC to YYYY, M, D, H, M, S
-  }
-  //---
-
-  //NTP
-  //---
-  #ifdef USE_NTP
-    // Initialize a NTPClient to get time
-    timeClient.begin();
-    timeClient.setTimeOffset(3600);
+  Journal_SetHook_v(Mqtt_Event_v);
+  Mqtt_Start_v(&MqttBridge_st);
 
-    if(!timeClient.update()) 
-        {
-          timeClient.forceUpdate();
-        }
+  //fleet leader / follower (idle while the role is off)
+  FleetHooks_t FleetHooks_st = {(uint32_t)ESP.getEfuseMac(), GetUnixTime_u32, FleetSetTime_v, FleetPlan_v};
 
-        // The formattedDate comes with the following format:
-        // 2018-05-28T16:00:13Z
-        NtpFormattedDate = timeClient.getFormattedDate();
+  Fleet_Start_v(&FleetHooks_st);
 
-        Serial.println("NTP date is: ");
-        Serial.println(NtpFormattedDate);
+  #ifdef USE_NTP
+    //first sync is requested by main task once WiFi is up, RTC time is used until then
+    #ifdef USE_POWER_SAVE
+      NtpHooks_t NtpHooks_st = {PowerSave_SetRadioActive_v, NtpResult_v};
+    #else
+      NtpHooks_t NtpHooks_st = {NULL, NtpResult_v};
+    #endif
 
-        //set date and time of RTC
-      SetDateTime_v(NtpFormattedDate);
+    Ntp_Start_v(&NtpHooks_st);
   #endif
 
-  //SPIFFS
-  //---
-  // Initialize SPIFFS
-  if(!SPIFFS.begin(true))
+  //no web server without file system
+  if(!Boot_StageOk_b(BOOT_STAGE_SPIFFS))
   {
-    Serial.println("An Error has occurred while mounting SPIFFS");
     return;
   }
-  //---
 
 
   //web server
@@ -378,7 +499,7 @@ void setup()
   // Route for root / web page --> resides in filesystem
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-                request->send(SPIFFS, "/index.html", String(), false, processor);
+                SendIndexPage_v(request);
               }
             );
 
@@ -393,62 +514,16 @@ void setup()
   // Route for button Light On
   server.on("/LightOn", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-                //DutyCyclePercent_u8 = 100;
-                //SetPwmDutycycle();
-
-                //Serial.print("Set DutyCycle: ");
-                //Serial.print(DutyCyclePercent_u8);
-                //Serial.print("%\n");
-
-                
-                
-
-                if(DimTaskRunning_b == false) 
-                {
-                  digitalWrite(LED_INTERN, HIGH);
-                  //LightOn_b = true;
-
-                  StartDutyCyclePercent_u8 = 0;
-                  StopDutyCycle_u8 = 100;
-                  RampUpTimeSec_u16 = 2;
-                  RampDownTimeSec_u16 = 0;
-
-                  //create dim task
-                  xTaskCreate(DimUp_task, "DimUp task", 1024, NULL, 1, &DimUp_taskHandle);
-                }
-
-
-                request->send(SPIFFS, "/index.html", String(), false, processor);
+                CommandLightOn_v(JOURNAL_SRC_WEB);
+                SendIndexPage_v(request);
               }
             );
 
   // Route for button LightOff
   server.on("/LightOff", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-                //DutyCyclePercent_u8 = 0;
-                //SetPwmDutycycle();
-
-                //Serial.print("Set DutyCycle: ");
-                //Serial.print(DutyCyclePercent_u8);
-                //Serial.print("%\n");
-
-                //LightOn_b = false;
-
-                if(DimTaskRunning_b == false) 
-                {
-                  digitalWrite(LED_INTERN, LOW);
-                  //LightOn_b = false;
-
-                  StartDutyCyclePercent_u8 = 100;
-                  StopDutyCycle_u8 = 0;
-                  RampUpTimeSec_u16 = 0;
-                  RampDownTimeSec_u16 = 2;
-
-                  //create dim task
-                  xTaskCreate(DimDown_task, "DimDown task", 1024, NULL, 1, &DimDown_taskHandle);
-                }
-
-                request->send(SPIFFS, "/index.html", String(), false, processor);
+                CommandLightOff_v(JOURNAL_SRC_WEB);
+                SendIndexPage_v(request);
               }
             );
 
@@ -456,40 +531,8 @@ void setup()
   // Route for button LightControlOn
   server.on("/LightControlOn", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-                if(LightControlRunning_b == false)
-                {
-                
-                  LightControlRunning_b = true;
-
-                  Serial.print("Light Control Enabled\n");
-
-                  LightControlState_u8 = STATE_IDLE;
-
-                  //create light control task
-                  xTaskCreate(LightControl_task, "Light Control Task", 4096*4, NULL, 1, &LightControl_taskHandle);
-
-                }
-
-                //just for TESTING
-                //---------
-                if(0)
-                {
-                  Serial.print("dimming up...\n");
-                
-                  request->send(SPIFFS, "/index.html", String(), false, processor);
-                  
-                  StartDutyCyclePercent_u8 = 0;
-                  StopDutyCycle_u8 = 100;
-                  RampUpTimeSec_u16 = 10;
-                  RampDownTimeSec_u16 = 0;
-
-                  //create dim task
-                  xTaskCreate(DimUp_task, "DimUp task", 1024, NULL, 1, NULL);
-                }
-                //---------
-
-                 request->send(SPIFFS, "/index.html", String(), false, processor);
-                
+                CommandControlOn_v(JOURNAL_SRC_WEB);
+                SendIndexPage_v(request);
               }
             );
 
@@ -497,63 +540,8 @@ void setup()
   // Route for button LightControlOff
   server.on("/LightControlOff", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-                Serial.print("Light Control Disabled\n");
-
-                LightControlRunning_b = false;
-
-                LightControlState_u8 = STATE_IDLE;
-                
-                //stopping light control task and switch off light
-                if(LightControl_taskHandle != NULL) 
-                {
-                  Serial.print("Stopping Light Control Task...\n");
-                  vTaskDelete(LightControl_taskHandle);
-                }
-                else
-                {
-                  Serial.print("Light Control TaskHandle = NULL...\n");
-                }
-
-
-                if(DimUp_taskHandle!= NULL) 
-                {
-                  Serial.print("Stopping Dim Task...\n");
-                  vTaskDelete(DimUp_taskHandle);
-                }
-
-                if(DimDown_taskHandle!= NULL) 
-                {
-                  Serial.print("Stopping Dim Task...\n");
-                  vTaskDelete(DimDown_taskHandle);
-                }
-
-
-                DutyCyclePercent_u8 = 0;
-                SetPwmDutycycle();
-
-                digitalWrite(LED_INTERN, LOW);
-                
-                
-
-                //just for TESTING
-                //---------
-                if(0)
-                {
-                  Serial.print("dimming down...\n");
-                
-                  request->send(SPIFFS, "/index.html", String(), false, processor);
-                  
-                  StartDutyCyclePercent_u8 = 100;
-                  StopDutyCycle_u8 = 0;
-                  RampUpTimeSec_u16 = 0;
-                  RampDownTimeSec_u16 = 10;
-
-                  //create dim task
-                  xTaskCreate(DimDown_task, "DimDown task", 1024, NULL, 1, NULL);
-                }
-                //---------
-
-                request->send(SPIFFS, "/index.html", String(), false, processor);
+                CommandControlOff_v(JOURNAL_SRC_WEB);
+                SendIndexPage_v(request);
               }
             );
 
@@ -639,1024 +627,2630 @@ void setup()
   //----
 
 
-  // Send a GET request to 
-  server.on("/get", HTTP_GET, [] (AsyncWebServerRequest *request) 
+  // Route for zone list: /api/zones
+  server.on("/api/zones", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-                String inputMessage;
-                String inputParam;
-                // GET InputDateTime value
-                if (request->hasParam(PARAM_INPUT_1)) 
-                {
-                  inputMessage = request->getParam(PARAM_INPUT_1)->value();
-                  inputParam = PARAM_INPUT_1;
+                SendZoneJson_v(request, -1);
+              }
+            );
 
-                  Serial.print("Set DateTime: ");
-                  Serial.print("\n");
-                  Serial.println(inputMessage);
-                  Serial.print("\n");
-                  SetDateTime_v(inputMessage);
-                }
-                // GET InputThresholdDark value
-                else if (request->hasParam(PARAM_INPUT_2)) 
+  // Route for single zone: /api/zone?id=<zone>[&level=<percent>[&ramp=<sec>]]
+  server.on("/api/zone", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                if(!request->hasParam(PARAM_ZONE_ID))
                 {
-                  inputMessage = request->getParam(PARAM_INPUT_2)->value();
-                  inputParam = PARAM_INPUT_2;
-                  ThresholdDarkPercent_u8 = inputMessage.toInt();
-
-                  Serial.print("Set ThresholdDarkPercent_u8: ");
-                  Serial.print("\n");
-                  Serial.println(ThresholdDarkPercent_u8);
-                  Serial.print("\n");
+                  request->send(400, "text/plain", "missing id");
+                  return;
                 }
-                // GET InputThresholdBright value
-                else if (request->hasParam(PARAM_INPUT_3)) 
-                {
-                  inputMessage = request->getParam(PARAM_INPUT_3)->value();
-                  inputParam = PARAM_INPUT_2;
-                  ThresholdBrightPercent_u8 = inputMessage.toInt();
 
-                  Serial.print("Set ThresholdBrightPercent_u8: ");
-                  Serial.print("\n");
-                  Serial.println(ThresholdBrightPercent_u8);
-                  Serial.print("\n");
-                }
-                else 
+                long Zone_s32 = request->getParam(PARAM_ZONE_ID)->value().toInt();
+
+                if((Zone_s32 < 0) || (Zone_s32 >= LightZone_Count_u8()))
                 {
-                  inputMessage = "No message sent";
-                  inputParam = "none";
+                  request->send(404, "text/plain", "unknown zone");
+                  return;
                 }
-                //Serial.println(inputMessage);
-                //request->send(200, "text/html", "HTTP GET request sent to your ESP on input field (" 
-                //                     + inputParam + ") with value: " + inputMessage +
-                //                     "<br><a href=\"/\">Return to Home Page</a>");
-                request->send(200, "text/html", "<h1>Wert wurde gesendet.<br><a href=\"/\">Zurueck zur Hauptseite</a></h1>");
-                });
 
-  
-
-  server.begin();
-  //---
-}
-//------------------------------
+                if(request->hasParam(PARAM_ZONE_LEVEL))
+                {
+                  long Percent_s32 = constrain(request->getParam(PARAM_ZONE_LEVEL)->value().toInt(), 0L, 100L);
+                  long RampSec_s32 = 0;
 
+                  if(request->hasParam(PARAM_ZONE_RAMP))
+                  {
+                    RampSec_s32 = constrain(request->getParam(PARAM_ZONE_RAMP)->value().toInt(), 0L, 65535L);
+                  }
 
+                  CommandZone_v(Zone_s32, Percent_s32, RampSec_s32, JOURNAL_SRC_WEB);
+                }
 
-//------------------------------
-//loop()
-//------------------------------
-void loop() 
-{
-  //nothing to do here...
-}
-//------------------------------
+                SendZoneJson_v(request, Zone_s32);
+              }
+            );
 
 
-//------------------------------
-//main loop
-//------------------------------
-void main_task(void * pvParameters) 
-{
+  // Route to fade all zones from their current level: PUT /api/light
+  // {"level":<percent>[,"ramp_ms":<msec>][,"curve":"linear|step|smooth|exp_in|exp_out"][,"zones":<mask>]}
+  // interrupts running ramps, answers right away with the predicted end of the fade
+  server.on("/api/light", HTTP_PUT, [](AsyncWebServerRequest *request)
+              {
+                SendLightLevel_v(request);
+              },
+              NULL,
+              [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+              {
+                //body is collected in _tempObject (freed by the server with the request)
+                if((index == 0) && (total <= LIGHT_REQUEST_LEN_MAX))
+                {
+                  request->_tempObject = calloc(1, LIGHT_REQUEST_LEN_MAX + 1);
+                }
 
-  while (1) 
-  {
+                if((request->_tempObject != NULL) && (index + len <= LIGHT_REQUEST_LEN_MAX))
+                {
+                  memcpy((char *)request->_tempObject + index, data, len);
+                }
+              }
+            );
 
-    digitalWrite(LED_GREEN, HIGH);
 
-    // Idle for xx msec
-    if(WifiConnected_b == true)
-    {
-      vTaskDelay(pdMS_TO_TICKS(2));
+  // Route for rule list: /api/rules
+  server.on("/api/rules", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                SendRulesJson_v(request);
+              }
+            );
 
-      digitalWrite(LED_GREEN, LOW);
+  // Route to add rule: /api/rules/add?anchor=time|sunrise|sunset&time=HH:MM|offset=<min>&level=<percent>
+  //                    [&ramp=<min>][&days=daily|weekdays|weekend|<mask>][&zones=<mask>][&from=MMDD&to=MMDD][&override=1]
+  server.on("/api/rules/add", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                ScheduleRule_t Rule_st;
 
-      vTaskDelay(pdMS_TO_TICKS(198));
-    }
-    else
-    {
-      vTaskDelay(pdMS_TO_TICKS(200));
-    }
+                if(!ParseRule_b(request, &Rule_st))
+                {
+                  request->send(400, "text/plain", "invalid rule");
+                  return;
+                }
 
-    //switch light manually on/off using hardware switch SWITCH1
-    //------
-    if((digitalRead(SWITCH1) == 0) && (LightOn_b == false) && (DimTaskRunning_b == false)) 
-    {
-      //switch light on
-      Serial.print("HW switch dimming up...\n");
-      
-      LightOn_b = true;
-      digitalWrite(LED_INTERN, HIGH);
+                if(!Schedule_AddRule_b(&Rule_st))
+                {
+                  request->send(507, "text/plain", "too many rules");
+                  return;
+                }
 
-      //create dim task
-      StartDutyCyclePercent_u8 = 0;
-      StopDutyCycle_u8 = 100;
-      RampUpTimeSec_u16 = 2;
-      RampDownTimeSec_u16 = 0;
-      xTaskCreate(DimUp_task, "DimUp task", 1024, NULL, 1, &DimUp_taskHandle);
-    }
+                Journal_Log_v(JOURNAL_EVENT_COMMAND, JOURNAL_SRC_WEB, JOURNAL_CMD_RULES, 0);
+                Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_RULES, JOURNAL_SRC_WEB, 0, 0, 0);
 
-    else if((digitalRead(SWITCH1) == 1) && (LightOn_b == true) && (DimTaskRunning_b == false)) 
-    {
-      //switch light off
-      Serial.print("HW switch dimming down...\n");
-              
-      LightOn_b = false;
-      digitalWrite(LED_INTERN, LOW);
+                SendRulesJson_v(request);
+              }
+            );
 
-      //create dim task
-      StartDutyCyclePercent_u8 = 100;
-      StopDutyCycle_u8 = 0;
-      RampUpTimeSec_u16 = 0;
-      RampDownTimeSec_u16 = 2;
-      xTaskCreate(DimDown_task, "DimDown task", 1024, NULL, 1, &DimDown_taskHandle);
-    }
-    //------
+  // Route to delete rule: /api/rules/delete?index=<n>
+  server.on("/api/rules/delete", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                if(!request->hasParam(PARAM_RULE_INDEX) || !Schedule_DeleteRule_b(request->getParam(PARAM_RULE_INDEX)->value().toInt()))
+                {
+                  request->send(404, "text/plain", "unknown rule");
+                  return;
+                }
 
+                Journal_Log_v(JOURNAL_EVENT_COMMAND, JOURNAL_SRC_WEB, JOURNAL_CMD_RULES, 0);
+                Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_RULES, JOURNAL_SRC_WEB, 0, 0, 0);
 
-    #ifdef USE_NTP
-      //update NTP client every 60sec (300 * 200msec)
-      
+                SendRulesJson_v(request);
+              }
+            );
 
-      if(UpdateNtpCounter_u16 > 300)
-      {
-        UpdateNtpCounter_u16 = 0;
+  // Route to delete all rules
+  server.on("/api/rules/clear", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                Schedule_ClearRules_v();
+                Journal_Log_v(JOURNAL_EVENT_COMMAND, JOURNAL_SRC_WEB, JOURNAL_CMD_RULES, 0);
+                Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_RULES, JOURNAL_SRC_WEB, 0, 0, 0);
+                SendRulesJson_v(request);
+              }
+            );
 
-        Serial.print("updating NTP client now...\n");
+  // Route for compiled timeline of today
+  server.on("/api/timeline", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                SendTimelineJson_v(request);
+              }
+            );
 
-        if(!timeClient.update()) 
-        {
-          timeClient.forceUpdate();
-        }
+  // Route to select schedule: /api/schedule/mode?mode=table|rules
+  server.on("/api/schedule/mode", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                if(request->hasParam(PARAM_SCHEDULE_MODE))
+                {
+                  if(!CommandScheduleMode_b(request->getParam(PARAM_SCHEDULE_MODE)->value().c_str(), JOURNAL_SRC_WEB))
+                  {
+                    request->send(400, "text/plain", "unknown mode");
+                    return;
+                  }
+                }
 
-        // The formattedDate comes with the following format:
-        // 2018-05-28T16:00:13Z
-        NtpFormattedDate = timeClient.getFormattedDate();
+                request->send(200, "application/json", (ScheduleMode_u8 == SCHEDULE_MODE_RULES) ? "{\"mode\":\"rules\"}" : "{\"mode\":\"table\"}");
+              }
+            );
 
-        Serial.println("NTP date is: ");
-        Serial.println(NtpFormattedDate);
+  // Route for light windows of today (table mode): /api/photoperiod
+  server.on("/api/photoperiod", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                Photoperiod_PrintJson_v(&Photoperiod_st, *response);
+                request->send(response);
+              }
+            );
 
-        //set date and time of RTC
-      SetDateTime_v(NtpFormattedDate);
-      }
+  // Route for energy and on-hours: /api/energy
+  server.on("/api/energy", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                EnergyMeter_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
-      UpdateNtpCounter_u16++;
-    #endif
+  // Route to restart the on-hours after replacing a strip: /api/energy/reset[?id=<zone>] (all zones without id)
+  server.on("/api/energy/reset", HTTP_POST, [](AsyncWebServerRequest *request)
+              {
+                uint8_t ZoneMask_u8 = ZONE_MASK_ALL;
 
+                if(request->hasParam(PARAM_ZONE_ID))
+                {
+                  long Zone_s32 = request->getParam(PARAM_ZONE_ID)->value().toInt();
 
-    
+                  if((Zone_s32 < 0) || (Zone_s32 >= LightZone_Count_u8()))
+                  {
+                    request->send(404, "text/plain", "unknown zone");
+                    return;
+                  }
 
-  }
-}
-//------------------------------
+                  ZoneMask_u8 = 1 << Zone_s32;
+                }
 
+                EnergyMeter_ResetZones_v(ZoneMask_u8);
 
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                EnergyMeter_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
-//------------------------------
-//Light Control Task
-//------------------------------
-void LightControl_task(void * pvParameters) 
-{
+  // Route for schedule preview of a year: /api/schedule/preview[?year=YYYY][&format=json|bin]
+  server.on("/api/schedule/preview", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                SendSchedulePreview_v(request);
+              }
+            );
 
-  uint16_t UpTimeSec_u16 = 0;      //time spent for dim up 
-  uint16_t DownTimeSec_u16 = 0;    //time spent for dim down
 
-  uint32_t HoldTimeSunriseSeconds_u32 = 0;
-  uint32_t HoldTimeSunsetSeconds_u32 = 0;
+  // Route for history: /api/history?series=temp|duty|light[&from=<unix>][&to=<unix>][&step=<sec>]
+  // default is the last 24 h in the finest available resolution
+  server.on("/api/history", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                uint8_t Series_u8 = 0xFF;
 
-  uint32_t HoldStartTimestamp_u32 = 0;
-  uint32_t ExpiredHoldTimeSeconds_u32 = 0;
+                if(request->hasParam(PARAM_HISTORY_SERIES))
+                {
+                  Series_u8 = Telemetry_SeriesFromName_u8(request->getParam(PARAM_HISTORY_SERIES)->value().c_str());
+                }
 
-  DateTime now;
+                if(Series_u8 == 0xFF)
+                {
+                  request->send(400, "text/plain", "unknown series");
+                  return;
+                }
 
-  Serial.print("Light Control Task Running...");
+                uint32_t To_u32 = request->hasParam(PARAM_HISTORY_TO) ? strtoul(request->getParam(PARAM_HISTORY_TO)->value().c_str(), NULL, 10) : Telemetry_LastTime_u32();
+                uint32_t From_u32 = request->hasParam(PARAM_HISTORY_FROM) ? strtoul(request->getParam(PARAM_HISTORY_FROM)->value().c_str(), NULL, 10) : To_u32 - 86400UL;
+                uint32_t Step_u32 = request->hasParam(PARAM_HISTORY_STEP) ? strtoul(request->getParam(PARAM_HISTORY_STEP)->value().c_str(), NULL, 10) : 0;
 
+                //query state (block buffer) lives on the heap until the response is sent
+                TelemetryQuery_t *Query_pst = (TelemetryQuery_t *)malloc(sizeof(TelemetryQuery_t));
 
-  while(1)
-  { 
-    
-    //state machine
-    switch(LightControlState_u8)
-    {
-      case STATE_IDLE:
+                if(Query_pst == NULL)
+                {
+                  request->send(503, "text/plain", "out of memory");
+                  return;
+                }
 
-        Serial.print("STATE = IDLE\n");
+                Telemetry_QueryInit_v(Query_pst, Series_u8, From_u32, To_u32, Step_u32);
 
-        digitalWrite(LED_INTERN, LOW);
+                AsyncWebServerResponse *response = request->beginChunkedResponse("application/json", [Query_pst](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                                     {
+                                                       return Telemetry_QueryFill_u32(Query_pst, buffer, maxLen);
+                                                     }
+                                                   );
 
-        //get date and time
-        GetDateTime_v();
+                request->_tempObject = Query_pst;   //freed by the server with the request
+                request->send(response);
+              }
+            );
 
-        //get sunrise and sunset time
-        GetSunriseTime_v();
-        GetSunsetTime_v();
+  // Route for status (values of the web page): /api/status
+  server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                SendStatusJson_v(request);
+              }
+            );
 
-        //Dim time and hold time
-        UpTimeSec_u16 = DimTimeMinFromTable_u8 * 60;
-        DownTimeSec_u16 = DimTimeMinFromTable_u8 * 60;
-        HoldTimeSunriseSeconds_u32 = HoldTimeMinFromTable_u8 * 60;
-        HoldTimeSunsetSeconds_u32 = HoldTimeMinFromTable_u8 * 60;
+  // Route for boot timeline: /api/boot
+  server.on("/api/boot", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                SendBootJson_v(request);
+              }
+            );
 
-        //calculate time for "new" sunrise and sunset
-        if(DimTimeMinFromTable_u8 == 60)
-        {
-          Sunrise_st.tm_hour =- 1;
-          
-        }
+  // Route for task stacks and heap: /api/tasks
+  server.on("/api/tasks", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                Task_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
-        if(DimTimeMinFromTable_u8 == 120)
-        {
-          Sunrise_st.tm_hour =- 2;
-        }
+  // Route for temperature probes: /api/sensors
+  server.on("/api/sensors", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                TempSensor_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
+  // Route for bus search after (un)plugging probes: /api/sensors/rescan (done with the next reading)
+  server.on("/api/sensors/rescan", HTTP_POST, [](AsyncWebServerRequest *request)
+              {
+                TempSensor_RequestRescan_v();
 
-        if(HoldTimeMinFromTable_u8 == 30)
-        {
-          if(Sunrise_st.tm_min >= 30)
-          {
-            Sunrise_st.tm_min =- 30;
-          }
-          else
-          {
-            Sunrise_st.tm_min = 60 - (30-Sunrise_st.tm_min);
-            Sunrise_st.tm_hour =- 1;
-          }
-        }
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                TempSensor_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
-        if(HoldTimeMinFromTable_u8 == 60)
-        {
-          Sunrise_st.tm_hour =- 1;
-        }
+  // Route for I2C bus statistics and DS3231 temperature: /api/i2c
+  server.on("/api/i2c", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                I2cBus_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
-        if(HoldTimeMinFromTable_u8 == 90)
-        {
-          Sunrise_st.tm_hour =- 1;
+  #ifdef USE_NTP
+    // Route for NTP server selection status: /api/ntp
+    server.on("/api/ntp", HTTP_GET, [](AsyncWebServerRequest *request)
+                {
+                  AsyncResponseStream *response = request->beginResponseStream("application/json");
+                  Ntp_PrintJson_v(*response);
+                  request->send(response);
+                }
+              );
+  #endif
 
-          if(Sunrise_st.tm_min >= 30)
-          {
-            Sunrise_st.tm_min =- 30;
-          }
-          else
-          {
-            Sunrise_st.tm_min = 60 - (30-Sunrise_st.tm_min);
-            Sunrise_st.tm_hour =- 1;
-          }
-        }
+  // Route for fleet synchronization status: /api/fleet
+  server.on("/api/fleet", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                Fleet_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
-        
-        //fake sunrise / sunset for DEBUGGING
-        #ifdef DEBUG_SUNRISE
-          Sunrise_st.tm_hour = DateTime_st.tm_hour;
-          Sunrise_st.tm_min = DateTime_st.tm_min;
-          DimTimeMinFromTable_u8 = 60;
-          HoldTimeMinFromTable_u8 = 60;
-          UpTimeSec_u16 = 60 * 60;
-          HoldTimeSunriseSeconds_u32 = 60 * 60;
-        #endif
+  // Route for supervisor status: /api/supervisor
+  server.on("/api/supervisor", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                Supervisor_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
-        //fake sunrise / sunset for DEBUGGING
-        #ifdef DEBUG_SUNSET
-          Sunset_st.tm_hour = DateTime_st.tm_hour;
-          Sunset_st.tm_min = DateTime_st.tm_min;
-          DimTimeMinFromTable_u8 = 60;
-          HoldTimeMinFromTable_u8 = 60;
-          DownTimeSec_u16 = 60 * 60;
-          HoldTimeSunsetSeconds_u32 = 60 * 60;
-        #endif
+  // Route for journal export: /api/journal[?from=<unix>][&to=<unix>]
+  // raw 16 byte records, decode with tools/journal_decode.py
+  server.on("/api/journal", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                uint32_t From_u32 = request->hasParam(PARAM_JOURNAL_FROM) ? strtoul(request->getParam(PARAM_JOURNAL_FROM)->value().c_str(), NULL, 10) : 0;
+                uint32_t To_u32 = request->hasParam(PARAM_JOURNAL_TO) ? strtoul(request->getParam(PARAM_JOURNAL_TO)->value().c_str(), NULL, 10) : UINT32_MAX;
 
-        //if SUNRISE time is reached, start dim up task
-        //only if dim up time or hold time is greater than zero
-        if((DateTime_st.tm_hour == Sunrise_st.tm_hour)
-            && (DateTime_st.tm_min == Sunrise_st.tm_min)
-            && ( (DimTimeMinFromTable_u8 > 0) || (HoldTimeMinFromTable_u8 > 0) ) )
-        {
-          //dim up light
-          Serial.print("sunrise time reached...\n");
+                //export state (read batch) lives on the heap until the response is sent
+                JournalExport_t *Export_pst = (JournalExport_t *)malloc(sizeof(JournalExport_t));
 
-          LightControlState_u8 = STATE_DIM_UP;
+                if(Export_pst == NULL)
+                {
+                  request->send(503, "text/plain", "out of memory");
+                  return;
+                }
 
-          digitalWrite(LED_INTERN, HIGH);
+                Journal_ExportInit_v(Export_pst, From_u32, To_u32);
 
-        }
+                AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream", [Export_pst](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                                     {
+                                                       return Journal_ExportFill_u32(Export_pst, buffer, maxLen);
+                                                     }
+                                                   );
 
+                response->addHeader("Content-Disposition", "attachment; filename=\"journal.bin\"");
+                request->_tempObject = Export_pst;   //freed by the server with the request
+                request->send(response);
+              }
+            );
 
+  // Route for input trace: /api/trace (raw 16 byte records of the last capture, replay with tools/trace_replay)
+  server.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                uint32_t Capture_u32 = Trace_Generation_u32();
 
-        //if SUNSET time is reached, switch on light (100%) and wait hold time
-        //only if dim up time or hold time is greater than zero
-        if((DateTime_st.tm_hour == Sunset_st.tm_hour)
-            && (DateTime_st.tm_min == Sunset_st.tm_min)
-            && ( (DimTimeMinFromTable_u8 > 0) || (HoldTimeMinFromTable_u8 > 0) ) )
-        {
-          //switch on light
-          Serial.print("sunset time reached...\n");
+                AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream", [Capture_u32](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                                     {
+                                                       return Trace_Read_u32(Capture_u32, index, buffer, maxLen);
+                                                     }
+                                                   );
 
-          Serial.print("switch on light...\n");
-          DutyCyclePercent_u8 = 100;
-          SetPwmDutycycle();
-          
-          digitalWrite(LED_INTERN, HIGH);
+                response->addHeader("Content-Disposition", "attachment; filename=\"trace.bin\"");
+                request->send(response);
+              }
+            );
 
-          LightControlState_u8 = STATE_WAITING_HOLD_TIME_SUNSET;
+  // Route for capture state: /api/trace/status
+  server.on("/api/trace/status", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                Trace_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
-        }
+  // Route to start a new capture (discards the last one): /api/trace/start
+  server.on("/api/trace/start", HTTP_POST, [](AsyncWebServerRequest *request)
+              {
+                if(!Trace_Start_b(GetUnixTime_u32(), ScheduleMode_u8))
+                {
+                  request->send(503, "text/plain", "out of memory");
+                  return;
+                }
 
-        break;
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                Trace_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
+  // Route to stop the capture: /api/trace/stop
+  server.on("/api/trace/stop", HTTP_POST, [](AsyncWebServerRequest *request)
+              {
+                Trace_Stop_v();
 
-      case STATE_DIM_UP:
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                Trace_PrintJson_v(*response);
+                request->send(response);
+              }
+            );
 
-          Serial.print("STATE = DIM UP\n");
+  // Route for device configuration
+  server.on("/api/config", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+                SendConfigJson_v(request, 200);
+              }
+            );
 
-          //dim up light
-          Serial.print("dimming up...\n");
-          
-          digitalWrite(LED_INTERN, HIGH);
+  // Route to change any subset of the configuration with one JSON document, e.g.
+  // {"time":"2024-03-01 06:00:00","threshold_dark":10,"threshold_bright":90,"latitude":51.33,"longitude":9.17,
+  //  "manual_ramp_s":5,"schedule_mode":"rules","mqtt_broker":"192.168.178.10","mqtt_port":1883,"mqtt_interval_ms":1000}
+  // nothing is applied unless the whole document is valid
+  server.on("/api/config", HTTP_POST, [](AsyncWebServerRequest *request)
+              {
+                ConfigParser_t *Parser_pst = (ConfigParser_t *)request->_tempObject;
 
-          //create dim task
-          StartDutyCyclePercent_u8 = 0;
-          StopDutyCycle_u8 = 100;
-          RampUpTimeSec_u16 = UpTimeSec_u16;
-          RampDownTimeSec_u16 = 0;
-          xTaskCreate(DimUp_task, "DimUp task", 1024, NULL, 1, &DimUp_taskHandle);
+                if(Parser_pst == NULL)
+                {
+                  request->send(400, "application/json", "{\"error\":\"empty body\"}");
+                  return;
+                }
 
+                if(!Config_ParserFinish_b(Parser_pst) || !Config_Validate_b(Parser_pst))
+                {
+                  AsyncResponseStream *response = request->beginResponseStream("application/json");
+                  response->setCode(400);
+                  response->printf("{\"error\":\"%s\",\"field\":\"%s\"}", Parser_pst->Error_pc, Parser_pst->ErrorField_ac);
+                  request->send(response);
+                  return;
+                }
 
-          LightControlState_u8 = STATE_WAITING_HOLD_TIME_SUNRISE;
+                Config_Apply_v(&Parser_pst->Patch_st);
+                PageCache_Bump_v();
+                Journal_Log_v(JOURNAL_EVENT_COMMAND, JOURNAL_SRC_WEB, JOURNAL_CMD_CONFIG, Parser_pst->Patch_st.Present_u32);
+                Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_CONFIG, JOURNAL_SRC_WEB, 0, Parser_pst->Patch_st.Present_u32, 0);
 
-          break;
+                //light windows are recomputed with the new setting
+                if(Parser_pst->Patch_st.Present_u32 & (CONFIG_FIELD_PHOTOPERIOD | CONFIG_FIELD_PHOTOPERIOD_AM | CONFIG_FIELD_PHOTOPERIOD_DIM))
+                {
+                  Photoperiod_st.DateKey_u32 = 0;
+                }
 
+                if(Parser_pst->Patch_st.Present_u32 & CONFIG_FIELD_STRIP_WATTS)
+                {
+                  EnergyMeter_SetWatts_v(Parser_pst->Patch_st.Config_st.StripWatts_f32);
+                }
 
-        case STATE_DIM_DOWN:
+                if(Parser_pst->Patch_st.Present_u32 & CONFIG_FIELD_TIME)
+                {
+                  const ConfigDateTime_t *DateTime_pst = &Parser_pst->Patch_st.DateTime_st;
+                  AdjustRtc_v(DateTime(DateTime_pst->Year_u16, DateTime_pst->Month_u8, DateTime_pst->Day_u8,
+                                       DateTime_pst->Hour_u8, DateTime_pst->Minute_u8, DateTime_pst->Second_u8), JOURNAL_SRC_WEB);
+                }
 
-          Serial.print("STATE = DIM DOWN\n");
+                SendConfigJson_v(request, 200);
+              },
+              NULL,
+              [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+              {
+                //parser state lives in _tempObject and is freed by the server with the request
+                if(index == 0)
+                {
+                  request->_tempObject = malloc(sizeof(ConfigParser_t));
 
-          //dim down light
-          Serial.print("dimming down...\n");
-          
-          digitalWrite(LED_INTERN, LOW);
+                  if(request->_tempObject != NULL)
+                  {
+                    Config_ParserInit_v((ConfigParser_t *)request->_tempObject);
+                  }
+                }
 
-          //create dim task
-          StartDutyCyclePercent_u8 = 100;
-          StopDutyCycle_u8 = 0;
-          RampUpTimeSec_u16 = 0;
-          RampDownTimeSec_u16 = DownTimeSec_u16;
-          xTaskCreate(DimDown_task, "DimDown task", 1024, NULL, 1, &DimDown_taskHandle);
+                if(request->_tempObject != NULL)
+                {
+                  Config_ParserFeed_v((ConfigParser_t *)request->_tempObject, data, len);
+                }
+              }
+            );
 
 
-          LightControlState_u8 = STATE_IDLE;
+  // Send a GET request to 
+  server.on("/get", HTTP_GET, [] (AsyncWebServerRequest *request) 
+              {
+                //values are read in place (no String copies)
+                const char *inputParam = "none";
+                uint32_t Percent_u32 = 0;
 
-          break;
+                // GET InputDateTime value
+                if (request->hasParam(PARAM_INPUT_1)) 
+                {
+                  const char *inputMessage = request->getParam(PARAM_INPUT_1)->value().c_str();
+                  inputParam = PARAM_INPUT_1;
 
+                  Serial.print("Set DateTime: ");
+                  Serial.print("\n");
+                  Serial.println(inputMessage);
+                  Serial.print("\n");
+                  SetDateTime_v(inputMessage, JOURNAL_SRC_WEB);
+                }
+                // GET InputThresholdDark / InputThresholdBright value
+                else if (request->hasParam(PARAM_INPUT_2) || request->hasParam(PARAM_INPUT_3)) 
+                {
+                  ConfigParser_t Parser_st;
+                  char Json_ac [40];
 
-        case STATE_WAITING_HOLD_TIME_SUNRISE:
+                  inputParam = request->hasParam(PARAM_INPUT_2) ? PARAM_INPUT_2 : PARAM_INPUT_3;
 
-          Serial.print("STATE = WAIT HOLD SUNRISE\n");
+                  if(!Text_ParseUint_b(request->getParam(inputParam)->value().c_str(), NULL, &Percent_u32))
+                  {
+                    request->send(400, "text/html", "<h1>Ungueltiger Wert.<br><a href=\"/\">Zurueck zur Hauptseite</a></h1>");
+                    return;
+                  }
 
-          //wait for hold time to expire
-          Serial.print("entering hold time loop...\n");
+                  //same path as /api/config: range 0...100, dark not above bright
+                  snprintf(Json_ac, sizeof(Json_ac), "{\"%s\":%u}", (inputParam == PARAM_INPUT_2) ? "threshold_dark" : "threshold_bright", Percent_u32);
 
-          //save start timestamp
-          now = GetDateTime_v();
-          HoldStartTimestamp_u32 = now.unixtime();
+                  Config_ParserInit_v(&Parser_st);
+                  Config_ParserFeed_v(&Parser_st, (const uint8_t *)Json_ac, strlen(Json_ac));
 
-          Serial.print("HoldStartTimestamp: ");
-          Serial.print(HoldStartTimestamp_u32);
-          Serial.print("\n");
+                  if(!Config_ParserFinish_b(&Parser_st) || !Config_Validate_b(&Parser_st))
+                  {
+                    AsyncResponseStream *response = request->beginResponseStream("text/html");
+                    response->setCode(400);
+                    response->printf("<h1>%s: %s<br><a href=\"/\">Zurueck zur Hauptseite</a></h1>", Parser_st.ErrorField_ac, Parser_st.Error_pc);
+                    request->send(response);
+                    return;
+                  }
 
-          while(ExpiredHoldTimeSeconds_u32 < HoldTimeSunriseSeconds_u32 + RampUpTimeSec_u16)
-          {
-            now = GetDateTime_v();
-            ExpiredHoldTimeSeconds_u32 = now.unixtime() - HoldStartTimestamp_u32;
+                  Config_Apply_v(&Parser_st.Patch_st);
+                  PageCache_Bump_v();
+                  Journal_Log_v(JOURNAL_EVENT_COMMAND, JOURNAL_SRC_WEB, JOURNAL_CMD_CONFIG, Parser_st.Patch_st.Present_u32);
 
-            Serial.print("waiting for hold time to expire...\n");
-            Serial.print(ExpiredHoldTimeSeconds_u32);
-            Serial.print("sec of ");
-            Serial.print(HoldTimeSunriseSeconds_u32 + RampUpTimeSec_u16);
-            Serial.print("sec expired\n");
+                  Serial.printf("Set %s: %u\n", inputParam, Percent_u32);
+                }
+                //Serial.println(inputMessage);
+                //request->send(200, "text/html", "HTTP GET request sent to your ESP on input field (" 
+                //                     + inputParam + ") with value: " + inputMessage +
+                //                     "<br><a href=\"/\">Return to Home Page</a>");
+                request->send(200, "text/html", "<h1>Wert wurde gesendet.<br><a href=\"/\">Zurueck zur Hauptseite</a></h1>");
+                });
 
-            delay(2000);
+  
 
-          }
+  server.begin();
+  //---
 
-          LightControlState_u8 = STATE_IDLE;
+  Boot_Done_v();
+}
+//------------------------------
 
-          ExpiredHoldTimeSeconds_u32 = 0;
 
-          DutyCyclePercent_u8 = 0;
-          SetPwmDutycycle();
-          
-          digitalWrite(LED_INTERN, LOW);
+//------------------------------
+//init stages (see BootStage_ast)
+//------------------------------
+bool BootPwm_b(void)
+{
+  LightZone_Init_v(LightZonePin_au8, LightZoneSchedule_au8, sizeof(LightZonePin_au8),
+                   PwmFreqHz_u16, PwmResolutionBit_u8, LightOutputChanged_v);
 
-          break;
+  #ifdef USE_PWM_DITHER
+    LightZone_SetDither_v(true);
+  #endif
 
+  SupervisorZones_u8 = Supervisor_Register_u8("zones", SUPERVISOR_DEADLINE_ZONES_MSEC, SupervisorRecover_v);
+  LightZone_Supervise_v(SupervisorZones_u8);
 
+  //warm reset (brownout, watchdog, ...): continue with the last light state
+  if(RestoreRetainedState_b())
+  {
+    return true;
+  }
 
-      case STATE_WAITING_HOLD_TIME_SUNSET:
+  DutyCyclePercent_u8 = 0;
+  SetPwmDutycycle();
 
-        Serial.print("STATE = WAIT HOLD SUNSET\n");
+  return true;
+}
 
-          //wait for hold time to expire
-          Serial.print("entering hold time loop...\n");
+bool BootRtc_b(void)
+{
+  //I2C
+  if(!I2cBus_Init_b(I2C_SDA, I2C_SCL, I2C_CLOCK_HZ))
+  {
+    return false;
+  }
 
-          //save start timestamp
-          now = GetDateTime_v();
-          HoldStartTimestamp_u32 = now.unixtime();
+  //RTC
+  I2cBus_Lock_v(I2C_OP_OTHER);
+  bool Found_b = rtc.begin();
+  bool LostPower_b = Found_b && rtc.lostPower();
+  I2cBus_Unlock_v();
+
+  if (!Found_b) 
+  {
+    Serial.println("couldn't find RTC!\n");
+  }
+  
+  if (LostPower_b) 
+  {
+    Serial.println("RTC lost power, using default time");
+
+    AdjustRtc_v(DateTime(2022, 1, 1, 0, 0, 0), JOURNAL_SRC_SYSTEM);  //set RTC to YYYY, M, D, H, M, S
+  }
+
+  return true;
+}
+
+bool BootWifi_b(void)
+{
+  #ifdef USE_ACCESS_POINT
+    //start in access point mode
+    WiFi.softAPConfig(local_IP, gateway, subnet);
+    WiFi.softAP(ssid,password);
+    Serial.printf("Settiung up WiFi Access Point ");
+    Serial.printf(ssid);
+    Serial.printf("\n");
+    WifiConnected_b = true;
+  #else
+    //start as client
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    WiFi.setHostname(hostname.c_str());
+
+    WiFi.mode(WIFI_STA);
+
+    #ifdef STATIC_IP
+      WiFi.config(local_IP, gateway, subnet, primaryDNS);
+    #endif
+
+    //connect in background, access point <hostname> after repeated failures
+    Wifi_Start_v(ssid, password, hostname.c_str(), password);
+  #endif
+
+  return true;
+}
+
+bool BootSpiffs_b(void)
+{
+  //format on first start
+  if(!SPIFFS.begin(true))
+  {
+    Serial.println("An Error has occurred while mounting SPIFFS");
+    return false;
+  }
+
+  return true;
+}
+
+bool BootSensor_b(void)
+{
+  TempSensor_Init_v(DS18B20_DATA);
+
+  return true;
+}
+
+bool BootPowerSave_b(void)
+{
+  #ifdef USE_POWER_SAVE
+    PowerSave_Init_v(RTC_INT, SWITCH1);
+
+    //light may already be on (restored state)
+    PowerSave_SetPwmActive_v(LightZone_AnyOn_b());
+  #endif
+
+  return true;
+}
+
+bool BootJournal_b(void)
+{
+  //logs reboot and events recorded so far
+  Journal_Init_v(GetUnixTime_u32);
+
+  return true;
+}
+
+bool BootConfig_b(void)
+{
+  //device configuration and schedule rules (stored in SPIFFS)
+  Config_Init_v();
+  Schedule_Init_v();
+
+  return true;
+}
+
+bool BootControl_b(void)
+{
+  //light control was running before the reset
+  if(LightControlRunning_b)
+  {
+    Serial.print("Light Control Restarted\n");
+
+    LightControlState_u8 = STATE_IDLE;
+  }
+
+  //task runs forever, parked while light control is off
+  SupervisorControl_u8 = Supervisor_Register_u8("light control", SUPERVISOR_DEADLINE_CONTROL_MSEC, SupervisorRecover_v);
+  LightControl_taskHandle = Task_Start_h(TASK_ID_LIGHT_CONTROL, LightControl_task, NULL);
+
+  return true;
+}
+
+bool BootPage_b(void)
+{
+  //page template (split into segments once)
+  if(!PageTemplate_Load_b("/index.html", PageVar_u32))
+  {
+    return false;
+  }
+
+  //rendered page and status JSON are cached until the state changes
+  PageCache_Init_b(PAGE_CACHE_INDEX, PageTemplate_RenderLenMax_u32(), PageTemplate_Render_u32);
+  PageCache_Init_b(PAGE_CACHE_STATUS, STATUS_JSON_LEN_MAX, RenderStatusJson_u32);
+
+  return true;
+}
+
+bool BootTelemetry_b(void)
+{
+  //telemetry history (tier files in SPIFFS)
+  Telemetry_Init_v(ReadTelemetrySample_v);
+
+  return true;
+}
+
+bool BootEnergy_b(void)
+{
+  //energy counters (RTC memory / SPIFFS), integrated from the zone output hook
+  EnergyMeter_Init_v(Config_st.StripWatts_f32);
+
+  return true;
+}
+//------------------------------
+
+
+
+//------------------------------
+//loop()
+//------------------------------
+void loop() 
+{
+  //nothing to do here...
+}
+//------------------------------
+
+
+//------------------------------
+//main loop
+//------------------------------
+void main_task(void * pvParameters) 
+{
+
+  while (1) 
+  {
+
+    #ifdef USE_POWER_SAVE
+      //no status blinking, sleep until SW1 changes or NTP update is due
+      //(poll while dimming, the switch is ignored until the level stands still;
+      //the hold of a sunrise / sunset program sleeps like idle)
+      if((LightZone_IsMoving_b(ZONE_MASK_ALL) == true) || (LightOn_b == true))
+      {
+        Supervisor_Heartbeat_v(SupervisorMain_u8);
+        PowerSave_WaitForSwitch_v(200);
+      }
+      else
+      {
+        Supervisor_Expect_v(SupervisorMain_u8, POWER_SAVE_HOUSEKEEPING_MIN * 60000UL + SUPERVISOR_DEADLINE_MAIN_MSEC);
+        PowerSave_WaitForSwitch_v(POWER_SAVE_HOUSEKEEPING_MIN * 60000UL);
+      }
+    #else
+      Supervisor_Heartbeat_v(SupervisorMain_u8);
+
+      digitalWrite(LED_GREEN, HIGH);
+
+      // Idle for xx msec
+      if((WifiConnected_b == true) || Wifi_Connected_b())
+      {
+        vTaskDelay(pdMS_TO_TICKS(2));
+
+        digitalWrite(LED_GREEN, LOW);
+
+        vTaskDelay(pdMS_TO_TICKS(198));
+      }
+      else
+      {
+        vTaskDelay(pdMS_TO_TICKS(200));
+      }
+    #endif
+
+    //switch light manually on/off using hardware switch SWITCH1
+    //(in the hold of a program: cancels it like a fade)
+    //------
+    uint8_t Switch_u8 = digitalRead(SWITCH1);
+    Trace_Switch_v(Switch_u8);
+
+    if((Switch_u8 == 0) && (LightOn_b == false) && (LightZone_IsMoving_b(ZONE_MASK_ALL) == false)) 
+    {
+      //switch light on
+      Serial.print("HW switch dimming up...\n");
+      
+      LightOn_b = true;
+      digitalWrite(LED_INTERN, HIGH);
+
+      //dim up all zones
+      DimLight_v(ZONE_MASK_ALL, 0, 100, Config_st.ManualRampSec_u16);
+
+      Journal_Log_v(JOURNAL_EVENT_SWITCH, JOURNAL_SRC_SWITCH, 1, 0);
+    }
+
+    else if((Switch_u8 == 1) && (LightOn_b == true) && (LightZone_IsMoving_b(ZONE_MASK_ALL) == false)) 
+    {
+      //switch light off
+      Serial.print("HW switch dimming down...\n");
+              
+      LightOn_b = false;
+      digitalWrite(LED_INTERN, LOW);
+
+      //dim down all zones
+      DimLight_v(ZONE_MASK_ALL, 100, 0, Config_st.ManualRampSec_u16);
+
+      Journal_Log_v(JOURNAL_EVENT_SWITCH, JOURNAL_SRC_SWITCH, 0, 0);
+    }
+    //------
+
+
+    #ifdef USE_NTP
+      //sync every NTP_SYNC_INTERVAL_MIN
+      //power save: every POWER_SAVE_HOUSEKEEPING_MIN
+      //immediately after every (re)connect
+      #ifdef USE_POWER_SAVE
+        bool NtpUpdateDue_b = (millis() - LastNtpUpdateMsec_u32) >= (POWER_SAVE_HOUSEKEEPING_MIN * 60000UL);
+      #else
+        bool NtpUpdateDue_b = (millis() - LastNtpUpdateMsec_u32) >= (NTP_SYNC_INTERVAL_MIN * 60000UL);
+      #endif
+
+      NtpUpdateDue_b = NtpUpdateDue_b || (Wifi_ConnectCount_u32() != NtpConnectCount_u32);
+
+      //fleet follower: the leader's clock is the reference
+      //sync runs in the NTP task (several seconds), result in NtpResult_v()
+      if(NtpUpdateDue_b && Wifi_Connected_b() && !Fleet_Following_b() && !Ntp_Busy_b())
+      {
+        LastNtpUpdateMsec_u32 = millis();
+        NtpConnectCount_u32 = Wifi_ConnectCount_u32();
+
+        Serial.print("NTP sync requested\n");
+
+        Ntp_Request_v();
+      }
+    #endif
+
+
+    #ifdef TASK_STACK_AUDIT
+      //stack high-water marks
+      if((millis() - LastTaskAuditMsec_u32) >= (TASK_AUDIT_PERIOD_SEC * 1000UL))
+      {
+        LastTaskAuditMsec_u32 = millis();
+        Task_Audit_v();
+      }
+    #endif
+
+  }
+}
+//------------------------------
+
+
+
+//------------------------------
+//Light Control Task
+//------------------------------
+void LightControl_task(void * pvParameters) 
+{
+
+  uint16_t UpTimeSec_u16 = 0;      //time spent for dim up 
+  uint16_t DownTimeSec_u16 = 0;    //time spent for dim down
+
+  uint32_t HoldTimeSunriseSeconds_u32 = 0;
+  uint32_t HoldTimeSunsetSeconds_u32 = 0;
+
+  uint16_t MorningOnMin_u16 = 0;   //start of sunrise program (minute of day)
+  uint16_t EveningOnMin_u16 = 0;   //start of sunset program
+  uint32_t MorningDoneKey_u32 = 0; //date key of the last started sunrise program
+  uint32_t EveningDoneKey_u32 = 0; //date key of the last started sunset program
+  bool Recomputed_b = false;
+
+  uint32_t HoldStartTimestamp_u32 = 0;
+  uint32_t ExpiredHoldTimeSeconds_u32 = 0;
+  uint32_t HoldStartMsec_u32 = 0;          //uptime clock, independent of the RTC
+  uint32_t HoldLimitMsec_u32 = 0;
+
+  DateTime now;
+
+  uint8_t JournalState_u8 = LightControlState_u8;   //last state written to journal
+  bool Active_b = false;                            //light control was running in last pass
+
+
+  while(1)
+  { 
+    //light control off: switch own zones off once, wait for LightControlOn
+    if(LightControlRunning_b == false)
+    {
+      if(Active_b)
+      {
+        DutyCyclePercent_u8 = 0;
+        SetPwmDutycycle();
+        Active_b = false;
+      }
+
+      Supervisor_Pause_v(SupervisorControl_u8);
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+
+    Supervisor_Heartbeat_v(SupervisorControl_u8);
+
+    if(!Active_b)
+    {
+      Serial.print("Light Control Task Running...");
+      JournalState_u8 = LightControlState_u8;
+      Active_b = true;
+    }
+
+    
+    //fleet follower: the leader's plans drive the AUTO zones, state machine stays idle
+    if(Fleet_Following_b())
+    {
+      LightControlState_u8 = STATE_IDLE;
+    }
+
+    //rule mode: execute timeline events, state machine stays idle
+    else if(ScheduleMode_u8 == SCHEDULE_MODE_RULES)
+    {
+      LightControlState_u8 = STATE_IDLE;
+
+      now = GetDateTime_v();
+      RunRuleSchedule_v();
+    }
+
+    //state machine
+    else switch(LightControlState_u8)
+    {
+      case STATE_IDLE:
+
+        Serial.print("STATE = IDLE\n");
+
+        digitalWrite(LED_INTERN, LOW);
+
+        //get date and time
+        now = GetDateTime_v();
+
+        //supplementary light windows of today (computed once per day)
+        Recomputed_b = UpdatePhotoperiod_b();
+
+        MorningOnMin_u16 = Photoperiod_st.MorningOnMin_u16;
+        EveningOnMin_u16 = Photoperiod_st.SunsetMin_u16;
+        UpTimeSec_u16 = Photoperiod_st.MorningDimMin_u16 * 60;
+        HoldTimeSunriseSeconds_u32 = Photoperiod_st.MorningHoldMin_u16 * 60;
+        HoldTimeSunsetSeconds_u32 = Photoperiod_st.EveningHoldMin_u16 * 60;
+        DownTimeSec_u16 = Photoperiod_st.EveningDimMin_u16 * 60;
+
+        
+        //fake sunrise / sunset for DEBUGGING
+        #ifdef DEBUG_SUNRISE
+          MorningOnMin_u16 = DateTime_st.tm_hour * 60 + DateTime_st.tm_min;
+          UpTimeSec_u16 = 60 * 60;
+          HoldTimeSunriseSeconds_u32 = 60 * 60;
+        #endif
+
+        //fake sunrise / sunset for DEBUGGING
+        #ifdef DEBUG_SUNSET
+          EveningOnMin_u16 = DateTime_st.tm_hour * 60 + DateTime_st.tm_min;
+          DownTimeSec_u16 = 60 * 60;
+          HoldTimeSunsetSeconds_u32 = 60 * 60;
+        #endif
+
+        //wake-up plan for today: sunrise and sunset trigger minutes
+        #ifdef USE_POWER_SAVE
+          UpdateDailyPlan_v(Recomputed_b);
+        #endif
+
+        //if start of morning window is reached, start dim up task
+        //only if the window isn't empty and only once a day
+        //(a short window ends within its start minute)
+        if((DateTime_st.tm_hour * 60 + DateTime_st.tm_min == MorningOnMin_u16)
+            && ((UpTimeSec_u16 > 0) || (HoldTimeSunriseSeconds_u32 > 0))
+            && (MorningDoneKey_u32 != GetDateKey_u32()))
+        {
+          //dim up light
+          Serial.print("sunrise time reached...\n");
+
+          MorningDoneKey_u32 = GetDateKey_u32();
+
+          LightControlState_u8 = STATE_DIM_UP;
+
+          digitalWrite(LED_INTERN, HIGH);
+
+        }
+
+
+
+        //if SUNSET time is reached, switch on light (100%) and wait hold time
+        //only if the window isn't empty and only once a day
+        //(without hold the program is back to IDLE in the same minute)
+        if((DateTime_st.tm_hour * 60 + DateTime_st.tm_min == EveningOnMin_u16)
+            && ((DownTimeSec_u16 > 0) || (HoldTimeSunsetSeconds_u32 > 0))
+            && (EveningDoneKey_u32 != GetDateKey_u32()))
+        {
+          //switch on light
+          Serial.print("sunset time reached...\n");
+
+          EveningDoneKey_u32 = GetDateKey_u32();
+
+          Serial.print("switch on light...\n");
+
+          //100 %, hold, dusk -> off (program runs through DIM_DOWN)
+          StartSunsetProgram_v(LightZone_ScheduleMask_u8(ZONE_SCHEDULE_AUTO), HoldTimeSunsetSeconds_u32, DownTimeSec_u16);
+          
+          digitalWrite(LED_INTERN, HIGH);
+
+          LightControlState_u8 = STATE_WAITING_HOLD_TIME_SUNSET;
+
+        }
+
+        break;
+
+
+      case STATE_DIM_UP:
+
+          Serial.print("STATE = DIM UP\n");
+
+          //dim up light
+          Serial.print("dimming up...\n");
+          
+          digitalWrite(LED_INTERN, HIGH);
+
+          //start sunrise program of scheduled zones (dawn, rise, hold, off)
+          RampUpTimeSec_u16 = UpTimeSec_u16;
+          StartSunriseProgram_v(LightZone_ScheduleMask_u8(ZONE_SCHEDULE_AUTO), RampUpTimeSec_u16, HoldTimeSunriseSeconds_u32);
+
+
+          LightControlState_u8 = STATE_WAITING_HOLD_TIME_SUNRISE;
+
+          break;
+
+
+        case STATE_DIM_DOWN:
+
+          Serial.print("STATE = DIM DOWN\n");
+
+          //dim down light
+          Serial.print("dimming down...\n");
+          
+          digitalWrite(LED_INTERN, LOW);
+
+          //ramp is part of the sunset program started at sunset
+
+
+          LightControlState_u8 = STATE_IDLE;
+
+          break;
+
+
+        case STATE_WAITING_HOLD_TIME_SUNRISE:
+
+          Serial.print("STATE = WAIT HOLD SUNRISE\n");
+
+          //wait for hold time to expire
+          Serial.print("entering hold time loop...\n");
+
+          //save start timestamp
+          now = GetDateTime_v();
+          HoldStartTimestamp_u32 = now.unixtime();
+
+          Serial.print("HoldStartTimestamp: ");
+          Serial.print(HoldStartTimestamp_u32);
+          Serial.print("\n");
+
+          HoldStartMsec_u32 = millis();
+          HoldLimitMsec_u32 = (HoldTimeSunriseSeconds_u32 + RampUpTimeSec_u16 + HOLD_TIMEOUT_MARGIN_SEC) * 1000UL;
+
+          while((ExpiredHoldTimeSeconds_u32 < HoldTimeSunriseSeconds_u32 + RampUpTimeSec_u16)
+                && ((millis() - HoldStartMsec_u32) < HoldLimitMsec_u32) && (LightControlRunning_b == true)
+                && !Fleet_Following_b())
+          {
+            Supervisor_Heartbeat_v(SupervisorControl_u8);
+
+            now = GetDateTime_v();
+            ExpiredHoldTimeSeconds_u32 = now.unixtime() - HoldStartTimestamp_u32;
+
+            Serial.print("waiting for hold time to expire...\n");
+            Serial.print(ExpiredHoldTimeSeconds_u32);
+            Serial.print("sec of ");
+            Serial.print(HoldTimeSunriseSeconds_u32 + RampUpTimeSec_u16);
+            Serial.print("sec expired\n");
+
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2000));    //LightControlOff ends the loop early
+
+          }
+
+          LightControlState_u8 = STATE_IDLE;
+
+          ExpiredHoldTimeSeconds_u32 = 0;
+
+          //a leader found during the hold time owns the zones now
+          if(!Fleet_Following_b())
+          {
+            DutyCyclePercent_u8 = 0;
+            SetPwmDutycycle();
+          }
+          
+          digitalWrite(LED_INTERN, LOW);
+
+          break;
+
+
+
+      case STATE_WAITING_HOLD_TIME_SUNSET:
+
+        Serial.print("STATE = WAIT HOLD SUNSET\n");
+
+          //wait for hold time to expire
+          Serial.print("entering hold time loop...\n");
+
+          //save start timestamp
+          now = GetDateTime_v();
+          HoldStartTimestamp_u32 = now.unixtime();
 
           Serial.print("HoldStartTimestamp: ");
           Serial.print(HoldStartTimestamp_u32);
           Serial.print("\n");
 
-          while(ExpiredHoldTimeSeconds_u32 < HoldTimeSunsetSeconds_u32)
-          {
-            now = GetDateTime_v();
-            ExpiredHoldTimeSeconds_u32 = now.unixtime() - HoldStartTimestamp_u32;
+          HoldStartMsec_u32 = millis();
+          HoldLimitMsec_u32 = (HoldTimeSunsetSeconds_u32 + HOLD_TIMEOUT_MARGIN_SEC) * 1000UL;
+
+          while((ExpiredHoldTimeSeconds_u32 < HoldTimeSunsetSeconds_u32)
+                && ((millis() - HoldStartMsec_u32) < HoldLimitMsec_u32) && (LightControlRunning_b == true)
+                && !Fleet_Following_b())
+          {
+            Supervisor_Heartbeat_v(SupervisorControl_u8);
+
+            now = GetDateTime_v();
+            ExpiredHoldTimeSeconds_u32 = now.unixtime() - HoldStartTimestamp_u32;
+
+            Serial.print("waiting for hold time to expire...\n");
+            Serial.print(ExpiredHoldTimeSeconds_u32);
+            Serial.print("sec of ");
+            Serial.print(HoldTimeSunsetSeconds_u32);
+            Serial.print("sec expired\n");
+
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2000));    //LightControlOff ends the loop early
+
+          }
+
+          LightControlState_u8 = STATE_DIM_DOWN;
+
+          ExpiredHoldTimeSeconds_u32 = 0;
+
+          break;
+
+
+        case STATE_STOP:
+
+          Serial.print("STATE = WAIT HOLD SUNSET\n");
+
+          ExpiredHoldTimeSeconds_u32 = 0;
+
+          DutyCyclePercent_u8 = 0;
+          SetPwmDutycycle();
+
+          digitalWrite(LED_INTERN, LOW);
+
+          LightControlState_u8 = STATE_IDLE;
+          
+          break;
+
+
+
+
+      default:
+        break;
+    }
+
+
+    //journal state transitions
+    if(LightControlState_u8 != JournalState_u8)
+    {
+      Journal_Log_v(JOURNAL_EVENT_STATE, JOURNAL_SRC_CONTROL, LightControlState_u8, JournalState_u8);
+      PageCache_Bump_v();
+      JournalState_u8 = LightControlState_u8;
+    }
+
+    
+    //sleep
+    #ifdef USE_POWER_SAVE
+      //nothing to do until the next sunrise / sunset event
+      if(LightControlState_u8 == STATE_IDLE)
+      {
+        //wait ends by alarm or its own timeout
+        Supervisor_Pause_v(SupervisorControl_u8);
+        PowerSave_WaitForNextEvent_v(now);
+      }
+      else
+      {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2000));
+      }
+    #else
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2000));    //LightControlOff wakes up early
+    #endif
+
+  }
+
+  vTaskDelete(NULL);
+
+}
+
+
+
+
+//------------------------------
+// send index.html, streamed from pre-parsed template
+//------------------------------
+void SendIndexPage_v(AsyncWebServerRequest *request)
+{
+  if(!PageTemplate_Loaded_b())
+  {
+    request->send(500, "text/plain", "index.html missing");
+    return;
+  }
+
+  UpdatePageClock_v();
+
+  if(PageCache_Send_b(request, PAGE_CACHE_INDEX, "text/html"))
+  {
+    return;
+  }
+
+  PageRenderState_t State_st;
+  PageTemplate_RenderInit_v(&State_st);
+
+  //render state travels with the response (copied into the filler)
+  request->send(request->beginChunkedResponse("text/html", [State_st](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t
+                  {
+                    return PageTemplate_Fill_u32(&State_st, buffer, maxLen);
+                  }
+                ));
+}
+//------------------------------
+
+
+//------------------------------
+// Send page values as JSON (cached like the page)
+//------------------------------
+void SendStatusJson_v(AsyncWebServerRequest *request)
+{
+  UpdatePageClock_v();
+
+  if(PageCache_Send_b(request, PAGE_CACHE_STATUS, "application/json"))
+  {
+    return;
+  }
+
+  char Json_ac [STATUS_JSON_LEN_MAX];
+
+  if(RenderStatusJson_u32(Json_ac, sizeof(Json_ac)) == 0)
+  {
+    request->send(500, "text/plain", "status too long");
+    return;
+  }
+
+  request->send(200, "application/json", Json_ac);
+}
+//------------------------------
+
+
+//------------------------------
+// Render page values as JSON, returns length (0: does not fit)
+//------------------------------
+size_t RenderStatusJson_u32(char *Buf_pc, size_t Size_u32)
+{
+  char Value_aac [PAGE_VAR_COUNT] [PAGE_VALUE_LEN_MAX + 1];
+
+  for(uint8_t i = 0; i < PAGE_VAR_COUNT; i++)
+  {
+    PageVar_u32(i, Value_aac [i], sizeof(Value_aac [i]));
+  }
+
+  int Len_s32 = snprintf(Buf_pc, Size_u32,
+                         "{\"date_time\":\"%s\",\"temperature\":%s,\"dutycycle\":%s,\"state\":\"%s\",\"sunrise\":\"%s\","
+                         "\"sunset\":\"%s\",\"threshold_dark\":%s,\"threshold_bright\":%s,\"version\":\"%s\"}",
+                         Value_aac [PAGE_VAR_DATE_TIME], Value_aac [PAGE_VAR_TEMP], Value_aac [PAGE_VAR_LIGHT_DUTYCYCLE],
+                         Value_aac [PAGE_VAR_STATE], Value_aac [PAGE_VAR_SUNRISE], Value_aac [PAGE_VAR_SUNSET],
+                         Value_aac [PAGE_VAR_THRESHOLD_DARK], Value_aac [PAGE_VAR_THRESHOLD_BRIGHT], Value_aac [PAGE_VAR_VERSION]);
+
+  return ((Len_s32 > 0) && ((size_t)Len_s32 < Size_u32)) ? Len_s32 : 0;
+}
+//------------------------------
+
+
+//------------------------------
+// Pages show the time in minutes: new minute -> new generation
+//------------------------------
+void UpdatePageClock_v(void)
+{
+  uint32_t Minute_u32 = GetUnixTime_u32() / 60;
+
+  if(Minute_u32 != PageMinute_u32)
+  {
+    PageMinute_u32 = Minute_u32;
+    PageCache_Bump_v();
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// Placeholder values of index.html
+// writes value into buffer, returns length
+//------------------------------
+size_t PageVar_u32(uint8_t Var_u8, char *Buf_pc, size_t Size_u32)
+{
+  Text_t Text_st;
+
+  Text_Init_v(&Text_st, Buf_pc, Size_u32);
+
+  switch(Var_u8)
+  {
+    case PAGE_VAR_DATE_TIME:
+      GetDateTime_v();
+      Text_Uint_v(&Text_st, DateTime_st.tm_mday);
+      Text_Char_v(&Text_st, '-');
+      Text_Uint_v(&Text_st, DateTime_st.tm_mon);
+      Text_Char_v(&Text_st, '-');
+      Text_Uint_v(&Text_st, DateTime_st.tm_year);
+      Text_Str_v(&Text_st, "  ");
+      Text_Uint_v(&Text_st, DateTime_st.tm_hour);
+      Text_Char_v(&Text_st, ':');
+      Text_Uint_v(&Text_st, DateTime_st.tm_min, 2);
+      break;
+
+    case PAGE_VAR_TEMP:
+      //sensors are read once per minute by telemetry, nan until the first sample
+      if(isnan(PageTemperature_f32))
+      {
+        PageTemperature_f32 = TempSensor_Get_f32(TEMP_ROLE_AIR);
+      }
+      Text_Fixed_v(&Text_st, PageTemperature_f32, 1);
+      break;
+
+    case PAGE_VAR_LIGHT_DUTYCYCLE:
+      Text_Uint_v(&Text_st, DutyCyclePercent_u8);
+      break;
+
+    case PAGE_VAR_STATE:
+    {
+      const char *State_pc = "";
+
+      switch(LightControlState_u8)
+      {
+        case STATE_IDLE:
+          State_pc = (ScheduleMode_u8 == SCHEDULE_MODE_RULES) ? "RULES" : "IDLE"; 
+          break;
+        
+        case STATE_DIM_UP:
+          State_pc = "DIM UP"; 
+          break;
+
+        case STATE_DIM_DOWN:
+          State_pc = "DIM DOWN"; 
+          break;
+
+        case STATE_WAITING_HOLD_TIME_SUNRISE:
+          State_pc = "WAIT TIME SUNRISE"; 
+          break;
+
+        case STATE_WAITING_HOLD_TIME_SUNSET:
+          State_pc = "WAIT TIME SUNSET"; 
+          break;
+
+        case STATE_STOP:
+          State_pc = "STOPPING"; 
+          break;
+
+        default:
+          break;
+      }
+
+      Text_Str_v(&Text_st, State_pc);
+      Text_Str_v(&Text_st, (LightControlRunning_b == false) ? " (OFF)" : "");
+      break;
+    }
+
+    case PAGE_VAR_SUNRISE:
+      GetSunriseTime_v();
+      Text_Time_v(&Text_st, Sunrise_st.tm_hour, Sunrise_st.tm_min);
+      break;
+
+    case PAGE_VAR_SUNSET:
+      GetSunsetTime_v();
+      Text_Time_v(&Text_st, Sunset_st.tm_hour, Sunset_st.tm_min);
+      break;
+
+    case PAGE_VAR_THRESHOLD_DARK:
+      Text_Uint_v(&Text_st, Config_st.ThresholdDarkPercent_u8);
+      break;
+
+    case PAGE_VAR_THRESHOLD_BRIGHT:
+      Text_Uint_v(&Text_st, Config_st.ThresholdBrightPercent_u8);
+      break;
+
+    case PAGE_VAR_VERSION:
+      Text_Uint_v(&Text_st, VER_MAJOR_U8);
+      Text_Char_v(&Text_st, '.');
+      Text_Uint_v(&Text_st, VER_MINOR_U8);
+      break;
+
+    default:
+      break;
+  }
+
+  return Text_Len_u32(&Text_st);
+}
+//------------------------------
+
+
+
+//------------------------------
+// Set PWM dutycycle of scheduled zones
+//------------------------------
+void SetPwmDutycycle(void)
+{
+  const LightKeyframe_t Level_st = {0, LightZone_PercentToLevel_u16(DutyCyclePercent_u8), ZONE_EASE_LINEAR};
+
+  LightZone_Set_v(LightZone_ScheduleMask_u8(ZONE_SCHEDULE_AUTO), Level_st.Level_u16);
+  Fleet_Publish_v(&Level_st, 1);
+}
+//------------------------------
+
+
+//------------------------------
+// Dim zones from start to stop level (ramp runs in zone engine)
+//------------------------------
+void DimLight_v(uint8_t ZoneMask_u8, uint8_t StartPercent_u8, uint8_t StopPercent_u8, uint16_t RampTimeSec_u16)
+{
+  LightZone_Set_v(ZoneMask_u8, LightZone_PercentToLevel_u16(StartPercent_u8));
+  LightZone_StartRamp_v(ZoneMask_u8, LightZone_PercentToLevel_u16(StopPercent_u8), (uint32_t)RampTimeSec_u16 * 1000);
+}
+//------------------------------
+
+
+//------------------------------
+// Sunrise: dawn glow 0 -> 5 % in the first 10 % of the dim time,
+// exponential rise to 100 %, hold, off
+//------------------------------
+void StartSunriseProgram_v(uint8_t ZoneMask_u8, uint16_t DimSec_u16, uint32_t HoldSec_u32)
+{
+  uint16_t HoldEndSec_u16 = min<uint32_t>(DimSec_u16 + HoldSec_u32, UINT16_MAX);
+
+  const LightKeyframe_t Sunrise_ast [] =
+  {
+    {0,                            0,                                 ZONE_EASE_LINEAR},
+    {(uint16_t)(DimSec_u16 / 10),  LightZone_PercentToLevel_u16(5),   ZONE_EASE_LINEAR},
+    {DimSec_u16,                   ZONE_LEVEL_MAX,                    ZONE_EASE_EXP_IN},
+    {HoldEndSec_u16,               ZONE_LEVEL_MAX,                    ZONE_EASE_LINEAR},
+    {HoldEndSec_u16,               0,                                 ZONE_EASE_STEP},
+  };
+
+  LightZone_StartProgram_v(ZoneMask_u8, Sunrise_ast, sizeof(Sunrise_ast) / sizeof(Sunrise_ast [0]), 0);
+  Fleet_Publish_v(Sunrise_ast, sizeof(Sunrise_ast) / sizeof(Sunrise_ast [0]));
+}
+//------------------------------
+
+
+//------------------------------
+// Sunset: 100 %, hold, falling to 5 % in 90 % of the dim time
+// (slow end), dusk glow -> off
+//------------------------------
+void StartSunsetProgram_v(uint8_t ZoneMask_u8, uint32_t HoldSec_u32, uint16_t DimSec_u16)
+{
+  uint16_t HoldEndSec_u16 = min<uint32_t>(HoldSec_u32, UINT16_MAX - DimSec_u16);
+
+  const LightKeyframe_t Sunset_ast [] =
+  {
+    {0,                                                  ZONE_LEVEL_MAX,                    ZONE_EASE_LINEAR},
+    {HoldEndSec_u16,                                     ZONE_LEVEL_MAX,                    ZONE_EASE_LINEAR},
+    {(uint16_t)(HoldEndSec_u16 + DimSec_u16 * 9 / 10),   LightZone_PercentToLevel_u16(5),   ZONE_EASE_EXP_OUT},
+    {(uint16_t)(HoldEndSec_u16 + DimSec_u16),            0,                                 ZONE_EASE_LINEAR},
+  };
+
+  LightZone_StartProgram_v(ZoneMask_u8, Sunset_ast, sizeof(Sunset_ast) / sizeof(Sunset_ast [0]), 0);
+  Fleet_Publish_v(Sunset_ast, sizeof(Sunset_ast) / sizeof(Sunset_ast [0]));
+}
+//------------------------------
+
+
+//------------------------------
+// Fleet follower: plan of the leader on the AUTO zones (fleet task)
+//------------------------------
+void FleetPlan_v(const LightKeyframe_t *Keyframe_past, uint8_t Count_u8, uint32_t OffsetMsec_u32)
+{
+  //light control off: the zones stay as the user left them
+  if(LightControlRunning_b == false)
+  {
+    return;
+  }
+
+  LightZone_StartProgram_v(LightZone_ScheduleMask_u8(ZONE_SCHEDULE_AUTO), Keyframe_past, Count_u8, OffsetMsec_u32);
+  Journal_Log_v(JOURNAL_EVENT_SCHEDULE, JOURNAL_SRC_FLEET, LightZone_LevelToPercent_u8(Keyframe_past [Count_u8 - 1].Level_u16),
+                LightZone_ScheduleMask_u8(ZONE_SCHEDULE_AUTO));
+}
+
+void FleetSetTime_v(uint32_t Unix_u32)
+{
+  AdjustRtc_v(DateTime(Unix_u32), JOURNAL_SRC_FLEET);
+}
+//------------------------------
+
+
+#ifdef USE_NTP
+//------------------------------
+// NTP sync done (NTP task): set RTC at the start of the next second
+//------------------------------
+void NtpResult_v(bool Ok_b, int64_t UnixUsec_s64)
+{
+  uint32_t Unix_u32 = UnixUsec_s64 / 1000000 + NTP_UTC_OFFSET_SEC;
+
+  Trace_Log_v(TRACE_IN_NTP, Ok_b, 0, 0, Ok_b ? Unix_u32 : 0, 0);
+
+  if(!Ok_b)
+  {
+    Serial.print("NTP sync failed, keeping RTC time\n");
+    return;
+  }
+
+  //a fleet leader showed up during the sync
+  if(Fleet_Following_b())
+  {
+    return;
+  }
+
+  //the DS3231 restarts its second when the seconds register is written
+  vTaskDelay(pdMS_TO_TICKS((1000000 - UnixUsec_s64 % 1000000) / 1000));
+
+  AdjustRtc_v(DateTime(Unix_u32 + 1), JOURNAL_SRC_NTP);
+
+  Serial.print("RTC set from NTP\n");
+}
+//------------------------------
+#endif
+
+
+//------------------------------
+// Output level of a zone changed (called by zone engine)
+//------------------------------
+void LightOutputChanged_v(uint8_t Zone_u8, uint16_t Level_u16)
+{
+  Trace_Output_v(Zone_u8, Level_u16);
+  EnergyMeter_Output_v(Zone_u8, Level_u16);
+
+  //zone 0 is shown on the web page
+  if((Zone_u8 == 0) && (LightZone_LevelToPercent_u8(Level_u16) != DutyCyclePercent_u8))
+  {
+    DutyCyclePercent_u8 = LightZone_LevelToPercent_u8(Level_u16);
+    PageCache_Bump_v();
+  }
+
+  #ifdef USE_POWER_SAVE
+    //LEDC needs APB clock, no light sleep while light is on
+    PowerSave_SetPwmActive_v(LightZone_AnyOn_b());
+  #endif
+
+  RetainState_v();
+}
+//------------------------------
+
+
+//------------------------------
+// Save light state to RTC memory
+//------------------------------
+void RetainState_v(void)
+{
+  portENTER_CRITICAL(&RetainMux);
+
+  Retained_st.Magic_u32 = RETAIN_MAGIC;
+
+  for(uint8_t i = 0; i < ZONE_COUNT_MAX; i++)
+  {
+    Retained_st.Level_au16 [i] = ZoneTable_st.Level_au16 [i];
+  }
+
+  Retained_st.LightOn_b = LightOn_b;
+  Retained_st.LightControlRunning_b = LightControlRunning_b;
+  Retained_st.Check_u8 = RetainCheck_u8(&Retained_st);
+
+  portEXIT_CRITICAL(&RetainMux);
+}
+//------------------------------
+
+
+//------------------------------
+// Restore light state after warm reset (false: power on or invalid)
+//------------------------------
+bool RestoreRetainedState_b(void)
+{
+  RetainedState_t State_st;
+
+  portENTER_CRITICAL(&RetainMux);
+  State_st = Retained_st;
+  portEXIT_CRITICAL(&RetainMux);
+
+  if((esp_reset_reason() == ESP_RST_POWERON) || (State_st.Magic_u32 != RETAIN_MAGIC) ||
+     (RetainCheck_u8(&State_st) != State_st.Check_u8))
+  {
+    return false;
+  }
+
+  LightOn_b = State_st.LightOn_b;
+  LightControlRunning_b = State_st.LightControlRunning_b;
+
+  for(uint8_t i = 0; i < LightZone_Count_u8(); i++)
+  {
+    LightZone_Set_v(1 << i, State_st.Level_au16 [i]);
+  }
+
+  Serial.printf("light state restored (reset reason %d)\n", esp_reset_reason());
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// Checksum of retained state
+//------------------------------
+uint8_t RetainCheck_u8(const RetainedState_t *State_pst)
+{
+  const uint8_t *Byte_pu8 = (const uint8_t *)State_pst;
+  uint8_t Check_u8 = 0xA5;
+
+  for(uint8_t i = 0; i < offsetof(RetainedState_t, Check_u8); i++)
+  {
+    Check_u8 ^= Byte_pu8 [i];
+  }
+
+  return Check_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// Send boot timeline as JSON (times in usec since power on)
+//------------------------------
+void SendBootJson_v(AsyncWebServerRequest *request)
+{
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  const char *Result_apc [] = {"pending", "ok", "failed", "skipped"};
+
+  response->printf("{\"reset_reason\":%d,\"graph_start_us\":%u,\"done_us\":%u,\"wifi_connected_us\":%u,\"stages\":[",
+                   esp_reset_reason(), Boot_RunUs_u32(), Boot_DoneUs_u32(), Wifi_FirstConnectUs_u32());
+
+  for(uint8_t i = 0; i < Boot_StageCount_u8(); i++)
+  {
+    const BootStage_t *Stage_pst = Boot_Stage_pst(i);
+    const BootTiming_t *Timing_pst = Boot_Timing_pst(i);
+    bool First_b = true;
+
+    response->printf("%s{\"name\":\"%s\",\"deps\":[", (i > 0) ? "," : "", Stage_pst->Name_pc);
+
+    for(uint8_t j = 0; j < Boot_StageCount_u8(); j++)
+    {
+      if(Stage_pst->DependMask_u16 & BOOT_DEPENDS(j))
+      {
+        response->printf("%s\"%s\"", First_b ? "" : ",", Boot_Stage_pst(j)->Name_pc);
+        First_b = false;
+      }
+    }
+
+    response->printf("],\"start_us\":%u,\"end_us\":%u,\"core\":%u,\"result\":\"%s\"}",
+                     Timing_pst->StartUs_u32, Timing_pst->EndUs_u32, Timing_pst->Core_u8, Result_apc [Timing_pst->Result_u8 & 0x03]);
+  }
+
+  response->print("]}");
+  request->send(response);
+}
+//------------------------------
+
+
+//------------------------------
+// Supervisor escalation of a stalled task (runs in supervisor task)
+//------------------------------
+void SupervisorRecover_v(uint8_t Slot_u8, uint8_t Level_u8)
+{
+  uint8_t Task_u8 = (Slot_u8 == SupervisorControl_u8) ? TASK_ID_LIGHT_CONTROL
+                  : (Slot_u8 == SupervisorZones_u8) ? TASK_ID_LIGHT_ZONE : TASK_ID_MAIN;
+
+  //deleting a task that holds a bus or file mutex would lock it forever: safe light, then reset
+  if((Level_u8 == SUPERVISOR_LEVEL_RESTART) && Task_HoldsLock_b(Task_u8))
+  {
+    Serial.print("supervisor: task holds a lock, no restart\n");
+    Level_u8 = SUPERVISOR_LEVEL_SAFE_LIGHT;
+    Supervisor_Escalate_v(Slot_u8, Level_u8);
+  }
+
+  switch(Level_u8)
+  {
+    case SUPERVISOR_LEVEL_RESTART:
+      if(Slot_u8 == SupervisorControl_u8)
+      {
+        LightControlState_u8 = STATE_IDLE;
+        LightControl_taskHandle = Task_Restart_h(TASK_ID_LIGHT_CONTROL, LightControl_task, NULL);
+      }
+      else if(Slot_u8 == SupervisorMain_u8)
+      {
+        Task_Restart_h(TASK_ID_MAIN, main_task, NULL);
+      }
+      else if(Slot_u8 == SupervisorZones_u8)
+      {
+        LightZone_Restart_v();
+      }
+      break;
+
+    case SUPERVISOR_LEVEL_SAFE_LIGHT:
+      //fixed level without ramp, the zone engine may be the stalled task
+      LightZone_Set_v(ZONE_MASK_ALL, LightZone_PercentToLevel_u16(SAFE_LIGHT_PERCENT));
+      break;
+
+    default:
+      break;
+  }
+
+  //after the action, the journal may be blocked by the stalled task
+  Journal_Log_v(JOURNAL_EVENT_SUPERVISOR, JOURNAL_SRC_SYSTEM, Slot_u8, Level_u8);
+}
+//------------------------------
+
+
+//------------------------------
+// Commands of web buttons and MQTT (Source_u8: JOURNAL_SRC_xxx)
+//------------------------------
+void CommandLightOn_v(uint8_t Source_u8)
+{
+  Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_LIGHT_ON, Source_u8, 0, 0, 0);
+
+  if(LightZone_IsMoving_b(ZONE_MASK_ALL) == false) 
+  {
+    digitalWrite(LED_INTERN, HIGH);
+
+    //dim up all zones
+    DimLight_v(ZONE_MASK_ALL, 0, 100, Config_st.ManualRampSec_u16);
+
+    Journal_Log_v(JOURNAL_EVENT_COMMAND, Source_u8, JOURNAL_CMD_LIGHT_ON, 0);
+  }
+}
+
+void CommandLightOff_v(uint8_t Source_u8)
+{
+  Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_LIGHT_OFF, Source_u8, 0, 0, 0);
+
+  if(LightZone_IsMoving_b(ZONE_MASK_ALL) == false) 
+  {
+    digitalWrite(LED_INTERN, LOW);
 
-            Serial.print("waiting for hold time to expire...\n");
-            Serial.print(ExpiredHoldTimeSeconds_u32);
-            Serial.print("sec of ");
-            Serial.print(HoldTimeSunsetSeconds_u32);
-            Serial.print("sec expired\n");
+    //dim down all zones
+    DimLight_v(ZONE_MASK_ALL, 100, 0, Config_st.ManualRampSec_u16);
 
-            delay(2000);
+    Journal_Log_v(JOURNAL_EVENT_COMMAND, Source_u8, JOURNAL_CMD_LIGHT_OFF, 0);
+  }
+}
 
-          }
+void CommandControlOn_v(uint8_t Source_u8)
+{
+  Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_CONTROL_ON, Source_u8, 0, 0, 0);
 
-          LightControlState_u8 = STATE_DIM_DOWN;
+  if(LightControlRunning_b == true)
+  {
+    return;
+  }
 
-          ExpiredHoldTimeSeconds_u32 = 0;
+  LightControlRunning_b = true;
 
-          break;
+  Serial.print("Light Control Enabled\n");
+  Journal_Log_v(JOURNAL_EVENT_COMMAND, Source_u8, JOURNAL_CMD_CONTROL_ON, 0);
 
+  LightControlState_u8 = STATE_IDLE;
+  PageCache_Bump_v();
 
-        case STATE_STOP:
+  //wake light control task
+  if(LightControl_taskHandle != NULL)
+  {
+    xTaskNotifyGive(LightControl_taskHandle);
+  }
 
-          Serial.print("STATE = WAIT HOLD SUNSET\n");
+  RetainState_v();
+}
 
-          ExpiredHoldTimeSeconds_u32 = 0;
+void CommandControlOff_v(uint8_t Source_u8)
+{
+  Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_CONTROL_OFF, Source_u8, 0, 0, 0);
 
-          DutyCyclePercent_u8 = 0;
-          SetPwmDutycycle();
+  Serial.print("Light Control Disabled\n");
+  Journal_Log_v(JOURNAL_EVENT_COMMAND, Source_u8, JOURNAL_CMD_CONTROL_OFF, 0);
 
-          digitalWrite(LED_INTERN, LOW);
+  LightControlRunning_b = false;
+  RetainState_v();
+  PageCache_Bump_v();
 
-          LightControlState_u8 = STATE_IDLE;
-          
-          break;
+  LightControlState_u8 = STATE_IDLE;
+  
+  //light control task parks itself and switches its zones off
+  if(LightControl_taskHandle != NULL)
+  {
+    Serial.print("Stopping Light Control Task...\n");
+    xTaskNotifyGive(LightControl_taskHandle);
+  }
+
+  //stop ramps of scheduled zones and switch them off
+  Serial.print("Stopping Dimming...\n");
+  DutyCyclePercent_u8 = 0;
+  SetPwmDutycycle();
+
+  digitalWrite(LED_INTERN, LOW);
+}
 
+void CommandLightLevel_v(uint8_t ZoneMask_u8, uint8_t Percent_u8, uint32_t RampMsec_u32, uint8_t Ease_u8, uint8_t Source_u8)
+{
+  Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_LIGHT_LEVEL, Source_u8, ZoneMask_u8, Percent_u8 | ((uint32_t)Ease_u8 << 8), RampMsec_u32);
 
+  //from the current level of each zone, running ramps and programs are interrupted
+  LightZone_StartFade_v(ZoneMask_u8, LightZone_PercentToLevel_u16(Percent_u8), RampMsec_u32, Ease_u8);
 
+  digitalWrite(LED_INTERN, (Percent_u8 > 0) ? HIGH : LOW);
 
-      default:
-        break;
+  Journal_Log_v(JOURNAL_EVENT_COMMAND, Source_u8, JOURNAL_CMD_LIGHT_LEVEL,
+                ((uint32_t)Percent_u8 << 24) | min<uint32_t>((RampMsec_u32 + 999) / 1000, 0xFFFFFF));
+}
+
+void CommandZone_v(uint8_t Zone_u8, uint8_t Percent_u8, uint16_t RampSec_u16, uint8_t Source_u8)
+{
+  Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_ZONE, Source_u8, 1 << Zone_u8, Percent_u8 | (ZONE_EASE_LINEAR << 8), RampSec_u16 * 1000UL);
+
+  LightZone_StartRamp_v(1 << Zone_u8, LightZone_PercentToLevel_u16(Percent_u8), RampSec_u16 * 1000UL);
+  Journal_Log_v(JOURNAL_EVENT_COMMAND, Source_u8, JOURNAL_CMD_ZONE, ((uint32_t)Zone_u8 << 16) | Percent_u8);
+}
+
+bool CommandScheduleMode_b(const char *Mode_pc, uint8_t Source_u8)
+{
+  if(strcmp(Mode_pc, "rules") == 0)
+  {
+    Schedule_SetMode_v(SCHEDULE_MODE_RULES);
+  }
+  else if(strcmp(Mode_pc, "table") == 0)
+  {
+    Schedule_SetMode_v(SCHEDULE_MODE_TABLE);
+  }
+  else
+  {
+    return false;
+  }
+
+  PageCache_Bump_v();
+
+  Journal_Log_v(JOURNAL_EVENT_COMMAND, Source_u8, JOURNAL_CMD_SCHEDULE_MODE, ScheduleMode_u8);
+  Trace_Log_v(TRACE_IN_COMMAND, JOURNAL_CMD_SCHEDULE_MODE, Source_u8, 0, ScheduleMode_u8, 0);
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// MQTT command topics <hostname>/cmd/...
+//   light          on | off
+//   control        on | off
+//   zone/<id>      <percent>[,<ramp sec>]
+//   level          <percent>[,<ramp msec>] all zones from their current level
+//   schedule_mode  table | rules
+//------------------------------
+bool MqttCommand_b(const char *Command_pc, const char *Payload_pc)
+{
+  if((strcmp(Command_pc, "light") == 0) || (strcmp(Command_pc, "control") == 0))
+  {
+    bool Light_b = (Command_pc [0] == 'l');
+
+    if((strcmp(Payload_pc, "on") == 0) && Light_b)
+    {
+      CommandLightOn_v(JOURNAL_SRC_MQTT);
+    }
+    else if(strcmp(Payload_pc, "on") == 0)
+    {
+      CommandControlOn_v(JOURNAL_SRC_MQTT);
+    }
+    else if((strcmp(Payload_pc, "off") == 0) && Light_b)
+    {
+      CommandLightOff_v(JOURNAL_SRC_MQTT);
+    }
+    else if(strcmp(Payload_pc, "off") == 0)
+    {
+      CommandControlOff_v(JOURNAL_SRC_MQTT);
+    }
+    else
+    {
+      return false;
     }
 
+    return true;
+  }
 
+  if(strncmp(Command_pc, "zone/", 5) == 0)
+  {
+    const char *Ramp_pc = strchr(Payload_pc, ',');
+    uint32_t Zone_u32 = 0;
+    uint32_t Percent_u32 = 0;
+    uint32_t RampSec_u32 = 0;
+
+    if(!Text_ParseUint_b(Command_pc + 5, NULL, &Zone_u32) || (Zone_u32 >= LightZone_Count_u8())
+       || !Text_ParseUint_b(Payload_pc, Ramp_pc, &Percent_u32) || (Percent_u32 > 100)
+       || ((Ramp_pc != NULL) && (!Text_ParseUint_b(Ramp_pc + 1, NULL, &RampSec_u32) || (RampSec_u32 > 65535))))
+    {
+      return false;
+    }
 
+    CommandZone_v(Zone_u32, Percent_u32, RampSec_u32, JOURNAL_SRC_MQTT);
+    return true;
+  }
 
-    
-    //sleep
-    vTaskDelay(pdMS_TO_TICKS(2000));
+  if(strcmp(Command_pc, "level") == 0)
+  {
+    const char *Ramp_pc = strchr(Payload_pc, ',');
+    uint32_t Percent_u32 = 0;
+    uint32_t RampMsec_u32 = 0;
+
+    if(!Text_ParseUint_b(Payload_pc, Ramp_pc, &Percent_u32) || (Percent_u32 > 100)
+       || ((Ramp_pc != NULL) && (!Text_ParseUint_b(Ramp_pc + 1, NULL, &RampMsec_u32) || (RampMsec_u32 > LIGHT_RAMP_MSEC_MAX))))
+    {
+      return false;
+    }
+
+    CommandLightLevel_v(ZONE_MASK_ALL, Percent_u32, RampMsec_u32, ZONE_EASE_LINEAR, JOURNAL_SRC_MQTT);
+    return true;
+  }
+
+  if(strcmp(Command_pc, "schedule_mode") == 0)
+  {
+    return CommandScheduleMode_b(Payload_pc, JOURNAL_SRC_MQTT);
+  }
+
+  return false;
+}
+//------------------------------
+
+
+//------------------------------
+// Send zone status as JSON (Zone_s8 < 0: all zones)
+//------------------------------
+void SendZoneJson_v(AsyncWebServerRequest *request, int8_t Zone_s8)
+{
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  uint8_t First_u8 = (Zone_s8 < 0) ? 0 : Zone_s8;
+  uint8_t Last_u8 = (Zone_s8 < 0) ? LightZone_Count_u8() : Zone_s8 + 1;
+
+  if(Zone_s8 < 0)
+  {
+    response->print("[");
+  }
+
+  for(uint8_t i = First_u8; i < Last_u8; i++)
+  {
+    response->printf("%s{\"id\":%u,\"pin\":%u,\"channel\":%u,\"schedule\":%u,\"level\":%u,\"target\":%u,\"ramping\":%s,\"dithering\":%s}",
+                     (i > First_u8) ? "," : "",
+                     i, ZoneTable_st.Pin_au8 [i], ZoneTable_st.Channel_au8 [i], ZoneTable_st.Schedule_au8 [i],
+                     LightZone_LevelToPercent_u8(ZoneTable_st.Level_au16 [i]),
+                     LightZone_LevelToPercent_u8(ZoneTable_st.Target_au16 [i]),
+                     LightZone_IsRamping_b(1 << i) ? "true" : "false",
+                     (LightZone_DitherMask_u8() & (1 << i)) ? "true" : "false");
+  }
+
+  if(Zone_s8 < 0)
+  {
+    response->print("]");
+  }
+
+  request->send(response);
+}
+//------------------------------
+
+
+//------------------------------
+// PUT /api/light: validate body, start fade, send prediction
+//------------------------------
+void SendLightLevel_v(AsyncWebServerRequest *request)
+{
+  const char *Body_pc = (const char *)request->_tempObject;
+  const char *Field_pc = "level";
+  char Value_ac [16];
+  uint32_t Percent_u32 = 0;
+  uint32_t RampMsec_u32 = 0;
+  uint32_t ZoneMask_u32 = ZONE_MASK_ALL;
+  uint8_t Ease_u8 = ZONE_EASE_LINEAR;
+  uint16_t From_au16 [ZONE_COUNT_MAX];
+
+  if(Body_pc == NULL)
+  {
+    request->send(400, "application/json", "{\"error\":\"empty or too long body\"}");
+    return;
+  }
+
+  bool Ok_b = Text_JsonValue_b(Body_pc, "level", Value_ac, sizeof(Value_ac)) && Text_ParseUint_b(Value_ac, NULL, &Percent_u32)
+              && (Percent_u32 <= 100);
+
+  if(Ok_b && Text_JsonValue_b(Body_pc, "ramp_ms", Value_ac, sizeof(Value_ac)))
+  {
+    Field_pc = "ramp_ms";
+    Ok_b = Text_ParseUint_b(Value_ac, NULL, &RampMsec_u32) && (RampMsec_u32 <= LIGHT_RAMP_MSEC_MAX);
+  }
 
+  if(Ok_b && Text_JsonValue_b(Body_pc, "curve", Value_ac, sizeof(Value_ac)))
+  {
+    Field_pc = "curve";
+    Ease_u8 = LightZone_EaseFromName_u8(Value_ac);
+    Ok_b = (Ease_u8 != ZONE_EASE_NONE);
+  }
+
+  if(Ok_b && Text_JsonValue_b(Body_pc, "zones", Value_ac, sizeof(Value_ac)))
+  {
+    Field_pc = "zones";
+    Ok_b = Text_ParseUint_b(Value_ac, NULL, &ZoneMask_u32) && (ZoneMask_u32 > 0) && (ZoneMask_u32 <= ZONE_MASK_ALL);
+  }
+
+  if(!Ok_b)
+  {
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->setCode(400);
+    response->printf("{\"error\":\"invalid value\",\"field\":\"%s\"}", Field_pc);
+    request->send(response);
+    return;
+  }
+
+  for(uint8_t i = 0; i < LightZone_Count_u8(); i++)
+  {
+    From_au16 [i] = LightZone_GetLevel_u16(i);
+  }
+
+  uint32_t StartMsec_u32 = millis();
+
+  CommandLightLevel_v(ZoneMask_u32, Percent_u32, RampMsec_u32, Ease_u8, JOURNAL_SRC_WEB);
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->print("{\"from\":[");
+
+  for(uint8_t i = 0, n = 0; i < LightZone_Count_u8(); i++)
+  {
+    if(ZoneMask_u32 & (1 << i))
+    {
+      response->printf("%s{\"id\":%u,\"level\":%u}", (n++ > 0) ? "," : "", i, LightZone_LevelToPercent_u8(From_au16 [i]));
+    }
+  }
+
+  //predicted end: uptime and RTC time
+  response->printf("],\"level\":%u,\"ramp_ms\":%u,\"curve\":\"%s\",\"zones\":%u,\"done_uptime_ms\":%u,\"done_at\":%u}",
+                   Percent_u32, RampMsec_u32, LightZone_EaseName_pc(Ease_u8), ZoneMask_u32, StartMsec_u32 + RampMsec_u32,
+                   GetUnixTime_u32() + (RampMsec_u32 + 999) / 1000);
+  request->send(response);
+}
+//------------------------------
+
+
+//------------------------------
+// Telemetry sample (called once per minute from telemetry task)
+//------------------------------
+void ReadTelemetrySample_v(TelemetrySample_t *Sample_pst)
+{
+  //one conversion for all probes, the sample keeps the coop air
+  TempSensor_Update_v();
+  float Temperature_f32 = TempSensor_Get_f32(TEMP_ROLE_AIR);
+
+  DateTime Now = I2cBus_RtcNow();
+
+  Sample_pst->Time_u32 = Now.unixtime();
+  Sample_pst->TempCenti_s16 = isnan(Temperature_f32) ? TELEMETRY_TEMP_INVALID : (int16_t)lroundf(Temperature_f32 * 100.0F);
+
+  for(uint8_t i = 0; i < TEMP_ROLE_COUNT; i++)
+  {
+    float Role_f32 = TempSensor_Get_f32(i);
+    Trace_Log_v(TRACE_IN_TEMP, i, 0, 0, isnan(Role_f32) ? (uint32_t)INT32_MIN : (uint32_t)lroundf(Role_f32 * 100.0F), 0);
+  }
+
+  //pages show 0.1 degC
+  if(!isnan(Temperature_f32) && (isnan(PageTemperature_f32) || (lroundf(Temperature_f32 * 10.0F) != lroundf(PageTemperature_f32 * 10.0F))))
+  {
+    PageTemperature_f32 = Temperature_f32;
+    PageCache_Bump_v();
+  }
+  Sample_pst->DutyPercent_u8 = DutyCyclePercent_u8;
+  Sample_pst->Light_u16 = analogRead(BRIGHTNESS_ANALOG_IN);
+
+  Trace_Log_v(TRACE_IN_ADC, BRIGHTNESS_ANALOG_IN, 0, 0, Sample_pst->Light_u16, 0);
+
+  //energy meter: new day / month, cheap persistence
+  EnergyMeter_Tick_v((uint32_t)Now.year() * 10000 + Now.month() * 100 + Now.day());
+}
+//------------------------------
+
+
+//------------------------------
+// Set RTC and journal the correction
+//------------------------------
+void AdjustRtc_v(const DateTime &NewTime, uint8_t Source_u8)
+{
+  int32_t Delta_s32 = (int32_t)(NewTime.unixtime() - I2cBus_RtcNow().unixtime());
+
+  I2cBus_RtcAdjust_v(NewTime);
+  PageCache_Bump_v();
+
+  //periodic NTP updates without correction are not worth a record
+  if(Delta_s32 != 0)
+  {
+    Journal_Log_v(JOURNAL_EVENT_TIME_SET, Source_u8, 0, (uint32_t)Delta_s32);
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// Unix time from DS3231 (journal clock)
+//------------------------------
+uint32_t GetUnixTime_u32(void)
+{
+  return I2cBus_RtcNow().unixtime();
+}
+//------------------------------
+
+
+//------------------------------
+// Get date and time from DS3231
+//------------------------------
+DateTime GetDateTime_v(void)
+{
+  DateTime now = I2cBus_RtcNow();   //get current time from RTC (cached within the second)
+
+  DateTime_st.tm_mday = int(now.day());
+  DateTime_st.tm_mon = int(now.month());
+  DateTime_st.tm_year = int(now.year());
+
+  DateTime_st.tm_hour = int(now.hour());
+  DateTime_st.tm_min = int(now.minute());
+  DateTime_st.tm_sec = int(now.second());
+
+  //calculation of calendar week
+  CalendarWeekNumber_u8 = CalcCalendarWeek_u8(DateTime_st.tm_year, DateTime_st.tm_mon, DateTime_st.tm_mday);
+  Serial.print("calendar week: ");
+  Serial.print(CalendarWeekNumber_u8);
+  Serial.print("\n");
+
+  return now;
+
+}
+//------------------------------
+
+
+//------------------------------
+// Set date and time of DS3231 to user values
+//------------------------------
+bool SetDateTime_v(const char *DateTime_pc, uint8_t Source_u8)
+{
+  ConfigDateTime_t DateTime_st;
+  char Text_ac [20];    //YYYY-MM-DD HH:MM:SS
+  size_t Len_u32 = strlen(DateTime_pc);
+
+  //NTP date ends with 'Z' (UTC)
+  if((Len_u32 == sizeof(Text_ac)) && (DateTime_pc [Len_u32 - 1] == 'Z'))
+  {
+    Len_u32--;
+  }
+
+  if(Len_u32 >= sizeof(Text_ac))
+  {
+    Serial.print("set RTC: invalid date/time\n");
+    return false;
+  }
+
+  memcpy(Text_ac, DateTime_pc, Len_u32);
+  Text_ac [Len_u32] = '\0';
+
+  if(!Config_ParseDateTime_b(Text_ac, &DateTime_st))
+  {
+    Serial.print("set RTC: invalid date/time\n");
+    return false;
   }
 
-  vTaskDelete(NULL);
+  Serial.print("set RTC to: ");
+  Serial.println(Text_ac);
+
+  AdjustRtc_v(DateTime(DateTime_st.Year_u16, DateTime_st.Month_u8, DateTime_st.Day_u8,
+                       DateTime_st.Hour_u8, DateTime_st.Minute_u8, DateTime_st.Second_u8), Source_u8);  //set RTC to YYYY, M, D, H, M, S
+
+  Serial.println("RTC says: ");
+
+  //buffer can be defined using following combinations:
+  //hh - the hour with a leading zero (00 to 23)
+  //mm - the minute with a leading zero (00 to 59)
+  //ss - the whole second with a leading zero where applicable (00 to 59)
+  //YYYY - the year as four digit number
+  //YY - the year as two digit number (00-99)
+  //MM - the month as number with a leading zero (01-12)
+  //MMM - the abbreviated English month name ('Jan' to 'Dec')
+  //DD - the day as number with a leading zero (01 to 31)
+  //DDD - the abbreviated English day name ('Mon' to 'Sun')
+
+  DateTime now = I2cBus_RtcNow();
+
+  char buf15[] = "YYMMDD-hh:mm:ss";
+  Serial.println(now.toString(buf15));
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// lookup sunrise time
+//------------------------------
+void GetSunriseTime_v(void)
+{
+
+  Sunrise_st.tm_hour = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [0];
+  Sunrise_st.tm_min = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [1];
 
-}
+  //dim time and hold time
+  DimTimeMinFromTable_u8 = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [4];
+  HoldTimeMinFromTable_u8 = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [5];
 
 
+}
+//------------------------------
 
 
 //------------------------------
-//dim up task
+// lookup sunset time
 //------------------------------
-void DimUp_task(void * pvParameters) 
+void GetSunsetTime_v(void)
 {
+  Sunset_st.tm_hour = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [2];
+  Sunset_st.tm_min = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [3];
 
-  DimTaskRunning_b = true;
-
-  Serial.println("DimUp task started");
-
-  DimUp_v();
-
-  Serial.println("DimUp task finished");
-
-  DimTaskRunning_b = false;
-  
-  vTaskDelete(NULL);
-  
+  //dim time and hold time
+  DimTimeMinFromTable_u8 = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [4];
+  HoldTimeMinFromTable_u8 = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [5];
 }
 //------------------------------
 
 
 //------------------------------
-//dim down task
+// light windows of today: once per day, again after a setting changed
 //------------------------------
-void DimDown_task(void * pvParameters) 
+bool UpdatePhotoperiod_b(void)
 {
-  DimTaskRunning_b = true;
+  uint32_t DateKey_u32 = GetDateKey_u32();
+  DeviceConfig_t Current_st;
 
-  Serial.println("DimDown task started");
+  if(Photoperiod_st.DateKey_u32 == DateKey_u32)
+  {
+    return false;
+  }
 
-  DimDown_v();
+  GetSunriseTime_v();
+  GetSunsetTime_v();
+  Config_Copy_v(&Current_st);
 
-  Serial.println("DimDown task finished");
+  Photoperiod_Compute_v(&Photoperiod_st, DateKey_u32, Sunrise_st.tm_hour * 60 + Sunrise_st.tm_min,
+                        Sunset_st.tm_hour * 60 + Sunset_st.tm_min, DimTimeMinFromTable_u8, HoldTimeMinFromTable_u8,
+                        &Current_st.Photoperiod_st);
 
-  DimTaskRunning_b = false;
+  Serial.printf("photoperiod %u: morning from %02u:%02u (%u + %u min), evening %u + %u min\n", DateKey_u32,
+                Photoperiod_st.MorningOnMin_u16 / 60, Photoperiod_st.MorningOnMin_u16 % 60,
+                Photoperiod_st.MorningDimMin_u16, Photoperiod_st.MorningHoldMin_u16,
+                Photoperiod_st.EveningHoldMin_u16, Photoperiod_st.EveningDimMin_u16);
 
-  vTaskDelete(NULL);
-  
+  return true;
 }
 //------------------------------
 
 
-
+#ifdef USE_POWER_SAVE
 //------------------------------
-// Processor function for webserver
-// replaces placeholders with strings
+// store today's light control events as wake-up plan (RTC memory)
 //------------------------------
-String processor(const String& var)
+void UpdateDailyPlan_v(bool Force_b)
 {
-  String RetStr = "";
+  uint32_t DateKey_u32 = GetDateKey_u32();
+  uint16_t EventMinute_au16 [PLAN_EVENTS_MAX];
+  uint8_t Count_u8 = 0;
 
-  
-
-  if(var == "DATE_TIME")
+  if(PowerSave_PlanValid_b(DateKey_u32) && (Force_b == false))
   {
-    GetDateTime_v();
+    return;
+  }
 
-    if(DateTime_st.tm_min > 9)
+  if(ScheduleMode_u8 == SCHEDULE_MODE_RULES)
+  {
+    for(uint8_t i = 0; (i < Timeline_st.Count_u8) && (Count_u8 < PLAN_EVENTS_MAX); i++)
     {
-      RetStr = String(DateTime_st.tm_mday) + "-" + String(DateTime_st.tm_mon) + "-" + String(DateTime_st.tm_year) + "  " +
-              String(DateTime_st.tm_hour) + ":" + String(DateTime_st.tm_min);
+      EventMinute_au16 [Count_u8++] = Timeline_st.Event_ast [i].Minute_u16;
     }
-    else
+  }
+  else
+  {
+    if(Photoperiod_MorningMin_u16(&Photoperiod_st) > 0)
     {
-      RetStr = String(DateTime_st.tm_mday) + "-" + String(DateTime_st.tm_mon) + "-" + String(DateTime_st.tm_year) + "  " +
-              String(DateTime_st.tm_hour) + ":0" + String(DateTime_st.tm_min);
+      EventMinute_au16 [Count_u8++] = Photoperiod_st.MorningOnMin_u16;
     }
 
-    Serial.print("Date Time: ");
-    Serial.print("\nRetStr: ");
-    Serial.println(RetStr);
-    Serial.print("\n");
+    if(Photoperiod_EveningMin_u16(&Photoperiod_st) > 0)
+    {
+      EventMinute_au16 [Count_u8++] = Photoperiod_st.SunsetMin_u16;
+    }
   }
 
-  else if(var == "TEMP")
-  {
-    RetStr = String(GetTemperature_f32(), 1);
+  PowerSave_SetPlan_v(DateKey_u32, EventMinute_au16, Count_u8);
 
-    Serial.print("Temperature: ");
-    Serial.print(GetTemperature_f32());
-    Serial.print("\nRetStr: ");
-    Serial.println(RetStr);
-    Serial.print("\n");
+  Serial.printf("power save: plan for %u with %u events, %u wake-ups expected\n",
+                DateKey_u32, Count_u8,
+                PowerSave_SimulateWakeupsPerDay_u16(&DailyPlan_st, POWER_SAVE_HOUSEKEEPING_MIN));
+}
+//------------------------------
+#endif
 
-    
-  }
 
-  else if(var == "LIGHT_DUTYCYCLE")
+//------------------------------
+// date as YYYYMMDD (from last RTC read)
+//------------------------------
+uint32_t GetDateKey_u32(void)
+{
+  return (uint32_t)DateTime_st.tm_year * 10000 + DateTime_st.tm_mon * 100 + DateTime_st.tm_mday;
+}
+//------------------------------
+
+
+//------------------------------
+// rule mode: compile timeline if needed and execute due events
+//------------------------------
+void RunRuleSchedule_v(void)
+{
+  uint32_t DateKey_u32 = GetDateKey_u32();
+  uint16_t NowMin_u16 = DateTime_st.tm_hour * 60 + DateTime_st.tm_min;
+
+  //recompile on new day or changed rules, then catch up with today's events
+  if(!Schedule_TimelineValid_b(DateKey_u32))
   {
-    RetStr = String(DutyCyclePercent_u8);
+    GetSunriseTime_v();
+    GetSunsetTime_v();
 
-    Serial.print("Dutycycle: ");
-    Serial.print(DutyCyclePercent_u8);
-    Serial.print("\nRetStr: ");
-    Serial.println(RetStr);
-    Serial.print("\n");
+    DateTime Today(DateTime_st.tm_year, DateTime_st.tm_mon, DateTime_st.tm_mday);
 
-    
-  }
+    Schedule_Compile_v(DateKey_u32, Today.dayOfTheWeek(), DateTime_st.tm_mon * 100 + DateTime_st.tm_mday,
+                       Sunrise_st.tm_hour * 60 + Sunrise_st.tm_min, Sunset_st.tm_hour * 60 + Sunset_st.tm_min);
 
+    NextTimelineEvent_u8 = 0;
 
-  else if(var == "STATE")
-  {
-    switch(LightControlState_u8)
-    {
-      case STATE_IDLE:
-        RetStr = "IDLE"; 
-        break;
-      
-      case STATE_DIM_UP:
-        RetStr = "DIM UP"; 
-        break;
+    #ifdef USE_POWER_SAVE
+      UpdateDailyPlan_v(true);
+    #endif
+  }
 
-      case STATE_DIM_DOWN:
-        RetStr = "DIM DOWN"; 
-        break;
+  uint8_t End_u8 = Schedule_UpperBound_u8(NowMin_u16);
+  uint8_t AutoZones_u8 = LightZone_ScheduleMask_u8(ZONE_SCHEDULE_AUTO);
 
-      case STATE_WAITING_HOLD_TIME_SUNRISE:
-        RetStr = "WAIT TIME SUNRISE"; 
-        break;
+  for(; NextTimelineEvent_u8 < End_u8; NextTimelineEvent_u8++)
+  {
+    const TimelineEvent_t *Event_pst = &Timeline_st.Event_ast [NextTimelineEvent_u8];
+    uint16_t EndMin_u16 = Event_pst->Minute_u16 + Event_pst->RampMin_u8;
+    uint16_t Level_u16 = LightZone_PercentToLevel_u16(Event_pst->LevelPercent_u8);
 
-      case STATE_WAITING_HOLD_TIME_SUNSET:
-        RetStr = "WAIT TIME SUNSET"; 
-        break;
+    Serial.printf("rule event %02u:%02u -> %u%%\n", Event_pst->Minute_u16 / 60, Event_pst->Minute_u16 % 60, Event_pst->LevelPercent_u8);
+    Journal_Log_v(JOURNAL_EVENT_SCHEDULE, JOURNAL_SRC_CONTROL, Event_pst->LevelPercent_u8, Event_pst->ZoneMask_u8 & AutoZones_u8);
 
-      case STATE_STOP:
-        RetStr = "STOPPING"; 
-        break;
+    //ramp already over (catching up) -> set level, else ramp for the remaining time
+    if(NowMin_u16 >= EndMin_u16)
+    {
+      const LightKeyframe_t Level_st = {0, Level_u16, ZONE_EASE_LINEAR};
 
-      default:
-        break;
+      LightZone_Set_v(Event_pst->ZoneMask_u8 & AutoZones_u8, Level_u16);
+      Fleet_Publish_v(&Level_st, 1);
     }
-
-    if(LightControlRunning_b == false)
+    else
     {
-      RetStr = RetStr + " (OFF)";
+      uint32_t RemainingSec_u32 = (uint32_t)(EndMin_u16 - NowMin_u16) * 60 - DateTime_st.tm_sec;
+      uint8_t ZoneMask_u8 = Event_pst->ZoneMask_u8 & AutoZones_u8;
+
+      //fleet: ramp from the level of the first zone of the event
+      const LightKeyframe_t Ramp_ast [] =
+      {
+        {0,                             LightZone_GetLevel_u16(ZoneMask_u8 ? __builtin_ctz(ZoneMask_u8) : 0),   ZONE_EASE_LINEAR},
+        {(uint16_t)RemainingSec_u32,    Level_u16,                                                              ZONE_EASE_LINEAR},
+      };
+
+      LightZone_StartRamp_v(ZoneMask_u8, Level_u16, RemainingSec_u32 * 1000);
+      Fleet_Publish_v(Ramp_ast, 2);
     }
-    
   }
+}
+//------------------------------
 
 
+//------------------------------
+// build rule from request parameters
+//------------------------------
+bool ParseRule_b(AsyncWebServerRequest *request, ScheduleRule_t *Rule_pst)
+{
+  memset(Rule_pst, 0, sizeof(ScheduleRule_t));
 
+  Rule_pst->WeekdayMask_u8 = RULE_DAYS_ALL;
+  Rule_pst->ZoneMask_u8 = ZONE_MASK_ALL;
 
-  else if(var == "SUNRISE")
+  if(!request->hasParam(PARAM_ZONE_LEVEL))
   {
-    GetSunriseTime_v();
+    return false;
+  }
+  Rule_pst->LevelPercent_u8 = constrain(request->getParam(PARAM_ZONE_LEVEL)->value().toInt(), 0L, 100L);
 
-    if(Sunrise_st.tm_min > 9)
+  const char *Anchor_pc = request->hasParam(PARAM_RULE_ANCHOR) ? request->getParam(PARAM_RULE_ANCHOR)->value().c_str() : "time";
+
+  if(strcmp(Anchor_pc, "time") == 0)
+  {
+    //HH:MM
+    if(!request->hasParam(PARAM_RULE_TIME))
     {
-      if(Sunrise_st.tm_hour > 9)
-      {
-        RetStr = String(Sunrise_st.tm_hour) + ":" + String(Sunrise_st.tm_min);
-      }
-      else
-      {
-        RetStr = "0" + String(Sunrise_st.tm_hour) + ":" + String(Sunrise_st.tm_min);
-      }
+      return false;
     }
-    else
+
+    const char *Time_pc = request->getParam(PARAM_RULE_TIME)->value().c_str();
+    const char *Colon_pc = strchr(Time_pc, ':');
+    uint32_t Hour_u32 = 0;
+    uint32_t Minute_u32 = 0;
+
+    if((Colon_pc == NULL) || !Text_ParseUint_b(Time_pc, Colon_pc, &Hour_u32) || !Text_ParseUint_b(Colon_pc + 1, NULL, &Minute_u32)
+       || (Hour_u32 > 23) || (Minute_u32 > 59))
     {
-      if(Sunrise_st.tm_hour > 9)
-      {
-        RetStr = String(Sunrise_st.tm_hour) + ":0" + String(Sunrise_st.tm_min);
-      }
-      else
-      {
-        RetStr = "0" + String(Sunrise_st.tm_hour) + ":0" + String(Sunrise_st.tm_min);
-      }
+      return false;
     }
 
-    Serial.print("Sunrise Time: ");
-    Serial.print("\nRetStr: ");
-    Serial.println(RetStr);
-    Serial.print("\n");
+    Rule_pst->Anchor_u8 = RULE_ANCHOR_TIME;
+    Rule_pst->TimeMin_s16 = Hour_u32 * 60 + Minute_u32;
+  }
+  else if((strcmp(Anchor_pc, "sunrise") == 0) || (strcmp(Anchor_pc, "sunset") == 0))
+  {
+    Rule_pst->Anchor_u8 = (strcmp(Anchor_pc, "sunrise") == 0) ? RULE_ANCHOR_SUNRISE : RULE_ANCHOR_SUNSET;
+
+    if(request->hasParam(PARAM_RULE_OFFSET))
+    {
+      Rule_pst->TimeMin_s16 = constrain(request->getParam(PARAM_RULE_OFFSET)->value().toInt(), (long)-RULE_OFFSET_MIN_MAX, (long)RULE_OFFSET_MIN_MAX);
+    }
+  }
+  else
+  {
+    return false;
   }
 
+  if(request->hasParam(PARAM_ZONE_RAMP))
+  {
+    Rule_pst->RampMin_u8 = constrain(request->getParam(PARAM_ZONE_RAMP)->value().toInt(), 0L, 255L);
+  }
 
-  else if(var == "SUNSET")
+  if(request->hasParam(PARAM_RULE_DAYS))
   {
-    GetSunsetTime_v();
+    const String &Days = request->getParam(PARAM_RULE_DAYS)->value();
 
-    if(Sunset_st.tm_min > 9)
+    if(Days == "weekdays")
     {
-      if(Sunset_st.tm_hour > 9)
-      {
-        RetStr = String(Sunset_st.tm_hour) + ":" + String(Sunset_st.tm_min);
-      }
-      else
-      {
-        RetStr = "0" + String(Sunset_st.tm_hour) + ":" + String(Sunset_st.tm_min);
-      }
+      Rule_pst->WeekdayMask_u8 = RULE_DAYS_WEEKDAYS;
     }
-    else
+    else if(Days == "weekend")
     {
-      if(Sunset_st.tm_hour > 9)
-      {
-        RetStr = String(Sunset_st.tm_hour) + ":0" + String(Sunset_st.tm_min);
-      }
-      else
-      {
-        RetStr = "0" + String(Sunset_st.tm_hour) + ":0" + String(Sunset_st.tm_min);
-      }
+      Rule_pst->WeekdayMask_u8 = RULE_DAYS_WEEKEND;
+    }
+    else if(Days != "daily")
+    {
+      Rule_pst->WeekdayMask_u8 = Days.toInt() & RULE_DAYS_ALL;
     }
-
-    Serial.print("Sunset Time: ");
-    Serial.print("\nRetStr: ");
-    Serial.println(RetStr);
-    Serial.print("\n");
   }
 
-
-  else if(var == "THRESHOLD_DARK")
+  if(request->hasParam(PARAM_RULE_ZONES))
   {
-    RetStr = String(ThresholdDarkPercent_u8);
-
-    Serial.print("ThresholdDarkPercent: ");
-    Serial.print(ThresholdDarkPercent_u8);
-    Serial.print("\nRetStr: ");
-    Serial.println(RetStr);
-    Serial.print("\n");
+    Rule_pst->ZoneMask_u8 = request->getParam(PARAM_RULE_ZONES)->value().toInt();
   }
 
-  else if(var == "THRESHOLD_BRIGHT")
+  if(request->hasParam(PARAM_RULE_FROM) && request->hasParam(PARAM_RULE_TO))
   {
-    RetStr = String(ThresholdBrightPercent_u8);
+    Rule_pst->FromDate_u16 = request->getParam(PARAM_RULE_FROM)->value().toInt();
+    Rule_pst->ToDate_u16 = request->getParam(PARAM_RULE_TO)->value().toInt();
 
-    Serial.print("ThresholdBrightPercent: ");
-    Serial.print(ThresholdBrightPercent_u8);
-    Serial.print("\nRetStr: ");
-    Serial.println(RetStr);
-    Serial.print("\n");
+    if((Rule_pst->FromDate_u16 < 101) || (Rule_pst->FromDate_u16 > 1231) || (Rule_pst->ToDate_u16 < 101) || (Rule_pst->ToDate_u16 > 1231))
+    {
+      return false;
+    }
   }
 
-
-  else if(var == "VERSION")
+  if(request->hasParam(PARAM_RULE_OVERRIDE) && (request->getParam(PARAM_RULE_OVERRIDE)->value().toInt() != 0))
   {
-    RetStr = String(VER_MAJOR_U8) + "." + String(VER_MINOR_U8);
+    Rule_pst->Flags_u8 |= RULE_FLAG_OVERRIDE;
   }
 
-
-
-  return RetStr;
+  return Schedule_RuleValid_b(Rule_pst);
 }
 //------------------------------
 
 
-
 //------------------------------
-// Set PWM dutycycle
+// send rules as JSON
 //------------------------------
-void SetPwmDutycycle(void)
+void SendRulesJson_v(AsyncWebServerRequest *request)
 {
-  //set PWM dutycycle (range: 0...2^resolution - 1)
-  ledcWrite(PwmChannel_u8, ( (1<<PwmResolutionBit_u8) - 1) / 100 * DutyCyclePercent_u8);
-}
-//------------------------------
-
+  static const char *AnchorName_apc [] = {"time", "sunrise", "sunset"};
 
-//------------------------------
-// Dim LED up
-//------------------------------
-void DimUp_v(void)
-{
-    uint8_t DutyCycleSteps_u8 =  StopDutyCycle_u8 - StartDutyCyclePercent_u8;
+  ScheduleRule_t Rule_ast [SCHEDULE_RULES_MAX];
+  uint8_t Count_u8 = Schedule_GetRules_u8(Rule_ast, SCHEDULE_RULES_MAX);
 
-    uint32_t DelayBetweenStepsMsec_u32 = RampUpTimeSec_u16 * 1000 / DutyCycleSteps_u8;
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
 
-    DutyCyclePercent_u8 = StartDutyCyclePercent_u8;
+  response->printf("{\"mode\":\"%s\",\"rules\":[", (ScheduleMode_u8 == SCHEDULE_MODE_RULES) ? "rules" : "table");
 
-    SetPwmDutycycle();
+  for(uint8_t i = 0; i < Count_u8; i++)
+  {
+    const ScheduleRule_t *Rule_pst = &Rule_ast [i];
 
-    while(DutyCycleSteps_u8)
-    {
-      delay(DelayBetweenStepsMsec_u32);
-      
-      if(DutyCyclePercent_u8 < 100)
-      {
-        DutyCyclePercent_u8++;
-      }
+    response->printf("%s{\"index\":%u,\"anchor\":\"%s\",\"time\":%d,\"level\":%u,\"ramp\":%u,\"days\":%u,\"zones\":%u,\"from\":%u,\"to\":%u,\"override\":%u}",
+                     (i > 0) ? "," : "", i, AnchorName_apc [Rule_pst->Anchor_u8 % 3], Rule_pst->TimeMin_s16,
+                     Rule_pst->LevelPercent_u8, Rule_pst->RampMin_u8, Rule_pst->WeekdayMask_u8, Rule_pst->ZoneMask_u8,
+                     Rule_pst->FromDate_u16, Rule_pst->ToDate_u16, (Rule_pst->Flags_u8 & RULE_FLAG_OVERRIDE) ? 1 : 0);
+  }
 
-      SetPwmDutycycle();
+  response->print("]}");
 
-      DutyCycleSteps_u8--;
-    }
+  request->send(response);
 }
 //------------------------------
 
 
 //------------------------------
-// Dim LED down
+// send compiled timeline as JSON
 //------------------------------
-void DimDown_v(void)
+void SendTimelineJson_v(AsyncWebServerRequest *request)
 {
-  uint8_t DutyCycleSteps_u8 = StartDutyCyclePercent_u8 - StopDutyCycle_u8;
-
-  uint32_t DelayBetweenStepsMsec_u32 = RampDownTimeSec_u16 * 1000 / DutyCycleSteps_u8;
-
-  DutyCyclePercent_u8 = StartDutyCyclePercent_u8;
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
 
-  SetPwmDutycycle();
+  response->printf("{\"date\":%u,\"events\":[", Timeline_st.DateKey_u32);
 
-  while(DutyCycleSteps_u8)
+  for(uint8_t i = 0; i < Timeline_st.Count_u8; i++)
   {
-    delay(DelayBetweenStepsMsec_u32);
-    
-    if(DutyCyclePercent_u8 > 0)
-    {
-      DutyCyclePercent_u8--;
-    }
+    const TimelineEvent_t *Event_pst = &Timeline_st.Event_ast [i];
 
-    SetPwmDutycycle();
-
-    DutyCycleSteps_u8--;
+    response->printf("%s{\"time\":\"%02u:%02u\",\"level\":%u,\"ramp\":%u,\"zones\":%u}",
+                     (i > 0) ? "," : "", Event_pst->Minute_u16 / 60, Event_pst->Minute_u16 % 60,
+                     Event_pst->LevelPercent_u8, Event_pst->RampMin_u8, Event_pst->ZoneMask_u8);
   }
-}
-//------------------------------
-
-
-//------------------------------
-// Get temperature value from DS18B20
-//------------------------------
-float GetTemperature_f32(void)
-{
-  float Temperature_f32 = 0.0F;
 
-  DS18B20.requestTemperatures();                  // send the command to get temperatures
-  Temperature_f32 = DS18B20.getTempCByIndex(0);   // read temperature in °C
+  response->print("]}");
 
-  Serial.print("DS18B20 temperature: ");
-  Serial.print(Temperature_f32);
-  Serial.print("°C \n");
-
-  
-  Serial.print("DS3231 temperature: ");
-  Serial.print(rtc.getTemperature());
-  Serial.print("°C \n");
-
-  return Temperature_f32;
+  request->send(response);
 }
 //------------------------------
 
 
 //------------------------------
-// Get date and time from DS3231
+// send light-on minutes, first on and last off of every day of a year
 //------------------------------
-DateTime GetDateTime_v(void)
+void SendSchedulePreview_v(AsyncWebServerRequest *request)
 {
-  DateTime now = rtc.now();   //get current time from RTC 
-
-  DateTime_st.tm_mday = int(now.day());
-  DateTime_st.tm_mon = int(now.month());
-  DateTime_st.tm_year = int(now.year());
-
-  DateTime_st.tm_hour = int(now.hour());
-  DateTime_st.tm_min = int(now.minute());
-  DateTime_st.tm_sec = int(now.second());
-
-  //calculation of calendar week
-  CalendarWeekNumber_u8 = CalcCalendarWeek_u8(DateTime_st.tm_year, DateTime_st.tm_mon, DateTime_st.tm_mday);
-  Serial.print("calendar week: ");
-  Serial.print(CalendarWeekNumber_u8);
-  Serial.print("\n");
-
-  return now;
-
-}
-//------------------------------
+  ScheduleRule_t Rule_ast [SCHEDULE_RULES_MAX];
 
+  long Year_s32 = request->hasParam(PARAM_PREVIEW_YEAR) ? request->getParam(PARAM_PREVIEW_YEAR)->value().toInt() : DateTime_st.tm_year;
+  bool Bin_b = request->hasParam(PARAM_PREVIEW_FORMAT) && (request->getParam(PARAM_PREVIEW_FORMAT)->value() == "bin");
 
-//------------------------------
-// Set date and time of DS3231 to user values
-//------------------------------
-void SetDateTime_v(String DateTimeString)
-{
-  uint16_t Year_u16 = 0;
-  uint8_t Month_u8 = 0;
-  uint8_t Day_u8 = 0;
-  uint8_t Hour_u8 = 0;
-  uint8_t Minute_u8 = 0;
-  uint8_t Second_u8 = 0;
-  char buf5 [5] = {0};
-  char buf3 [3] = {0};
-  char buf2 [2] = {0};
-
-  //convert date-time-string to yyyy, mm, dd, hh, mm, ss
-  // Y Y Y Y - M M - D D     H  H  :  M  M  :  S  S
-  // 0 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18
-
-  //year
-  buf5 [0] = DateTimeString [0];
-  buf5 [1] = DateTimeString [1];
-  buf5 [2] = DateTimeString [2];
-  buf5 [3] = DateTimeString [3];
-  buf5 [4] = '\0';
-  Year_u16 = atoi(buf5);
-
-  //month
-  if(DateTimeString [5] != '0')
-  {
-    buf3 [0] = DateTimeString [5];
-    buf3 [1] = DateTimeString [6];
-    buf3 [2] = '\0';
-    Month_u8 = atoi(buf3);
-  }
-  else
-  {
-    buf2 [0] = DateTimeString [6];
-    buf2 [1] = '\0';
-    Month_u8 = atoi(buf2);
-  }
-
-  //day
-  if(DateTimeString [8] != '0')
-  {
-    buf3 [0] = DateTimeString [8];
-    buf3 [1] = DateTimeString [9];
-    buf3 [2] = '\0';
-    Day_u8 = atoi(buf3);
-  }
-  else
-  {
-    buf2 [0] = DateTimeString [9];
-    buf2 [1] = '\0';
-    Day_u8 = atoi(buf2);
-  }
-
-  //hours
-  if(DateTimeString [11] != '0')
-  {
-    buf3 [0] = DateTimeString [11];
-    buf3 [1] = DateTimeString [12];
-    buf3 [2] = '\0';
-    Hour_u8 = atoi(buf3);
-  }
-  else
+  if((Year_s32 < PREVIEW_YEAR_MIN) || (Year_s32 > PREVIEW_YEAR_MAX))
   {
-    buf2 [0] = DateTimeString [12];
-    buf2 [1] = '\0';
-    Hour_u8 = atoi(buf2);
+    request->send(400, "text/plain", "year out of range");
+    return;
   }
 
-  //minutes
-  if(DateTimeString [14] != '0')
-  {
-    buf3 [0] = DateTimeString [14];
-    buf3 [1] = DateTimeString [15];
-    buf3 [2] = '\0';
-    Minute_u8 = atoi(buf3);
-  }
-  else
-  {
-    buf2 [0] = DateTimeString [15];
-    buf2 [1] = '\0';
-    Minute_u8 = atoi(buf2);
-  }
+  //result and output state live on the heap until the response is sent (too big for the stack of the web server task)
+  SchedulePreviewOut_t *Out_pst = (SchedulePreviewOut_t *)malloc(sizeof(SchedulePreviewOut_t));
 
-  //seconds
-  if(DateTimeString [17] != '0')
-  {
-    buf3 [0] = DateTimeString [17];
-    buf3 [1] = DateTimeString [18];
-    buf3 [2] = '\0';
-    Second_u8 = atoi(buf3);
-  }
-  else
+  if(Out_pst == NULL)
   {
-    buf2 [0] = DateTimeString [18];
-    buf2 [1] = '\0';
-    Second_u8 = atoi(buf2);
+    request->send(503, "text/plain", "out of memory");
+    return;
   }
 
-  Serial.print("set RTC to: \n");
-  Serial.println(Year_u16);
-  Serial.println(Month_u8);
-  Serial.println(Day_u8);
-  Serial.println(Hour_u8);
-  Serial.println(Minute_u8);
-  Serial.println(Second_u8);
-  Serial.print("\n");
-  
+  DeviceConfig_t Current_st;
+  uint8_t RuleCount_u8 = Schedule_GetRules_u8(Rule_ast, SCHEDULE_RULES_MAX);
+  Config_Copy_v(&Current_st);
 
-  rtc.adjust(DateTime(Year_u16, Month_u8, Day_u8, Hour_u8, Minute_u8, Second_u8));  //set RTC to YYYY, M, D, H, M, S
+  uint32_t Start_u32 = micros();
+  SchedulePreview_Compute_v(&Out_pst->Preview_st, Year_s32, ScheduleMode_u8, Rule_ast, RuleCount_u8, LightZone_ScheduleMask_u8(ZONE_SCHEDULE_AUTO),
+                            &Current_st.Photoperiod_st);
+  uint32_t ComputeUsec_u32 = micros() - Start_u32;
 
-  Serial.println("RTC says: ");
+  Serial.printf("schedule preview %ld computed in %u us\n", Year_s32, ComputeUsec_u32);
 
-  //buffer can be defined using following combinations:
-  //hh - the hour with a leading zero (00 to 23)
-  //mm - the minute with a leading zero (00 to 59)
-  //ss - the whole second with a leading zero where applicable (00 to 59)
-  //YYYY - the year as four digit number
-  //YY - the year as two digit number (00-99)
-  //MM - the month as number with a leading zero (01-12)
-  //MMM - the abbreviated English month name ('Jan' to 'Dec')
-  //DD - the day as number with a leading zero (01 to 31)
-  //DDD - the abbreviated English day name ('Mon' to 'Sun')
+  SchedulePreview_OutInit_v(Out_pst, Bin_b ? PREVIEW_FORMAT_BIN : PREVIEW_FORMAT_JSON, ComputeUsec_u32);
 
-  DateTime now = rtc.now();
+  AsyncWebServerResponse *response = request->beginChunkedResponse(Bin_b ? "application/octet-stream" : "application/json", [Out_pst](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                       {
+                                         return SchedulePreview_Fill_u32(Out_pst, buffer, maxLen);
+                                       }
+                                     );
 
-  char buf15[] = "YYMMDD-hh:mm:ss";
-  Serial.println(now.toString(buf15));
+  request->_tempObject = Out_pst;   //freed by the server with the request
+  request->send(response);
 }
 //------------------------------
 
 
 //------------------------------
-// lookup sunrise time
+// send device configuration as JSON
 //------------------------------
-void GetSunriseTime_v(void)
+void SendConfigJson_v(AsyncWebServerRequest *request, int Code_s32)
 {
+  char DateTime_ac [] = "YYYY-MM-DD hh:mm:ss";
 
-  Sunrise_st.tm_hour = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [0];
-  Sunrise_st.tm_min = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [1];
-
-  //dim time and hold time
-  DimTimeMinFromTable_u8 = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [4];
-  HoldTimeMinFromTable_u8 = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [5];
-
-
-}
-//------------------------------
+  I2cBus_RtcNow().toString(DateTime_ac);
 
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->setCode(Code_s32);
 
-//------------------------------
-// lookup sunset time
-//------------------------------
-void GetSunsetTime_v(void)
-{
-  Sunset_st.tm_hour = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [2];
-  Sunset_st.tm_min = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [3];
+  Config_PrintJson_v(*response, DateTime_ac);
 
-  //dim time and hold time
-  DimTimeMinFromTable_u8 = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [4];
-  HoldTimeMinFromTable_u8 = SunriseSunset_au8 [CalendarWeekNumber_u8 - 1] [5];
+  request->send(response);
 }
 //------------------------------
 
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+#------------------------------
+# Host model of the PWM dithering of the light zones
+#
+# Runs the first order sigma-delta modulator of src/LightZones.cpp
+# (DitherTimer_v) for every 16 bit level in the dithered bottom range and
+# reports:
+#   - effective resolution: worst error of the average over one eye
+#     integration window, in bits of full scale
+#   - flicker: lowest frequency of the code sequence and its modulation
+#     depth (percent flicker of the envelope, the PWM carrier excluded)
+#   - the longest time a dawn ramp stays on one output value, with and
+#     without dithering
+#
+# usage:
+#   python3 tools/dither_model.py [--bits 13] [--pwm-hz 5000] [--rate 2500]
+#                                 [--code-max 256] [--window-ms 10] [--ramp-min 60]
+#------------------------------
+
+import argparse
+import cmath
+import math
+
+LEVEL_BITS = 16
+
+#2^(6x) - 1 normalised, 17 points (EaseExp_au16 of src/LightZones.cpp)
+EASE_EXP = [0, 309, 709, 1229, 1902, 2775, 3908, 5377, 7282, 9752,
+            12955, 17110, 22498, 29485, 38546, 50296, 65535]
+
+
+def modulate(level, shift, periods):
+    # same arithmetic as DitherTimer_v, accumulator starts at 0
+    mask = (1 << shift) - 1
+    code = level >> shift
+    acc = 0
+    out = []
+    for _ in range(periods):
+        acc += level & mask
+        out.append(code + (acc >> shift))
+        acc &= mask
+    return out
+
+
+def window_error(seq, level, shift, window):
+    # worst deviation of a moving average from the exact level [level LSB]
+    target = level / (1 << shift)
+    total = sum(seq[:window])
+    worst = abs(total / window - target)
+    for i in range(window, len(seq)):
+        total += seq[i] - seq[i - window]
+        worst = max(worst, abs(total / window - target))
+    return worst * (1 << shift)
+
+
+def fundamental(seq, rate):
+    # frequency and amplitude of the first harmonic of one cycle
+    n = len(seq)
+    x = sum(v * cmath.exp(-2j * math.pi * k / n) for k, v in enumerate(seq))
+    return rate / n, 2 * abs(x) / n
+
+
+def ease_exp_in(fraction):
+    index = min(fraction >> 12, 15)
+    rest = fraction - (index << 12)
+    y = EASE_EXP[index] + (((EASE_EXP[index + 1] - EASE_EXP[index]) * rest) >> 12)
+    return 65536 if y >= 65535 else y
+
+
+def longest_dwell(ramp_msec, shift, code_max, curve, dither):
+    # longest run of one output value in the bottom range, 20 ms engine tick
+    last = None
+    start = 0
+    longest = (0, 0)
+    for t in range(0, ramp_msec + 1, 20):
+        fraction = t * 65536 // ramp_msec
+        eased = ease_exp_in(fraction) if curve == "exp_in" else fraction
+        level = 0xFFFF * eased // 65536
+        if (level >> shift) >= code_max:
+            break
+        value = level if dither else level >> shift
+        if value != last:
+            if last is not None and t - start > longest[0]:
+                longest = (t - start, start)
+            last = value
+            start = t
+    return longest
+
+
+def main():
+    parser = argparse.ArgumentParser(description="sigma-delta PWM dithering model")
+    parser.add_argument("--bits", type=int, default=13, help="LEDC resolution")
+    parser.add_argument("--pwm-hz", type=int, default=5000, help="LEDC frequency")
+    parser.add_argument("--rate", type=int, default=2500, help="ZONE_DITHER_HZ")
+    parser.add_argument("--code-max", type=int, default=256, help="ZONE_DITHER_CODE_MAX")
+    parser.add_argument("--window-ms", type=float, default=10.0, help="eye integration time")
+    parser.add_argument("--ramp-min", type=float, default=60.0, help="dawn ramp duration")
+    args = parser.parse_args()
+
+    shift = LEVEL_BITS - args.bits
+    if shift <= 0:
+        print("LEDC resolution >= %u bit: nothing to dither" % LEVEL_BITS)
+        return
+
+    # a new duty is latched at the end of a PWM period
+    rate = min(args.rate, args.pwm_hz)
+    steps = 1 << shift
+    window = max(1, int(rate * args.window_ms / 1000))
+
+    worst_error = 0.0
+    worst_error_level = 0
+    lowest_hz = None
+    lowest = None
+    worst_depth = (0.0, 0)
+
+    for level in range(1, args.code_max << shift):
+        if level & (steps - 1) == 0:
+            continue
+
+        seq = modulate(level, shift, steps * (window + 2))
+        error = window_error(seq, level, shift, window)
+        if error > worst_error:
+            worst_error, worst_error_level = error, level
+
+        cycle = steps // math.gcd(level & (steps - 1), steps)
+        hz, amplitude = fundamental(seq[:cycle], rate)
+        code = level >> shift
+        depth = 100.0 / (2 * code + 1)          # percent flicker of c / c + 1
+        relative = amplitude * steps / level
+        if lowest_hz is None or hz < lowest_hz or (hz == lowest_hz and relative > lowest[2]):
+            lowest_hz, lowest = hz, (level, amplitude, relative)
+        if depth > worst_depth[0]:
+            worst_depth = (depth, level)
+
+    full_scale = (1 << LEVEL_BITS) - 1
+    effective_bits = LEVEL_BITS - max(0.0, math.log2(max(worst_error, 1.0)))
+
+    print("LEDC %u bit @ %u Hz, dither rate %u Hz, codes < %u dithered (levels < %u)"
+          % (args.bits, args.pwm_hz, rate, args.code_max, args.code_max << shift))
+    print()
+    print("resolution")
+    print("  without dithering       %2u bit   (step %u level LSB)" % (args.bits, steps))
+    print("  with dithering          %5.2f bit (worst %.3f level LSB over %.1f ms, level %u)"
+          % (effective_bits, worst_error, args.window_ms, worst_error_level))
+    print("  relative step at code 1 %.2f %% -> %.2f %% of the level"
+          % (100.0, 100.0 / steps))
+    print()
+    print("flicker (PWM carrier %u Hz not included)" % args.pwm_hz)
+    print("  lowest frequency        %.1f Hz (worst level %u: amplitude %.3f codes, %.0f %% of the mean)"
+          % (lowest_hz, lowest[0], lowest[1], 100.0 * lowest[2]))
+    print("  worst percent flicker   %.1f %% (level %u, alternates codes %u / %u)"
+          % (worst_depth[0], worst_depth[1], worst_depth[1] >> shift, (worst_depth[1] >> shift) + 1))
+    print("  full scale resolution   1 / %u" % full_scale)
+    print()
+
+    ramp_msec = int(args.ramp_min * 60000)
+    print("longest dwell on one output value in the bottom range, %.0f min ramp" % args.ramp_min)
+    for curve in ("linear", "exp_in"):
+        plain = longest_dwell(ramp_msec, shift, args.code_max, curve, False)
+        dither = longest_dwell(ramp_msec, shift, args.code_max, curve, True)
+        print("  %-8s without %7.1f s (at %6.1f s)   with %6.1f s (at %6.1f s)"
+              % (curve, plain[0] / 1000, plain[1] / 1000, dither[0] / 1000, dither[1] / 1000))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,191 @@
+//------------------------------
+// One board of a simulated fleet (host, localhost multicast)
+//
+// Runs src/FleetSync.cpp unchanged in a process with its own uptime
+// clock (random offset, crystal drift) and RTC (offset, drift). The
+// leader publishes a test plan every few seconds, every board prints the
+// wall clock time at which keyframe 0 of each plan happened on it, so
+// the outputs of several processes can be compared (run_local.sh).
+//
+// build (from PlatformIo/Chicken-Light):
+//   g++ -std=gnu++17 -O2 -pthread -Itools/fleet_sim/host -Iinclude tools/fleet_sim/fleet_node.cpp src/FleetSync.cpp -o fleet_node
+//
+// usage:
+//   fleet_node leader|follower [--node N] [--stagger-ms S] [--drift-ppm P] [--rtc-offset-s O]
+//                              [--plan-every-s T] [--run-s R]
+//
+// output (one line per event):
+//   node=1 role=leader plan=1 t0_ms=<wall clock [ms]>
+//   node=2 role=follower plan=1 t0_ms=<wall clock [ms]> late_ms=<joined after start> stagger_ms=<S>
+//------------------------------
+
+#include <Arduino.h>
+#include <time.h>
+#include <thread>
+
+#include "FleetSync.h"
+#include "DeviceConfig.h"
+#include "TaskBudget.h"
+#include "WifiManager.h"
+
+//------------------------------
+// simulated board
+//------------------------------
+std::recursive_mutex SimCriticalMux;
+
+DeviceConfig_t Config_st;
+
+static int64_t StartUsec_s64 = 0;             //host monotonic at start
+static int64_t UptimeBaseUsec_s64 = 0;        //uptime at start (random: boards boot at different times)
+static double DriftPpm_f64 = 0.0;
+static int64_t RtcOffsetMsec_s64 = 0;         //RTC - wall clock
+static uint32_t Node_u32 = 0;
+static const char *Role_pc = "";
+static uint8_t PlanCount_u8 = 0;
+
+static int64_t MonotonicUsec_s64(void)
+{
+  struct timespec Now_st;
+  clock_gettime(CLOCK_MONOTONIC, &Now_st);
+  return (int64_t)Now_st.tv_sec * 1000000 + Now_st.tv_nsec / 1000;
+}
+
+static int64_t WallMsec_s64(void)
+{
+  struct timespec Now_st;
+  clock_gettime(CLOCK_REALTIME, &Now_st);
+  return (int64_t)Now_st.tv_sec * 1000 + Now_st.tv_nsec / 1000000;
+}
+
+int64_t SimUptimeUsec_s64(void)
+{
+  int64_t Elapsed_s64 = MonotonicUsec_s64() - StartUsec_s64;
+  return UptimeBaseUsec_s64 + Elapsed_s64 + (int64_t)(Elapsed_s64 * DriftPpm_f64 / 1e6);
+}
+
+static uint32_t RtcUnix_u32(void)
+{
+  return (WallMsec_s64() + RtcOffsetMsec_s64) / 1000;
+}
+
+static void RtcSet_v(uint32_t Unix_u32)
+{
+  //the RTC starts the new second now
+  RtcOffsetMsec_s64 = (int64_t)Unix_u32 * 1000 - WallMsec_s64();
+  printf("node=%u role=%s rtc_set=%u\n", Node_u32, Role_pc, Unix_u32);
+}
+
+static void Plan_v(const LightKeyframe_t *Keyframe_past, uint8_t Count_u8, uint32_t OffsetMsec_u32)
+{
+  printf("node=%u role=%s plan=%u t0_ms=%lld late_ms=%u stagger_ms=%u\n", Node_u32, Role_pc, ++PlanCount_u8,
+         (long long)(WallMsec_s64() - OffsetMsec_u32), OffsetMsec_u32, Config_st.FleetStaggerMsec_u16);
+  fflush(stdout);
+}
+
+class StdoutPrint : public Print
+{
+  public:
+    size_t write(uint8_t c) { return fputc(c, stdout) != EOF; }
+};
+//------------------------------
+
+
+//------------------------------
+// firmware functions used by FleetSync.cpp
+//------------------------------
+void Config_Copy_v(DeviceConfig_t *Config_pst)
+{
+  std::lock_guard<std::recursive_mutex> Lock(SimCriticalMux);
+  *Config_pst = Config_st;
+}
+
+bool Wifi_Connected_b(void) { return true; }
+uint32_t Wifi_ConnectCount_u32(void) { return 1; }
+
+TaskHandle_t Task_Start_h(uint8_t Task_u8, TaskFunction_t Func_pfn, void *Param_pv)
+{
+  std::thread(Func_pfn, Param_pv).detach();
+  return NULL;
+}
+//------------------------------
+
+
+int main(int argc, char **argv)
+{
+  uint32_t PlanEverySec_u32 = 5;
+  uint32_t RunSec_u32 = 30;
+
+  if(argc < 2)
+  {
+    fprintf(stderr, "usage: fleet_node leader|follower [--node N] [--stagger-ms S] [--drift-ppm P] [--rtc-offset-s O]"
+                    " [--plan-every-s T] [--run-s R]\n");
+    return 2;
+  }
+
+  memset(&Config_st, 0, sizeof(Config_st));
+  Config_st.FleetRole_u8 = Fleet_RoleFromName_u8(argv [1]);
+
+  if((Config_st.FleetRole_u8 != FLEET_ROLE_LEADER) && (Config_st.FleetRole_u8 != FLEET_ROLE_FOLLOWER))
+  {
+    fprintf(stderr, "role: leader or follower\n");
+    return 2;
+  }
+
+  Role_pc = argv [1];
+  Node_u32 = getpid();
+
+  for(int i = 2; i + 1 < argc; i += 2)
+  {
+    if(strcmp(argv [i], "--node") == 0) Node_u32 = strtoul(argv [i + 1], NULL, 0);
+    else if(strcmp(argv [i], "--stagger-ms") == 0) Config_st.FleetStaggerMsec_u16 = strtoul(argv [i + 1], NULL, 0);
+    else if(strcmp(argv [i], "--drift-ppm") == 0) DriftPpm_f64 = atof(argv [i + 1]);
+    else if(strcmp(argv [i], "--rtc-offset-s") == 0) RtcOffsetMsec_s64 = (int64_t)(atof(argv [i + 1]) * 1000);
+    else if(strcmp(argv [i], "--plan-every-s") == 0) PlanEverySec_u32 = strtoul(argv [i + 1], NULL, 0);
+    else if(strcmp(argv [i], "--run-s") == 0) RunSec_u32 = strtoul(argv [i + 1], NULL, 0);
+    else
+    {
+      fprintf(stderr, "unknown option %s\n", argv [i]);
+      return 2;
+    }
+  }
+
+  srand(Node_u32);
+  StartUsec_s64 = MonotonicUsec_s64();
+  UptimeBaseUsec_s64 = (int64_t)(rand() % 100000) * 1000 + rand() % 1000;
+
+  FleetHooks_t Hooks_st = {Node_u32, RtcUnix_u32, RtcSet_v, Plan_v};
+  Fleet_Start_v(&Hooks_st);
+
+  //leader: sunrise-like test plan every PlanEverySec_u32 (followers only print)
+  const LightKeyframe_t Test_ast [] =
+  {
+    {0,   0,               ZONE_EASE_LINEAR},
+    {2,   ZONE_LEVEL_MAX,  ZONE_EASE_EXP_IN},
+    {3,   0,               ZONE_EASE_STEP},
+  };
+
+  int64_t EndUsec_s64 = MonotonicUsec_s64() + (int64_t)RunSec_u32 * 1000000;
+  int64_t NextPlanUsec_s64 = MonotonicUsec_s64() + 3000000;     //followers lock first
+
+  while(MonotonicUsec_s64() < EndUsec_s64)
+  {
+    if((Config_st.FleetRole_u8 == FLEET_ROLE_LEADER) && (MonotonicUsec_s64() >= NextPlanUsec_s64))
+    {
+      NextPlanUsec_s64 += (int64_t)PlanEverySec_u32 * 1000000;
+      Fleet_Publish_v(Test_ast, sizeof(Test_ast) / sizeof(Test_ast [0]));
+      Plan_v(Test_ast, sizeof(Test_ast) / sizeof(Test_ast [0]), 0);
+    }
+
+    usleep(10000);
+  }
+
+  StdoutPrint Out;
+
+  printf("node=%u role=%s status=", Node_u32, Role_pc);
+  Fleet_PrintJson_v(Out);
+  printf("\n");
+  fflush(stdout);
+
+  //fleet task thread still runs
+  _exit(0);
+}
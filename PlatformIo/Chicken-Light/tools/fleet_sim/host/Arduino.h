@@ -0,0 +1,74 @@
+//------------------------------
+// Host build of the fleet synchronization (fleet_sim)
+//
+// just enough of Arduino / FreeRTOS for src/FleetSync.cpp: every process
+// is one board with its own uptime clock (offset, crystal drift) and RTC,
+// tasks are threads, critical sections one process wide mutex
+//------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+
+using std::min;
+using std::max;
+
+//board clocks (fleet_node.cpp)
+int64_t SimUptimeUsec_s64(void);
+
+inline uint32_t millis(void) { return SimUptimeUsec_s64() / 1000; }
+
+//FreeRTOS
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef void *SemaphoreHandle_t;
+typedef uint32_t TickType_t;
+typedef std::recursive_mutex portMUX_TYPE;
+
+extern std::recursive_mutex SimCriticalMux;
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(Mux) ((void)(Mux), SimCriticalMux.lock())
+#define portEXIT_CRITICAL(Mux) ((void)(Mux), SimCriticalMux.unlock())
+#define pdMS_TO_TICKS(Msec) (Msec)
+
+inline void vTaskDelay(TickType_t Ticks) { usleep(Ticks * 1000); }
+
+//Print with printf (status JSON)
+class Print
+{
+  public:
+    virtual size_t write(uint8_t c) = 0;
+
+    size_t printf(const char *Format_pc, ...)
+    {
+      char Buf_ac [512];
+      va_list Args;
+
+      va_start(Args, Format_pc);
+      int Len_s32 = vsnprintf(Buf_ac, sizeof(Buf_ac), Format_pc, Args);
+      va_end(Args);
+
+      for(int i = 0; (i < Len_s32) && (i < (int)sizeof(Buf_ac) - 1); i++)
+      {
+        write(Buf_ac [i]);
+      }
+
+      return Len_s32;
+    }
+};
+
+class IPAddress
+{
+  public:
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : Byte_au8 {a, b, c, d} {}
+    uint8_t Byte_au8 [4];
+};
@@ -0,0 +1,111 @@
+//------------------------------
+// Host build of the fleet synchronization (fleet_sim)
+//
+// WiFiUDP multicast on the loopback interface: all processes of one host
+// bind the same port (SO_REUSEPORT) and join the group on 127.0.0.1
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+
+class WiFiUDP
+{
+  public:
+    uint8_t beginMulticast(IPAddress Group, uint16_t Port_u16)
+    {
+      int On_s32 = 1;
+      struct sockaddr_in Addr_st = {};
+      struct ip_mreq Member_st = {};
+      struct in_addr Loopback_st = {};
+
+      Fd_s32 = socket(AF_INET, SOCK_DGRAM, 0);
+
+      if(Fd_s32 < 0)
+      {
+        return 0;
+      }
+
+      setsockopt(Fd_s32, SOL_SOCKET, SO_REUSEADDR, &On_s32, sizeof(On_s32));
+      setsockopt(Fd_s32, SOL_SOCKET, SO_REUSEPORT, &On_s32, sizeof(On_s32));
+
+      Addr_st.sin_family = AF_INET;
+      Addr_st.sin_port = htons(Port_u16);
+      Addr_st.sin_addr.s_addr = htonl(INADDR_ANY);
+
+      memcpy(&Group_st.sin_addr.s_addr, Group.Byte_au8, 4);
+      Group_st.sin_family = AF_INET;
+      Group_st.sin_port = htons(Port_u16);
+
+      Loopback_st.s_addr = htonl(INADDR_LOOPBACK);
+      Member_st.imr_multiaddr = Group_st.sin_addr;
+      Member_st.imr_interface = Loopback_st;
+
+      if((bind(Fd_s32, (struct sockaddr *)&Addr_st, sizeof(Addr_st)) < 0)
+         || (setsockopt(Fd_s32, IPPROTO_IP, IP_ADD_MEMBERSHIP, &Member_st, sizeof(Member_st)) < 0)
+         || (setsockopt(Fd_s32, IPPROTO_IP, IP_MULTICAST_IF, &Loopback_st, sizeof(Loopback_st)) < 0)
+         || (setsockopt(Fd_s32, IPPROTO_IP, IP_MULTICAST_LOOP, &On_s32, sizeof(On_s32)) < 0))
+      {
+        perror("fleet_sim: multicast on loopback");
+        stop();
+        return 0;
+      }
+
+      fcntl(Fd_s32, F_SETFL, O_NONBLOCK);
+
+      return 1;
+    }
+
+    void stop(void)
+    {
+      if(Fd_s32 >= 0)
+      {
+        close(Fd_s32);
+        Fd_s32 = -1;
+      }
+    }
+
+    int beginMulticastPacket(void)
+    {
+      TxLen_u32 = 0;
+      return 1;
+    }
+
+    size_t write(const uint8_t *Data_pu8, size_t Len_u32)
+    {
+      Len_u32 = min(Len_u32, sizeof(Tx_au8) - TxLen_u32);
+      memcpy(Tx_au8 + TxLen_u32, Data_pu8, Len_u32);
+      TxLen_u32 += Len_u32;
+      return Len_u32;
+    }
+
+    int endPacket(void)
+    {
+      return sendto(Fd_s32, Tx_au8, TxLen_u32, 0, (struct sockaddr *)&Group_st, sizeof(Group_st)) == (ssize_t)TxLen_u32;
+    }
+
+    int parsePacket(void)
+    {
+      RxLen_s32 = (Fd_s32 >= 0) ? recv(Fd_s32, Rx_au8, sizeof(Rx_au8), 0) : -1;
+      return max(RxLen_s32, 0);
+    }
+
+    int read(uint8_t *Buf_pu8, size_t Len_u32)
+    {
+      int Len_s32 = min<int>(Len_u32, max(RxLen_s32, 0));
+      memcpy(Buf_pu8, Rx_au8, Len_s32);
+      return Len_s32;
+    }
+
+  private:
+    int Fd_s32 = -1;
+    struct sockaddr_in Group_st = {};
+    uint8_t Tx_au8 [1472];
+    size_t TxLen_u32 = 0;
+    uint8_t Rx_au8 [1472];
+    int RxLen_s32 = 0;
+};
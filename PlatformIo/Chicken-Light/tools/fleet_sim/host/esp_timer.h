@@ -0,0 +1,12 @@
+//------------------------------
+// Host build of the fleet synchronization (fleet_sim)
+//
+// esp_timer: uptime clock of the simulated board
+//------------------------------
+#pragma once
+
+#include <stdint.h>
+
+int64_t SimUptimeUsec_s64(void);
+
+inline int64_t esp_timer_get_time(void) { return SimUptimeUsec_s64(); }
@@ -0,0 +1,46 @@
+#!/bin/sh
+#------------------------------
+# Fleet synchronization on localhost: one leader, three followers
+#
+# Followers have crystal drift, a wrong RTC and one a stagger; for every
+# plan the start of each follower is compared with the leader's
+# (error = follower t0 - stagger - leader t0).
+#
+# usage (from PlatformIo/Chicken-Light):
+#   sh tools/fleet_sim/run_local.sh [run seconds]
+#------------------------------
+set -e
+
+RUN_S=${1:-20}
+OUT=$(mktemp -d)
+
+g++ -std=gnu++17 -O2 -pthread -Itools/fleet_sim/host -Iinclude tools/fleet_sim/fleet_node.cpp src/FleetSync.cpp -o "$OUT/fleet_node"
+
+"$OUT/fleet_node" leader   --node 1 --run-s "$RUN_S" --plan-every-s 4                                  > "$OUT/1.txt" &
+"$OUT/fleet_node" follower --node 2 --run-s "$RUN_S" --drift-ppm 80 --rtc-offset-s -7.3                > "$OUT/2.txt" &
+"$OUT/fleet_node" follower --node 3 --run-s "$RUN_S" --drift-ppm -50 --rtc-offset-s 3 --stagger-ms 500 > "$OUT/3.txt" &
+"$OUT/fleet_node" follower --node 4 --run-s "$RUN_S" --drift-ppm 20 --stagger-ms 1000                  > "$OUT/4.txt" &
+wait
+
+cat "$OUT"/*.txt | grep -v "plan=" || true
+
+cat "$OUT"/*.txt | awk '
+  /plan=/ {
+    for(i = 1; i <= NF; i++) { split($i, kv, "="); v[kv[1]] = kv[2] }
+    if(v["role"] == "leader") { lead[v["plan"]] = v["t0_ms"] }
+    else { n++; node[n] = v["node"]; plan[n] = v["plan"]; t0[n] = v["t0_ms"]; stagger[n] = v["stagger_ms"]; late[n] = v["late_ms"] }
+  }
+  END {
+    worst = 0
+    for(i = 1; i <= n; i++)
+    {
+      #followers count the plans they ran, the first one may be the repeat of an earlier plan
+      best = ""
+      for(p in lead) { e = t0[i] - stagger[i] - lead[p]; if(best == "" || (e * e < best * best)) best = e }
+      printf("node %s plan %s: error %d ms (joined %s ms late, stagger %s ms)\n", node[i], plan[i], best, late[i], stagger[i])
+      if(best * best > worst * worst) worst = best
+    }
+    printf("plans %d, worst error %d ms\n", n, worst)
+  }'
+
+rm -rf "$OUT"
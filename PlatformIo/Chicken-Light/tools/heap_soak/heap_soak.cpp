@@ -0,0 +1,733 @@
+//------------------------------
+// Heap fragmentation soak of the text paths (host)
+//
+// Runs the page, NTP result and /get parameter paths for --days simulated
+// days on a simulated ESP32 heap (first fit, 8 byte block header,
+// neighbours merged on free) and logs the largest free block per day.
+// The rest of the firmware is a fixed background load on the same heap:
+// MQTT publishes every minute, web requests with their chunk buffer,
+// keep-alive connections of up to 3 h and the UDP buffer of each NTP sync.
+//
+//   text    src/TextFormat.cpp, src/PageTemplate.cpp (data/index.html)
+//           and the NtpClock result hook of main.cpp, as used now (UTC
+//           in microseconds, RTC set from the unix time, no date text)
+//   string  the String chains these paths had before: processor(),
+//           NTPClient::getFormattedDate() into a global String,
+//           SetDateTime_v(String), String copies of /get parameters
+//
+// Both modes see the same background load (same seed). The text mode
+// also holds index.html in RAM from boot (the old server read it per
+// request), so its free heap starts lower by the template size; compare
+// the trend of each mode, not the absolute values.
+//
+// build (from PlatformIo/Chicken-Light):
+//   g++ -std=gnu++17 -O2 -Itools/heap_soak/host -Iinclude tools/heap_soak/heap_soak.cpp src/TextFormat.cpp src/PageTemplate.cpp -o heap_soak
+//
+// usage (from PlatformIo/Chicken-Light, reads data/index.html):
+//   heap_soak [--days N] [--heap-kb K] [--mode text|string|both] [--seed S] [--verbose]
+//
+// exit code: 0 text paths allocate nothing after boot and their largest
+// free block does not shrink over the soak, 1 otherwise
+//------------------------------
+
+//includes
+//------------------------------
+#include <Arduino.h>
+#include <time.h>
+
+#include <new>
+
+#include "TextFormat.h"
+#include "PageTemplate.h"
+#include "SPIFFS.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define SOAK_DAYS_DEFAULT 30
+#define SOAK_HEAP_KB_DEFAULT 96               //free DRAM heap with WiFi, web server and MQTT up
+#define SOAK_START_UNIX 1740787200UL          //2025-03-01 00:00
+
+#define HEAP_ALIGN 4
+#define HEAP_HEADER 8                         //size + state, like multi_heap
+#define HEAP_SPLIT_MIN 16                     //smaller rests stay with the block
+
+#define MINUTES_PER_DAY 1440
+#define NTP_SYNC_MIN 15                       //NTP_SYNC_INTERVAL_MIN of main.cpp
+#define NTP_UTC_OFFSET_SEC 3600               //of main.cpp, RTC runs on CET
+#define PAGE_VIEWS_PER_DAY 96
+#define GET_PER_DAY 2                         //threshold changes via /get
+#define CHUNK_BYTES 1436                      //one TCP segment per chunk callback
+
+#define BACKGROUND_MAX 128
+
+#define MODE_TEXT 0
+#define MODE_STRING 1
+//------------------------------
+
+//global variables
+//------------------------------
+HostSerial Serial;
+HostSpiffs SPIFFS;
+uint32_t SimMillis_u32 = 0;
+
+static uint8_t *Heap_pu8 = NULL;
+static size_t HeapSize_u32 = SOAK_HEAP_KB_DEFAULT * 1024;
+
+static bool InPath_b = false;                 //allocations of the text paths are counted
+static uint32_t PathAllocs_u32 = 0;
+static uint32_t HeapFailed_u32 = 0;
+
+typedef struct
+{
+  void *Ptr_pv;
+  uint32_t ExpireMin_u32;
+} BackgroundBlock_t;
+
+static BackgroundBlock_t Background_ast [BACKGROUND_MAX];
+static uint32_t RandomState_u32 = 1;
+
+static uint32_t Now_u32 = SOAK_START_UNIX;    //simulated RTC
+static uint32_t Minute_u32 = 0;               //since start
+
+static String NtpFormattedDate;               //global of the old NTP sync
+static volatile long Sink_s32;                //parsed values of the string mode
+//------------------------------
+
+
+//------------------------------
+// simulated heap: first fit over address ordered blocks
+//------------------------------
+static uint32_t *Block_pu32(size_t Offset_u32)
+{
+  return (uint32_t *)&Heap_pu8 [Offset_u32];         //[0] size with header, [1] 1 = used
+}
+
+static void HeapInit_v(void)
+{
+  //host memory behind the simulated heap (names in parentheses: not the SimHeap macros)
+  (free)(Heap_pu8);
+  Heap_pu8 = (uint8_t *)(malloc)(HeapSize_u32);
+  Block_pu32(0) [0] = HeapSize_u32;
+  Block_pu32(0) [1] = 0;
+}
+
+void *SimHeap_Malloc_pv(size_t Size_u32)
+{
+  if(Heap_pu8 == NULL)
+  {
+    HeapInit_v();
+  }
+
+  size_t Need_u32 = (max(Size_u32, (size_t)1) + HEAP_HEADER + HEAP_ALIGN - 1) & ~(size_t)(HEAP_ALIGN - 1);
+
+  PathAllocs_u32 += InPath_b ? 1 : 0;
+
+  for(size_t Offset_u32 = 0; Offset_u32 < HeapSize_u32; Offset_u32 += Block_pu32(Offset_u32) [0])
+  {
+    uint32_t *Block_p = Block_pu32(Offset_u32);
+
+    if((Block_p [1] == 0) && (Block_p [0] >= Need_u32))
+    {
+      if(Block_p [0] - Need_u32 >= HEAP_HEADER + HEAP_SPLIT_MIN)
+      {
+        Block_pu32(Offset_u32 + Need_u32) [0] = Block_p [0] - Need_u32;
+        Block_pu32(Offset_u32 + Need_u32) [1] = 0;
+        Block_p [0] = Need_u32;
+      }
+
+      Block_p [1] = 1;
+      return &Heap_pu8 [Offset_u32 + HEAP_HEADER];
+    }
+  }
+
+  HeapFailed_u32++;
+  return NULL;
+}
+
+void SimHeap_Free_v(void *Ptr_pv)
+{
+  if(Ptr_pv == NULL)
+  {
+    return;
+  }
+
+  Block_pu32((uint8_t *)Ptr_pv - Heap_pu8 - HEAP_HEADER) [1] = 0;
+
+  //merge free neighbours
+  for(size_t Offset_u32 = 0; Offset_u32 < HeapSize_u32; Offset_u32 += Block_pu32(Offset_u32) [0])
+  {
+    uint32_t *Block_p = Block_pu32(Offset_u32);
+
+    while((Block_p [1] == 0) && (Offset_u32 + Block_p [0] < HeapSize_u32) && (Block_pu32(Offset_u32 + Block_p [0]) [1] == 0))
+    {
+      Block_p [0] += Block_pu32(Offset_u32 + Block_p [0]) [0];
+    }
+  }
+}
+
+void *SimHeap_Realloc_pv(void *Ptr_pv, size_t Size_u32)
+{
+  void *New_pv = SimHeap_Malloc_pv(Size_u32);
+
+  if((Ptr_pv != NULL) && (New_pv != NULL))
+  {
+    size_t Old_u32 = Block_pu32((uint8_t *)Ptr_pv - Heap_pu8 - HEAP_HEADER) [0] - HEAP_HEADER;
+
+    memcpy(New_pv, Ptr_pv, min(Old_u32, Size_u32));
+  }
+
+  SimHeap_Free_v(Ptr_pv);
+  return New_pv;
+}
+
+static void HeapStats_v(size_t *Free_pu32, size_t *Largest_pu32)
+{
+  *Free_pu32 = 0;
+  *Largest_pu32 = 0;
+
+  for(size_t Offset_u32 = 0; Offset_u32 < HeapSize_u32; Offset_u32 += Block_pu32(Offset_u32) [0])
+  {
+    if(Block_pu32(Offset_u32) [1] == 0)
+    {
+      *Free_pu32 += Block_pu32(Offset_u32) [0] - HEAP_HEADER;
+      *Largest_pu32 = max(*Largest_pu32, (size_t)Block_pu32(Offset_u32) [0] - HEAP_HEADER);
+    }
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// C++ allocations of the paths go to the simulated heap as well
+//------------------------------
+void *operator new(size_t Size_u32)
+{
+  void *Ptr_pv = SimHeap_Malloc_pv(Size_u32);
+
+  if(Ptr_pv == NULL)
+  {
+    throw std::bad_alloc();
+  }
+
+  return Ptr_pv;
+}
+
+void operator delete(void *Ptr_pv) noexcept
+{
+  SimHeap_Free_v(Ptr_pv);
+}
+
+void operator delete(void *Ptr_pv, size_t Size_u32) noexcept
+{
+  SimHeap_Free_v(Ptr_pv);
+}
+//------------------------------
+
+
+//------------------------------
+// background load of the rest of the firmware
+//------------------------------
+static uint32_t Random_u32(uint32_t Range_u32)
+{
+  //xorshift32
+  RandomState_u32 ^= RandomState_u32 << 13;
+  RandomState_u32 ^= RandomState_u32 >> 17;
+  RandomState_u32 ^= RandomState_u32 << 5;
+
+  return RandomState_u32 % Range_u32;
+}
+
+static void *BackgroundAlloc_pv(size_t Size_u32, uint32_t LifeMin_u32)
+{
+  for(uint8_t i = 0; i < BACKGROUND_MAX; i++)
+  {
+    if(Background_ast [i].Ptr_pv == NULL)
+    {
+      Background_ast [i].Ptr_pv = SimHeap_Malloc_pv(Size_u32);
+      Background_ast [i].ExpireMin_u32 = (LifeMin_u32 == UINT32_MAX) ? UINT32_MAX : Minute_u32 + LifeMin_u32;
+      return Background_ast [i].Ptr_pv;
+    }
+  }
+
+  return NULL;
+}
+
+static void BackgroundExpire_v(void)
+{
+  for(uint8_t i = 0; i < BACKGROUND_MAX; i++)
+  {
+    if((Background_ast [i].Ptr_pv != NULL) && (Background_ast [i].ExpireMin_u32 <= Minute_u32))
+    {
+      SimHeap_Free_v(Background_ast [i].Ptr_pv);
+      Background_ast [i].Ptr_pv = NULL;
+    }
+  }
+}
+
+static void BackgroundClear_v(void)
+{
+  for(uint8_t i = 0; i < BACKGROUND_MAX; i++)
+  {
+    Background_ast [i].Ptr_pv = NULL;
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// simulated device state behind the page values
+//------------------------------
+static void Now_v(struct tm *Time_pst)
+{
+  time_t Time = Now_u32;
+
+  gmtime_r(&Time, Time_pst);
+  Time_pst->tm_year += 1900;
+  Time_pst->tm_mon += 1;
+}
+
+static float Temperature_f32(void)
+{
+  return 12.0F + 8.0F * sinf((Now_u32 % 86400) * 2.0F * (float)M_PI / 86400.0F);
+}
+
+static uint8_t DutyCycle_u8(void)
+{
+  uint32_t Day_u32 = Now_u32 % 86400 / 60;
+
+  return ((Day_u32 >= 5 * 60) && (Day_u32 < 21 * 60)) ? 100 : 0;
+}
+
+static uint16_t SunriseMin_u16(void)
+{
+  return 6 * 60 + (Now_u32 / 86400) % 120;
+}
+//------------------------------
+
+
+//------------------------------
+// text mode: page values with Text_t (PageVar_u32 of main.cpp)
+//------------------------------
+static size_t SoakPageVar_u32(uint8_t Var_u8, char *Buf_pc, size_t Size_u32)
+{
+  Text_t Text_st;
+  struct tm Time_st;
+
+  Text_Init_v(&Text_st, Buf_pc, Size_u32);
+  Now_v(&Time_st);
+
+  switch(Var_u8)
+  {
+    case PAGE_VAR_DATE_TIME:
+      Text_Uint_v(&Text_st, Time_st.tm_mday);
+      Text_Char_v(&Text_st, '-');
+      Text_Uint_v(&Text_st, Time_st.tm_mon);
+      Text_Char_v(&Text_st, '-');
+      Text_Uint_v(&Text_st, Time_st.tm_year);
+      Text_Str_v(&Text_st, "  ");
+      Text_Uint_v(&Text_st, Time_st.tm_hour);
+      Text_Char_v(&Text_st, ':');
+      Text_Uint_v(&Text_st, Time_st.tm_min, 2);
+      break;
+
+    case PAGE_VAR_TEMP:
+      Text_Fixed_v(&Text_st, Temperature_f32(), 1);
+      break;
+
+    case PAGE_VAR_LIGHT_DUTYCYCLE:
+      Text_Uint_v(&Text_st, DutyCycle_u8());
+      break;
+
+    case PAGE_VAR_STATE:
+      Text_Str_v(&Text_st, DutyCycle_u8() ? "WAIT TIME SUNRISE" : "IDLE");
+      break;
+
+    case PAGE_VAR_SUNRISE:
+      Text_Time_v(&Text_st, SunriseMin_u16() / 60, SunriseMin_u16() % 60);
+      break;
+
+    case PAGE_VAR_SUNSET:
+      Text_Time_v(&Text_st, 17 + SunriseMin_u16() % 3, SunriseMin_u16() % 60);
+      break;
+
+    case PAGE_VAR_THRESHOLD_DARK:
+      Text_Uint_v(&Text_st, 20);
+      break;
+
+    case PAGE_VAR_THRESHOLD_BRIGHT:
+      Text_Uint_v(&Text_st, 80);
+      break;
+
+    case PAGE_VAR_VERSION:
+      Text_Uint_v(&Text_st, 1);
+      Text_Char_v(&Text_st, '.');
+      Text_Uint_v(&Text_st, 4);
+      break;
+
+    default:
+      break;
+  }
+
+  return Text_Len_u32(&Text_st);
+}
+
+static void TextPage_v(uint8_t *Chunk_pu8)
+{
+  PageRenderState_t State_st;
+
+  PageTemplate_RenderInit_v(&State_st);
+
+  while(PageTemplate_Fill_u32(&State_st, Chunk_pu8, CHUNK_BYTES) > 0)
+  {
+  }
+}
+
+//NtpResult_v: NtpClock passes UTC in microseconds, the RTC is set from the
+//unix time (DateTime of RTClib), the page shows it on the next render
+static void TextNtp_v(void)
+{
+  int64_t UnixUsec_s64 = ((int64_t)Now_u32 - NTP_UTC_OFFSET_SEC) * 1000000 + 250000;
+  uint32_t Unix_u32 = UnixUsec_s64 / 1000000 + NTP_UTC_OFFSET_SEC;
+  time_t Time = Unix_u32;
+  struct tm Time_st;
+
+  gmtime_r(&Time, &Time_st);
+
+  if(Unix_u32 != Now_u32)
+  {
+    printf("text: NTP time %u not accepted\n", Unix_u32);
+  }
+}
+
+static void TextGet_v(void)
+{
+  const char *Value_pc = "42";                //value of the request parameter
+  uint32_t Percent_u32;
+
+  Text_ParseUint_b(Value_pc, NULL, &Percent_u32);
+}
+//------------------------------
+
+
+//------------------------------
+// string mode: the paths before the Text_t layer
+//------------------------------
+static String LegacyProcessor(const String &Var)
+{
+  String RetStr = "";
+  struct tm Time_st;
+
+  Now_v(&Time_st);
+
+  if(Var == "DATE_TIME")
+  {
+    RetStr = String(Time_st.tm_mday) + "-" + String(Time_st.tm_mon) + "-" + String(Time_st.tm_year) + "  " +
+             String(Time_st.tm_hour) + ((Time_st.tm_min > 9) ? ":" : ":0") + String(Time_st.tm_min);
+  }
+  else if(Var == "TEMP")
+  {
+    RetStr = String(Temperature_f32(), 1);
+  }
+  else if(Var == "LIGHT_DUTYCYCLE")
+  {
+    RetStr = String(DutyCycle_u8());
+  }
+  else if(Var == "STATE")
+  {
+    RetStr = DutyCycle_u8() ? "WAIT TIME SUNRISE" : "IDLE";
+  }
+  else if((Var == "SUNRISE") || (Var == "SUNSET"))
+  {
+    uint16_t Hour_u16 = (Var == "SUNRISE") ? SunriseMin_u16() / 60 : 17 + SunriseMin_u16() % 3;
+    uint16_t Minute_u16 = SunriseMin_u16() % 60;
+
+    RetStr = ((Hour_u16 > 9) ? String("") : String("0")) + String(Hour_u16) + ((Minute_u16 > 9) ? ":" : ":0") + String(Minute_u16);
+  }
+  else if(Var == "THRESHOLD_DARK")
+  {
+    RetStr = String(20);
+  }
+  else if(Var == "THRESHOLD_BRIGHT")
+  {
+    RetStr = String(80);
+  }
+  else if(Var == "VERSION")
+  {
+    RetStr = String(1) + "." + String(4);
+  }
+
+  return RetStr;
+}
+
+//template processor of the web server: String per marker name and value
+static void StringPage_v(uint8_t *Chunk_pu8, const char *Template_pc)
+{
+  size_t Fill_u32 = 0;
+
+  for(const char *Pos_pc = Template_pc; *Pos_pc != '\0'; Pos_pc++)
+  {
+    const char *End_pc = (*Pos_pc == '%') ? strchr(Pos_pc + 1, '%') : NULL;
+
+    if((End_pc != NULL) && (End_pc - Pos_pc > 1) && (End_pc - Pos_pc < 32))
+    {
+      String Var = String("").substring(0);
+      Var.concat(Pos_pc + 1, End_pc - Pos_pc - 1);
+
+      String Value = LegacyProcessor(Var);
+
+      for(size_t i = 0; i < Value.length(); i++)
+      {
+        Chunk_pu8 [Fill_u32++ % CHUNK_BYTES] = Value [i];
+      }
+
+      Pos_pc = End_pc;
+    }
+    else
+    {
+      Chunk_pu8 [Fill_u32++ % CHUNK_BYTES] = *Pos_pc;
+    }
+  }
+}
+
+static String LegacyFormattedDate(unsigned long Secs_u32)
+{
+  struct tm Time_st;
+  time_t Time = Secs_u32;
+
+  gmtime_r(&Time, &Time_st);
+
+  String MonthStr = (Time_st.tm_mon + 1 < 10) ? "0" + String(Time_st.tm_mon + 1) : String(Time_st.tm_mon + 1);
+  String DayStr = (Time_st.tm_mday < 10) ? "0" + String(Time_st.tm_mday) : String(Time_st.tm_mday);
+  String HoursStr = (Time_st.tm_hour < 10) ? "0" + String(Time_st.tm_hour) : String(Time_st.tm_hour);
+  String MinuteStr = (Time_st.tm_min < 10) ? "0" + String(Time_st.tm_min) : String(Time_st.tm_min);
+  String SecondStr = (Time_st.tm_sec < 10) ? "0" + String(Time_st.tm_sec) : String(Time_st.tm_sec);
+
+  return String(Time_st.tm_year + 1900) + "-" + MonthStr + "-" + DayStr + "T" + (HoursStr + ":" + MinuteStr + ":" + SecondStr) + "Z";
+}
+
+static void LegacySetDateTime_v(String DateTimeString)
+{
+  Sink_s32 = DateTimeString.substring(0, 4).toInt();
+  Sink_s32 = DateTimeString.substring(5, 7).toInt();
+}
+
+static void StringNtp_v(void)
+{
+  NtpFormattedDate = LegacyFormattedDate(Now_u32);
+  LegacySetDateTime_v(NtpFormattedDate);
+}
+
+static void StringGet_v(void)
+{
+  String InputMessage;
+  String InputParam;
+
+  InputMessage = String("42");
+  InputParam = "threshold_dark";
+  Sink_s32 = InputMessage.toInt();
+}
+//------------------------------
+
+
+//------------------------------
+// one soak run, returns min. largest free block per day
+//------------------------------
+static void Soak_v(uint8_t Mode_u8, uint16_t Days_u16, uint32_t Seed_u32, const char *Template_pc,
+                   size_t *Largest_pu32, size_t *Free_pu32)
+{
+  HeapInit_v();
+  BackgroundClear_v();
+  NtpFormattedDate = String();
+
+  RandomState_u32 = Seed_u32;
+  Now_u32 = SOAK_START_UNIX;
+  Minute_u32 = 0;
+  PathAllocs_u32 = 0;
+  HeapFailed_u32 = 0;
+
+  //boot: template buffer (text mode), web server and MQTT client
+  if(Mode_u8 == MODE_TEXT)
+  {
+    PageTemplate_Load_b("/index.html", SoakPageVar_u32);
+  }
+
+  BackgroundAlloc_pv(6144, UINT32_MAX);
+  BackgroundAlloc_pv(2048, UINT32_MAX);
+
+  for(uint16_t Day_u16 = 0; Day_u16 < Days_u16; Day_u16++)
+  {
+    Largest_pu32 [Day_u16] = HeapSize_u32;
+    Free_pu32 [Day_u16] = HeapSize_u32;
+
+    for(uint16_t Min_u16 = 0; Min_u16 < MINUTES_PER_DAY; Min_u16++, Minute_u32++, Now_u32 += 60, SimMillis_u32 += 60000)
+    {
+      BackgroundExpire_v();
+
+      //MQTT state / telemetry publish
+      BackgroundAlloc_pv(96 + Random_u32(224), 1);
+
+      //page view: request, response and chunk buffer around the render
+      if(Random_u32(MINUTES_PER_DAY) < PAGE_VIEWS_PER_DAY)
+      {
+        void *Request_pv = SimHeap_Malloc_pv(380);
+        void *Response_pv = SimHeap_Malloc_pv(220);
+        uint8_t *Chunk_pu8 = (uint8_t *)SimHeap_Malloc_pv(CHUNK_BYTES);
+
+        //keep-alive connection of the browser
+        if(Random_u32(4) == 0)
+        {
+          BackgroundAlloc_pv(1100 + Random_u32(400), 1 + Random_u32(180));
+        }
+
+        InPath_b = true;
+        (Mode_u8 == MODE_TEXT) ? TextPage_v(Chunk_pu8) : StringPage_v(Chunk_pu8, Template_pc);
+        InPath_b = false;
+
+        SimHeap_Free_v(Chunk_pu8);
+        SimHeap_Free_v(Response_pv);
+        SimHeap_Free_v(Request_pv);
+      }
+
+      //NTP sync: UDP buffer around the result (text) or the date formatting (string)
+      if((Minute_u32 % NTP_SYNC_MIN) == 0)
+      {
+        void *Packet_pv = SimHeap_Malloc_pv(1500);
+
+        InPath_b = true;
+        (Mode_u8 == MODE_TEXT) ? TextNtp_v() : StringNtp_v();
+        InPath_b = false;
+
+        SimHeap_Free_v(Packet_pv);
+      }
+
+      //threshold change via /get
+      if(Random_u32(MINUTES_PER_DAY) < GET_PER_DAY)
+      {
+        void *Request_pv = SimHeap_Malloc_pv(380);
+
+        InPath_b = true;
+        (Mode_u8 == MODE_TEXT) ? TextGet_v() : StringGet_v();
+        InPath_b = false;
+
+        SimHeap_Free_v(Request_pv);
+      }
+
+      size_t Free_u32;
+      size_t Largest_u32;
+
+      HeapStats_v(&Free_u32, &Largest_u32);
+      Largest_pu32 [Day_u16] = min(Largest_pu32 [Day_u16], Largest_u32);
+      Free_pu32 [Day_u16] = min(Free_pu32 [Day_u16], Free_u32);
+    }
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// main
+//------------------------------
+int main(int argc, char **argv)
+{
+  uint16_t Days_u16 = SOAK_DAYS_DEFAULT;
+  uint32_t Seed_u32 = 0x2545F491;
+  bool Mode_ab [2] = {true, true};
+
+  for(int i = 1; i < argc; i++)
+  {
+    if((strcmp(argv [i], "--days") == 0) && (i + 1 < argc)) Days_u16 = min(max(strtoul(argv [++i], NULL, 0), 1UL), 3650UL);
+    else if((strcmp(argv [i], "--heap-kb") == 0) && (i + 1 < argc)) HeapSize_u32 = min(max(strtoul(argv [++i], NULL, 0), 32UL), 320UL) * 1024;
+    else if((strcmp(argv [i], "--seed") == 0) && (i + 1 < argc)) Seed_u32 = max(strtoul(argv [++i], NULL, 0), 1UL);
+    else if((strcmp(argv [i], "--mode") == 0) && (i + 1 < argc))
+    {
+      i++;
+      Mode_ab [MODE_TEXT] = (strcmp(argv [i], "string") != 0);
+      Mode_ab [MODE_STRING] = (strcmp(argv [i], "text") != 0);
+    }
+    else if(strcmp(argv [i], "--verbose") == 0) Serial.Enabled_b = true;
+    else
+    {
+      fprintf(stderr, "usage: heap_soak [--days N] [--heap-kb K] [--mode text|string|both] [--seed S] [--verbose]\n");
+      return 2;
+    }
+  }
+
+  //template for the string mode (the old server streamed the file)
+  static char Template_ac [16384];
+  FILE *File_p = fopen("data/index.html", "r");
+
+  if(File_p == NULL)
+  {
+    fprintf(stderr, "data/index.html not found (run from PlatformIo/Chicken-Light)\n");
+    return 2;
+  }
+
+  Template_ac [fread(Template_ac, 1, sizeof(Template_ac) - 1, File_p)] = '\0';
+  fclose(File_p);
+
+  static size_t Largest_aau32 [2][3650];
+  static size_t Free_aau32 [2][3650];
+  uint32_t PathAllocs_au32 [2] = {0, 0};
+  uint32_t Failed_au32 [2] = {0, 0};
+
+  for(uint8_t m = 0; m < 2; m++)
+  {
+    if(Mode_ab [m])
+    {
+      Soak_v(m, Days_u16, Seed_u32, Template_ac, Largest_aau32 [m], Free_aau32 [m]);
+      PathAllocs_au32 [m] = PathAllocs_u32;
+      Failed_au32 [m] = HeapFailed_u32;
+    }
+  }
+
+  printf("heap %u KB, %u days, min. per day in bytes\n", (unsigned)(HeapSize_u32 / 1024), Days_u16);
+  printf("day   text largest   text free   string largest  string free\n");
+
+  for(uint16_t d = 0; d < Days_u16; d++)
+  {
+    printf("%3u", d + 1);
+
+    for(uint8_t m = 0; m < 2; m++)
+    {
+      if(Mode_ab [m]) printf("   %12zu  %10zu", Largest_aau32 [m][d], Free_aau32 [m][d]);
+      else printf("   %12s  %10s", "-", "-");
+    }
+
+    printf("\n");
+  }
+
+  //fragmentation trend: worst largest block of the first and the last week
+  bool Ok_b = true;
+
+  for(uint8_t m = 0; m < 2; m++)
+  {
+    if(!Mode_ab [m])
+    {
+      continue;
+    }
+
+    uint16_t Week_u16 = min<uint16_t>(7, Days_u16);
+    size_t First_u32 = SIZE_MAX;
+    size_t Last_u32 = SIZE_MAX;
+
+    for(uint16_t d = 0; d < Week_u16; d++)
+    {
+      First_u32 = min(First_u32, Largest_aau32 [m][d]);
+      Last_u32 = min(Last_u32, Largest_aau32 [m][Days_u16 - 1 - d]);
+    }
+
+    printf("%s: %u allocations in the text paths, largest free block first week %zu, last week %zu (%+ld), %u failed allocations\n",
+           (m == MODE_TEXT) ? "text" : "string", PathAllocs_au32 [m], First_u32, Last_u32, (long)Last_u32 - (long)First_u32, Failed_au32 [m]);
+
+    if(m == MODE_TEXT)
+    {
+      Ok_b = (PathAllocs_au32 [m] == 0) && (Last_u32 >= First_u32) && (Failed_au32 [m] == 0);
+    }
+  }
+
+  printf("%s\n", Ok_b ? "ok" : "FAILED");
+
+  return Ok_b ? 0 : 1;
+}
+//------------------------------
@@ -0,0 +1,192 @@
+//------------------------------
+// Host build of the text paths (heap_soak)
+//
+// just enough of Arduino for src/TextFormat.cpp and src/PageTemplate.cpp:
+// simulated uptime, and String as in the ESP32
+// core (short strings inline, exact size reallocation on concat). All
+// heap use of this build goes to the simulated heap (SimHeap_xxx).
+//------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+typedef uint8_t byte;
+
+//simulated heap (heap_soak.cpp)
+void *SimHeap_Malloc_pv(size_t Size_u32);
+void *SimHeap_Realloc_pv(void *Ptr_pv, size_t Size_u32);
+void SimHeap_Free_v(void *Ptr_pv);
+
+//simulated uptime (heap_soak.cpp)
+extern uint32_t SimMillis_u32;
+
+inline uint32_t millis(void) { return SimMillis_u32; }
+inline void delay(uint32_t Msec_u32) { SimMillis_u32 += Msec_u32; }
+inline uint16_t word(uint8_t High_u8, uint8_t Low_u8) { return ((uint16_t)High_u8 << 8) | Low_u8; }
+
+class Print
+{
+  public:
+    virtual size_t write(uint8_t c) = 0;
+
+    size_t print(const char *Str_pc)
+    {
+      size_t Len_u32 = strlen(Str_pc);
+
+      for(size_t i = 0; i < Len_u32; i++)
+      {
+        write(Str_pc [i]);
+      }
+
+      return Len_u32;
+    }
+
+    size_t println(const char *Str_pc)
+    {
+      return print(Str_pc) + print("\n");
+    }
+
+    size_t printf(const char *Format_pc, ...)
+    {
+      char Buf_ac [512];
+      va_list Args;
+
+      va_start(Args, Format_pc);
+      int Len_s32 = vsnprintf(Buf_ac, sizeof(Buf_ac), Format_pc, Args);
+      va_end(Args);
+
+      for(int i = 0; (i < Len_s32) && (i < (int)sizeof(Buf_ac) - 1); i++)
+      {
+        write(Buf_ac [i]);
+      }
+
+      return Len_s32;
+    }
+};
+
+//log of the firmware, off unless --verbose
+class HostSerial : public Print
+{
+  public:
+    bool Enabled_b = false;
+
+    size_t write(uint8_t c) override
+    {
+      if(Enabled_b)
+      {
+        fputc(c, stdout);
+      }
+
+      return 1;
+    }
+};
+
+extern HostSerial Serial;
+
+//String of the ESP32 core: up to 11 characters inline, longer ones on the heap
+class String
+{
+  public:
+    String(const char *Str_pc = "") { assign(Str_pc, strlen(Str_pc)); }
+    String(const String &Other) { assign(Other.c_str(), Other.Len_u32); }
+    String(unsigned long Value_u32) { char Buf_ac [12]; snprintf(Buf_ac, sizeof(Buf_ac), "%lu", Value_u32); assign(Buf_ac, strlen(Buf_ac)); }
+    String(int Value_s32) { char Buf_ac [12]; snprintf(Buf_ac, sizeof(Buf_ac), "%d", Value_s32); assign(Buf_ac, strlen(Buf_ac)); }
+    String(unsigned int Value_u32) : String((unsigned long)Value_u32) {}
+    String(unsigned char Value_u8) : String((unsigned long)Value_u8) {}
+    String(float Value_f32, unsigned int Decimals_u32) { char Buf_ac [33]; snprintf(Buf_ac, sizeof(Buf_ac), "%.*f", Decimals_u32, Value_f32); assign(Buf_ac, strlen(Buf_ac)); }
+    ~String() { if(Heap_pc) SimHeap_Free_v(Heap_pc); }
+
+    String &operator=(const String &Other)
+    {
+      if(this != &Other)
+      {
+        String Copy(Other);
+        std::swap(Heap_pc, Copy.Heap_pc);
+        std::swap(Len_u32, Copy.Len_u32);
+        memcpy(Sso_ac, Copy.Sso_ac, sizeof(Sso_ac));
+      }
+      return *this;
+    }
+
+    void concat(const char *Str_pc, size_t Len_u32_)
+    {
+      size_t New_u32 = Len_u32 + Len_u32_;
+      char *Buf_pc = Sso_ac;
+
+      //active buffer first (a heap string stays on the heap), then one write path
+      if(Heap_pc)
+      {
+        Heap_pc = (char *)SimHeap_Realloc_pv(Heap_pc, New_u32 + 1);
+        Buf_pc = Heap_pc;
+      }
+      else if(New_u32 >= sizeof(Sso_ac))
+      {
+        Heap_pc = (char *)SimHeap_Malloc_pv(New_u32 + 1);
+        memcpy(Heap_pc, Sso_ac, Len_u32);
+        Buf_pc = Heap_pc;
+      }
+
+      memcpy(&Buf_pc [Len_u32], Str_pc, Len_u32_);
+      Len_u32 = New_u32;
+      Buf_pc [Len_u32] = '\0';
+    }
+
+    String &operator+=(const String &Other) { String Copy(Other); concat(Copy.c_str(), Copy.Len_u32); return *this; }
+    String &operator+=(const char *Str_pc) { concat(Str_pc, strlen(Str_pc)); return *this; }
+
+    bool operator==(const char *Str_pc) const { return strcmp(c_str(), Str_pc) == 0; }
+
+    const char *c_str(void) const { return Heap_pc ? Heap_pc : Sso_ac; }
+    size_t length(void) const { return Len_u32; }
+    char operator[](size_t i) const { return c_str() [i]; }
+    long toInt(void) const { return atol(c_str()); }
+
+    int indexOf(char Char_c) const
+    {
+      const char *Found_pc = strchr(c_str(), Char_c);
+      return Found_pc ? Found_pc - c_str() : -1;
+    }
+
+    String substring(size_t From_u32, size_t To_u32 = SIZE_MAX) const
+    {
+      To_u32 = min(To_u32, Len_u32);
+      String Part;
+      if(From_u32 < To_u32) Part.concat(&c_str() [From_u32], To_u32 - From_u32);
+      return Part;
+    }
+
+  private:
+    char *Heap_pc = NULL;
+    size_t Len_u32 = 0;
+    char Sso_ac [12] = {0};
+
+    void assign(const char *Str_pc, size_t Len_u32_)
+    {
+      Len_u32 = 0;
+      Sso_ac [0] = '\0';
+      concat(Str_pc, Len_u32_);
+    }
+};
+
+inline String operator+(const String &Left, const String &Right) { String Sum(Left); Sum += Right; return Sum; }
+inline String operator+(const String &Left, const char *Right_pc) { String Sum(Left); Sum += Right_pc; return Sum; }
+inline String operator+(const char *Left_pc, const String &Right) { String Sum(Left_pc); Sum += Right; return Sum; }
+
+//firmware heap use (template buffer) goes to the simulated heap
+#define malloc(Size) SimHeap_Malloc_pv(Size)
+#define realloc(Ptr, Size) SimHeap_Realloc_pv(Ptr, Size)
+#define free(Ptr) SimHeap_Free_v(Ptr)
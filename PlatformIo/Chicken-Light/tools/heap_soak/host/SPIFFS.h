@@ -0,0 +1,46 @@
+//------------------------------
+// Host build (heap_soak): SPIFFS read from the data/ directory
+//------------------------------
+#pragma once
+
+#include "Arduino.h"
+
+#define FILE_READ "r"
+
+class File
+{
+  public:
+    File(FILE *Handle_p = NULL) : Handle_p(Handle_p) {}
+
+    operator bool() const { return Handle_p != NULL; }
+
+    size_t size(void)
+    {
+      long Pos_s32 = ftell(Handle_p);
+      fseek(Handle_p, 0, SEEK_END);
+      long Size_s32 = ftell(Handle_p);
+      fseek(Handle_p, Pos_s32, SEEK_SET);
+      return Size_s32;
+    }
+
+    size_t read(uint8_t *Buf_pu8, size_t Size_u32) { return fread(Buf_pu8, 1, Size_u32, Handle_p); }
+    void close(void) { if(Handle_p) fclose(Handle_p); Handle_p = NULL; }
+
+  private:
+    FILE *Handle_p;
+};
+
+class HostSpiffs
+{
+  public:
+    const char *Root_pc = "data";
+
+    File open(const char *Path_pc, const char *Mode_pc)
+    {
+      char Name_ac [256];
+      snprintf(Name_ac, sizeof(Name_ac), "%s%s", Root_pc, Path_pc);
+      return File(fopen(Name_ac, Mode_pc));
+    }
+};
+
+extern HostSpiffs SPIFFS;
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+#------------------------------
+# Decoder for the event journal of the chicken house light control
+#
+# usage:
+#   curl -o journal.bin "http://<ip>/api/journal?from=<unix>&to=<unix>"
+#   python3 journal_decode.py journal.bin
+#
+# record layout and constants: include/Journal.h
+#------------------------------
+
+import struct
+import sys
+import datetime
+
+RECORD = struct.Struct("<IBBHIHBB")   # 16 bytes, little endian
+
+EVENTS = {0: "SEGMENT", 1: "BOOT", 2: "STATE", 3: "SWITCH", 4: "COMMAND", 5: "TIME_SET", 6: "SCHEDULE",
+          7: "SUPERVISOR"}
+SOURCES = {0: "system", 1: "switch", 2: "web", 3: "control", 4: "ntp", 5: "mqtt", 6: "fleet"}
+STATES = {0: "IDLE", 1: "DIM_UP", 2: "WAITING_HOLD_TIME_SUNRISE", 3: "WAITING_HOLD_TIME_SUNSET", 4: "DIM_DOWN", 5: "STOP"}
+COMMANDS = {1: "light on", 2: "light off", 3: "control on", 4: "control off", 5: "zone", 6: "config", 7: "rules", 8: "schedule mode",
+            9: "light level"}
+LEVELS = {1: "task restarted", 2: "safe light level", 3: "watchdog reset"}
+RESET_REASONS = {0: "unknown", 1: "power on", 2: "external", 3: "software", 4: "panic", 5: "interrupt wdt", 6: "task wdt",
+                 7: "other wdt", 8: "deep sleep", 9: "brownout", 10: "sdio"}
+
+
+def valid(raw):
+    check = 0xA5
+    for b in raw[:15]:
+        check ^= b
+    return check == raw[15]
+
+
+def describe(event, arg, value):
+    if event == 0:
+        return "segment %u" % value
+    if event == 1:
+        return "reset reason: %s" % RESET_REASONS.get(arg, arg)
+    if event == 2:
+        return "%s -> %s" % (STATES.get(value, value), STATES.get(arg, arg))
+    if event == 3:
+        return "on" if arg else "off"
+    if event == 4:
+        text = COMMANDS.get(arg, "command %u" % arg)
+        if arg == 5:
+            text += " %u -> %u%%" % (value >> 16, value & 0xFFFF)
+        elif arg == 6:
+            text += " fields 0x%02x" % value
+        elif arg == 8:
+            text += " %s" % ("rules" if value else "table")
+        elif arg == 9:
+            text += " %u%% in %u s" % (value >> 24, value & 0xFFFFFF)
+        return text
+    if event == 5:
+        delta = value - (1 << 32) if value & 0x80000000 else value
+        return "clock corrected by %+d s" % delta
+    if event == 6:
+        return "level %u%% zones 0x%02x" % (arg, value)
+    if event == 7:
+        return "slot %u missed deadline: %s" % (arg, LEVELS.get(value, value))
+    return "arg %u value %u" % (arg, value)
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("usage: journal_decode.py <journal.bin>")
+        return 1
+
+    data = open(sys.argv[1], "rb").read()
+
+    for offset in range(0, len(data) - RECORD.size + 1, RECORD.size):
+        raw = data[offset:offset + RECORD.size]
+        time, event, source, arg, value, boot, _, _ = RECORD.unpack(raw)
+
+        if not valid(raw):
+            print("%08x: corrupt record" % offset)
+            continue
+
+        # RTC runs in local time (GMT+1, see web page), print as is
+        stamp = datetime.datetime.fromtimestamp(time, datetime.timezone.utc).strftime("%Y-%m-%d %H:%M:%S")
+
+        print("%s  boot %-4u %-8s %-8s %s" % (stamp, boot, EVENTS.get(event, event), SOURCES.get(source, source),
+                                              describe(event, arg, value)))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
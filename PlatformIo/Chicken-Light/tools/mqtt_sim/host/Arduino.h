@@ -0,0 +1,124 @@
+//------------------------------
+// Host build of the MQTT bridge (mqtt_sim)
+//
+// just enough of Arduino / FreeRTOS for src/MqttBridge.cpp and the
+// PubSubClient library: uptime is the host's monotonic clock, tasks are
+// threads, critical sections one process wide mutex
+//------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <mutex>
+
+using std::min;
+using std::max;
+
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+inline int64_t HostUptimeUsec_s64(void)
+{
+  struct timespec Now_st;
+  clock_gettime(CLOCK_MONOTONIC, &Now_st);
+  return (int64_t)Now_st.tv_sec * 1000000 + Now_st.tv_nsec / 1000;
+}
+
+inline uint32_t millis(void) { return HostUptimeUsec_s64() / 1000; }
+inline void delay(uint32_t Msec_u32) { usleep(Msec_u32 * 1000); }
+inline void yield(void) { usleep(100); }
+
+//FreeRTOS
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef void *SemaphoreHandle_t;
+typedef uint32_t TickType_t;
+typedef std::recursive_mutex portMUX_TYPE;
+
+extern std::recursive_mutex SimCriticalMux;
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(Mux) ((void)(Mux), SimCriticalMux.lock())
+#define portEXIT_CRITICAL(Mux) ((void)(Mux), SimCriticalMux.unlock())
+#define pdMS_TO_TICKS(Msec) (Msec)
+
+inline void vTaskDelay(TickType_t Ticks) { usleep(Ticks * 1000); }
+
+class Print
+{
+  public:
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *Buf_pu8, size_t Size_u32)
+    {
+      for(size_t i = 0; i < Size_u32; i++)
+      {
+        write(Buf_pu8 [i]);
+      }
+
+      return Size_u32;
+    }
+
+    size_t print(const char *Str_pc) { return write((const uint8_t *)Str_pc, strlen(Str_pc)); }
+
+    size_t printf(const char *Format_pc, ...)
+    {
+      char Buf_ac [512];
+      va_list Args;
+
+      va_start(Args, Format_pc);
+      int Len_s32 = vsnprintf(Buf_ac, sizeof(Buf_ac), Format_pc, Args);
+      va_end(Args);
+
+      return write((const uint8_t *)Buf_ac, min(Len_s32, (int)sizeof(Buf_ac) - 1));
+    }
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+    virtual void flush(void) = 0;
+};
+
+//log of the firmware, prefixed for the summary of run_local.sh
+class HostSerial : public Print
+{
+  public:
+    size_t write(uint8_t c) override
+    {
+      fputc(c, stdout);
+      return 1;
+    }
+};
+
+extern HostSerial Serial;
+
+//IPv4 address, bytes in network order
+class IPAddress
+{
+  public:
+    IPAddress() : Byte_au8 {0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : Byte_au8 {a, b, c, d} {}
+
+    operator uint32_t() const { uint32_t Addr_u32; memcpy(&Addr_u32, Byte_au8, 4); return Addr_u32; }
+    uint8_t operator [](int i) const { return Byte_au8 [i]; }
+    bool operator ==(const IPAddress &Other) const { return memcmp(Byte_au8, Other.Byte_au8, 4) == 0; }
+
+    uint8_t Byte_au8 [4];
+};
@@ -0,0 +1,24 @@
+//------------------------------
+// Host build (mqtt_sim): Arduino network client interface
+//------------------------------
+#pragma once
+
+#include "Arduino.h"
+
+class Client : public Stream
+{
+  public:
+    virtual int connect(IPAddress Ip, uint16_t Port_u16) = 0;
+    virtual int connect(const char *Host_pc, uint16_t Port_u16) = 0;
+    using Print::write;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *Buf_pu8, size_t Size_u32) = 0;
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int read(uint8_t *Buf_pu8, size_t Size_u32) = 0;
+    virtual int peek(void) = 0;
+    virtual void flush(void) = 0;
+    virtual void stop(void) = 0;
+    virtual uint8_t connected(void) = 0;
+    virtual operator bool() = 0;
+};
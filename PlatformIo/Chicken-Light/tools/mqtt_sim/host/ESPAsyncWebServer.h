@@ -0,0 +1,6 @@
+//------------------------------
+// Host build (mqtt_sim): PageCache.h only needs the request type
+//------------------------------
+#pragma once
+
+class AsyncWebServerRequest;
@@ -0,0 +1,6 @@
+//------------------------------
+// Host build (mqtt_sim): IPAddress is part of Arduino.h
+//------------------------------
+#pragma once
+
+#include "Arduino.h"
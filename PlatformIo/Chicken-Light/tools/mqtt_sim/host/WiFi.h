@@ -0,0 +1,16 @@
+//------------------------------
+// Host build (mqtt_sim): station always connected
+//------------------------------
+#pragma once
+
+#include "Arduino.h"
+
+#define WL_CONNECTED 3
+
+class WiFiClass
+{
+  public:
+    int status(void) { return WL_CONNECTED; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,119 @@
+//------------------------------
+// Host build (mqtt_sim): TCP client on a host socket
+//------------------------------
+#pragma once
+
+#include "Client.h"
+
+#include <netdb.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+class WiFiClient : public Client
+{
+  public:
+    int connect(IPAddress Ip, uint16_t Port_u16) override
+    {
+      char Host_ac [16];
+
+      snprintf(Host_ac, sizeof(Host_ac), "%u.%u.%u.%u", Ip [0], Ip [1], Ip [2], Ip [3]);
+      return connect(Host_ac, Port_u16);
+    }
+
+    int connect(const char *Host_pc, uint16_t Port_u16) override
+    {
+      struct addrinfo Hints_st = {};
+      struct addrinfo *Result_pst = NULL;
+      char Port_ac [6];
+
+      stop();
+
+      Hints_st.ai_family = AF_INET;
+      Hints_st.ai_socktype = SOCK_STREAM;
+      snprintf(Port_ac, sizeof(Port_ac), "%u", Port_u16);
+
+      if(getaddrinfo(Host_pc, Port_ac, &Hints_st, &Result_pst) != 0)
+      {
+        return 0;
+      }
+
+      Socket_s32 = socket(AF_INET, SOCK_STREAM, 0);
+
+      if((Socket_s32 < 0) || (::connect(Socket_s32, Result_pst->ai_addr, Result_pst->ai_addrlen) != 0))
+      {
+        freeaddrinfo(Result_pst);
+        stop();
+        return 0;
+      }
+
+      int On_s32 = 1;
+      setsockopt(Socket_s32, IPPROTO_TCP, TCP_NODELAY, &On_s32, sizeof(On_s32));
+      freeaddrinfo(Result_pst);
+
+      return 1;
+    }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t *Buf_pu8, size_t Size_u32) override
+    {
+      ssize_t Sent_s32 = (Socket_s32 < 0) ? -1 : send(Socket_s32, Buf_pu8, Size_u32, MSG_NOSIGNAL);
+
+      return (Sent_s32 < 0) ? 0 : Sent_s32;
+    }
+
+    int available(void) override
+    {
+      uint8_t Buf_au8 [1024];
+      ssize_t Len_s32 = (Socket_s32 < 0) ? -1 : recv(Socket_s32, Buf_au8, sizeof(Buf_au8), MSG_PEEK | MSG_DONTWAIT);
+
+      return (Len_s32 < 0) ? 0 : Len_s32;
+    }
+
+    int read(void) override
+    {
+      uint8_t c;
+
+      return (read(&c, 1) == 1) ? c : -1;
+    }
+
+    int read(uint8_t *Buf_pu8, size_t Size_u32) override
+    {
+      ssize_t Len_s32 = (Socket_s32 < 0) ? -1 : recv(Socket_s32, Buf_pu8, Size_u32, MSG_DONTWAIT);
+
+      return (Len_s32 < 0) ? -1 : Len_s32;
+    }
+
+    int peek(void) override
+    {
+      uint8_t c;
+
+      return ((Socket_s32 >= 0) && (recv(Socket_s32, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1)) ? c : -1;
+    }
+
+    void flush(void) override {}
+
+    void stop(void) override
+    {
+      if(Socket_s32 >= 0)
+      {
+        close(Socket_s32);
+      }
+
+      Socket_s32 = -1;
+    }
+
+    //closed by the peer: readable with 0 bytes
+    uint8_t connected(void) override
+    {
+      uint8_t c;
+
+      return (Socket_s32 >= 0) && (recv(Socket_s32, &c, 1, MSG_PEEK | MSG_DONTWAIT) != 0);
+    }
+
+    operator bool() override { return Socket_s32 >= 0; }
+
+  private:
+    int Socket_s32 = -1;
+};
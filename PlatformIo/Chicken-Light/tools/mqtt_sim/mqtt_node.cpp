@@ -0,0 +1,234 @@
+//------------------------------
+// MQTT bridge node (host)
+//
+// Runs src/MqttBridge.cpp unchanged against a real broker. The node
+// changes its state much faster than the publish interval: the page cache
+// generation and the duty cycle every 10 ms, the state text every second,
+// the temperature never. Every second a burst of journal records is
+// queued, more than fit between two publishes when --burst is above
+// MQTT_EVENT_QUEUE. Arg counts the bursts, Value numbers the records, so
+// loss and order can be checked on the broker side.
+//
+// Commands from <base>/cmd/<command> are printed as
+//   command=<command> payload=<payload> accepted=<0|1>
+// ("light" with on/off is accepted, anything else rejected). At the end
+//   generations=<n> events=<n> bursts=<n>
+// is printed and the process ends without DISCONNECT, the broker then
+// publishes the last will.
+//
+// build (from PlatformIo/Chicken-Light, PubSubClient sources in $PUBSUB):
+//   g++ -std=gnu++17 -O2 -pthread -Itools/mqtt_sim/host -Iinclude -I$PUBSUB tools/mqtt_sim/mqtt_node.cpp src/MqttBridge.cpp src/TextFormat.cpp $PUBSUB/PubSubClient.cpp -o mqtt_node
+//
+// usage:
+//   mqtt_node [--broker host] [--port p] [--base name] [--interval-ms m] [--burst n] [--run-s s]
+//------------------------------
+
+//includes
+//------------------------------
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include <atomic>
+#include <thread>
+
+#include "MqttBridge.h"
+#include "DeviceConfig.h"
+#include "TaskBudget.h"
+#include "TextFormat.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define NODE_STEP_MSEC 10
+#define NODE_CONNECT_WAIT_MSEC 5000
+//------------------------------
+
+//global variables
+//------------------------------
+std::recursive_mutex SimCriticalMux;
+HostSerial Serial;
+WiFiClass WiFi;
+
+DeviceConfig_t Config_st;
+static std::atomic<uint32_t> Generation_u32 {1};
+static std::atomic<uint8_t> Duty_u8 {0};
+static std::atomic<bool> Dimming_b {false};
+
+static const MqttValue_t MqttValue_ast [] =
+{
+  {"state",       PAGE_VAR_STATE},
+  {"dutycycle",   PAGE_VAR_LIGHT_DUTYCYCLE},
+  {"temperature", PAGE_VAR_TEMP},
+};
+//------------------------------
+
+
+//------------------------------
+// firmware services used by the bridge
+//------------------------------
+void Config_Copy_v(DeviceConfig_t *Config_pst)
+{
+  portENTER_CRITICAL(&SimCriticalMux);
+  *Config_pst = Config_st;
+  portEXIT_CRITICAL(&SimCriticalMux);
+}
+
+TaskHandle_t Task_Start_h(uint8_t Task_u8, TaskFunction_t Func_pfn, void *Param_pv)
+{
+  std::thread(Func_pfn, Param_pv).detach();
+
+  return (TaskHandle_t)(uintptr_t)(Task_u8 + 1);
+}
+
+uint32_t PageCache_Generation_u32(void)
+{
+  return Generation_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// status JSON, page values and commands of the node
+//------------------------------
+static size_t NodeStatus_u32(char *Buf_pc, size_t Size_u32)
+{
+  Text_t Text_st;
+
+  Text_Init_v(&Text_st, Buf_pc, Size_u32);
+  Text_Str_v(&Text_st, "{\"generation\":");
+  Text_Uint_v(&Text_st, Generation_u32);
+  Text_Str_v(&Text_st, ",\"dutycycle\":");
+  Text_Uint_v(&Text_st, Duty_u8);
+  Text_Char_v(&Text_st, '}');
+
+  return Text_Len_u32(&Text_st);
+}
+
+static size_t NodeValue_u32(uint8_t Var_u8, char *Buf_pc, size_t Size_u32)
+{
+  Text_t Text_st;
+
+  Text_Init_v(&Text_st, Buf_pc, Size_u32);
+
+  switch(Var_u8)
+  {
+    case PAGE_VAR_STATE:
+      Text_Str_v(&Text_st, Dimming_b ? "DIM UP" : "IDLE");
+      break;
+
+    case PAGE_VAR_LIGHT_DUTYCYCLE:
+      Text_Uint_v(&Text_st, Duty_u8);
+      break;
+
+    case PAGE_VAR_TEMP:
+      Text_Str_v(&Text_st, "21.5");
+      break;
+
+    default:
+      break;
+  }
+
+  return Text_Len_u32(&Text_st);
+}
+
+static bool NodeCommand_b(const char *Command_pc, const char *Payload_pc)
+{
+  bool Ok_b = (strcmp(Command_pc, "light") == 0) && ((strcmp(Payload_pc, "on") == 0) || (strcmp(Payload_pc, "off") == 0));
+
+  printf("command=%s payload=%s accepted=%u\n", Command_pc, Payload_pc, Ok_b);
+  fflush(stdout);
+
+  return Ok_b;
+}
+//------------------------------
+
+
+//------------------------------
+// main
+//------------------------------
+int main(int argc, char **argv)
+{
+  const char *Broker_pc = "127.0.0.1";
+  const char *Base_pc = "chicken-sim";
+  uint32_t Port_u32 = 1883;
+  uint32_t IntervalMsec_u32 = 500;
+  uint32_t Burst_u32 = 20;
+  uint32_t RunSec_u32 = 10;
+
+  for(int i = 1; i < argc; i++)
+  {
+    if((strcmp(argv [i], "--broker") == 0) && (i + 1 < argc)) Broker_pc = argv [++i];
+    else if((strcmp(argv [i], "--port") == 0) && (i + 1 < argc)) Port_u32 = strtoul(argv [++i], NULL, 0);
+    else if((strcmp(argv [i], "--base") == 0) && (i + 1 < argc)) Base_pc = argv [++i];
+    else if((strcmp(argv [i], "--interval-ms") == 0) && (i + 1 < argc)) IntervalMsec_u32 = strtoul(argv [++i], NULL, 0);
+    else if((strcmp(argv [i], "--burst") == 0) && (i + 1 < argc)) Burst_u32 = strtoul(argv [++i], NULL, 0);
+    else if((strcmp(argv [i], "--run-s") == 0) && (i + 1 < argc)) RunSec_u32 = strtoul(argv [++i], NULL, 0);
+    else
+    {
+      fprintf(stderr, "usage: mqtt_node [--broker host] [--port p] [--base name] [--interval-ms m] [--burst n] [--run-s s]\n");
+      return 2;
+    }
+  }
+
+  memset(&Config_st, 0, sizeof(Config_st));
+  snprintf(Config_st.MqttBroker_ac, sizeof(Config_st.MqttBroker_ac), "%s", Broker_pc);
+  Config_st.MqttPort_u16 = Port_u32;
+  Config_st.MqttIntervalMsec_u16 = IntervalMsec_u32;
+
+  const MqttBridge_t Bridge_st = {Base_pc, NodeStatus_u32, NodeValue_u32, MqttValue_ast,
+                                  sizeof(MqttValue_ast) / sizeof(MqttValue_ast [0]), NodeCommand_b};
+
+  Mqtt_Start_v(&Bridge_st);
+
+  for(uint32_t Wait_u32 = 0; !Mqtt_Connected_b() && (Wait_u32 < NODE_CONNECT_WAIT_MSEC); Wait_u32 += NODE_STEP_MSEC)
+  {
+    delay(NODE_STEP_MSEC);
+  }
+
+  if(!Mqtt_Connected_b())
+  {
+    printf("no connection to %s:%u\n", Broker_pc, Port_u32);
+    return 1;
+  }
+
+  uint32_t Generations_u32 = 0;
+  uint32_t Events_u32 = 0;
+  uint32_t Bursts_u32 = 0;
+
+  for(uint32_t Step_u32 = 0; Step_u32 < RunSec_u32 * 1000 / NODE_STEP_MSEC; Step_u32++)
+  {
+    Generation_u32++;
+    Generations_u32++;
+    Duty_u8 = (Duty_u8 + 1) % 101;
+
+    if((Step_u32 % (1000 / NODE_STEP_MSEC)) == 0)
+    {
+      Dimming_b = !Dimming_b;
+      Bursts_u32++;
+
+      for(uint32_t k = 0; k < Burst_u32; k++)
+      {
+        JournalRecord_t Record_st;
+
+        memset(&Record_st, 0, sizeof(Record_st));
+        Record_st.Time_u32 = time(NULL);
+        Record_st.Type_u8 = JOURNAL_EVENT_COMMAND;
+        Record_st.Arg_u16 = Bursts_u32;
+        Record_st.Value_u32 = ++Events_u32;
+
+        Mqtt_Event_v(&Record_st);
+      }
+    }
+
+    delay(NODE_STEP_MSEC);
+  }
+
+  //let the last batch go out, then vanish without DISCONNECT
+  delay(2 * IntervalMsec_u32 + 200);
+
+  printf("generations=%u events=%u bursts=%u\n", Generations_u32, Events_u32, Bursts_u32);
+  fflush(stdout);
+
+  _exit(0);
+}
+//------------------------------
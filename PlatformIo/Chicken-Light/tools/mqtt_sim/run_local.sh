@@ -0,0 +1,111 @@
+#!/bin/sh
+#------------------------------
+# MQTT bridge against a local mosquitto
+#
+#   retained    after the node is gone: online = offline (last will),
+#               status, state, dutycycle, temperature kept; event not
+#   coalescing  state changes every 10 ms, but status and dutycycle at
+#               most once per interval; temperature (never changes) once
+#   events      journal bursts larger than the queue: records arrive in
+#               order without duplicates, only the oldest are dropped,
+#               the last one gets through
+#   commands    cmd/light on is run, bad payloads and unknown commands are
+#               rejected, long payloads cut to MQTT_COMMAND_LEN_MAX
+#
+# needs mosquitto, mosquitto_sub and mosquitto_pub, and the PubSubClient
+# sources (PlatformIO fetches them on the first build)
+#
+# usage (from PlatformIo/Chicken-Light):
+#   sh tools/mqtt_sim/run_local.sh [run seconds]
+#   PUBSUB=<dir with PubSubClient.cpp> sh tools/mqtt_sim/run_local.sh
+#------------------------------
+set -e
+
+RUN_S=${1:-10}
+PORT=${PORT:-18830}
+BASE=chicken-sim
+INTERVAL_MS=200
+BURST=20
+QUEUE=16
+PUBSUB=${PUBSUB:-.pio/libdeps/nodemcu-32s/PubSubClient/src}
+OUT=$(mktemp -d)
+FAIL=0
+
+if [ ! -f "$PUBSUB/PubSubClient.cpp" ]; then
+  echo "PubSubClient not found in $PUBSUB (pio pkg install, or set PUBSUB)"
+  exit 2
+fi
+
+g++ -std=gnu++17 -O2 -pthread -Itools/mqtt_sim/host -Iinclude -I"$PUBSUB" tools/mqtt_sim/mqtt_node.cpp src/MqttBridge.cpp src/TextFormat.cpp "$PUBSUB/PubSubClient.cpp" -o "$OUT/mqtt_node"
+
+printf "listener %s 127.0.0.1\nallow_anonymous true\npersistence false\n" "$PORT" > "$OUT/mosquitto.conf"
+mosquitto -c "$OUT/mosquitto.conf" > "$OUT/broker.txt" 2>&1 &
+BROKER=$!
+trap 'kill $BROKER $LIVE 2>/dev/null; rm -rf "$OUT"' EXIT
+sleep 1
+
+mosquitto_sub -h 127.0.0.1 -p "$PORT" -v -t "$BASE/#" > "$OUT/live.txt" &
+LIVE=$!
+sleep 0.5
+
+"$OUT/mqtt_node" --port "$PORT" --base "$BASE" --interval-ms "$INTERVAL_MS" --burst "$BURST" --run-s "$RUN_S" > "$OUT/node.txt" &
+NODE=$!
+sleep 2
+
+mosquitto_pub -h 127.0.0.1 -p "$PORT" -t "$BASE/cmd/light" -m on
+mosquitto_pub -h 127.0.0.1 -p "$PORT" -t "$BASE/cmd/light" -m dim
+mosquitto_pub -h 127.0.0.1 -p "$PORT" -t "$BASE/cmd/reboot" -m now
+mosquitto_pub -h 127.0.0.1 -p "$PORT" -t "$BASE/cmd/light" -m 0123456789012345678901234567890123456789
+
+wait $NODE
+sleep 0.5
+kill $LIVE
+mosquitto_sub -h 127.0.0.1 -p "$PORT" -v -t "$BASE/#" --retained-only -W 2 > "$OUT/retained.txt" 2>/dev/null || true
+
+verdict()
+{
+  if [ "$2" = "pass" ]; then V=pass; else V=FAIL; FAIL=1; fi
+  printf "%-11s %s -> %s\n" "$1" "$3" "$V"
+}
+
+# retained: topic set after the node is gone
+RETAINED=$(cut -d' ' -f1 "$OUT/retained.txt" | sed "s|^$BASE/||" | sort | tr '\n' ' ')
+ONLINE=$(awk -v t="$BASE/online" '$1 == t { print $2 }' "$OUT/retained.txt")
+R=FAIL
+if [ "$RETAINED" = "dutycycle online state status temperature " ] && [ "$ONLINE" = "offline" ]; then R=pass; fi
+verdict retained $R "topics: $RETAINED(online = $ONLINE)"
+
+# coalescing: publishes per topic against the changes of the node
+GENERATIONS=$(grep -o 'generations=[0-9]*' "$OUT/node.txt" | cut -d= -f2)
+RESULT=$(awk -v base="$BASE" -v run_s="$RUN_S" -v interval="$INTERVAL_MS" -v gen="$GENERATIONS" '
+  { n[substr($1, length(base) + 2)]++ }
+  END {
+    limit = int(run_s * 1000 / interval) + 4
+    ok = (n["status"] <= limit) && (n["dutycycle"] <= limit) && (n["status"] > 0) && (n["temperature"] == 1) && (gen > 4 * n["status"])
+    printf("%s status %d dutycycle %d state %d temperature %d for %d changes (limit %d)\n", ok ? "pass" : "FAIL",
+           n["status"], n["dutycycle"], n["state"], n["temperature"], gen, limit)
+  }' "$OUT/live.txt")
+verdict coalescing "${RESULT%% *}" "${RESULT#* }"
+
+# events: order, duplicates, loss only within a burst above the queue size
+EVENTS=$(grep -o 'events=[0-9]*' "$OUT/node.txt" | cut -d= -f2)
+RESULT=$(grep "^$BASE/event " "$OUT/live.txt" | grep -o '"value":[0-9]*' | cut -d: -f2 | awk -v events="$EVENTS" -v burst="$BURST" -v queue="$QUEUE" '
+  { if($1 <= last) bad++; last = $1; n++ }
+  END {
+    lost = events - n
+    allowed = (burst > queue) ? (events / burst) * (burst - queue) : 0
+    ok = (bad == 0) && (last == events) && (lost <= allowed)
+    printf("%s %d of %d records, %d lost (allowed %d), %d out of order\n", ok ? "pass" : "FAIL", n, events, lost, allowed, bad)
+  }')
+verdict events "${RESULT%% *}" "${RESULT#* }"
+
+# commands: accepted flag and cut payload
+C1=$(grep -c '^command=light payload=on accepted=1$' "$OUT/node.txt" || true)
+C2=$(grep -c '^command=light payload=dim accepted=0$' "$OUT/node.txt" || true)
+C3=$(grep -c '^command=reboot payload=now accepted=0$' "$OUT/node.txt" || true)
+C4=$(grep -c '^command=light payload=01234567890123456789012345678901 accepted=0$' "$OUT/node.txt" || true)
+R=FAIL
+if [ "$C1$C2$C3$C4" = "1111" ]; then R=pass; fi
+verdict commands $R "on $C1, bad payload $C2, unknown $C3, cut payload $C4"
+
+exit $FAIL
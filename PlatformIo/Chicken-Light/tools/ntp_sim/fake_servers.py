@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+#------------------------------
+# Stand-in NTP servers on localhost (ntp_sim)
+#
+# Every server answers on its own UDP port with the host's wall clock plus
+# a configurable error, so the selection in src/NtpClock.cpp can be
+# exercised with good servers, falsetickers and misbehaving ones.
+#
+# usage:
+#   python3 tools/ntp_sim/fake_servers.py PORT[:OPTION[,OPTION...]] ...
+#
+# options:
+#   offset=MS     constant clock error
+#   jitter=MS     random error per reply (normal distribution)
+#   asym=MS       reply held back after the transmit timestamp (return path delay)
+#   drop=P        probability of no reply
+#   stratum=N     default 2
+#   kiss          kiss-o'-death "RATE" (stratum 0)
+#   unsync        leap indicator 3 (clock not synchronized)
+#   silent        never answers
+#------------------------------
+
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+
+NTP_UNIX_OFFSET = 2208988800
+
+
+def ntp_timestamp(unix):
+    sec = int(unix)
+    frac = int((unix - sec) * (1 << 32)) & 0xFFFFFFFF
+    return struct.pack("!II", (sec + NTP_UNIX_OFFSET) & 0xFFFFFFFF, frac)
+
+
+def parse(spec):
+    port, _, options = spec.partition(":")
+    server = {"port": int(port), "offset": 0.0, "jitter": 0.0, "asym": 0.0, "drop": 0.0,
+              "stratum": 2, "kiss": False, "unsync": False}
+    for option in filter(None, options.split(",")):
+        key, _, value = option.partition("=")
+        if key in ("kiss", "unsync"):
+            server[key] = True
+        elif key == "silent":
+            server["drop"] = 1.0
+        elif key == "stratum":
+            server[key] = int(value)
+        elif key in ("offset", "jitter", "asym", "drop"):
+            server[key] = float(value)
+        else:
+            raise SystemExit("unknown option " + key)
+    return server
+
+
+def serve(server):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("127.0.0.1", server["port"]))
+
+    while True:
+        request, peer = sock.recvfrom(512)
+        received = time.time()
+
+        if len(request) < 48 or (request[0] & 0x07) != 3 or random.random() < server["drop"]:
+            continue
+
+        error = server["offset"] / 1000.0
+        if server["jitter"] > 0:
+            error += random.gauss(0.0, server["jitter"] / 1000.0)
+
+        leap = 3 if server["unsync"] else 0
+        stratum = 0 if server["kiss"] else server["stratum"]
+        header = struct.pack("!BBbb", (leap << 6) | (4 << 3) | 4, stratum, 6, -20)
+        root = struct.pack("!II", 0x00000100, 0x00000200)   # 3.9 ms root delay, 7.8 ms dispersion
+        refid = b"RATE" if server["kiss"] else b"SIM\0"
+        reference = ntp_timestamp(received + error - 16)
+        origin = request[40:48]
+
+        reply = header + root + refid + reference + origin + ntp_timestamp(received + error) \
+            + ntp_timestamp(time.time() + error)
+
+        if server["asym"] > 0:
+            time.sleep(server["asym"] / 1000.0)
+
+        sock.sendto(reply, peer)
+
+
+def main():
+    if len(sys.argv) < 2:
+        raise SystemExit("usage: fake_servers.py PORT[:OPTION[,OPTION...]] ...")
+
+    for spec in sys.argv[1:]:
+        threading.Thread(target=serve, args=(parse(spec),), daemon=True).start()
+
+    while True:
+        time.sleep(3600)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,92 @@
+//------------------------------
+// Host build of the NTP clock (ntp_sim)
+//
+// just enough of Arduino / FreeRTOS for src/NtpClock.cpp: uptime is the
+// host's monotonic clock, tasks are threads, critical sections one
+// process wide mutex
+//------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <mutex>
+
+using std::min;
+using std::max;
+
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+inline int64_t HostUptimeUsec_s64(void)
+{
+  struct timespec Now_st;
+  clock_gettime(CLOCK_MONOTONIC, &Now_st);
+  return (int64_t)Now_st.tv_sec * 1000000 + Now_st.tv_nsec / 1000;
+}
+
+inline uint32_t millis(void) { return HostUptimeUsec_s64() / 1000; }
+
+//FreeRTOS
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef void *SemaphoreHandle_t;
+typedef uint32_t TickType_t;
+typedef std::recursive_mutex portMUX_TYPE;
+
+extern std::recursive_mutex SimCriticalMux;
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(Mux) ((void)(Mux), SimCriticalMux.lock())
+#define portEXIT_CRITICAL(Mux) ((void)(Mux), SimCriticalMux.unlock())
+#define pdMS_TO_TICKS(Msec) (Msec)
+
+inline void vTaskDelay(TickType_t Ticks) { usleep(Ticks * 1000); }
+
+//Print with printf (status JSON)
+class Print
+{
+  public:
+    virtual size_t write(uint8_t c) = 0;
+
+    size_t printf(const char *Format_pc, ...)
+    {
+      char Buf_ac [512];
+      va_list Args;
+
+      va_start(Args, Format_pc);
+      int Len_s32 = vsnprintf(Buf_ac, sizeof(Buf_ac), Format_pc, Args);
+      va_end(Args);
+
+      for(int i = 0; (i < Len_s32) && (i < (int)sizeof(Buf_ac) - 1); i++)
+      {
+        write(Buf_ac [i]);
+      }
+
+      return Len_s32;
+    }
+};
+
+//IPv4 address, bytes in network order
+class IPAddress
+{
+  public:
+    IPAddress() : Byte_au8 {0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : Byte_au8 {a, b, c, d} {}
+
+    bool fromString(const char *Text_pc) { return inet_pton(AF_INET, Text_pc, Byte_au8) == 1; }
+    operator uint32_t() const { uint32_t Addr_u32; memcpy(&Addr_u32, Byte_au8, 4); return Addr_u32; }
+    uint8_t operator [](int i) const { return Byte_au8 [i]; }
+    bool operator ==(const IPAddress &Other) const { return memcmp(Byte_au8, Other.Byte_au8, 4) == 0; }
+
+    uint8_t Byte_au8 [4];
+};
@@ -0,0 +1,35 @@
+//------------------------------
+// Host build of the NTP clock (ntp_sim)
+//
+// host name lookup by the host resolver (/etc/hosts, "localhost")
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#include <netdb.h>
+
+class WiFiClass
+{
+  public:
+    int hostByName(const char *Host_pc, IPAddress &Ip)
+    {
+      struct addrinfo Hints_st = {};
+      struct addrinfo *Result_pst = NULL;
+
+      Hints_st.ai_family = AF_INET;
+      Hints_st.ai_socktype = SOCK_DGRAM;
+
+      if(getaddrinfo(Host_pc, NULL, &Hints_st, &Result_pst) != 0)
+      {
+        return 0;
+      }
+
+      memcpy(Ip.Byte_au8, &((struct sockaddr_in *)Result_pst->ai_addr)->sin_addr, 4);
+      freeaddrinfo(Result_pst);
+
+      return 1;
+    }
+};
+
+extern WiFiClass WiFi;
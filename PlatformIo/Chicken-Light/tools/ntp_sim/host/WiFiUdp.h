@@ -0,0 +1,112 @@
+//------------------------------
+// Host build of the NTP clock (ntp_sim)
+//
+// WiFiUDP unicast on a non-blocking host socket
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+
+class WiFiUDP
+{
+  public:
+    uint8_t begin(uint16_t Port_u16)
+    {
+      int On_s32 = 1;
+      struct sockaddr_in Addr_st = {};
+
+      stop();
+      Fd_s32 = socket(AF_INET, SOCK_DGRAM, 0);
+
+      if(Fd_s32 < 0)
+      {
+        return 0;
+      }
+
+      setsockopt(Fd_s32, SOL_SOCKET, SO_REUSEADDR, &On_s32, sizeof(On_s32));
+
+      Addr_st.sin_family = AF_INET;
+      Addr_st.sin_port = htons(Port_u16);
+      Addr_st.sin_addr.s_addr = htonl(INADDR_ANY);
+
+      if(bind(Fd_s32, (struct sockaddr *)&Addr_st, sizeof(Addr_st)) < 0)
+      {
+        perror("ntp_sim: bind");
+        stop();
+        return 0;
+      }
+
+      fcntl(Fd_s32, F_SETFL, O_NONBLOCK);
+
+      return 1;
+    }
+
+    void stop(void)
+    {
+      if(Fd_s32 >= 0)
+      {
+        close(Fd_s32);
+        Fd_s32 = -1;
+      }
+    }
+
+    int beginPacket(IPAddress Ip, uint16_t Port_u16)
+    {
+      To_st = {};
+      To_st.sin_family = AF_INET;
+      To_st.sin_port = htons(Port_u16);
+      memcpy(&To_st.sin_addr.s_addr, Ip.Byte_au8, 4);
+      TxLen_u32 = 0;
+      return 1;
+    }
+
+    size_t write(const uint8_t *Data_pu8, size_t Len_u32)
+    {
+      Len_u32 = min(Len_u32, sizeof(Tx_au8) - TxLen_u32);
+      memcpy(Tx_au8 + TxLen_u32, Data_pu8, Len_u32);
+      TxLen_u32 += Len_u32;
+      return Len_u32;
+    }
+
+    int endPacket(void)
+    {
+      return sendto(Fd_s32, Tx_au8, TxLen_u32, 0, (struct sockaddr *)&To_st, sizeof(To_st)) == (ssize_t)TxLen_u32;
+    }
+
+    int parsePacket(void)
+    {
+      socklen_t Len_u32 = sizeof(From_st);
+
+      RxLen_s32 = (Fd_s32 >= 0) ? recvfrom(Fd_s32, Rx_au8, sizeof(Rx_au8), 0, (struct sockaddr *)&From_st, &Len_u32) : -1;
+      return max(RxLen_s32, 0);
+    }
+
+    int read(uint8_t *Buf_pu8, size_t Len_u32)
+    {
+      int Len_s32 = min<int>(Len_u32, max(RxLen_s32, 0));
+      memcpy(Buf_pu8, Rx_au8, Len_s32);
+      return Len_s32;
+    }
+
+    IPAddress remoteIP(void)
+    {
+      IPAddress Ip;
+      memcpy(Ip.Byte_au8, &From_st.sin_addr.s_addr, 4);
+      return Ip;
+    }
+
+    uint16_t remotePort(void) { return ntohs(From_st.sin_port); }
+
+  private:
+    int Fd_s32 = -1;
+    struct sockaddr_in To_st = {};
+    struct sockaddr_in From_st = {};
+    uint8_t Tx_au8 [1472];
+    size_t TxLen_u32 = 0;
+    uint8_t Rx_au8 [1472];
+    int RxLen_s32 = 0;
+};
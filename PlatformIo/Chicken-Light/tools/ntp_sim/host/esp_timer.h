@@ -0,0 +1,10 @@
+//------------------------------
+// Host build of the NTP clock (ntp_sim)
+//
+// esp_timer: uptime is the host's monotonic clock
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+
+inline int64_t esp_timer_get_time(void) { return HostUptimeUsec_s64(); }
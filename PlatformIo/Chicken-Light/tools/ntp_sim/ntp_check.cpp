@@ -0,0 +1,136 @@
+//------------------------------
+// NTP server selection against local stand-in servers (host)
+//
+// Runs src/NtpClock.cpp unchanged: the configured servers are usually
+// fake_servers.py on 127.0.0.1, every sync result is compared with the
+// host's wall clock (the fake servers are offsets from it).
+//
+// build (from PlatformIo/Chicken-Light):
+//   g++ -std=gnu++17 -O2 -pthread -Itools/ntp_sim/host -Iinclude tools/ntp_sim/ntp_check.cpp src/NtpClock.cpp -o ntp_check
+//
+// usage:
+//   ntp_check [--syncs N] server [server ...]       (server: "host[:port]", at most NTP_SERVER_COUNT)
+//
+// output (one line per sync):
+//   sync=1 ok=1 error_ms=<result - wall clock> status=<JSON of /api/ntp>
+//------------------------------
+
+#include <Arduino.h>
+#include <thread>
+
+#include "NtpClock.h"
+#include "DeviceConfig.h"
+#include "TaskBudget.h"
+#include "WifiManager.h"
+
+#include <WiFi.h>
+
+//------------------------------
+// simulated board
+//------------------------------
+std::recursive_mutex SimCriticalMux;
+WiFiClass WiFi;
+
+DeviceConfig_t Config_st;
+
+static volatile bool Done_b = false;
+static bool Ok_b = false;
+static double ErrorMsec_f64 = 0.0;
+
+static int64_t WallUsec_s64(void)
+{
+  struct timespec Now_st;
+  clock_gettime(CLOCK_REALTIME, &Now_st);
+  return (int64_t)Now_st.tv_sec * 1000000 + Now_st.tv_nsec / 1000;
+}
+
+static void Result_v(bool Result_b, int64_t UnixUsec_s64)
+{
+  Ok_b = Result_b;
+  ErrorMsec_f64 = Result_b ? (UnixUsec_s64 - WallUsec_s64()) / 1000.0 : 0.0;
+  Done_b = true;
+}
+
+class StdoutPrint : public Print
+{
+  public:
+    size_t write(uint8_t c) { return fputc(c, stdout) != EOF; }
+};
+//------------------------------
+
+
+//------------------------------
+// firmware functions used by NtpClock.cpp
+//------------------------------
+void Config_Copy_v(DeviceConfig_t *Config_pst)
+{
+  std::lock_guard<std::recursive_mutex> Lock(SimCriticalMux);
+  *Config_pst = Config_st;
+}
+
+bool Wifi_Connected_b(void) { return true; }
+
+TaskHandle_t Task_Start_h(uint8_t Task_u8, TaskFunction_t Func_pfn, void *Param_pv)
+{
+  std::thread(Func_pfn, Param_pv).detach();
+  return NULL;
+}
+//------------------------------
+
+
+int main(int argc, char **argv)
+{
+  uint32_t Syncs_u32 = 1;
+  uint8_t Servers_u8 = 0;
+  StdoutPrint Out;
+
+  memset(&Config_st, 0, sizeof(Config_st));
+
+  for(int i = 1; i < argc; i++)
+  {
+    char Host_ac [NTP_SERVER_LEN_MAX + 1];
+    uint16_t Port_u16;
+
+    if((strcmp(argv [i], "--syncs") == 0) && (i + 1 < argc))
+    {
+      Syncs_u32 = strtoul(argv [++i], NULL, 0);
+    }
+    else if((Servers_u8 < NTP_SERVER_COUNT) && Ntp_ParseServer_b(argv [i], Host_ac, &Port_u16))
+    {
+      strcpy(Config_st.NtpServer_aac [Servers_u8++], argv [i]);
+    }
+    else
+    {
+      fprintf(stderr, "usage: ntp_check [--syncs N] host[:port] ... (at most %u servers)\n", NTP_SERVER_COUNT);
+      return 2;
+    }
+  }
+
+  NtpHooks_t Hooks_st = {NULL, Result_v};
+  Ntp_Start_v(&Hooks_st);
+
+  for(uint32_t Sync_u32 = 1; Sync_u32 <= Syncs_u32; Sync_u32++)
+  {
+    Done_b = false;
+    Ntp_Request_v();
+
+    while(!Done_b)
+    {
+      usleep(10000);
+    }
+
+    //next request only after this sync has ended
+    while(Ntp_Busy_b())
+    {
+      usleep(1000);
+    }
+
+    printf("sync=%u ok=%u error_ms=%.3f status=", Sync_u32, Ok_b, ErrorMsec_f64);
+    Ntp_PrintJson_v(Out);
+    printf("\n");
+    fflush(stdout);
+  }
+
+  //NTP task thread still runs
+  _exit(0);
+}
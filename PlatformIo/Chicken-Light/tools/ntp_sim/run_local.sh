@@ -0,0 +1,61 @@
+#!/bin/sh
+#------------------------------
+# NTP server selection on localhost: stand-in servers, three scenarios
+#
+#   falseticker  three good servers (one slow return path), one 2.5 s off:
+#                the wrong one is outvoted, the result stays within 5 ms
+#   split        two servers against two: no majority, the RTC is kept
+#   failover     one good server, one silent, one unsynchronized, one
+#                kiss-o'-death: the bad ones lose their score and are
+#                skipped (back-off), time comes from the good one
+#
+# usage (from PlatformIo/Chicken-Light):
+#   sh tools/ntp_sim/run_local.sh
+#------------------------------
+set -e
+
+OUT=$(mktemp -d)
+FAIL=0
+
+g++ -std=gnu++17 -O2 -pthread -Itools/ntp_sim/host -Iinclude tools/ntp_sim/ntp_check.cpp src/NtpClock.cpp -o "$OUT/ntp_check"
+
+python3 tools/ntp_sim/fake_servers.py \
+  12301:jitter=0.5 12302:jitter=0.5,asym=4 12303:jitter=2 12304:offset=2500 \
+  12311:offset=2500 12312:offset=2500,jitter=1 \
+  12321:silent 12322:unsync 12323:kiss &
+SERVERS=$!
+trap 'kill $SERVERS; rm -rf "$OUT"' EXIT
+sleep 1
+
+# scenario name, expected ok per sync, server states of the last sync ("" = not checked)
+check()
+{
+  NAME=$1
+  EXPECT_OK=$2
+  EXPECT_STATES=$3
+  RESULT=$(awk -v expect="$EXPECT_OK" '
+    {
+      for(i = 1; i <= NF; i++) { split($i, kv, "="); v[kv[1]] = kv[2] }
+      ok = ok v["ok"]
+      e = v["error_ms"] < 0 ? -v["error_ms"] : v["error_ms"]
+      if(e > worst) worst = e
+    }
+    END { printf("%s %.3f %s\n", ok, worst, (ok == expect && worst < 5.0) ? "pass" : "FAIL") }' "$OUT/$NAME.txt")
+  STATES=$(tail -n 1 "$OUT/$NAME.txt" | grep -o '"state":"[a-z]*"' | cut -d'"' -f4 | tr '\n' ' ')
+  set -- $RESULT
+  VERDICT=$3
+  if [ -n "$EXPECT_STATES" ] && [ "$STATES" != "$EXPECT_STATES" ]; then VERDICT=FAIL; fi
+  if [ "$VERDICT" != "pass" ]; then FAIL=1; fi
+  printf "%-12s ok per sync %s (expected %s), worst error %s ms, states: %s-> %s\n" "$NAME" "$1" "$EXPECT_OK" "$2" "$STATES" "$VERDICT"
+}
+
+"$OUT/ntp_check" --syncs 2 127.0.0.1:12301 localhost:12302 127.0.0.1:12303 127.0.0.1:12304 > "$OUT/falseticker.txt"
+check falseticker 11 "truechimer truechimer truechimer falseticker "
+
+"$OUT/ntp_check" --syncs 1 127.0.0.1:12301 127.0.0.1:12302 127.0.0.1:12311 127.0.0.1:12312 > "$OUT/split.txt"
+check split 0 "undecided undecided undecided undecided "
+
+"$OUT/ntp_check" --syncs 3 127.0.0.1:12301 127.0.0.1:12321 127.0.0.1:12322 127.0.0.1:12323 > "$OUT/failover.txt"
+check failover 111 "truechimer backoff backoff backoff "
+
+exit $FAIL
@@ -0,0 +1,54 @@
+//------------------------------
+// Host build of the schedule preview (preview_bench)
+//
+// just enough of Arduino for src/SchedulePreview.cpp: no hardware, no
+// tasks, Print with printf and block write for the JSON / binary output
+//------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+class Print
+{
+  public:
+    virtual size_t write(uint8_t c) = 0;
+
+    size_t write(const uint8_t *Buf_pu8, size_t Size_u32)
+    {
+      for(size_t i = 0; i < Size_u32; i++)
+      {
+        write(Buf_pu8 [i]);
+      }
+
+      return Size_u32;
+    }
+
+    size_t printf(const char *Format_pc, ...)
+    {
+      char Buf_ac [512];
+      va_list Args;
+
+      va_start(Args, Format_pc);
+      int Len_s32 = vsnprintf(Buf_ac, sizeof(Buf_ac), Format_pc, Args);
+      va_end(Args);
+
+      for(int i = 0; (i < Len_s32) && (i < (int)sizeof(Buf_ac) - 1); i++)
+      {
+        write(Buf_ac [i]);
+      }
+
+      return Len_s32;
+    }
+};
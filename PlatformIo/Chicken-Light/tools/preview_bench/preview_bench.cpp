@@ -0,0 +1,394 @@
+//------------------------------
+// Schedule preview benchmark and check (host)
+//
+// Runs src/SchedulePreview.cpp unchanged for the table (dim and hold of
+// the table, photoperiod targets) and for rule sets (a typical one and
+// random sets of up to SCHEDULE_RULES_MAX rules). Every year is compared
+// with a plain reference model: calendar by the C library and
+// CalcCalendarWeek_u8 of the firmware, table windows by
+// src/Photoperiod.cpp, then every minute of the day simulated per zone.
+// The time per year is measured on the host and scaled by --factor to a
+// rough ESP32 estimate (240 MHz, in-order, no SIMD); the exact device
+// time is "compute_us" of /api/schedule/preview.
+//
+// build (from PlatformIo/Chicken-Light):
+//   g++ -std=gnu++17 -O2 -Itools/preview_bench/host -Iinclude tools/preview_bench/preview_bench.cpp src/SchedulePreview.cpp src/Photoperiod.cpp -o preview_bench
+//
+// usage:
+//   preview_bench [--from YYYY] [--to YYYY] [--sets N] [--factor F] [--budget-us B]
+//
+// exit code: 0 preview matches the reference and the estimate is within budget, 1 otherwise
+//------------------------------
+
+//includes
+//------------------------------
+#include <Arduino.h>
+#include <time.h>
+
+#include <chrono>
+
+#include "SchedulePreview.h"
+#include "Photoperiod.h"
+#include "SunriseSunset.h"
+#include "LightZones.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define MINUTES_PER_DAY 1440
+#define BENCH_REPEAT 200
+
+//host time * factor = ESP32 estimate (-Os, 240 MHz)
+#define BENCH_FACTOR_DEFAULT 25.0
+#define BENCH_BUDGET_USEC 5000
+//------------------------------
+
+//global variables
+//------------------------------
+static SchedulePreview_t Preview_st;
+static SchedulePreview_t Reference_st;
+
+static const PhotoperiodSetting_t Table_st = {PHOTOPERIOD_TABLE, 50, 30};
+
+static const ScheduleRule_t Typical_ast [] =
+{
+  //anchor               flags               time  level ramp  days                zones  from  to
+  {RULE_ANCHOR_SUNRISE,  0,                  -90,  100,  30,   RULE_DAYS_ALL,      0x01,  0,    0},
+  {RULE_ANCHOR_SUNRISE,  0,                  0,    0,    15,   RULE_DAYS_ALL,      0x01,  0,    0},
+  {RULE_ANCHOR_SUNSET,   0,                  -15,  80,   10,   RULE_DAYS_ALL,      0x03,  0,    0},
+  {RULE_ANCHOR_TIME,     0,                  21*60, 0,   30,   RULE_DAYS_ALL,      0x03,  0,    0},
+  {RULE_ANCHOR_TIME,     RULE_FLAG_OVERRIDE, 6*60, 40,   0,    RULE_DAYS_WEEKEND,  0x02,  1101, 228},
+  {RULE_ANCHOR_TIME,     RULE_FLAG_OVERRIDE, 8*60, 0,    20,   RULE_DAYS_WEEKEND,  0x02,  1101, 228},
+};
+//------------------------------
+
+
+//------------------------------
+// calendar week, copy of CalcCalendarWeek_u8 (main.cpp)
+//------------------------------
+static uint8_t CalcCalendarWeek_u8(uint16_t y_u16, uint16_t m_u16, uint16_t d_u16)
+{
+  int adj = (((y_u16-1901) + ((y_u16-1901)/4) + 4) % 7) + 3;
+  static const int Before_as32 [12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  int doy = d_u16 + Before_as32 [m_u16 - 1] + (((m_u16 > 2) && ((y_u16 % 4) == 0)) ? 1 : 0);
+  uint8_t wknum = (adj + doy) / 7;
+  if (wknum < 1) {
+    adj = (((y_u16-1902) + ((y_u16-1902)/4) + 4) % 7) + 3;
+    if (adj==9) return 53;
+    if ((adj==8) && ((y_u16 % 4)==1)) return 53;
+    return 52;
+  }
+  if (wknum > 52) {
+    if (adj==9) return 53;
+    if ((adj==8) && ((y_u16 % 4)==0)) return 53;
+    return 1;
+  }
+  return wknum;
+}
+//------------------------------
+
+
+//------------------------------
+// reference: one day, minute by minute
+//------------------------------
+static bool RuleActive_b(const ScheduleRule_t *Rule_pst, uint8_t Weekday_u8, uint16_t MonthDay_u16)
+{
+  if((Rule_pst->WeekdayMask_u8 & (1 << Weekday_u8)) == 0) return false;
+  if((Rule_pst->FromDate_u16 == 0) || (Rule_pst->ToDate_u16 == 0)) return true;
+  if(Rule_pst->FromDate_u16 <= Rule_pst->ToDate_u16)
+  {
+    return (MonthDay_u16 >= Rule_pst->FromDate_u16) && (MonthDay_u16 <= Rule_pst->ToDate_u16);
+  }
+  return (MonthDay_u16 >= Rule_pst->FromDate_u16) || (MonthDay_u16 <= Rule_pst->ToDate_u16);
+}
+
+static void ReferenceDay_v(uint16_t Year_u16, int Slot_s32, uint8_t Mode_u8, const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8,
+                           uint8_t ZoneMask_u8, const PhotoperiodSetting_t *Setting_pst, uint8_t *Target_pu8,
+                           uint16_t *On_pu16, uint16_t *First_pu16, uint16_t *Last_pu16)
+{
+  struct tm Date_st = {};
+  Date_st.tm_year = Year_u16 - 1900;
+  Date_st.tm_mday = Slot_s32;            //day 0 = Dec 31 before
+  time_t Time_t = timegm(&Date_st);
+  gmtime_r(&Time_t, &Date_st);
+
+  uint8_t Week_u8 = CalcCalendarWeek_u8(Date_st.tm_year + 1900, Date_st.tm_mon + 1, Date_st.tm_mday);
+  const uint8_t *Row_pu8 = SunriseSunset_au8 [min<int>(Week_u8, 52) - 1];
+  int Sunrise_s32 = Row_pu8 [0] * 60 + Row_pu8 [1];
+  int Sunset_s32 = Row_pu8 [2] * 60 + Row_pu8 [3];
+  PhotoperiodDay_t Day_st;
+
+  Photoperiod_Compute_v(&Day_st, 0, Sunrise_s32, Sunset_s32, Row_pu8 [4], Row_pu8 [5], Setting_pst);
+  int Morning_s32 = (ZoneMask_u8 != 0) ? Photoperiod_MorningMin_u16(&Day_st) : 0;
+  int Evening_s32 = (ZoneMask_u8 != 0) ? Photoperiod_EveningMin_u16(&Day_st) : 0;
+  uint16_t MonthDay_u16 = (Date_st.tm_mon + 1) * 100 + Date_st.tm_mday;
+
+  //events of the day, stable by minute
+  int Minute_as32 [SCHEDULE_RULES_MAX];
+  uint8_t Zones_au8 [SCHEDULE_RULES_MAX];
+  uint8_t Order_au8 [SCHEDULE_RULES_MAX];
+  uint8_t Count_u8 = 0;
+  uint8_t Override_u8 = 0;
+
+  for(uint8_t r = 0; (Mode_u8 == SCHEDULE_MODE_RULES) && (r < RuleCount_u8); r++)
+  {
+    if((Rule_past [r].Flags_u8 & RULE_FLAG_OVERRIDE) && RuleActive_b(&Rule_past [r], Date_st.tm_wday, MonthDay_u16))
+    {
+      Override_u8 |= Rule_past [r].ZoneMask_u8;
+    }
+  }
+
+  for(uint8_t r = 0; (Mode_u8 == SCHEDULE_MODE_RULES) && (r < RuleCount_u8); r++)
+  {
+    const ScheduleRule_t *Rule_pst = &Rule_past [r];
+    uint8_t Zones_u8 = Rule_pst->ZoneMask_u8 & ZoneMask_u8;
+
+    if(!RuleActive_b(Rule_pst, Date_st.tm_wday, MonthDay_u16)) continue;
+    if((Rule_pst->Flags_u8 & RULE_FLAG_OVERRIDE) == 0) Zones_u8 &= ~Override_u8;
+    if(Zones_u8 == 0) continue;
+
+    int Minute_s32 = Rule_pst->TimeMin_s16;
+    if(Rule_pst->Anchor_u8 == RULE_ANCHOR_SUNRISE) Minute_s32 += Sunrise_s32;
+    if(Rule_pst->Anchor_u8 == RULE_ANCHOR_SUNSET) Minute_s32 += Sunset_s32;
+
+    uint8_t Pos_u8 = Count_u8++;
+    Minute_as32 [r] = constrain(Minute_s32, 0, MINUTES_PER_DAY - 1);
+    Zones_au8 [r] = Zones_u8;
+    while((Pos_u8 > 0) && (Minute_as32 [Order_au8 [Pos_u8 - 1]] > Minute_as32 [r]))
+    {
+      Order_au8 [Pos_u8] = Order_au8 [Pos_u8 - 1];
+      Pos_u8--;
+    }
+    Order_au8 [Pos_u8] = r;
+  }
+
+  int RampEnd_as32 [ZONE_COUNT_MAX] = {0};
+  uint8_t Next_u8 = 0;
+
+  *On_pu16 = 0;
+  *First_pu16 = PREVIEW_NONE;
+  *Last_pu16 = PREVIEW_NONE;
+
+  for(int m = 0; m < MINUTES_PER_DAY; m++)
+  {
+    bool Lit_b = false;
+
+    if(Mode_u8 == SCHEDULE_MODE_RULES)
+    {
+      for(; (Next_u8 < Count_u8) && (Minute_as32 [Order_au8 [Next_u8]] == m); Next_u8++)
+      {
+        const ScheduleRule_t *Rule_pst = &Rule_past [Order_au8 [Next_u8]];
+
+        for(uint8_t z = 0; z < ZONE_COUNT_MAX; z++)
+        {
+          if((Zones_au8 [Order_au8 [Next_u8]] & (1 << z)) == 0) continue;
+
+          bool On_b = (Target_pu8 [z] > 0) || (RampEnd_as32 [z] > m);
+          Target_pu8 [z] = Rule_pst->LevelPercent_u8;
+          RampEnd_as32 [z] = ((Rule_pst->LevelPercent_u8 == 0) && On_b) ? m + Rule_pst->RampMin_u8 : 0;
+        }
+      }
+
+      for(uint8_t z = 0; z < ZONE_COUNT_MAX; z++)
+      {
+        Lit_b |= (Target_pu8 [z] > 0) || (RampEnd_as32 [z] > m);
+      }
+    }
+    else
+    {
+      Lit_b = ((m >= Sunrise_s32 - Morning_s32) && (m < Sunrise_s32)) || ((m >= Sunset_s32) && (m < Sunset_s32 + Evening_s32));
+    }
+
+    if(Lit_b)
+    {
+      (*On_pu16)++;
+      *First_pu16 = min<uint16_t>(*First_pu16, m);
+      *Last_pu16 = m + 1;
+    }
+  }
+}
+
+static void Reference_v(SchedulePreview_t *Preview_pst, uint16_t Year_u16, uint8_t Mode_u8,
+                        const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8, uint8_t ZoneMask_u8,
+                        const PhotoperiodSetting_t *Setting_pst)
+{
+  uint8_t Target_au8 [ZONE_COUNT_MAX] = {0};
+  uint16_t On_u16, First_u16, Last_u16;
+
+  Preview_pst->Year_u16 = Year_u16;
+  Preview_pst->Days_u16 = ((Year_u16 % 4) == 0) ? 366 : 365;
+  Preview_pst->Mode_u8 = Mode_u8;
+
+  for(int Slot_s32 = 0; Slot_s32 <= Preview_pst->Days_u16; Slot_s32++)
+  {
+    ReferenceDay_v(Year_u16, Slot_s32, Mode_u8, Rule_past, RuleCount_u8, ZoneMask_u8, Setting_pst, Target_au8,
+                   &On_u16, &First_u16, &Last_u16);
+
+    if(Slot_s32 > 0)
+    {
+      Preview_pst->OnMin_au16 [Slot_s32 - 1] = On_u16;
+      Preview_pst->FirstOn_au16 [Slot_s32 - 1] = First_u16;
+      Preview_pst->LastOff_au16 [Slot_s32 - 1] = Last_u16;
+    }
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// random rule set (fixed seed per set)
+//------------------------------
+static uint8_t RandomRules_u8(ScheduleRule_t *Rule_past, uint32_t Seed_u32, uint8_t Count_u8)
+{
+  srand(Seed_u32);
+
+  for(uint8_t r = 0; r < Count_u8; r++)
+  {
+    ScheduleRule_t *Rule_pst = &Rule_past [r];
+
+    Rule_pst->Anchor_u8 = rand() % 3;
+    Rule_pst->Flags_u8 = ((rand() % 5) == 0) ? RULE_FLAG_OVERRIDE : 0;
+    Rule_pst->TimeMin_s16 = (Rule_pst->Anchor_u8 == RULE_ANCHOR_TIME) ? rand() % MINUTES_PER_DAY : rand() % 361 - 180;
+    Rule_pst->LevelPercent_u8 = ((rand() % 2) == 0) ? 0 : 1 + rand() % 100;
+    Rule_pst->RampMin_u8 = ((rand() % 3) == 0) ? 0 : rand() % 121;
+    Rule_pst->WeekdayMask_u8 = ((rand() % 2) == 0) ? RULE_DAYS_ALL : rand() & RULE_DAYS_ALL;
+    Rule_pst->ZoneMask_u8 = 1 + rand() % 0xFF;
+    Rule_pst->FromDate_u16 = ((rand() % 3) == 0) ? (1 + rand() % 12) * 100 + 1 + rand() % 28 : 0;
+    Rule_pst->ToDate_u16 = (Rule_pst->FromDate_u16 != 0) ? (1 + rand() % 12) * 100 + 1 + rand() % 28 : 0;
+  }
+
+  return Count_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// compare with reference, time per year [us] (best of BENCH_REPEAT)
+//------------------------------
+static bool Check_b(const char *Name_pc, uint16_t Year_u16, uint8_t Mode_u8, const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8,
+                    const PhotoperiodSetting_t *Setting_pst)
+{
+  SchedulePreview_Compute_v(&Preview_st, Year_u16, Mode_u8, Rule_past, RuleCount_u8, ZONE_MASK_ALL, Setting_pst);
+  Reference_v(&Reference_st, Year_u16, Mode_u8, Rule_past, RuleCount_u8, ZONE_MASK_ALL, Setting_pst);
+
+  for(uint16_t d = 0; d < Reference_st.Days_u16; d++)
+  {
+    if((Preview_st.OnMin_au16 [d] != Reference_st.OnMin_au16 [d]) ||
+       (Preview_st.FirstOn_au16 [d] != Reference_st.FirstOn_au16 [d]) ||
+       (Preview_st.LastOff_au16 [d] != Reference_st.LastOff_au16 [d]))
+    {
+      printf("MISMATCH %s year=%u day=%u preview=%u/%u/%u reference=%u/%u/%u\n", Name_pc, Year_u16, d + 1,
+             Preview_st.OnMin_au16 [d], Preview_st.FirstOn_au16 [d], Preview_st.LastOff_au16 [d],
+             Reference_st.OnMin_au16 [d], Reference_st.FirstOn_au16 [d], Reference_st.LastOff_au16 [d]);
+      return false;
+    }
+  }
+
+  return (Preview_st.Days_u16 == Reference_st.Days_u16);
+}
+
+static double TimeUsec_f64(uint16_t Year_u16, uint8_t Mode_u8, const ScheduleRule_t *Rule_past, uint8_t RuleCount_u8,
+                           const PhotoperiodSetting_t *Setting_pst)
+{
+  double Best_f64 = 1e9;
+
+  for(uint32_t i = 0; i < BENCH_REPEAT; i++)
+  {
+    auto Start = std::chrono::steady_clock::now();
+    SchedulePreview_Compute_v(&Preview_st, Year_u16, Mode_u8, Rule_past, RuleCount_u8, ZONE_MASK_ALL, Setting_pst);
+    auto Stop = std::chrono::steady_clock::now();
+
+    Best_f64 = min(Best_f64, std::chrono::duration<double, std::micro>(Stop - Start).count());
+  }
+
+  return Best_f64;
+}
+//------------------------------
+
+
+int main(int argc, char **argv)
+{
+  uint16_t From_u16 = 2024;
+  uint16_t To_u16 = 2030;
+  uint32_t Sets_u32 = 200;
+  double Factor_f64 = BENCH_FACTOR_DEFAULT;
+  double BudgetUsec_f64 = BENCH_BUDGET_USEC;
+  bool Ok_b = true;
+
+  for(int i = 1; i + 1 < argc; i += 2)
+  {
+    if(strcmp(argv [i], "--from") == 0) From_u16 = strtoul(argv [i + 1], NULL, 0);
+    else if(strcmp(argv [i], "--to") == 0) To_u16 = strtoul(argv [i + 1], NULL, 0);
+    else if(strcmp(argv [i], "--sets") == 0) Sets_u32 = strtoul(argv [i + 1], NULL, 0);
+    else if(strcmp(argv [i], "--factor") == 0) Factor_f64 = atof(argv [i + 1]);
+    else if(strcmp(argv [i], "--budget-us") == 0) BudgetUsec_f64 = atof(argv [i + 1]);
+    else
+    {
+      fprintf(stderr, "usage: preview_bench [--from YYYY] [--to YYYY] [--sets N] [--factor F] [--budget-us B]\n");
+      return 2;
+    }
+  }
+
+  From_u16 = constrain(From_u16, PREVIEW_YEAR_MIN, PREVIEW_YEAR_MAX);
+  To_u16 = constrain(To_u16, From_u16, PREVIEW_YEAR_MAX);
+
+  //correctness: table, photoperiod targets, typical rules, random rule sets
+  uint32_t Checked_u32 = 0;
+  ScheduleRule_t Rule_ast [SCHEDULE_RULES_MAX];
+
+  for(uint16_t Year_u16 = From_u16; Ok_b && (Year_u16 <= To_u16); Year_u16++)
+  {
+    Ok_b &= Check_b("table", Year_u16, SCHEDULE_MODE_TABLE, NULL, 0, &Table_st);
+    Ok_b &= Check_b("typical", Year_u16, SCHEDULE_MODE_RULES, Typical_ast, sizeof(Typical_ast) / sizeof(Typical_ast [0]), &Table_st);
+    Checked_u32 += 2;
+
+    for(uint32_t s = 0; Ok_b && (s < Sets_u32); s++)
+    {
+      PhotoperiodSetting_t Setting_st = {(uint16_t)(1 + rand() % PHOTOPERIOD_MIN_MAX), (uint8_t)(rand() % 101),
+                                         (uint8_t)(rand() % (PHOTOPERIOD_DIM_MIN_MAX + 1))};
+      Ok_b &= Check_b("photoperiod", Year_u16, SCHEDULE_MODE_TABLE, NULL, 0, &Setting_st);
+      Checked_u32++;
+    }
+
+    for(uint32_t s = 0; Ok_b && (s < Sets_u32); s++)
+    {
+      uint8_t Count_u8 = RandomRules_u8(Rule_ast, Year_u16 * 1000 + s, 1 + s % SCHEDULE_RULES_MAX);
+      Ok_b &= Check_b("random", Year_u16, SCHEDULE_MODE_RULES, Rule_ast, Count_u8, &Table_st);
+      Checked_u32++;
+    }
+  }
+
+  printf("check: %u years compared with the reference model: %s\n", Checked_u32, Ok_b ? "ok" : "FAILED");
+
+  //speed: one year, best of BENCH_REPEAT runs
+  RandomRules_u8(Rule_ast, 1, SCHEDULE_RULES_MAX);
+
+  struct
+  {
+    const char *Name_pc;
+    uint8_t Mode_u8;
+    const ScheduleRule_t *Rule_past;
+    uint8_t Count_u8;
+    PhotoperiodSetting_t Setting_st;
+  } Case_ast [] =
+  {
+    {"table",          SCHEDULE_MODE_TABLE, NULL,        0,                                          Table_st},
+    {"photoperiod",    SCHEDULE_MODE_TABLE, NULL,        0,                                          {14 * 60, 70, 30}},
+    {"rules typical",  SCHEDULE_MODE_RULES, Typical_ast, sizeof(Typical_ast) / sizeof(Typical_ast [0]), Table_st},
+    {"rules 16",       SCHEDULE_MODE_RULES, Rule_ast,    SCHEDULE_RULES_MAX,                         Table_st},
+  };
+
+  for(auto &Case_st : Case_ast)
+  {
+    double HostUsec_f64 = TimeUsec_f64(2028, Case_st.Mode_u8, Case_st.Rule_past, Case_st.Count_u8, &Case_st.Setting_st);
+    double Esp32Usec_f64 = HostUsec_f64 * Factor_f64;
+    bool Fast_b = (Esp32Usec_f64 < BudgetUsec_f64);
+
+    printf("speed: %-14s host %8.1f us/year, ESP32 estimate %8.0f us (budget %.0f us) %s\n",
+           Case_st.Name_pc, HostUsec_f64, Esp32Usec_f64, BudgetUsec_f64, Fast_b ? "ok" : "TOO SLOW");
+
+    Ok_b &= Fast_b;
+  }
+
+  return Ok_b ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+#------------------------------
+# Static RAM per subsystem of the chicken house light control
+#
+# Sums the RAM sections (.data, .bss, DRAM / RTC attributes) of every
+# object file of the build: one line per source file (subsystem), one per
+# library. Task stacks are static (src/TaskBudget.cpp), so they are part
+# of the TaskBudget line.
+#
+# usage:
+#   runs after every build (platformio.ini: extra_scripts = post:tools/ram_report.py)
+#   python3 tools/ram_report.py [.pio/build/nodemcu-32s] [size tool]
+#------------------------------
+
+import os
+import subprocess
+import sys
+
+DRAM_PREFIXES = (".data", ".bss", ".sbss", ".sdata", ".dram", "COMMON")
+RTC_PREFIXES = (".rtc_noinit", ".rtc.data", ".rtc.bss", ".rtc_data", ".rtc_bss")
+
+
+def subsystem(build_dir, path):
+    rel = os.path.relpath(path, build_dir).replace(os.sep, "/")
+    parts = rel.split("/")
+
+    if parts[0] == "src":
+        return os.path.basename(rel).split(".")[0]
+    if parts[0].startswith("lib") and len(parts) > 2:
+        return "lib " + parts[1]
+    if parts[0].startswith("Framework"):
+        return "framework"
+    return parts[0]
+
+
+def object_sections(size_tool, path):
+    out = subprocess.run([size_tool, "-A", path], capture_output=True, text=True, check=True).stdout
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[1].isdigit():
+            yield fields[0], int(fields[1])
+
+
+def report(build_dir, size_tool):
+    totals = {}
+
+    for root, _, files in os.walk(build_dir):
+        for name in files:
+            if not name.endswith(".o"):
+                continue
+            path = os.path.join(root, name)
+            dram = rtc = 0
+            for section, size in object_sections(size_tool, path):
+                if section.startswith(RTC_PREFIXES):
+                    rtc += size
+                elif section.startswith(DRAM_PREFIXES):
+                    dram += size
+            if dram or rtc:
+                entry = totals.setdefault(subsystem(build_dir, path), [0, 0])
+                entry[0] += dram
+                entry[1] += rtc
+
+    print("static RAM per subsystem (bytes)")
+    print("%-28s %8s %8s" % ("subsystem", "DRAM", "RTC"))
+    for name, (dram, rtc) in sorted(totals.items(), key=lambda item: -item[1][0]):
+        print("%-28s %8d %8d" % (name, dram, rtc))
+    print("%-28s %8d %8d" % ("total", sum(v[0] for v in totals.values()), sum(v[1] for v in totals.values())))
+
+
+def after_build(source, target, env):
+    report(env.subst("$BUILD_DIR"), env.subst("$SIZETOOL") or "xtensa-esp32-elf-size")
+
+
+try:
+    #PlatformIO extra script
+    Import("env")
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", after_build)
+except NameError:
+    if __name__ == "__main__":
+        report(sys.argv[1] if len(sys.argv) > 1 else ".pio/build/nodemcu-32s",
+               sys.argv[2] if len(sys.argv) > 2 else "xtensa-esp32-elf-size")
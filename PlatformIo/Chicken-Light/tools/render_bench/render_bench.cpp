@@ -0,0 +1,470 @@
+//------------------------------
+// index.html render benchmark (host)
+//
+// Renders data/index.html per request in three ways and measures the time
+// and the peak heap of one page:
+//
+//   processor  the old request->send(SPIFFS, "/index.html", ..., processor)
+//              path: file read per request, scanned for %NAME%, String
+//              name and String value per marker (if/else chain)
+//   stream     src/PageTemplate.cpp: PageTemplate_Fill_u32 chunk by chunk
+//              from the segment table split at boot (SendIndexPage_v)
+//   render     src/PageTemplate.cpp: PageTemplate_Render_u32 into the page
+//              cache buffer (allocated once at boot, not per page)
+//
+// All modes use the same page values (fixed clock) and must send the same
+// bytes. The chunk buffer of the web server is the same in all modes and
+// not counted. The peak heap is the largest amount of heap held above the
+// start of the page. The time per page is measured on the host and scaled
+// by --factor to a rough ESP32 estimate (240 MHz). SPIFFS reads and the
+// file buffer of the processor mode are not included.
+//
+// Uses the host stubs of heap_soak (String as in the ESP32 core, SPIFFS
+// from data/); the simulated heap here only counts bytes.
+//
+// build (from PlatformIo/Chicken-Light):
+//   g++ -std=gnu++17 -O2 -Itools/heap_soak/host -Iinclude tools/render_bench/render_bench.cpp src/TextFormat.cpp src/PageTemplate.cpp -o render_bench
+//
+// usage (from PlatformIo/Chicken-Light, reads data/index.html):
+//   render_bench [--repeat N] [--chunk B] [--factor F]
+//
+// exit code: 0 all modes send the same page and stream/render allocate
+// nothing per page, 1 otherwise
+//------------------------------
+
+//includes
+//------------------------------
+#include <Arduino.h>
+#include <time.h>
+
+#include <chrono>
+#include <new>
+
+#include "TextFormat.h"
+#include "PageTemplate.h"
+#include "SPIFFS.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define BENCH_REPEAT_DEFAULT 2000
+#define BENCH_CHUNK_DEFAULT 1436              //one TCP segment per chunk callback
+#define BENCH_PAGE_MAX 16384
+#define BENCH_NOW_UNIX 1740810600UL           //2025-03-01 06:30
+
+//page values
+#define BENCH_TEMP 7.4F
+#define BENCH_DUTYCYCLE 100
+#define BENCH_SUNRISE_MIN (7 * 60 + 4)
+#define BENCH_SUNSET_MIN (17 * 60 + 58)
+
+//host time * factor = ESP32 estimate (-Os, 240 MHz)
+#define BENCH_FACTOR_DEFAULT 25.0
+
+#define HEAP_HEADER 8                         //size + state, like multi_heap
+
+#define MODE_PROCESSOR 0
+#define MODE_STREAM 1
+#define MODE_RENDER 2
+#define MODE_COUNT 3
+//------------------------------
+
+//global variables
+//------------------------------
+HostSerial Serial;
+HostSpiffs SPIFFS;
+uint32_t SimMillis_u32 = 0;
+
+static size_t HeapUsed_u32 = 0;
+static size_t HeapPeak_u32 = 0;
+static uint32_t HeapAllocs_u32 = 0;
+
+static const char *ModeName_apc [MODE_COUNT] = {"processor", "stream", "render"};
+//------------------------------
+
+
+//------------------------------
+// heap: host memory, used bytes (with block header) and peak counted
+//------------------------------
+void *SimHeap_Malloc_pv(size_t Size_u32)
+{
+  size_t *Block_pu32 = (size_t *)(malloc)(Size_u32 + sizeof(size_t));
+
+  if(Block_pu32 == NULL)
+  {
+    return NULL;
+  }
+
+  Block_pu32 [0] = Size_u32;
+  HeapUsed_u32 += Size_u32 + HEAP_HEADER;
+  HeapPeak_u32 = max(HeapPeak_u32, HeapUsed_u32);
+  HeapAllocs_u32++;
+
+  return &Block_pu32 [1];
+}
+
+void SimHeap_Free_v(void *Ptr_pv)
+{
+  if(Ptr_pv == NULL)
+  {
+    return;
+  }
+
+  size_t *Block_pu32 = (size_t *)Ptr_pv - 1;
+
+  HeapUsed_u32 -= Block_pu32 [0] + HEAP_HEADER;
+  (free)(Block_pu32);
+}
+
+void *SimHeap_Realloc_pv(void *Ptr_pv, size_t Size_u32)
+{
+  void *New_pv = SimHeap_Malloc_pv(Size_u32);
+
+  if((Ptr_pv != NULL) && (New_pv != NULL))
+  {
+    memcpy(New_pv, Ptr_pv, min(((size_t *)Ptr_pv) [-1], Size_u32));
+  }
+
+  SimHeap_Free_v(Ptr_pv);
+  return New_pv;
+}
+
+void *operator new(size_t Size_u32)
+{
+  void *Ptr_pv = SimHeap_Malloc_pv(Size_u32);
+
+  if(Ptr_pv == NULL)
+  {
+    throw std::bad_alloc();
+  }
+
+  return Ptr_pv;
+}
+
+void operator delete(void *Ptr_pv) noexcept
+{
+  SimHeap_Free_v(Ptr_pv);
+}
+
+void operator delete(void *Ptr_pv, size_t Size_u32) noexcept
+{
+  SimHeap_Free_v(Ptr_pv);
+}
+//------------------------------
+
+
+//------------------------------
+// page values of a fixed device state
+//------------------------------
+static void Now_v(struct tm *Time_pst)
+{
+  time_t Time = BENCH_NOW_UNIX;
+
+  gmtime_r(&Time, Time_pst);
+  Time_pst->tm_year += 1900;
+  Time_pst->tm_mon += 1;
+}
+
+//stream/render: PageVar_u32 of main.cpp
+static size_t BenchPageVar_u32(uint8_t Var_u8, char *Buf_pc, size_t Size_u32)
+{
+  Text_t Text_st;
+  struct tm Time_st;
+
+  Text_Init_v(&Text_st, Buf_pc, Size_u32);
+  Now_v(&Time_st);
+
+  switch(Var_u8)
+  {
+    case PAGE_VAR_DATE_TIME:
+      Text_Uint_v(&Text_st, Time_st.tm_mday);
+      Text_Char_v(&Text_st, '-');
+      Text_Uint_v(&Text_st, Time_st.tm_mon);
+      Text_Char_v(&Text_st, '-');
+      Text_Uint_v(&Text_st, Time_st.tm_year);
+      Text_Str_v(&Text_st, "  ");
+      Text_Uint_v(&Text_st, Time_st.tm_hour);
+      Text_Char_v(&Text_st, ':');
+      Text_Uint_v(&Text_st, Time_st.tm_min, 2);
+      break;
+
+    case PAGE_VAR_TEMP:
+      Text_Fixed_v(&Text_st, BENCH_TEMP, 1);
+      break;
+
+    case PAGE_VAR_LIGHT_DUTYCYCLE:
+      Text_Uint_v(&Text_st, BENCH_DUTYCYCLE);
+      break;
+
+    case PAGE_VAR_STATE:
+      Text_Str_v(&Text_st, "WAIT TIME SUNRISE");
+      break;
+
+    case PAGE_VAR_SUNRISE:
+      Text_Time_v(&Text_st, BENCH_SUNRISE_MIN / 60, BENCH_SUNRISE_MIN % 60);
+      break;
+
+    case PAGE_VAR_SUNSET:
+      Text_Time_v(&Text_st, BENCH_SUNSET_MIN / 60, BENCH_SUNSET_MIN % 60);
+      break;
+
+    case PAGE_VAR_THRESHOLD_DARK:
+      Text_Uint_v(&Text_st, 20);
+      break;
+
+    case PAGE_VAR_THRESHOLD_BRIGHT:
+      Text_Uint_v(&Text_st, 80);
+      break;
+
+    case PAGE_VAR_VERSION:
+      Text_Uint_v(&Text_st, 1);
+      Text_Char_v(&Text_st, '.');
+      Text_Uint_v(&Text_st, 4);
+      break;
+
+    default:
+      break;
+  }
+
+  return Text_Len_u32(&Text_st);
+}
+
+//processor: processor() of the old server
+static String LegacyProcessor(const String &Var)
+{
+  String RetStr = "";
+  struct tm Time_st;
+
+  Now_v(&Time_st);
+
+  if(Var == "DATE_TIME")
+  {
+    RetStr = String(Time_st.tm_mday) + "-" + String(Time_st.tm_mon) + "-" + String(Time_st.tm_year) + "  " +
+             String(Time_st.tm_hour) + ((Time_st.tm_min > 9) ? ":" : ":0") + String(Time_st.tm_min);
+  }
+  else if(Var == "TEMP")
+  {
+    RetStr = String(BENCH_TEMP, 1);
+  }
+  else if(Var == "LIGHT_DUTYCYCLE")
+  {
+    RetStr = String(BENCH_DUTYCYCLE);
+  }
+  else if(Var == "STATE")
+  {
+    RetStr = "WAIT TIME SUNRISE";
+  }
+  else if((Var == "SUNRISE") || (Var == "SUNSET"))
+  {
+    uint16_t Min_u16 = (Var == "SUNRISE") ? BENCH_SUNRISE_MIN : BENCH_SUNSET_MIN;
+    uint16_t Hour_u16 = Min_u16 / 60;
+    uint16_t Minute_u16 = Min_u16 % 60;
+
+    RetStr = ((Hour_u16 > 9) ? String("") : String("0")) + String(Hour_u16) + ((Minute_u16 > 9) ? ":" : ":0") + String(Minute_u16);
+  }
+  else if(Var == "THRESHOLD_DARK")
+  {
+    RetStr = String(20);
+  }
+  else if(Var == "THRESHOLD_BRIGHT")
+  {
+    RetStr = String(80);
+  }
+  else if(Var == "VERSION")
+  {
+    RetStr = String(1) + "." + String(4);
+  }
+
+  return RetStr;
+}
+//------------------------------
+
+
+//------------------------------
+// one page per mode, returns page length (0: error)
+//------------------------------
+static size_t ProcessorPage_u32(uint8_t *Chunk_pu8, size_t ChunkLen_u32, char *Page_pc)
+{
+  size_t Page_u32 = 0;
+  size_t Fill_u32 = 0;
+  File file = SPIFFS.open("/index.html", FILE_READ);
+
+  if(!file)
+  {
+    return 0;
+  }
+
+  //file read chunk by chunk, markers may cross a chunk: keep the tail
+  size_t Read_u32;
+
+  while((Read_u32 = file.read(&Chunk_pu8 [Fill_u32], ChunkLen_u32 - Fill_u32)) > 0)
+  {
+    size_t End_u32 = Fill_u32 + Read_u32;
+    size_t i = 0;
+
+    while(i < End_u32)
+    {
+      const uint8_t *Close_pu8 = (Chunk_pu8 [i] == '%') ? (const uint8_t *)memchr(&Chunk_pu8 [i + 1], '%', End_u32 - i - 1) : NULL;
+
+      if((Chunk_pu8 [i] == '%') && (Close_pu8 == NULL) && (End_u32 - i < PAGE_VALUE_LEN_MAX + 2) && (End_u32 == ChunkLen_u32))
+      {
+        break;
+      }
+
+      size_t Name_u32 = (Close_pu8 != NULL) ? Close_pu8 - &Chunk_pu8 [i + 1] : 0;
+
+      if((Close_pu8 != NULL) && (Name_u32 == 0))
+      {
+        Page_pc [Page_u32++] = '%';
+        i += 2;
+      }
+      else if((Close_pu8 != NULL) && (Name_u32 <= PAGE_VALUE_LEN_MAX + 1))
+      {
+        String Param;
+        Param.concat((const char *)&Chunk_pu8 [i + 1], Name_u32);
+
+        String Value = LegacyProcessor(Param);
+
+        memcpy(&Page_pc [Page_u32], Value.c_str(), Value.length());
+        Page_u32 += Value.length();
+        i += Name_u32 + 2;
+      }
+      else
+      {
+        Page_pc [Page_u32++] = Chunk_pu8 [i++];
+      }
+    }
+
+    Fill_u32 = End_u32 - i;
+    memmove(Chunk_pu8, &Chunk_pu8 [i], Fill_u32);
+  }
+
+  memcpy(&Page_pc [Page_u32], Chunk_pu8, Fill_u32);
+  file.close();
+
+  return Page_u32 + Fill_u32;
+}
+
+static size_t StreamPage_u32(uint8_t *Chunk_pu8, size_t ChunkLen_u32, char *Page_pc)
+{
+  PageRenderState_t State_st;
+  size_t Page_u32 = 0;
+  size_t Len_u32;
+
+  PageTemplate_RenderInit_v(&State_st);
+
+  while((Len_u32 = PageTemplate_Fill_u32(&State_st, Chunk_pu8, ChunkLen_u32)) > 0)
+  {
+    memcpy(&Page_pc [Page_u32], Chunk_pu8, Len_u32);
+    Page_u32 += Len_u32;
+  }
+
+  return Page_u32;
+}
+
+static size_t RenderPage_u32(char *Cache_pc, size_t CacheLen_u32, char *Page_pc)
+{
+  size_t Page_u32 = PageTemplate_Render_u32(Cache_pc, CacheLen_u32);
+
+  memcpy(Page_pc, Cache_pc, Page_u32);
+
+  return Page_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// main
+//------------------------------
+int main(int argc, char **argv)
+{
+  uint32_t Repeat_u32 = BENCH_REPEAT_DEFAULT;
+  size_t ChunkLen_u32 = BENCH_CHUNK_DEFAULT;
+  double Factor_f64 = BENCH_FACTOR_DEFAULT;
+
+  for(int i = 1; i < argc; i++)
+  {
+    if((strcmp(argv [i], "--repeat") == 0) && (i + 1 < argc)) Repeat_u32 = max(strtoul(argv [++i], NULL, 0), 1UL);
+    else if((strcmp(argv [i], "--chunk") == 0) && (i + 1 < argc)) ChunkLen_u32 = min(max(strtoul(argv [++i], NULL, 0), 64UL), 8192UL);
+    else if((strcmp(argv [i], "--factor") == 0) && (i + 1 < argc)) Factor_f64 = atof(argv [++i]);
+    else
+    {
+      fprintf(stderr, "usage: render_bench [--repeat N] [--chunk B] [--factor F]\n");
+      return 2;
+    }
+  }
+
+  //boot: template split once, page cache buffer
+  size_t Boot_u32 = HeapUsed_u32;
+
+  if(!PageTemplate_Load_b("/index.html", BenchPageVar_u32))
+  {
+    fprintf(stderr, "data/index.html not loaded (run from PlatformIo/Chicken-Light)\n");
+    return 2;
+  }
+
+  size_t CacheLen_u32 = PageTemplate_RenderLenMax_u32();
+  char *Cache_pc = (char *)malloc(CacheLen_u32);
+
+  printf("boot: template and segments %zu bytes, page cache %zu bytes (heap with headers)\n", HeapUsed_u32 - Boot_u32 - CacheLen_u32 - HEAP_HEADER, CacheLen_u32 + HEAP_HEADER);
+
+  //chunk buffer of the web server, the same for all modes
+  uint8_t *Chunk_pu8 = (uint8_t *)(malloc)(ChunkLen_u32);
+  static char Page_aac [MODE_COUNT][BENCH_PAGE_MAX];
+  size_t PageLen_au32 [MODE_COUNT];
+  bool Ok_b = true;
+
+  printf("mode         page bytes   us per page   ESP32 est. us   peak heap   allocations per page\n");
+
+  for(uint8_t m = 0; m < MODE_COUNT; m++)
+  {
+    size_t Start_u32 = HeapUsed_u32;
+    uint32_t Allocs_u32 = HeapAllocs_u32;
+
+    HeapPeak_u32 = HeapUsed_u32;
+
+    auto Begin = std::chrono::steady_clock::now();
+
+    for(uint32_t r = 0; r < Repeat_u32; r++)
+    {
+      switch(m)
+      {
+        case MODE_PROCESSOR: PageLen_au32 [m] = ProcessorPage_u32(Chunk_pu8, ChunkLen_u32, Page_aac [m]); break;
+        case MODE_STREAM:    PageLen_au32 [m] = StreamPage_u32(Chunk_pu8, ChunkLen_u32, Page_aac [m]); break;
+        default:             PageLen_au32 [m] = RenderPage_u32(Cache_pc, CacheLen_u32, Page_aac [m]); break;
+      }
+    }
+
+    double Usec_f64 = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Begin).count() / Repeat_u32;
+    uint32_t PageAllocs_u32 = (HeapAllocs_u32 - Allocs_u32) / Repeat_u32;
+
+    printf("%-10s   %10zu   %11.2f   %13.0f   %9zu   %20u\n", ModeName_apc [m], PageLen_au32 [m], Usec_f64, Usec_f64 * Factor_f64,
+           HeapPeak_u32 - Start_u32, PageAllocs_u32);
+
+    if(PageLen_au32 [m] == 0)
+    {
+      printf("%s: no page\n", ModeName_apc [m]);
+      Ok_b = false;
+    }
+
+    if((m != MODE_PROCESSOR) && ((HeapPeak_u32 != Start_u32) || (PageAllocs_u32 != 0)))
+    {
+      printf("%s: heap used per page\n", ModeName_apc [m]);
+      Ok_b = false;
+    }
+
+    if((m != MODE_PROCESSOR) && ((PageLen_au32 [m] != PageLen_au32 [MODE_PROCESSOR]) || (memcmp(Page_aac [m], Page_aac [MODE_PROCESSOR], PageLen_au32 [m]) != 0)))
+    {
+      printf("%s: page differs from processor\n", ModeName_apc [m]);
+      Ok_b = false;
+    }
+  }
+
+  free(Cache_pc);
+  (free)(Chunk_pu8);
+
+  printf("%s\n", Ok_b ? "ok" : "FAILED");
+
+  return Ok_b ? 0 : 1;
+}
+//------------------------------
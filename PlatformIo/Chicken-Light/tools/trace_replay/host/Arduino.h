@@ -0,0 +1,61 @@
+//------------------------------
+// Host build of the zone engine (trace replay)
+//
+// just enough of Arduino / FreeRTOS for src/LightZones.cpp: the clock is
+// the virtual replay clock, LEDC writes go nowhere (levels are taken from
+// the output hook), there are no tasks
+//------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+//replay clock [ms], set by the replay
+extern uint32_t ReplayMsec_u32;
+
+inline uint32_t millis(void) { return ReplayMsec_u32; }
+
+inline void ledcSetup(uint8_t Channel_u8, uint32_t FreqHz_u32, uint8_t ResolutionBit_u8) {}
+inline void ledcAttachPin(uint8_t Pin_u8, uint8_t Channel_u8) {}
+inline void ledcWrite(uint8_t Channel_u8, uint32_t Duty_u32) {}
+
+//FreeRTOS
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef uint32_t TickType_t;
+typedef int portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(Mux) ((void)(Mux))
+#define portEXIT_CRITICAL(Mux) ((void)(Mux))
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define pdTRUE 1
+#define pdMS_TO_TICKS(Msec) (Msec)
+
+inline TickType_t xTaskGetTickCount(void) { return ReplayMsec_u32; }
+inline void vTaskDelayUntil(TickType_t *LastWake_p, TickType_t Ticks) {}
+inline uint32_t ulTaskNotifyTake(int Clear_s32, TickType_t Ticks) { return 0; }
+inline void xTaskNotifyGive(TaskHandle_t Task_h) {}
+
+//one thread: the output mutex is always free
+typedef void *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex(void) { return (SemaphoreHandle_t)1; }
+inline int xSemaphoreTake(SemaphoreHandle_t Mutex_h, TickType_t Ticks) { return pdTRUE; }
+inline int xSemaphoreGive(SemaphoreHandle_t Mutex_h) { return pdTRUE; }
+
+//declarations of the task and supervisor headers only
+class Print
+{
+  public:
+    virtual size_t write(uint8_t c) = 0;
+};
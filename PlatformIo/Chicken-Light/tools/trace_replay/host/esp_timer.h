@@ -0,0 +1,30 @@
+//------------------------------
+// Host build of the zone engine (trace replay)
+//
+// esp_timer: dithering is not modelled (levels are taken from the output
+// hook), the timer never starts
+//------------------------------
+#pragma once
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+typedef void *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *);
+typedef enum { ESP_TIMER_TASK } esp_timer_dispatch_t;
+
+typedef struct
+{
+  esp_timer_cb_t callback;
+  void *arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char *name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *Args_pst, esp_timer_handle_t *Timer_ph) { return ESP_FAIL; }
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t Timer_h, uint64_t PeriodUsec_u64) { return ESP_FAIL; }
+inline esp_err_t esp_timer_stop(esp_timer_handle_t Timer_h) { return ESP_OK; }
@@ -0,0 +1,529 @@
+//------------------------------
+// Trace replay on the host
+//
+// A capture of the device (/api/trace) holds the external inputs, the
+// zone engine calls they caused and the output levels. The engine calls
+// are fed with their recorded timestamps through the zone engine of the
+// firmware (src/LightZones.cpp, built for the host), ticking at the same
+// cadence as the engine task. The replayed outputs are then compared
+// with the outputs the device recorded, in both directions, with a time
+// tolerance for the tick phase.
+//
+// Zones that were ramping when the capture started are synchronized to
+// the last recorded device level with their first engine call and are
+// compared from then on.
+//
+// build (from PlatformIo/Chicken-Light):
+//   g++ -std=gnu++17 -O2 -Itools/trace_replay/host -Iinclude tools/trace_replay/trace_replay.cpp src/LightZones.cpp -o trace_replay
+//
+// usage:
+//   curl -X POST http://<ip>/api/trace/start
+//   ... reproduce the problem ...
+//   curl -X POST http://<ip>/api/trace/stop
+//   curl -o trace.bin http://<ip>/api/trace
+//   ./trace_replay trace.bin [--dump] [--tolerance <ms>]
+//
+// exit code: 0 outputs match, 1 mismatch, 2 unreadable trace
+//------------------------------
+
+//includes
+//------------------------------
+#include <Arduino.h>
+#include <time.h>
+
+#include <vector>
+
+#include "LightZones.h"
+#include "TaskBudget.h"
+#include "Supervisor.h"
+#include "Trace.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define REPLAY_TOLERANCE_MSEC 60            //engine tick phase and hook latency on the device
+#define REPLAY_MISMATCH_PRINT_MAX 20
+
+static const char *CommandName_apc [] = {"", "light on", "light off", "control on", "control off", "zone", "config",
+                                         "rules", "schedule mode", "light level"};
+static const char *SourceName_apc [] = {"system", "switch", "web", "control", "ntp", "mqtt"};
+//------------------------------
+
+//global variables
+//------------------------------
+typedef struct
+{
+  uint32_t Msec_u32;
+  uint8_t Percent_u8;
+} OutPoint_t;
+
+uint32_t ReplayMsec_u32 = 0;
+
+static std::vector<TraceRecord_t> Record_av;
+static std::vector<OutPoint_t> Device_av [ZONE_COUNT_MAX];
+static std::vector<OutPoint_t> Replay_av [ZONE_COUNT_MAX];
+
+static uint32_t SyncMsec_au32 [ZONE_COUNT_MAX];     //compared from
+static uint16_t DeviceLevel_au16 [ZONE_COUNT_MAX];  //last recorded by the device
+static uint8_t Unknown_u8 = 0;                      //ramping at capture start, not yet synchronized
+
+static bool Ticking_b = false;
+static uint32_t NextTickMsec_u32 = 0;
+//------------------------------
+
+//function prototypes
+//------------------------------
+static bool Load_b(const char *Path_pc);
+static void Dump_v(void);
+static void Replay_v(void);
+static void EngineCall_v(size_t Index_u32);
+static void Advance_v(uint32_t Msec_u32);
+static void ReplayOutput_v(uint8_t Zone_u8, uint16_t Level_u16);
+static uint32_t Compare_u32(const std::vector<OutPoint_t> *From_pav, const std::vector<OutPoint_t> *To_pav,
+                            const char *What_pc, uint32_t Tolerance_u32, uint32_t *Printed_pu32);
+static void WallClock_v(uint32_t Msec_u32, char *Text_pc, size_t Size_u32);
+//------------------------------
+
+
+//------------------------------
+// firmware functions the zone engine calls
+//------------------------------
+TaskHandle_t Task_Start_h(uint8_t Task_u8, TaskFunction_t Func_pfn, void *Param_pv) { return NULL; }
+TaskHandle_t Task_Restart_h(uint8_t Task_u8, TaskFunction_t Func_pfn, void *Param_pv) { return NULL; }
+void Task_WatchLock_v(SemaphoreHandle_t Lock_h) {}
+void Supervisor_Heartbeat_v(uint8_t Slot_u8) {}
+void Supervisor_Pause_v(uint8_t Slot_u8) {}
+void Trace_Log_v(uint8_t Type_u8, uint8_t Arg0_u8, uint8_t Arg1_u8, uint8_t Arg2_u8, uint32_t Value_u32, uint32_t Aux_u32) {}
+//------------------------------
+
+
+//------------------------------
+// main
+//------------------------------
+int main(int argc, char **argv)
+{
+  const char *Path_pc = NULL;
+  bool Dump_b = false;
+  uint32_t Tolerance_u32 = REPLAY_TOLERANCE_MSEC;
+
+  for(int i = 1; i < argc; i++)
+  {
+    if(strcmp(argv [i], "--dump") == 0)
+    {
+      Dump_b = true;
+    }
+    else if((strcmp(argv [i], "--tolerance") == 0) && (i + 1 < argc))
+    {
+      Tolerance_u32 = strtoul(argv [++i], NULL, 10);
+    }
+    else
+    {
+      Path_pc = argv [i];
+    }
+  }
+
+  if((Path_pc == NULL) || !Load_b(Path_pc))
+  {
+    fprintf(stderr, "usage: trace_replay trace.bin [--dump] [--tolerance <ms>]\n");
+    return 2;
+  }
+
+  if(Dump_b)
+  {
+    Dump_v();
+  }
+
+  Replay_v();
+
+  uint32_t Printed_u32 = 0;
+  uint32_t Mismatch_u32 = Compare_u32(Device_av, Replay_av, "device output not replayed", Tolerance_u32, &Printed_u32)
+                          + Compare_u32(Replay_av, Device_av, "replayed output not on device", Tolerance_u32, &Printed_u32);
+
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    printf("zone %u: %zu device / %zu replayed output changes\n", i, Device_av [i].size(), Replay_av [i].size());
+  }
+
+  if(Mismatch_u32 > 0)
+  {
+    printf("%u mismatches (tolerance %u ms)\n", Mismatch_u32, Tolerance_u32);
+    return 1;
+  }
+
+  printf("outputs match (tolerance %u ms)\n", Tolerance_u32);
+  return 0;
+}
+//------------------------------
+
+
+//------------------------------
+// read trace file
+//------------------------------
+static bool Load_b(const char *Path_pc)
+{
+  FILE *File_pst = fopen(Path_pc, "rb");
+  TraceRecord_t Record_st;
+
+  if(File_pst == NULL)
+  {
+    perror(Path_pc);
+    return false;
+  }
+
+  while(fread(&Record_st, sizeof(Record_st), 1, File_pst) == 1)
+  {
+    Record_av.push_back(Record_st);
+  }
+
+  fclose(File_pst);
+
+  if(Record_av.empty() || (Record_av [0].Type_u8 != TRACE_START) || (Record_av [0].Aux_u32 != TRACE_VERSION)
+     || (Record_av [0].Arg_au8 [0] == 0) || (Record_av [0].Arg_au8 [0] > ZONE_COUNT_MAX))
+  {
+    fprintf(stderr, "%s: no trace (version %u expected)\n", Path_pc, TRACE_VERSION);
+    return false;
+  }
+
+  return true;
+}
+//------------------------------
+
+
+//------------------------------
+// print all records
+//------------------------------
+static void Dump_v(void)
+{
+  for(size_t i = 0; i < Record_av.size(); i++)
+  {
+    const TraceRecord_t *Record_pst = &Record_av [i];
+    const uint8_t *Arg_pu8 = Record_pst->Arg_au8;
+    char Clock_ac [24];
+
+    WallClock_v(Record_pst->Msec_u32, Clock_ac, sizeof(Clock_ac));
+    printf("%10.3f  %s  ", Record_pst->Msec_u32 / 1000.0, Clock_ac);
+
+    switch(Record_pst->Type_u8)
+    {
+      case TRACE_START:
+        printf("START      %u zones, schedule mode %u, ramping 0x%02X\n", Arg_pu8 [0], Arg_pu8 [1], Arg_pu8 [2]);
+        break;
+
+      case TRACE_IN_RTC:
+        printf("RTC        %u\n", Record_pst->Value_u32);
+        break;
+
+      case TRACE_IN_NTP:
+        printf("NTP        %s %u\n", Arg_pu8 [0] ? "ok" : "failed", Record_pst->Value_u32);
+        break;
+
+      case TRACE_IN_TEMP:
+        if((int32_t)Record_pst->Value_u32 == INT32_MIN)
+        {
+          printf("TEMP       role %u: invalid\n", Arg_pu8 [0]);
+        }
+        else
+        {
+          printf("TEMP       role %u: %.2f degC\n", Arg_pu8 [0], (int32_t)Record_pst->Value_u32 / 100.0);
+        }
+        break;
+
+      case TRACE_IN_ADC:
+        printf("ADC        GPIO %u: %u\n", Arg_pu8 [0], Record_pst->Value_u32);
+        break;
+
+      case TRACE_IN_SWITCH:
+        printf("SWITCH     %u\n", Arg_pu8 [0]);
+        break;
+
+      case TRACE_IN_COMMAND:
+        printf("COMMAND    %s (%s) mask 0x%02X value %u ramp %u ms\n",
+               (Arg_pu8 [0] < sizeof(CommandName_apc) / sizeof(CommandName_apc [0])) ? CommandName_apc [Arg_pu8 [0]] : "?",
+               (Arg_pu8 [1] < sizeof(SourceName_apc) / sizeof(SourceName_apc [0])) ? SourceName_apc [Arg_pu8 [1]] : "?",
+               Arg_pu8 [2], Record_pst->Value_u32, Record_pst->Aux_u32);
+        break;
+
+      case TRACE_ZONE_SET:
+        printf("SET        mask 0x%02X level %u\n", Arg_pu8 [0], Record_pst->Value_u32);
+        break;
+
+      case TRACE_ZONE_FADE:
+        printf("FADE       mask 0x%02X to %u in %u ms, %s\n", Arg_pu8 [0], Record_pst->Value_u32, Record_pst->Aux_u32,
+               LightZone_EaseName_pc(Arg_pu8 [1]));
+        break;
+
+      case TRACE_ZONE_PROGRAM:
+        printf("PROGRAM    mask 0x%02X, %u keyframes, offset %u ms\n", Arg_pu8 [0], Arg_pu8 [1], Record_pst->Aux_u32);
+        break;
+
+      case TRACE_ZONE_KEYFRAME:
+        printf("  KEYFRAME %u: %u s level %u, %s\n", Arg_pu8 [0], Record_pst->Value_u32 & 0xFFFF, Record_pst->Value_u32 >> 16,
+               LightZone_EaseName_pc(Arg_pu8 [1]));
+        break;
+
+      case TRACE_ZONE_STOP:
+        printf("STOP       mask 0x%02X\n", Arg_pu8 [0]);
+        break;
+
+      case TRACE_OUT_LEVEL:
+        printf("OUT        zone %u: %u (%u %%)\n", Arg_pu8 [0], Record_pst->Value_u32,
+               LightZone_LevelToPercent_u8(Record_pst->Value_u32));
+        break;
+
+      default:
+        printf("?          type %u\n", Record_pst->Type_u8);
+        break;
+    }
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// feed engine calls through the zone engine
+//------------------------------
+static void Replay_v(void)
+{
+  static const uint8_t Pin_au8 [ZONE_COUNT_MAX] = {0};
+  static const uint8_t Schedule_au8 [ZONE_COUNT_MAX] = {0};
+  uint8_t Count_u8 = Record_av [0].Arg_au8 [0];
+
+  LightZone_Init_v(Pin_au8, Schedule_au8, Count_u8, 1000, 13, ReplayOutput_v);
+
+  for(uint8_t i = 0; i < Count_u8; i++)
+  {
+    Replay_av [i].clear();
+    Replay_av [i].push_back({0, 0});
+  }
+
+  Unknown_u8 = Record_av [0].Arg_au8 [2];
+
+  for(size_t i = 1; i < Record_av.size(); i++)
+  {
+    const TraceRecord_t *Record_pst = &Record_av [i];
+    uint8_t Zone_u8 = Record_pst->Arg_au8 [0];
+
+    Advance_v(Record_pst->Msec_u32);
+    ReplayMsec_u32 = Record_pst->Msec_u32;
+
+    switch(Record_pst->Type_u8)
+    {
+      case TRACE_OUT_LEVEL:
+        if(Zone_u8 >= Count_u8)
+        {
+          break;
+        }
+
+        //initial state
+        if(i <= Count_u8)
+        {
+          LightZone_Set_v(1 << Zone_u8, Record_pst->Value_u32);
+        }
+
+        DeviceLevel_au16 [Zone_u8] = Record_pst->Value_u32;
+        Device_av [Zone_u8].push_back({Record_pst->Msec_u32, LightZone_LevelToPercent_u8(Record_pst->Value_u32)});
+        break;
+
+      case TRACE_ZONE_SET:
+      case TRACE_ZONE_FADE:
+      case TRACE_ZONE_PROGRAM:
+      case TRACE_ZONE_STOP:
+        EngineCall_v(i);
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+static void EngineCall_v(size_t Index_u32)
+{
+  const TraceRecord_t *Record_pst = &Record_av [Index_u32];
+  uint8_t Mask_u8 = Record_pst->Arg_au8 [0];
+
+  //zones ramping at capture start: continue from the level the device had
+  for(uint8_t i = 0; i < ZoneTable_st.Count_u8; i++)
+  {
+    if(Mask_u8 & Unknown_u8 & (1 << i))
+    {
+      LightZone_Set_v(1 << i, DeviceLevel_au16 [i]);
+      SyncMsec_au32 [i] = Record_pst->Msec_u32;
+      Unknown_u8 &= ~(1 << i);
+    }
+  }
+
+  switch(Record_pst->Type_u8)
+  {
+    case TRACE_ZONE_SET:
+      LightZone_Set_v(Mask_u8, Record_pst->Value_u32);
+      break;
+
+    case TRACE_ZONE_FADE:
+      LightZone_StartFade_v(Mask_u8, Record_pst->Value_u32, Record_pst->Aux_u32, Record_pst->Arg_au8 [1]);
+      break;
+
+    case TRACE_ZONE_PROGRAM:
+    {
+      //keyframes follow, possibly interleaved with records of other tasks
+      LightKeyframe_t Keyframe_ast [ZONE_KEYFRAMES_MAX];
+      uint8_t Count_u8 = min<uint8_t>(Record_pst->Arg_au8 [1], ZONE_KEYFRAMES_MAX);
+      uint8_t Found_u8 = 0;
+
+      for(size_t i = Index_u32 + 1; (i < Record_av.size()) && (Found_u8 < Count_u8); i++)
+      {
+        const TraceRecord_t *Key_pst = &Record_av [i];
+
+        if(Key_pst->Type_u8 == TRACE_ZONE_KEYFRAME)
+        {
+          Keyframe_ast [Found_u8].TimeSec_u16 = Key_pst->Value_u32 & 0xFFFF;
+          Keyframe_ast [Found_u8].Level_u16 = Key_pst->Value_u32 >> 16;
+          Keyframe_ast [Found_u8].Ease_u8 = Key_pst->Arg_au8 [1];
+          Found_u8++;
+        }
+      }
+
+      LightZone_StartProgram_v(Mask_u8, Keyframe_ast, Found_u8, Record_pst->Aux_u32);
+      break;
+    }
+
+    case TRACE_ZONE_STOP:
+      LightZone_Stop_v(Mask_u8);
+      break;
+  }
+
+  //idle engine task is woken and ticks right away
+  if(!Ticking_b && (ZoneTable_st.RampingMask_u8 != 0))
+  {
+    LightZone_Step_v(ReplayMsec_u32);
+    Ticking_b = true;
+    NextTickMsec_u32 = ReplayMsec_u32 + ZONE_ENGINE_TICK_MSEC;
+  }
+}
+
+//engine ticks before Msec_u32
+static void Advance_v(uint32_t Msec_u32)
+{
+  while(Ticking_b && (NextTickMsec_u32 < Msec_u32))
+  {
+    ReplayMsec_u32 = NextTickMsec_u32;
+
+    if(ZoneTable_st.RampingMask_u8 == 0)
+    {
+      Ticking_b = false;
+      break;
+    }
+
+    LightZone_Step_v(ReplayMsec_u32);
+    NextTickMsec_u32 += ZONE_ENGINE_TICK_MSEC;
+  }
+}
+
+//output hook, same reduction to percent steps as on the device
+static void ReplayOutput_v(uint8_t Zone_u8, uint16_t Level_u16)
+{
+  uint8_t Percent_u8 = LightZone_LevelToPercent_u8(Level_u16);
+  std::vector<OutPoint_t> *Timeline_pv = &Replay_av [Zone_u8];
+
+  if(Timeline_pv->empty() || (Timeline_pv->back().Percent_u8 != Percent_u8))
+  {
+    Timeline_pv->push_back({ReplayMsec_u32, Percent_u8});
+  }
+}
+//------------------------------
+
+
+//------------------------------
+// every point of one timeline must be reached by the other within the tolerance
+//------------------------------
+static uint32_t Compare_u32(const std::vector<OutPoint_t> *From_pav, const std::vector<OutPoint_t> *To_pav,
+                            const char *What_pc, uint32_t Tolerance_u32, uint32_t *Printed_pu32)
+{
+  uint32_t Mismatch_u32 = 0;
+  uint32_t EndMsec_u32 = Record_av.back().Msec_u32;
+
+  for(uint8_t z = 0; z < ZoneTable_st.Count_u8; z++)
+  {
+    const std::vector<OutPoint_t> *Other_pv = &To_pav [z];
+
+    for(const OutPoint_t &Point_st : From_pav [z])
+    {
+      //before synchronization (ramping at start) or after the end of the capture
+      if((Point_st.Msec_u32 < SyncMsec_au32 [z]) || ((Unknown_u8 & (1 << z)) != 0) || (Point_st.Msec_u32 > EndMsec_u32)
+         || Other_pv->empty())
+      {
+        continue;
+      }
+
+      uint32_t From_u32 = (Point_st.Msec_u32 > Tolerance_u32) ? Point_st.Msec_u32 - Tolerance_u32 : 0;
+      uint32_t To_u32 = Point_st.Msec_u32 + Tolerance_u32;
+
+      //range of the other timeline within the window
+      uint8_t Min_u8 = 0xFF;
+      uint8_t Max_u8 = 0;
+      uint8_t Current_u8 = Other_pv->front().Percent_u8;
+
+      for(const OutPoint_t &Other_st : *Other_pv)
+      {
+        if(Other_st.Msec_u32 <= From_u32)
+        {
+          Current_u8 = Other_st.Percent_u8;
+        }
+        else if(Other_st.Msec_u32 <= To_u32)
+        {
+          Min_u8 = min(Min_u8, Other_st.Percent_u8);
+          Max_u8 = max(Max_u8, Other_st.Percent_u8);
+        }
+      }
+
+      Min_u8 = min(Min_u8, Current_u8);
+      Max_u8 = max(Max_u8, Current_u8);
+
+      if((Point_st.Percent_u8 >= Min_u8) && (Point_st.Percent_u8 <= Max_u8))
+      {
+        continue;
+      }
+
+      Mismatch_u32++;
+
+      if(*Printed_pu32 < REPLAY_MISMATCH_PRINT_MAX)
+      {
+        char Clock_ac [24];
+
+        WallClock_v(Point_st.Msec_u32, Clock_ac, sizeof(Clock_ac));
+        printf("%10.3f  %s  zone %u: %s: %u %% (other side %u...%u %%)\n", Point_st.Msec_u32 / 1000.0, Clock_ac, z,
+               What_pc, Point_st.Percent_u8, Min_u8, Max_u8);
+        (*Printed_pu32)++;
+      }
+    }
+  }
+
+  return Mismatch_u32;
+}
+//------------------------------
+
+
+//------------------------------
+// RTC time at a capture time (last RTC record + uptime)
+//------------------------------
+static void WallClock_v(uint32_t Msec_u32, char *Text_pc, size_t Size_u32)
+{
+  uint32_t AnchorUnix_u32 = Record_av [0].Value_u32;
+  uint32_t AnchorMsec_u32 = 0;
+
+  for(size_t i = 1; (i < Record_av.size()) && (Record_av [i].Msec_u32 <= Msec_u32); i++)
+  {
+    if(Record_av [i].Type_u8 == TRACE_IN_RTC)
+    {
+      AnchorUnix_u32 = Record_av [i].Value_u32;
+      AnchorMsec_u32 = Record_av [i].Msec_u32;
+    }
+  }
+
+  time_t Unix = AnchorUnix_u32 + (Msec_u32 - AnchorMsec_u32) / 1000;
+  struct tm Time_st;
+
+  gmtime_r(&Unix, &Time_st);
+  strftime(Text_pc, Size_u32, "%Y-%m-%d %H:%M:%S", &Time_st);
+}
+//------------------------------
@@ -0,0 +1,105 @@
+//------------------------------
+// Host build of the power save mode (wakeup_sim)
+//
+// just enough of Arduino / FreeRTOS for src/PowerSave.cpp: GPIO, pin
+// interrupts and the task notification of the waiting task are the
+// simulated hardware of wakeup_sim.cpp, time is the simulated RTC
+//------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+class Print
+{
+  public:
+    virtual size_t write(uint8_t c) = 0;
+
+    size_t write(const uint8_t *Buf_pu8, size_t Size_u32)
+    {
+      for(size_t i = 0; i < Size_u32; i++)
+      {
+        write(Buf_pu8 [i]);
+      }
+
+      return Size_u32;
+    }
+
+    size_t print(const char *Text_pc)
+    {
+      return write((const uint8_t *)Text_pc, strlen(Text_pc));
+    }
+
+    size_t printf(const char *Format_pc, ...)
+    {
+      char Buf_ac [512];
+      va_list Args;
+
+      va_start(Args, Format_pc);
+      int Len_s32 = vsnprintf(Buf_ac, sizeof(Buf_ac), Format_pc, Args);
+      va_end(Args);
+
+      return write((const uint8_t *)Buf_ac, min<int>(Len_s32, sizeof(Buf_ac) - 1));
+    }
+};
+
+//firmware log, shown with --verbose
+class HostSerial : public Print
+{
+  public:
+    bool Enabled_b = false;
+
+    size_t write(uint8_t c) override
+    {
+      if(Enabled_b)
+      {
+        putchar(c);
+      }
+
+      return 1;
+    }
+};
+
+extern HostSerial Serial;
+
+//GPIO (wakeup_sim.cpp)
+#define INPUT_PULLUP 0x05
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define digitalPinToInterrupt(Pin) (Pin)
+
+void pinMode(uint8_t Pin_u8, uint8_t Mode_u8);
+int digitalRead(uint8_t Pin_u8);
+void attachInterrupt(uint8_t Pin_u8, void (*Isr_pfn)(void), int Mode_s32);
+
+//FreeRTOS
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdMS_TO_TICKS(Msec) (Msec)
+#define portYIELD_FROM_ISR()
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskNotifyGiveFromISR(TaskHandle_t Task_h, BaseType_t *Woken_p);
+uint32_t ulTaskNotifyTake(BaseType_t Clear_s32, TickType_t Ticks);   //the simulated wait
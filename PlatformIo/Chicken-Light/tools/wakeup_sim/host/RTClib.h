@@ -0,0 +1,73 @@
+//------------------------------
+// Host RTClib: DateTime / TimeSpan on the C library, DS3231 alarms are
+// simulated by wakeup_sim.cpp
+//------------------------------
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+
+class TimeSpan
+{
+  public:
+    TimeSpan(int32_t Seconds_s32 = 0) : Seconds_s32(Seconds_s32) {}
+    int32_t totalseconds(void) const { return Seconds_s32; }
+
+  private:
+    int32_t Seconds_s32;
+};
+
+class DateTime
+{
+  public:
+    DateTime(uint32_t Unix_u32 = 0) : Unix_u32(Unix_u32) {}
+
+    DateTime(uint16_t Year_u16, uint8_t Month_u8, uint8_t Day_u8, uint8_t Hour_u8 = 0, uint8_t Minute_u8 = 0, uint8_t Second_u8 = 0)
+    {
+      struct tm Tm_st = {};
+
+      Tm_st.tm_year = Year_u16 - 1900;
+      Tm_st.tm_mon = Month_u8 - 1;
+      Tm_st.tm_mday = Day_u8;
+      Tm_st.tm_hour = Hour_u8;
+      Tm_st.tm_min = Minute_u8;
+      Tm_st.tm_sec = Second_u8;
+      Unix_u32 = (uint32_t)timegm(&Tm_st);
+    }
+
+    uint32_t unixtime(void) const { return Unix_u32; }
+    uint16_t year(void) const { return Tm().tm_year + 1900; }
+    uint8_t month(void) const { return Tm().tm_mon + 1; }
+    uint8_t day(void) const { return Tm().tm_mday; }
+    uint8_t hour(void) const { return Tm().tm_hour; }
+    uint8_t minute(void) const { return Tm().tm_min; }
+    uint8_t second(void) const { return Tm().tm_sec; }
+    uint8_t dayOfTheWeek(void) const { return Tm().tm_wday; }
+
+    DateTime operator+(const TimeSpan &Span) const { return DateTime(Unix_u32 + Span.totalseconds()); }
+
+  private:
+    uint32_t Unix_u32;
+
+    struct tm Tm(void) const
+    {
+      time_t Time_t = Unix_u32;
+      struct tm Tm_st;
+
+      gmtime_r(&Time_t, &Tm_st);
+      return Tm_st;
+    }
+};
+
+enum Ds3231SqwPinMode { DS3231_OFF = 0x1C };
+enum Ds3231Alarm1Mode { DS3231_A1_Hour = 0x08 };        //match h:m:s
+enum Ds3231Alarm2Mode { DS3231_A2_Hour = 0x04 };        //match h:m
+
+class RTC_DS3231
+{
+  public:
+    void writeSqwPinMode(Ds3231SqwPinMode Mode) {}
+    bool setAlarm1(const DateTime &Time, Ds3231Alarm1Mode Mode);
+    bool setAlarm2(const DateTime &Time, Ds3231Alarm2Mode Mode);
+    void clearAlarm(uint8_t Alarm_u8);
+};
@@ -0,0 +1,12 @@
+//------------------------------
+// Host WiFi: modem sleep setting only
+//------------------------------
+#pragma once
+
+class HostWiFi
+{
+  public:
+    bool setSleep(bool Enable_b) { return true; }
+};
+
+static HostWiFi WiFi;
@@ -0,0 +1,11 @@
+//------------------------------
+// Host GPIO driver: interrupt type and wake-up enable of the simulated pins
+//------------------------------
+#pragma once
+
+typedef int gpio_num_t;
+typedef enum { GPIO_INTR_DISABLE, GPIO_INTR_POSEDGE, GPIO_INTR_NEGEDGE, GPIO_INTR_ANYEDGE, GPIO_INTR_LOW_LEVEL, GPIO_INTR_HIGH_LEVEL } gpio_int_type_t;
+
+esp_err_t gpio_wakeup_enable(gpio_num_t Pin, gpio_int_type_t Type);
+esp_err_t gpio_wakeup_disable(gpio_num_t Pin);
+esp_err_t gpio_set_intr_type(gpio_num_t Pin, gpio_int_type_t Type);
@@ -0,0 +1,19 @@
+//------------------------------
+// Host esp_pm: configuration and locks are accepted and ignored
+//------------------------------
+#pragma once
+
+typedef struct
+{
+  int max_freq_mhz;
+  int min_freq_mhz;
+  bool light_sleep_enable;
+} esp_pm_config_esp32_t;
+
+typedef enum { ESP_PM_CPU_FREQ_MAX, ESP_PM_APB_FREQ_MAX, ESP_PM_NO_LIGHT_SLEEP } esp_pm_lock_type_t;
+typedef void *esp_pm_lock_handle_t;
+
+inline esp_err_t esp_pm_configure(const void *Config_p) { return ESP_OK; }
+inline esp_err_t esp_pm_lock_create(esp_pm_lock_type_t Type, int Arg_s32, const char *Name_pc, esp_pm_lock_handle_t *Lock_ph) { *Lock_ph = (void *)1; return ESP_OK; }
+inline esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t Lock_h) { return ESP_OK; }
+inline esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t Lock_h) { return ESP_OK; }
@@ -0,0 +1,6 @@
+//------------------------------
+// Host esp_sleep: light sleep is the simulated wait (ulTaskNotifyTake)
+//------------------------------
+#pragma once
+
+inline esp_err_t esp_sleep_enable_gpio_wakeup(void) { return ESP_OK; }
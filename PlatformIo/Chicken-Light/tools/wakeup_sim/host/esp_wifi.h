@@ -0,0 +1,8 @@
+//------------------------------
+// Host esp_wifi: power save setting only
+//------------------------------
+#pragma once
+
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+
+inline esp_err_t esp_wifi_set_ps(wifi_ps_type_t Type) { return ESP_OK; }
@@ -0,0 +1,14 @@
+//------------------------------
+// Host GPIO registers: interrupt type per pin
+//------------------------------
+#pragma once
+
+typedef struct
+{
+  struct
+  {
+    uint32_t int_type;
+  } pin [40];
+} gpio_dev_t;
+
+extern gpio_dev_t GPIO;
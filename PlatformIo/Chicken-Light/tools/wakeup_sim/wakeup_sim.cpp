@@ -0,0 +1,396 @@
+//------------------------------
+// Power save wake-ups per day (host)
+//
+// Runs src/PowerSave.cpp unchanged against a simulated DS3231 and GPIO.
+// For every day of a year the table plan is built like UpdateDailyPlan_v
+// (src/Photoperiod.cpp) and stored with PowerSave_SetPlan_v, then the idle
+// path of the light control task is followed: PowerSave_WaitForNextEvent_v
+// until an event minute, the light window (no sleep while the PWM runs),
+// wait again. The wake-ups the firmware counted for a day
+// (PowerSaveWakeupsYesterday_u16 after the next plan) are compared with
+// PowerSave_SimulateWakeupsPerDay_u16, the value the firmware logs as
+// expectation. The boot day is only shown: until the first alarm interrupt
+// was seen the fallback timeouts end before the alarm.
+//
+// The simulated pins also check the interrupt handling: RTC INT must be
+// armed as LOW_LEVEL wake-up while waiting, must not stay armed on the
+// level after the ISR (INT is low until the alarm is cleared) and must be
+// back to the falling edge after the wait.
+//
+// Without alarm interrupt (--no-alarm) the waits end by their timeout on
+// the drifting slow clock (--drift-pct, + = runs fast); the count is only
+// shown.
+//
+// build (from PlatformIo/Chicken-Light):
+//   g++ -std=gnu++17 -O2 -Itools/wakeup_sim/host -Iinclude tools/wakeup_sim/wakeup_sim.cpp src/PowerSave.cpp src/Photoperiod.cpp -o wakeup_sim
+//
+// usage:
+//   wakeup_sim [--year YYYY] [--photoperiod-min M] [--no-alarm] [--drift-pct P] [--verbose]
+//
+// exit code: 0 counts match and pin handling ok, 1 otherwise
+//------------------------------
+
+//includes
+//------------------------------
+#include <Arduino.h>
+#include <math.h>
+
+#include "PowerSave.h"
+#include "I2cBus.h"
+#include "Photoperiod.h"
+#include "SunriseSunset.h"
+#include "driver/gpio.h"
+#include "soc/gpio_struct.h"
+//------------------------------
+
+//constants
+//------------------------------
+#define SIM_RTC_INT 25                    //pins of main.cpp
+#define SIM_SWITCH 27
+#define SIM_PINS 40
+#define SECONDS_PER_DAY 86400UL
+#define EVENTS_MAX 2                      //table: morning and evening window
+//------------------------------
+
+//global variables
+//------------------------------
+HostSerial Serial;
+gpio_dev_t GPIO;
+RTC_DS3231 rtc;
+
+static uint32_t Now_u32 = 0;                          //simulated time (RTC, UTC = local)
+static bool AlarmWired_b = true;
+static double DriftPct_f64 = 0.0;
+
+static int32_t AlarmTod_as32 [2] = {-1, -1};         //second of day, -1 = not set
+static bool AlarmFlag_ab [2] = {false, false};       //INT low while a flag is set
+static void (*Isr_apfn [SIM_PINS])(void);
+static bool Notified_b = false;
+
+static uint32_t PinErrors_u32 = 0;
+//------------------------------
+
+
+//------------------------------
+// simulated GPIO
+//------------------------------
+void pinMode(uint8_t Pin_u8, uint8_t Mode_u8) {}
+
+int digitalRead(uint8_t Pin_u8)
+{
+  return (Pin_u8 == SIM_RTC_INT) ? !(AlarmFlag_ab [0] || AlarmFlag_ab [1]) : 1;
+}
+
+void attachInterrupt(uint8_t Pin_u8, void (*Isr_pfn)(void), int Mode_s32)
+{
+  Isr_apfn [Pin_u8] = Isr_pfn;
+  GPIO.pin [Pin_u8].int_type = (Mode_s32 == FALLING) ? GPIO_INTR_NEGEDGE : GPIO_INTR_ANYEDGE;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t Pin, gpio_int_type_t Type)
+{
+  GPIO.pin [Pin].int_type = Type;
+  return ESP_OK;
+}
+
+//like ESP-IDF: wake-up off, pin left without interrupt type
+esp_err_t gpio_wakeup_disable(gpio_num_t Pin)
+{
+  GPIO.pin [Pin].int_type = GPIO_INTR_DISABLE;
+  return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t Pin, gpio_int_type_t Type)
+{
+  GPIO.pin [Pin].int_type = Type;
+  return ESP_OK;
+}
+//------------------------------
+
+
+//------------------------------
+// simulated DS3231 alarms
+//------------------------------
+bool RTC_DS3231::setAlarm1(const DateTime &Time, Ds3231Alarm1Mode Mode)
+{
+  AlarmTod_as32 [0] = Time.unixtime() % SECONDS_PER_DAY;
+  return true;
+}
+
+bool RTC_DS3231::setAlarm2(const DateTime &Time, Ds3231Alarm2Mode Mode)
+{
+  AlarmTod_as32 [1] = Time.unixtime() % SECONDS_PER_DAY / 60 * 60;
+  return true;
+}
+
+void RTC_DS3231::clearAlarm(uint8_t Alarm_u8)
+{
+  AlarmFlag_ab [Alarm_u8 - 1] = false;
+}
+//------------------------------
+
+
+//------------------------------
+// I2C bus: single task, nothing to lock
+//------------------------------
+void I2cBus_Lock_v(uint8_t Op_u8) {}
+void I2cBus_Unlock_v(void) {}
+//------------------------------
+
+
+//------------------------------
+// simulated task notification: the wait of the light control task
+//------------------------------
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+  return (TaskHandle_t)1;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t Task_h, BaseType_t *Woken_p)
+{
+  Notified_b = true;
+  *Woken_p = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t Clear_s32, TickType_t Ticks)
+{
+  //timeout runs on the slow clock
+  uint32_t Timeout_u32 = Now_u32 + (uint32_t)ceil(Ticks / 1000.0 / (1.0 + DriftPct_f64 / 100.0));
+  uint32_t Fire_u32 = UINT32_MAX;
+
+  for(uint8_t i = 0; i < 2; i++)
+  {
+    if(AlarmTod_as32 [i] >= 0)
+    {
+      uint32_t Time_u32 = Now_u32 - Now_u32 % SECONDS_PER_DAY + AlarmTod_as32 [i];
+      Time_u32 += (Time_u32 <= Now_u32) ? SECONDS_PER_DAY : 0;
+      Fire_u32 = min(Fire_u32, Time_u32);
+    }
+  }
+
+  if(Notified_b || !AlarmWired_b || (Fire_u32 > Timeout_u32))
+  {
+    Now_u32 = Notified_b ? Now_u32 : Timeout_u32;
+    Notified_b = false;
+    return 0;
+  }
+
+  //INT goes low: wakes the chip only if armed as level, the ISR runs on level or edge
+  Now_u32 = Fire_u32;
+
+  for(uint8_t i = 0; i < 2; i++)
+  {
+    AlarmFlag_ab [i] = AlarmFlag_ab [i] || ((int32_t)(Now_u32 % SECONDS_PER_DAY) == AlarmTod_as32 [i]);
+  }
+
+  uint32_t Type_u32 = GPIO.pin [SIM_RTC_INT].int_type;
+
+  if(Type_u32 != GPIO_INTR_LOW_LEVEL)
+  {
+    printf("%u: RTC INT not armed as wake-up level (type %u)\n", Now_u32, Type_u32);
+    PinErrors_u32++;
+  }
+
+  if((Type_u32 == GPIO_INTR_LOW_LEVEL) || (Type_u32 == GPIO_INTR_NEGEDGE))
+  {
+    Isr_apfn [SIM_RTC_INT]();
+  }
+
+  if(GPIO.pin [SIM_RTC_INT].int_type == GPIO_INTR_LOW_LEVEL)
+  {
+    printf("%u: RTC INT still armed on the level after the ISR (fires until cleared)\n", Now_u32);
+    PinErrors_u32++;
+  }
+
+  Notified_b = false;
+  return 1;
+}
+//------------------------------
+
+
+//------------------------------
+// calendar week, copy of CalcCalendarWeek_u8 (main.cpp)
+//------------------------------
+static uint8_t CalcCalendarWeek_u8(uint16_t y_u16, uint16_t m_u16, uint16_t d_u16)
+{
+  int adj = (((y_u16-1901) + ((y_u16-1901)/4) + 4) % 7) + 3;
+  static const int Before_as32 [12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  int doy = d_u16 + Before_as32 [m_u16 - 1] + (((m_u16 > 2) && ((y_u16 % 4) == 0)) ? 1 : 0);
+  uint8_t wknum = (adj + doy) / 7;
+  if (wknum < 1) {
+    adj = (((y_u16-1902) + ((y_u16-1902)/4) + 4) % 7) + 3;
+    if (adj==9) return 53;
+    if ((adj==8) && ((y_u16 % 4)==1)) return 53;
+    return 52;
+  }
+  if (wknum > 52) {
+    if (adj==9) return 53;
+    if ((adj==8) && ((y_u16 % 4)==0)) return 53;
+    return 1;
+  }
+  return wknum;
+}
+//------------------------------
+
+
+//------------------------------
+// table plan of one day (UpdateDailyPlan_v): event minutes and light window lengths
+//------------------------------
+static uint8_t DayPlan_u8(const DateTime &Day, const PhotoperiodSetting_t *Setting_pst, uint16_t *Event_pu16, uint16_t *Length_pu16)
+{
+  const uint8_t *Row_pu8 = SunriseSunset_au8 [min<int>(CalcCalendarWeek_u8(Day.year(), Day.month(), Day.day()), 52) - 1];
+  PhotoperiodDay_t Day_st;
+  uint8_t Count_u8 = 0;
+
+  Photoperiod_Compute_v(&Day_st, 0, Row_pu8 [0] * 60 + Row_pu8 [1], Row_pu8 [2] * 60 + Row_pu8 [3], Row_pu8 [4], Row_pu8 [5], Setting_pst);
+
+  if(Photoperiod_MorningMin_u16(&Day_st) > 0)
+  {
+    Event_pu16 [Count_u8] = Day_st.MorningOnMin_u16;
+    Length_pu16 [Count_u8++] = Photoperiod_MorningMin_u16(&Day_st);
+  }
+
+  if(Photoperiod_EveningMin_u16(&Day_st) > 0)
+  {
+    Event_pu16 [Count_u8] = Day_st.SunsetMin_u16;
+    Length_pu16 [Count_u8++] = Photoperiod_EveningMin_u16(&Day_st);
+  }
+
+  return Count_u8;
+}
+//------------------------------
+
+
+//------------------------------
+// main
+//------------------------------
+int main(int argc, char **argv)
+{
+  uint16_t Year_u16 = 2025;
+  PhotoperiodSetting_t Setting_st = {PHOTOPERIOD_TABLE, 50, 30};
+
+  for(int i = 1; i < argc; i++)
+  {
+    if((strcmp(argv [i], "--year") == 0) && (i + 1 < argc)) Year_u16 = strtoul(argv [++i], NULL, 0);
+    else if((strcmp(argv [i], "--photoperiod-min") == 0) && (i + 1 < argc)) Setting_st.TargetMin_u16 = min<uint32_t>(strtoul(argv [++i], NULL, 0), PHOTOPERIOD_MIN_MAX);
+    else if((strcmp(argv [i], "--drift-pct") == 0) && (i + 1 < argc)) DriftPct_f64 = atof(argv [++i]);
+    else if(strcmp(argv [i], "--no-alarm") == 0) AlarmWired_b = false;
+    else if(strcmp(argv [i], "--verbose") == 0) Serial.Enabled_b = true;
+    else
+    {
+      fprintf(stderr, "usage: wakeup_sim [--year YYYY] [--photoperiod-min M] [--no-alarm] [--drift-pct P] [--verbose]\n");
+      return 2;
+    }
+  }
+
+  PowerSave_Init_v(SIM_RTC_INT, SIM_SWITCH);
+
+  DailyPlan_t Previous_st;
+  bool Previous_b = false;
+  uint32_t Days_u32 = 0;
+  uint32_t Mismatch_u32 = 0;
+  uint32_t Missed_u32 = 0;
+  uint32_t Wakeups_u32 = 0;
+  uint32_t Housekeeping_u32 = 0;
+  uint16_t Min_u16 = UINT16_MAX;
+  uint16_t Max_u16 = 0;
+
+  Now_u32 = DateTime(Year_u16, 1, 1).unixtime();
+  uint32_t End_u32 = DateTime(Year_u16 + 1, 1, 1).unixtime();
+
+  while(Now_u32 < End_u32)
+  {
+    uint32_t Midnight_u32 = Now_u32 - Now_u32 % SECONDS_PER_DAY;
+    DateTime Today(Midnight_u32);
+    uint16_t Event_au16 [EVENTS_MAX];
+    uint16_t Length_au16 [EVENTS_MAX];
+    uint8_t Count_u8 = DayPlan_u8(Today, &Setting_st, Event_au16, Length_au16);
+    uint8_t Handled_u8 = 0;
+
+    //first pass of the day: new plan, the firmware moves the count of the day before
+    PowerSave_SetPlan_v((uint32_t)Today.year() * 10000 + Today.month() * 100 + Today.day(), Event_au16, Count_u8);
+
+    if(Previous_b)
+    {
+      uint16_t Expected_u16 = PowerSave_SimulateWakeupsPerDay_u16(&Previous_st, 0);
+      uint16_t Counted_u16 = PowerSaveWakeupsYesterday_u16;
+
+      //boot day: until the first alarm interrupt the timeouts wake early
+      if(Days_u32 == 0)
+      {
+        printf("%u (boot day): %u wake-ups, %u after the first alarm\n", Previous_st.DateKey_u32, Counted_u16, Expected_u16);
+      }
+      else if(AlarmWired_b && (Counted_u16 != Expected_u16))
+      {
+        printf("%u: %u wake-ups, expected %u\n", Previous_st.DateKey_u32, Counted_u16, Expected_u16);
+        Mismatch_u32++;
+      }
+
+      Days_u32++;
+      Wakeups_u32 += Counted_u16;
+      Housekeeping_u32 += PowerSave_SimulateWakeupsPerDay_u16(&Previous_st, POWER_SAVE_HOUSEKEEPING_MIN);
+      Min_u16 = min(Min_u16, Counted_u16);
+      Max_u16 = max(Max_u16, Counted_u16);
+    }
+
+    Previous_st = DailyPlan_st;
+    Previous_b = true;
+
+    //idle path of the light control task
+    while(Now_u32 < Midnight_u32 + SECONDS_PER_DAY)
+    {
+      uint16_t Minute_u16 = (Now_u32 - Midnight_u32) / 60;
+      bool Event_b = false;
+
+      for(uint8_t i = 0; i < Count_u8; i++)
+      {
+        if((Handled_u8 & (1 << i)) == 0)
+        {
+          if(Event_au16 [i] == Minute_u16)
+          {
+            //light window: PWM active, no waits until the task is idle again
+            Handled_u8 |= (1 << i);
+            Now_u32 = Midnight_u32 + (Event_au16 [i] + Length_au16 [i]) * 60UL;
+            Event_b = true;
+            break;
+          }
+
+          if(Event_au16 [i] < Minute_u16)
+          {
+            printf("%u: event %02u:%02u missed (woke at %02u:%02u)\n", Previous_st.DateKey_u32,
+                   Event_au16 [i] / 60, Event_au16 [i] % 60, Minute_u16 / 60, Minute_u16 % 60);
+            Handled_u8 |= (1 << i);
+            Missed_u32++;
+          }
+        }
+      }
+
+      if(Event_b)
+      {
+        continue;
+      }
+
+      PowerSave_WaitForNextEvent_v(DateTime(Now_u32));
+
+      if(GPIO.pin [SIM_RTC_INT].int_type != GPIO_INTR_NEGEDGE)
+      {
+        printf("%u: RTC INT not back to falling edge after the wait\n", Now_u32);
+        PinErrors_u32++;
+      }
+    }
+  }
+
+  bool Ok_b = (Mismatch_u32 == 0) && (PinErrors_u32 == 0) && (!AlarmWired_b || (Missed_u32 == 0));
+
+  printf("plan: %s", (Setting_st.TargetMin_u16 == PHOTOPERIOD_TABLE) ? "dim / hold of the table" : "photoperiod");
+  if(Setting_st.TargetMin_u16 != PHOTOPERIOD_TABLE) printf(" %u min", Setting_st.TargetMin_u16);
+  printf(", alarm %s, slow clock drift %+.1f %%\n", AlarmWired_b ? "wired" : "not wired", DriftPct_f64);
+  printf("days %u: wake-ups per day min %u avg %.2f max %u, %u days differ from the firmware expectation\n",
+         Days_u32, Min_u16, Days_u32 ? (double)Wakeups_u32 / Days_u32 : 0.0, Max_u16, Mismatch_u32);
+  printf("with main task housekeeping every %u min: avg %.2f per day\n", POWER_SAVE_HOUSEKEEPING_MIN,
+         Days_u32 ? (double)Housekeeping_u32 / Days_u32 : 0.0);
+  printf("missed events %u, pin errors %u: %s\n", Missed_u32, PinErrors_u32, Ok_b ? "ok" : "FAILED");
+
+  return Ok_b ? 0 : 1;
+}
+//------------------------------